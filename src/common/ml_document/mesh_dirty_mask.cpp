@@ -0,0 +1,72 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "mesh_dirty_mask.h"
+
+MeshDirtyMask::MeshDirtyMask() :
+	tracked(false), changeMask(0)
+{
+}
+
+/**
+ * @brief Forgets all the tracked changes: the whole mesh will be considered
+ * modified until some components are marked again.
+ */
+void MeshDirtyMask::reset()
+{
+	tracked = false;
+	changeMask = 0;
+}
+
+/**
+ * @brief States that nothing in the mesh has been modified.
+ */
+void MeshDirtyMask::setUnchanged()
+{
+	tracked = true;
+	changeMask = 0;
+}
+
+bool MeshDirtyMask::isTracked() const
+{
+	return tracked;
+}
+
+bool MeshDirtyMask::isUnchanged() const
+{
+	return tracked && changeMask == 0;
+}
+
+int MeshDirtyMask::mask() const
+{
+	return changeMask;
+}
+
+/**
+ * @brief Marks as modified the given components of the mesh.
+ */
+void MeshDirtyMask::mark(int mask)
+{
+	tracked = true;
+	changeMask |= mask;
+}
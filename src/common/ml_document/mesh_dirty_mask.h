@@ -0,0 +1,56 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MESH_DIRTY_MASK_H
+#define MESH_DIRTY_MASK_H
+
+/*
+MeshDirtyMask Class
+Keeps track of the components of a mesh that have been modified (e.g. by a
+filter), as a mask composed of MeshModel::MeshElement.
+
+A tracker that has been reset is not tracked: nothing is known about the
+changes, and the whole mesh must be considered modified. Marking some
+components (or calling setUnchanged) makes the tracker tracked: a filter that
+knows what it modifies calls setUnchanged on every mesh of the document, and
+then marks what it modifies.
+*/
+class MeshDirtyMask
+{
+public:
+	MeshDirtyMask();
+
+	void reset();
+	void setUnchanged();
+	bool isTracked() const;
+	bool isUnchanged() const;
+	int mask() const;
+
+	void mark(int mask);
+
+private:
+	bool tracked;
+	int changeMask;
+};
+
+#endif // MESH_DIRTY_MASK_H
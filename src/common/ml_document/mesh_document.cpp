@@ -23,6 +23,8 @@
 
 #include "mesh_document.h"
 
+#include "../utilities/laplacian_cache.h"
+
 template <class LayerElement>
 QString nameDisambiguator(std::list<LayerElement> &elemList, QString meshLabel)
 {
@@ -78,10 +80,15 @@ MeshDocument::MeshDocument()
 
 MeshDocument::~MeshDocument()
 {
+	for (const MeshModel& m : meshList)
+		meshlab::LaplacianCache::instance().evict(&m);
 }
 
 void MeshDocument::clear()
 {
+	emit meshesAboutToBeModified();
+	for (const MeshModel& m : meshList)
+		meshlab::LaplacianCache::instance().evict(&m);
 	meshList.clear();
 	rasterList.clear();
 
@@ -273,6 +280,8 @@ bool MeshDocument::isBusy()
 
 void MeshDocument::setBusy(bool _busy)
 {
+	if (_busy)
+		emit meshesAboutToBeModified();
 	busy=_busy;
 }
 
@@ -384,6 +393,8 @@ MeshDocument::MeshIterator MeshDocument::eraseMesh(MeshIterator it)
 				setCurrentMesh(this->meshList.front().id());
 		}
 
+		emit meshesAboutToBeModified();
+		meshlab::LaplacianCache::instance().evict(&*it);
 		it = meshList.erase(it);
 
 		emit meshSetChanged();
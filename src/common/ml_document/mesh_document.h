@@ -225,6 +225,9 @@ signals:
 	void meshAdded(int index);
 	void meshRemoved(int index);
 
+	///before the meshes are modified by a processing (see setBusy) or deleted
+	void meshesAboutToBeModified();
+
 	///whenever the rasterList is changed
 	void rasterSetChanged();
 
@@ -81,50 +81,57 @@ QString MeshModel::relativePathName(const QString& path) const
 
 /**
  * @brief Starting from the (still unloaded) textures contained in the contained
- * CMeshO, loads the textures in the map of QImages contained in the MeshModel.
+ * CMeshO, registers the textures in the texture store of the MeshModel.
  *
  * The contained CMeshO will have a list of texture names like "filename.png",
- * and these names will be mapped with the actual loaded image in the map
- * "textures".
+ * and these names will be mapped with the files of the images in the store
+ * "textures". The images are not decoded here: each one is loaded through the
+ * image io plugins the first time it is requested with getTexture, and the
+ * store releases the ones exceeding its memory budget, that will be loaded
+ * again on access.
  *
- * When a texture is not found, a dummy texture will be used (":/img/dummy.png").
+ * When the file of a texture is not found, a dummy texture will be used
+ * (":/img/dummy.png").
  *
  * Returns the list of non-loaded textures that have been modified with
  * ":/img/dummy.png" in the contained mesh.
  */
 std::list<std::string> MeshModel::loadTextures(
 		GLLogStream* log,
-		vcg::CallBackPos* cb)
+		vcg::CallBackPos*)
 {
 	std::list<std::string> unloadedTextures;
 	for (std::string& textName : cm.textures){
-		if (textures.find(textName) == textures.end()){
-			QImage img(":/img/dummy.png");
+		if (!textures.contains(textName)){
 			QFileInfo finfo(QString::fromStdString(textName));
-			try {
-				img = meshlab::loadImage(finfo.absoluteFilePath(), log, cb);
+			QFileInfo mfi(fullName());
+			//could be relative to the meshmodel
+			QFileInfo relInfo(mfi.absolutePath() + "/" + finfo.filePath());
+			if (finfo.exists()){
 				textName = finfo.fileName().toStdString();
-			} catch (const MLException& e) {
-				try { //could be relative to the meshmodel
-					QFileInfo mfi(fullName());
-					QString fn2 = mfi.absolutePath() + "/" + finfo.filePath();
-					img = meshlab::loadImage(fn2, log, cb);
-					textName = finfo.filePath().toStdString();
-				} catch (const MLException& e) {
-					if (log){
-						log->log(
-							GLLogStream::WARNING, "Failed loading " + textName +
-							"; using a dummy texture");
-					}
-					else {
-						std::cerr <<
-							"Failed loading " + textName + "; using a dummy texture\n";
-					}
-					unloadedTextures.push_back(textName);
-					textName = "dummy.png";
+				if (!textures.contains(textName))
+					textures.setImageFile(textName, finfo.absoluteFilePath());
+			}
+			else if (relInfo.exists()){
+				textName = finfo.filePath().toStdString();
+				if (!textures.contains(textName))
+					textures.setImageFile(textName, relInfo.absoluteFilePath());
+			}
+			else {
+				if (log){
+					log->log(
+						GLLogStream::WARNING, "Failed loading " + textName +
+						"; using a dummy texture");
+				}
+				else {
+					std::cerr <<
+						"Failed loading " + textName + "; using a dummy texture\n";
 				}
+				unloadedTextures.push_back(textName);
+				textName = "dummy.png";
+				if (!textures.contains(textName))
+					textures.setImage(textName, QImage(":/img/dummy.png"));
 			}
-			textures[textName] = img;
 		}
 	}
 	return unloadedTextures;
@@ -139,22 +146,21 @@ void MeshModel::saveTextures(
 	for (const std::string& tname : cm.textures){
 		meshlab::saveImage(
 				basePath + "/" + QString::fromStdString(tname),
-				textures.at(tname), quality, log, cb);
+				textures.image(tname), quality, log, cb);
 	}
 }
 
+/**
+ * @brief Returns the texture having the given name, decoding it from its file
+ * if it is the first access or if it has been released by the texture store.
+ * If the file cannot be decoded, a dummy texture is returned.
+ */
 QImage MeshModel::getTexture(const std::string& tn) const
 {
-	auto it = textures.find(tn);
-	if (it != textures.end())
-		return it->second;
-	else
-		return QImage();
-}
-
-const std::map<std::string, QImage>& MeshModel::getTextures() const
-{
-	return textures;
+	QImage img = textures.image(tn);
+	if (img.isNull() && textures.contains(tn))
+		return QImage(":/img/dummy.png");
+	return img;
 }
 
 void MeshModel::clearTextures()
@@ -165,19 +171,18 @@ void MeshModel::clearTextures()
 
 void MeshModel::addTexture(std::string name, const QImage& txt)
 {
-	if (textures.find(name) == textures.end()){
+	if (!textures.contains(name)){
 		// just to be sure to not make duplicates in the contained mesh list of textures
 		if (std::find(cm.textures.begin(), cm.textures.end(), name) == cm.textures.end())
 			cm.textures.push_back(name);
-		textures[name]=txt;
+		textures.setImage(name, txt);
 	}
 }
 
 void MeshModel::setTexture(std::string name, const QImage& txt)
 {
-	auto it = textures.find(name);
-	if (it != textures.end())
-		it->second = txt;
+	if (textures.contains(name))
+		textures.setImage(name, txt);
 }
 
 void MeshModel::changeTextureName(
@@ -185,13 +190,10 @@ void MeshModel::changeTextureName(
 		std::string newName)
 {
 	if (oldName != newName) {
-		auto mit = textures.find(oldName);
 		auto tit = std::find(cm.textures.begin(), cm.textures.end(), oldName);
-		if (mit != textures.end() && tit != cm.textures.end()){
+		if (textures.contains(oldName) && tit != cm.textures.end()){
 			*tit = newName;
-
-			textures[newName] = mit->second;
-			textures.erase(mit);
+			textures.rename(oldName, newName);
 		}
 	}
 }
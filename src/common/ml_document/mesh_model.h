@@ -30,6 +30,8 @@
 #include <map>
 
 #include "cmesh.h"
+#include "mesh_dirty_mask.h"
+#include "texture_store.h"
 #include "../GLLogStream.h"
 #include "../filterscript.h"
 #include "../ml_shared_data_context/ml_plugin_gl_context.h"
@@ -171,7 +173,6 @@ public:
 	void saveTextures(const QString& basePath, int quality = -1, GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr);
 
 	QImage getTexture(const std::string& tn) const;
-	const std::map<std::string, QImage>& getTextures() const;
 	void clearTextures();
 	void addTexture(std::string name, const QImage& txt);
 	void setTexture(std::string name, const QImage& txt);
@@ -199,6 +200,10 @@ public:
 
 	bool meshModified() const;
 	void setMeshModified(bool b = true);
+
+	// components modified by the last filter; see MeshDirtyMask
+	MeshDirtyMask& dirtyMask() { return dirty; }
+	const MeshDirtyMask& dirtyMask() const { return dirty; }
 	static int io2mm(int single_iobit);
 
 	CMeshO cm;
@@ -210,6 +215,7 @@ private:
 	QString _label;
 	int _id;
 	bool modified;
+	MeshDirtyMask dirty;
 
 	//this is an id used for meshes that are loaded from files
 	//that can store more than one mesh. For meshes loaded from
@@ -217,7 +223,7 @@ private:
 	int idInsideFile = -1;
 
 	//textures associated to mesh
-	std::map<std::string, QImage> textures;
+	TextureStore textures;
 };// end class MeshModel
 
 #endif
@@ -0,0 +1,266 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "texture_store.h"
+
+#include <QMutexLocker>
+
+#include "../mlexception.h"
+#include "../utilities/load_save.h"
+
+namespace {
+
+// the image io plugins are not required to be reentrant: the textures
+// loaded again on access are loaded one at a time
+QMutex loadMutex;
+
+} // namespace
+
+// 4GB of decoded textures
+std::size_t TextureStore::defaultBudget = std::size_t(4) << 30;
+
+TextureStore::TextureStore() :
+	decodedBytes(0), useClock(0), budget(defaultBudget)
+{
+}
+
+TextureStore::TextureStore(const TextureStore& oth)
+{
+	QMutexLocker locker(&oth.mutex);
+	entries = oth.entries;
+	decodedBytes = oth.decodedBytes;
+	useClock = oth.useClock;
+	budget = oth.budget;
+}
+
+TextureStore& TextureStore::operator=(const TextureStore& oth)
+{
+	if (this != &oth) {
+		TextureStore tmp(oth);
+		QMutexLocker locker(&mutex);
+		entries = std::move(tmp.entries);
+		decodedBytes = tmp.decodedBytes;
+		useClock = tmp.useClock;
+		budget = tmp.budget;
+	}
+	return *this;
+}
+
+std::size_t TextureStore::defaultMemoryBudget()
+{
+	return defaultBudget;
+}
+
+/**
+ * @brief Sets the memory budget of the stores that will be created from now on.
+ */
+void TextureStore::setDefaultMemoryBudget(std::size_t bytes)
+{
+	defaultBudget = bytes;
+}
+
+std::size_t TextureStore::memoryBudget() const
+{
+	QMutexLocker locker(&mutex);
+	return budget;
+}
+
+void TextureStore::setMemoryBudget(std::size_t bytes)
+{
+	QMutexLocker locker(&mutex);
+	budget = bytes;
+	evict(std::string());
+}
+
+/**
+ * @brief Returns the memory currently used by the decoded images.
+ * Images that have no file are always counted, therefore the returned value
+ * can be greater than the memory budget.
+ */
+std::size_t TextureStore::decodedMemory() const
+{
+	QMutexLocker locker(&mutex);
+	return decodedBytes;
+}
+
+bool TextureStore::contains(const std::string& name) const
+{
+	QMutexLocker locker(&mutex);
+	return entries.find(name) != entries.end();
+}
+
+std::size_t TextureStore::size() const
+{
+	QMutexLocker locker(&mutex);
+	return entries.size();
+}
+
+std::list<std::string> TextureStore::names() const
+{
+	QMutexLocker locker(&mutex);
+	std::list<std::string> res;
+	for (const auto& p : entries)
+		res.push_back(p.first);
+	return res;
+}
+
+/**
+ * @brief Returns the image having the given name, loading it again from its
+ * file if it has been released. Returns a null image if there is no texture
+ * with the given name or if its file cannot be loaded anymore.
+ *
+ * Loading is done without holding the lock of the store.
+ */
+QImage TextureStore::image(const std::string& name) const
+{
+	QString fileName;
+	{
+		QMutexLocker locker(&mutex);
+		auto it = entries.find(name);
+		if (it == entries.end())
+			return QImage();
+		it->second.lastUse = ++useClock;
+		if (!it->second.image.isNull() || it->second.fileName.isEmpty())
+			return it->second.image;
+		fileName = it->second.fileName;
+	}
+
+	QImage img;
+	{
+		QMutexLocker locker(&loadMutex);
+		try {
+			img = meshlab::loadImage(fileName);
+		}
+		catch (const MLException&) {
+			return QImage();
+		}
+	}
+	storeDecoded(name, fileName, img);
+	return img;
+}
+
+/**
+ * @brief Sets (or replaces) the texture having the given name with a decoded
+ * image; the image will be kept in memory until it is replaced or erased.
+ */
+void TextureStore::setImage(const std::string& name, const QImage& img)
+{
+	QMutexLocker locker(&mutex);
+	Entry& e = entries[name];
+	decodedBytes -= imageBytes(e.image);
+	e.fileName.clear();
+	e.image = img;
+	e.lastUse = ++useClock;
+	decodedBytes += imageBytes(e.image);
+	evict(name);
+}
+
+/**
+ * @brief Sets (or replaces) the texture having the given name with the image
+ * contained in fileName. The image is decoded the first time it is accessed;
+ * it can be released when the memory budget is exceeded, and it will be
+ * loaded again from the file on the next access.
+ */
+void TextureStore::setImageFile(const std::string& name, const QString& fileName)
+{
+	QMutexLocker locker(&mutex);
+	Entry& e = entries[name];
+	decodedBytes -= imageBytes(e.image);
+	e.fileName = fileName;
+	e.image = QImage();
+	e.lastUse = ++useClock;
+}
+
+bool TextureStore::rename(const std::string& oldName, const std::string& newName)
+{
+	QMutexLocker locker(&mutex);
+	auto it = entries.find(oldName);
+	if (it == entries.end() || oldName == newName)
+		return false;
+	auto nit = entries.find(newName);
+	if (nit != entries.end()) {
+		decodedBytes -= imageBytes(nit->second.image);
+		entries.erase(nit);
+	}
+	Entry e = std::move(it->second);
+	entries.erase(it);
+	entries[newName] = std::move(e);
+	return true;
+}
+
+void TextureStore::erase(const std::string& name)
+{
+	QMutexLocker locker(&mutex);
+	auto it = entries.find(name);
+	if (it != entries.end()) {
+		decodedBytes -= imageBytes(it->second.image);
+		entries.erase(it);
+	}
+}
+
+void TextureStore::clear()
+{
+	QMutexLocker locker(&mutex);
+	entries.clear();
+	decodedBytes = 0;
+}
+
+std::size_t TextureStore::imageBytes(const QImage& img)
+{
+	return img.isNull() ? 0 : std::size_t(img.sizeInBytes());
+}
+
+/**
+ * Stores the image loaded from fileName, if in the meantime the texture has
+ * not been replaced or loaded by another thread.
+ */
+void TextureStore::storeDecoded(const std::string& name, const QString& fileName, const QImage& img) const
+{
+	QMutexLocker locker(&mutex);
+	auto it = entries.find(name);
+	if (it == entries.end() || !it->second.image.isNull() || it->second.fileName != fileName)
+		return;
+	it->second.image = img;
+	decodedBytes += imageBytes(img);
+	evict(name);
+}
+
+/**
+ * Releases the least recently used decoded images that have a file, until the memory budget is satisfied. The image called keep
+ * is never released. Must be called with the lock held.
+ */
+void TextureStore::evict(const std::string& keep) const
+{
+	while (decodedBytes > budget) {
+		auto lru = entries.end();
+		for (auto it = entries.begin(); it != entries.end(); ++it) {
+			if (it->first != keep && !it->second.image.isNull() && !it->second.fileName.isEmpty() &&
+				(lru == entries.end() || it->second.lastUse < lru->second.lastUse))
+				lru = it;
+		}
+		if (lru == entries.end())
+			return;
+		decodedBytes -= imageBytes(lru->second.image);
+		lru->second.image = QImage();
+	}
+}
@@ -0,0 +1,96 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* Visual and Computer Graphics Library                            o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2004-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef TEXTURE_STORE_H
+#define TEXTURE_STORE_H
+
+#include <list>
+#include <map>
+#include <string>
+
+#include <QImage>
+#include <QMutex>
+#include <QString>
+
+/*
+TextureStore Class
+The set of named textures of a MeshModel.
+
+Textures coming from a file remember the file they are loaded from, and are
+decoded (through the image io plugins) only when they are accessed.
+Decoded images count against a memory budget: when the budget is exceeded,
+the least recently used decoded images that can be loaded again from their
+file are released, and they are loaded again when they are accessed.
+Images set without a file (e.g. generated or modified by a filter) are always
+kept in memory.
+
+All the member functions are thread safe.
+*/
+class TextureStore
+{
+public:
+	TextureStore();
+	TextureStore(const TextureStore& oth);
+	TextureStore& operator=(const TextureStore& oth);
+
+	static std::size_t defaultMemoryBudget();
+	static void setDefaultMemoryBudget(std::size_t bytes);
+
+	std::size_t memoryBudget() const;
+	void setMemoryBudget(std::size_t bytes);
+	std::size_t decodedMemory() const;
+
+	bool contains(const std::string& name) const;
+	std::size_t size() const;
+	std::list<std::string> names() const;
+
+	QImage image(const std::string& name) const;
+
+	void setImage(const std::string& name, const QImage& img);
+	void setImageFile(const std::string& name, const QString& fileName);
+	bool rename(const std::string& oldName, const std::string& newName);
+	void erase(const std::string& name);
+	void clear();
+
+private:
+	struct Entry
+	{
+		QString fileName; // empty if the image cannot be loaded again from a file
+		QImage  image;    // decoded image, null if not resident
+		unsigned long long lastUse = 0;
+	};
+
+	static std::size_t imageBytes(const QImage& img);
+	void storeDecoded(const std::string& name, const QString& fileName, const QImage& img) const;
+	void evict(const std::string& keep) const;
+
+	mutable QMutex mutex;
+	mutable std::map<std::string, Entry> entries;
+	mutable std::size_t decodedBytes;
+	mutable unsigned long long useClock;
+	std::size_t budget;
+
+	static std::size_t defaultBudget;
+};
+
+#endif // TEXTURE_STORE_H
@@ -0,0 +1,522 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "ml_mesh_lod.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <unordered_map>
+
+// resolution (cells along the longest side of the bbox) of the coarsest level
+static const int lodBaseResolution = 32;
+static const int lodMaxLevels = 8;
+static const int lodMaxResolution = 4096;
+
+/**
+ * @brief Starts building the hierarchy in background. The background thread
+ * takes a snapshot of the mesh first: the mesh must not be modified until
+ * waitForSnapshot returns.
+ */
+MLMeshLOD::MLMeshLOD(const CMeshO& m, bool useVertexColor) :
+	mesh(&m), snapshotTaken(false), color(useVertexColor), ready(false), cancelled(false)
+{
+	builder = std::thread(&MLMeshLOD::build, this);
+}
+
+/**
+ * @brief Stops the construction of the hierarchy, if still running.
+ * The GL buffers must have already been released with releaseGL.
+ */
+MLMeshLOD::~MLMeshLOD()
+{
+	cancelled = true;
+	if (builder.joinable())
+		builder.join();
+}
+
+/**
+ * @brief Waits until the background thread has taken the snapshot of the
+ * mesh (or has been cancelled); afterwards the mesh can be modified or deleted.
+ */
+void MLMeshLOD::waitForSnapshot()
+{
+	std::unique_lock<std::mutex> lock(snapshotMutex);
+	snapshotTakenCond.wait(lock, [this] { return snapshotTaken; });
+}
+
+/**
+ * @brief Returns true when the hierarchy has been built and the proxy can be
+ * drawn.
+ */
+bool MLMeshLOD::isReady() const
+{
+	return ready;
+}
+
+bool MLMeshLOD::hasColor() const
+{
+	return color;
+}
+
+/**
+ * @brief Draws the proxy, using the modelview, projection and viewport
+ * currently set in the GL context, and returns the number of primitives
+ * drawn (triangles, or points).
+ *
+ * The level of each chunk is chosen such that its error, projected on screen,
+ * is less than pixelTolerance; if the primitives of the resulting cut exceed
+ * primitiveBudget, the tolerance is doubled (up to 8 times).
+ * If points is true, only the vertices of the chosen levels are drawn.
+ * The buffers of a chunk are allocated the first time it is drawn.
+ */
+size_t MLMeshLOD::draw(bool points, bool useColor, float pixelTolerance, size_t primitiveBudget)
+{
+	if (!ready || levels.empty())
+		return 0;
+
+	GLfloat mv[16], pr[16];
+	GLint vp[4];
+	glGetFloatv(GL_MODELVIEW_MATRIX, mv);
+	glGetFloatv(GL_PROJECTION_MATRIX, pr);
+	glGetIntegerv(GL_VIEWPORT, vp);
+
+	// clip = pr * mv (column major); its rows give the frustum planes
+	float clip[16];
+	for (int c = 0; c < 4; ++c)
+		for (int r = 0; r < 4; ++r)
+			clip[c * 4 + r] =
+				pr[0 * 4 + r] * mv[c * 4 + 0] + pr[1 * 4 + r] * mv[c * 4 + 1] +
+				pr[2 * 4 + r] * mv[c * 4 + 2] + pr[3 * 4 + r] * mv[c * 4 + 3];
+	float planes[6][4];
+	for (int i = 0; i < 3; ++i) {
+		for (int k = 0; k < 4; ++k) {
+			planes[2 * i + 0][k] = clip[k * 4 + 3] + clip[k * 4 + i];
+			planes[2 * i + 1][k] = clip[k * 4 + 3] - clip[k * 4 + i];
+		}
+	}
+
+	const bool perspective = pr[15] == 0;
+	const float scale = std::sqrt(mv[0] * mv[0] + mv[1] * mv[1] + mv[2] * mv[2]);
+	const float pixelsPerUnit = pr[5] * vp[3] * 0.5f * scale;
+
+	// visible chunks, and the minimum distance from the viewer of their box
+	std::vector<unsigned int> visible;
+	std::vector<float> distance;
+	for (unsigned int c = 0; c < chunkBoxes.size(); ++c) {
+		const vcg::Box3f& b = chunkBoxes[c];
+		if (b.IsNull())
+			continue;
+		bool outside = false;
+		for (int i = 0; i < 6 && !outside; ++i) {
+			const float* pl = planes[i];
+			float px = pl[0] >= 0 ? b.max[0] : b.min[0];
+			float py = pl[1] >= 0 ? b.max[1] : b.min[1];
+			float pz = pl[2] >= 0 ? b.max[2] : b.min[2];
+			outside = pl[0] * px + pl[1] * py + pl[2] * pz + pl[3] < 0;
+		}
+		if (outside)
+			continue;
+		vcg::Point3f cen = b.Center();
+		float z = -(mv[2] * cen[0] + mv[6] * cen[1] + mv[10] * cen[2] + mv[14]);
+		visible.push_back(c);
+		distance.push_back(z - b.Diag() * 0.5f * scale);
+	}
+
+	std::vector<unsigned int> selected(visible.size());
+	float tolerance = std::max(pixelTolerance, 0.1f);
+	for (int attempt = 0; attempt < 8; ++attempt) {
+		size_t total = 0;
+		for (unsigned int i = 0; i < visible.size(); ++i) {
+			unsigned int l = 0;
+			if (!perspective || distance[i] > 0) {
+				float ppu = perspective ? pixelsPerUnit / distance[i] : pixelsPerUnit;
+				while (l + 1 < levels.size() && levels[l].error * ppu > tolerance)
+					++l;
+			}
+			else {
+				l = (unsigned int) levels.size() - 1;
+			}
+			selected[i] = l;
+			total += levels[l].chunks[visible[i]].primitiveNumber();
+		}
+		if (total <= primitiveBudget)
+			break;
+		tolerance *= 2;
+	}
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+	if (useColor && color)
+		glEnableClientState(GL_COLOR_ARRAY);
+
+	size_t drawn = 0;
+	for (unsigned int i = 0; i < visible.size(); ++i) {
+		Chunk& ch = levels[selected[i]].chunks[visible[i]];
+		if (ch.positions.empty())
+			continue;
+		if (ch.bo[0] == 0) {
+			glGenBuffers(4, ch.bo);
+			glBindBuffer(GL_ARRAY_BUFFER, ch.bo[0]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vcg::Point3f) * ch.positions.size(), ch.positions.data(), GL_STATIC_DRAW);
+			glBindBuffer(GL_ARRAY_BUFFER, ch.bo[1]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(vcg::Point3f) * ch.normals.size(), ch.normals.data(), GL_STATIC_DRAW);
+			if (color) {
+				glBindBuffer(GL_ARRAY_BUFFER, ch.bo[2]);
+				glBufferData(GL_ARRAY_BUFFER, sizeof(vcg::Color4b) * ch.colors.size(), ch.colors.data(), GL_STATIC_DRAW);
+			}
+			if (!ch.indices.empty()) {
+				glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ch.bo[3]);
+				glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(GLuint) * ch.indices.size(), ch.indices.data(), GL_STATIC_DRAW);
+			}
+		}
+
+		glBindBuffer(GL_ARRAY_BUFFER, ch.bo[0]);
+		glVertexPointer(3, GL_FLOAT, 0, 0);
+		glBindBuffer(GL_ARRAY_BUFFER, ch.bo[1]);
+		glNormalPointer(GL_FLOAT, 0, 0);
+		if (useColor && color) {
+			glBindBuffer(GL_ARRAY_BUFFER, ch.bo[2]);
+			glColorPointer(4, GL_UNSIGNED_BYTE, 0, 0);
+		}
+		if (points || ch.indices.empty()) {
+			glDrawArrays(GL_POINTS, 0, GLsizei(ch.positions.size()));
+			drawn += ch.positions.size();
+		}
+		else {
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ch.bo[3]);
+			glDrawElements(GL_TRIANGLES, GLsizei(ch.indices.size()), GL_UNSIGNED_INT, 0);
+			drawn += ch.indices.size() / 3;
+		}
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	glDisableClientState(GL_VERTEX_ARRAY);
+	glDisableClientState(GL_NORMAL_ARRAY);
+	glDisableClientState(GL_COLOR_ARRAY);
+	return drawn;
+}
+
+/**
+ * @brief Releases the GL buffers of the chunks; they will be allocated again
+ * if the proxy is drawn. Must be called with the GL context current.
+ */
+void MLMeshLOD::releaseGL()
+{
+	for (Level& l : levels) {
+		for (Chunk& ch : l.chunks) {
+			if (ch.bo[0] != 0) {
+				glDeleteBuffers(4, ch.bo);
+				std::fill(ch.bo, ch.bo + 4, 0);
+			}
+		}
+	}
+}
+
+size_t MLMeshLOD::Chunk::primitiveNumber() const
+{
+	return indices.empty() ? positions.size() : indices.size() / 3;
+}
+
+size_t MLMeshLOD::Clustering::primitiveNumber() const
+{
+	return triangles.empty() ? positions.size() : triangles.size() / 3;
+}
+
+/**
+ * Takes the snapshot of the mesh, then builds the levels from the coarsest
+ * one, halving the cell size each time, until a level has more than a quarter
+ * of the primitives of the mesh.
+ * Runs in the builder thread.
+ */
+void MLMeshLOD::build()
+{
+	bool taken = takeSnapshot(*mesh);
+	{
+		std::lock_guard<std::mutex> lock(snapshotMutex);
+		mesh = nullptr;
+		snapshotTaken = true;
+	}
+	snapshotTakenCond.notify_all();
+	if (!taken)
+		return;
+
+	const size_t meshPrimitives = faces.empty() ? vertices.size() : faces.size() / 3;
+	const float longestSide = bbox.IsNull() ? 0 : bbox.Dim()[bbox.MaxDim()];
+
+	if (longestSide > 0) {
+		for (int l = 0, res = lodBaseResolution; l < lodMaxLevels && res <= lodMaxResolution; ++l, res *= 2) {
+			float cellSize = longestSide / res;
+			Clustering cl;
+			if (!clusterMesh(cellSize, cl))
+				return;
+			levels.emplace_back();
+			if (!splitInChunks(cl, cellSize * std::sqrt(3.f), levels.back()))
+				return;
+			if (cl.primitiveNumber() * 4 > meshPrimitives)
+				break;
+		}
+	}
+
+	chunkBoxes.assign(chunkGridSize * chunkGridSize * chunkGridSize, vcg::Box3f());
+	for (const Level& l : levels)
+		for (unsigned int c = 0; c < l.chunks.size(); ++c)
+			chunkBoxes[c].Add(l.chunks[c].box);
+
+	// the snapshot is not needed anymore
+	std::vector<vcg::Point3f>().swap(vertices);
+	std::vector<vcg::Point3f>().swap(vertexNormals);
+	std::vector<vcg::Color4b>().swap(vertexColors);
+	std::vector<GLuint>().swap(faces);
+
+	ready = true;
+}
+
+/**
+ * Copies the (non deleted) elements of the mesh.
+ * Per vertex normals are taken from the mesh only for point clouds; for meshes
+ * they are recomputed on each level.
+ * Returns false if the construction has been cancelled.
+ */
+bool MLMeshLOD::takeSnapshot(const CMeshO& m)
+{
+	std::vector<GLuint> remap(m.vert.size(), GLuint(-1));
+	vertices.reserve(m.vn);
+	if (color)
+		vertexColors.reserve(m.vn);
+	if (m.fn == 0)
+		vertexNormals.reserve(m.vn);
+	for (size_t i = 0; i < m.vert.size(); ++i) {
+		if ((i & 0xFFFF) == 0 && cancelled)
+			return false;
+		const CVertexO& v = m.vert[i];
+		if (v.IsD())
+			continue;
+		remap[i] = GLuint(vertices.size());
+		vertices.push_back(vcg::Point3f::Construct(v.cP()));
+		bbox.Add(vertices.back());
+		if (color)
+			vertexColors.push_back(v.cC());
+		if (m.fn == 0)
+			vertexNormals.push_back(vcg::Point3f::Construct(v.cN()).Normalize());
+	}
+	faces.reserve(size_t(m.fn) * 3);
+	for (size_t i = 0; i < m.face.size(); ++i) {
+		if ((i & 0xFFFF) == 0 && cancelled)
+			return false;
+		const CFaceO& f = m.face[i];
+		if (f.IsD())
+			continue;
+		for (int j = 0; j < 3; ++j)
+			faces.push_back(remap[vcg::tri::Index(m, f.cV(j))]);
+	}
+	return true;
+}
+
+/**
+ * Vertex clustering of the snapshot on a uniform grid having the given cell
+ * size: each cluster is placed in the average of its vertices, and triangles
+ * that collapse or that are duplicated are removed.
+ * Returns false if the construction has been cancelled.
+ */
+bool MLMeshLOD::clusterMesh(float cellSize, Clustering& cl) const
+{
+	std::unordered_map<unsigned long long, GLuint> cellToCluster;
+	std::vector<GLuint> vertToCluster(vertices.size());
+	std::vector<vcg::Point3d> posSum;
+	std::vector<vcg::Point3f> normSum;
+	std::vector<std::array<unsigned long long, 4>> colSum;
+	std::vector<unsigned int> count;
+
+	for (size_t i = 0; i < vertices.size(); ++i) {
+		if ((i & 0xFFFF) == 0 && cancelled)
+			return false;
+		auto ins = cellToCluster.insert(std::make_pair(cellKey(vertices[i], cellSize), GLuint(count.size())));
+		GLuint c = ins.first->second;
+		if (ins.second) {
+			posSum.push_back(vcg::Point3d(0, 0, 0));
+			count.push_back(0);
+			if (color)
+				colSum.push_back({{0, 0, 0, 0}});
+			if (faces.empty())
+				normSum.push_back(vcg::Point3f(0, 0, 0));
+		}
+		vertToCluster[i] = c;
+		posSum[c] += vcg::Point3d::Construct(vertices[i]);
+		++count[c];
+		if (color)
+			for (int k = 0; k < 4; ++k)
+				colSum[c][k] += vertexColors[i][k];
+		if (faces.empty())
+			normSum[c] += vertexNormals[i];
+	}
+
+	cl.positions.resize(count.size());
+	if (color)
+		cl.colors.resize(count.size());
+	for (size_t c = 0; c < count.size(); ++c) {
+		cl.positions[c] = vcg::Point3f::Construct(posSum[c] / double(count[c]));
+		if (color)
+			for (int k = 0; k < 4; ++k)
+				cl.colors[c][k] = (unsigned char) (colSum[c][k] / count[c]);
+	}
+
+	if (faces.empty()) {
+		cl.normals.resize(count.size());
+		for (size_t c = 0; c < count.size(); ++c)
+			cl.normals[c] = normSum[c].Normalize();
+		return true;
+	}
+
+	// the smallest index is rotated first (keeping the orientation), so that
+	// duplicated triangles can be found by sorting
+	std::vector<std::array<GLuint, 3>> tris;
+	tris.reserve(faces.size() / 3);
+	for (size_t f = 0; f < faces.size(); f += 3) {
+		if ((f & 0xFFFF) == 0 && cancelled)
+			return false;
+		std::array<GLuint, 3> t = {{vertToCluster[faces[f]], vertToCluster[faces[f + 1]], vertToCluster[faces[f + 2]]}};
+		if (t[0] == t[1] || t[1] == t[2] || t[2] == t[0])
+			continue;
+		std::rotate(t.begin(), std::min_element(t.begin(), t.end()), t.end());
+		tris.push_back(t);
+	}
+	if (cancelled)
+		return false;
+	std::sort(tris.begin(), tris.end());
+	if (cancelled)
+		return false;
+	tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+
+	cl.triangles.reserve(tris.size() * 3);
+	for (const std::array<GLuint, 3>& t : tris)
+		cl.triangles.insert(cl.triangles.end(), t.begin(), t.end());
+	return computeNormals(cl);
+}
+
+/**
+ * Area weighted per vertex normals of the triangles of the clustering.
+ * Returns false if the construction has been cancelled.
+ */
+bool MLMeshLOD::computeNormals(Clustering& cl) const
+{
+	cl.normals.assign(cl.positions.size(), vcg::Point3f(0, 0, 0));
+	for (size_t f = 0; f < cl.triangles.size(); f += 3) {
+		if ((f & 0xFFFF) == 0 && cancelled)
+			return false;
+		const GLuint* t = &cl.triangles[f];
+		vcg::Point3f n =
+			(cl.positions[t[1]] - cl.positions[t[0]]) ^ (cl.positions[t[2]] - cl.positions[t[0]]);
+		for (int k = 0; k < 3; ++k)
+			cl.normals[t[k]] += n;
+	}
+	for (vcg::Point3f& n : cl.normals)
+		n.Normalize();
+	return !cancelled;
+}
+
+/**
+ * Splits a clustering in the chunks of the level: each triangle goes in the
+ * chunk that contains its first vertex (each point in the chunk that contains
+ * it), and vertices shared between chunks are duplicated.
+ * Returns false if the construction has been cancelled.
+ */
+bool MLMeshLOD::splitInChunks(const Clustering& cl, float error, Level& level) const
+{
+	level.error = error;
+	level.chunks.resize(chunkGridSize * chunkGridSize * chunkGridSize);
+
+	if (cl.triangles.empty()) {
+		for (size_t v = 0; v < cl.positions.size(); ++v) {
+			if ((v & 0xFFFF) == 0 && cancelled)
+				return false;
+			Chunk& ch = level.chunks[chunkIndex(cl.positions[v])];
+			ch.positions.push_back(cl.positions[v]);
+			ch.normals.push_back(cl.normals[v]);
+			if (color)
+				ch.colors.push_back(cl.colors[v]);
+			ch.box.Add(cl.positions[v]);
+		}
+		return true;
+	}
+
+	std::vector<std::vector<GLuint>> buckets(level.chunks.size());
+	for (size_t f = 0; f < cl.triangles.size(); f += 3) {
+		if ((f & 0xFFFF) == 0 && cancelled)
+			return false;
+		buckets[chunkIndex(cl.positions[cl.triangles[f]])].push_back(GLuint(f));
+	}
+
+	// stamp[v] == c + 1 if v has already been added to chunk c, as localIndex[v]
+	std::vector<unsigned int> stamp(cl.positions.size(), 0);
+	std::vector<GLuint> localIndex(cl.positions.size());
+	for (unsigned int c = 0; c < buckets.size(); ++c) {
+		if (cancelled)
+			return false;
+		Chunk& ch = level.chunks[c];
+		ch.indices.reserve(buckets[c].size() * 3);
+		for (GLuint f : buckets[c]) {
+			for (int k = 0; k < 3; ++k) {
+				GLuint v = cl.triangles[f + k];
+				if (stamp[v] != c + 1) {
+					stamp[v] = c + 1;
+					localIndex[v] = GLuint(ch.positions.size());
+					ch.positions.push_back(cl.positions[v]);
+					ch.normals.push_back(cl.normals[v]);
+					if (color)
+						ch.colors.push_back(cl.colors[v]);
+					ch.box.Add(cl.positions[v]);
+				}
+				ch.indices.push_back(localIndex[v]);
+			}
+		}
+	}
+	return true;
+}
+
+/**
+ * Key of the grid cell containing p; 21 bits per coordinate.
+ */
+unsigned long long MLMeshLOD::cellKey(const vcg::Point3f& p, float cellSize) const
+{
+	unsigned long long key = 0;
+	for (int k = 0; k < 3; ++k) {
+		long long i = (long long) std::floor((p[k] - bbox.min[k]) / cellSize);
+		i = std::min(std::max(i, 0LL), (1LL << 21) - 1);
+		key = (key << 21) | (unsigned long long) i;
+	}
+	return key;
+}
+
+unsigned int MLMeshLOD::chunkIndex(const vcg::Point3f& p) const
+{
+	unsigned int idx = 0;
+	for (int k = 0; k < 3; ++k) {
+		float dim = bbox.Dim()[k];
+		int i = dim > 0 ? int((p[k] - bbox.min[k]) / dim * chunkGridSize) : 0;
+		i = std::min(std::max(i, 0), chunkGridSize - 1);
+		idx = idx * chunkGridSize + i;
+	}
+	return idx;
+}
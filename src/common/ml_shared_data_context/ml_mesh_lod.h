@@ -0,0 +1,132 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef ML_MESH_LOD_H
+#define ML_MESH_LOD_H
+
+#include <GL/glew.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "../ml_document/cmesh.h"
+
+/**
+ * @brief The MLMeshLOD class is a view-dependent level of detail proxy of a
+ * mesh, used to render very large meshes while the view is changing.
+ *
+ * The proxy is a hierarchy of levels obtained by vertex clustering on nested
+ * uniform grids (each level has cells of half the size of the previous one),
+ * and every level is split in the same set of spatial chunks.
+ * When drawing, each chunk is culled against the view frustum and rendered
+ * at the coarsest level whose geometric error, projected on the screen, is
+ * below a given tolerance. The tolerance is relaxed until the primitives of
+ * the cut fit in the given budget.
+ * Point clouds are clustered in the same way, and rendered as points.
+ *
+ * The hierarchy is built in a background thread, starting from a compact
+ * snapshot of the mesh taken by the same thread: the mesh must not be
+ * modified or deleted until waitForSnapshot returns (or the proxy is
+ * deleted), afterwards it is not accessed anymore.
+ * Apart from the constructor and waitForSnapshot, all the member functions
+ * must be called from the thread that renders, with a GL context current.
+ */
+class MLMeshLOD
+{
+public:
+	MLMeshLOD(const CMeshO& m, bool useVertexColor);
+	~MLMeshLOD();
+
+	void waitForSnapshot();
+	bool isReady() const;
+	bool hasColor() const;
+
+	size_t draw(bool points, bool useColor, float pixelTolerance, size_t primitiveBudget);
+	void releaseGL();
+
+private:
+	struct Chunk
+	{
+		vcg::Box3f                box;
+		std::vector<vcg::Point3f> positions;
+		std::vector<vcg::Point3f> normals;
+		std::vector<vcg::Color4b> colors;
+		std::vector<GLuint>       indices; // empty for point clouds
+		GLuint                    bo[4] = {0, 0, 0, 0};
+
+		size_t primitiveNumber() const;
+	};
+
+	struct Level
+	{
+		float              error; // size of the clustering cells
+		std::vector<Chunk> chunks;
+	};
+
+	// a level of the hierarchy before it is split in chunks
+	struct Clustering
+	{
+		std::vector<vcg::Point3f> positions;
+		std::vector<vcg::Point3f> normals;
+		std::vector<vcg::Color4b> colors;
+		std::vector<GLuint>       triangles;
+
+		size_t primitiveNumber() const;
+	};
+
+	void build();
+	bool takeSnapshot(const CMeshO& m);
+	bool clusterMesh(float cellSize, Clustering& cl) const;
+	bool computeNormals(Clustering& cl) const;
+	bool splitInChunks(const Clustering& cl, float error, Level& level) const;
+	unsigned long long cellKey(const vcg::Point3f& p, float cellSize) const;
+	unsigned int chunkIndex(const vcg::Point3f& p) const;
+
+	// the mesh, until the snapshot has been taken
+	const CMeshO*           mesh;
+	bool                    snapshotTaken;
+	std::mutex              snapshotMutex;
+	std::condition_variable snapshotTakenCond;
+
+	// snapshot of the mesh, released when the hierarchy is built
+	std::vector<vcg::Point3f> vertices;
+	std::vector<vcg::Point3f> vertexNormals;
+	std::vector<vcg::Color4b> vertexColors;
+	std::vector<GLuint>       faces;
+
+	vcg::Box3f               bbox;
+	bool                     color;
+	std::vector<Level>       levels; // from the coarsest to the finest
+	std::vector<vcg::Box3f>  chunkBoxes;
+
+	std::atomic<bool> ready;
+	std::atomic<bool> cancelled;
+	std::thread       builder;
+
+	static const int chunkGridSize = 8;
+};
+
+#endif // ML_MESH_LOD_H
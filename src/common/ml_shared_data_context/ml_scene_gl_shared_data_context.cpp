@@ -27,12 +27,13 @@
 
 
 MLSceneGLSharedDataContext::MLSceneGLSharedDataContext(MeshDocument& md,vcg::QtThreadSafeMemoryInfo& gpumeminfo,bool highprecision,size_t perbatchtriangles, size_t minfacespersmoothrendering)
-	:QGLWidget(),_md(md),_gpumeminfo(gpumeminfo),_perbatchtriangles(perbatchtriangles), _minfacessmoothrendering(minfacespersmoothrendering),_highprecision(highprecision),_timer(this)
+	:QGLWidget(),_md(md),_gpumeminfo(gpumeminfo),_perbatchtriangles(perbatchtriangles), _minfacessmoothrendering(minfacespersmoothrendering),_highprecision(highprecision),_timer(this),_lodenabled(false),_lodminprimitives(0)
 {
 	//if (md.size() != 0)
 	//    throw MLException(QString("MLSceneGLSharedDataContext: MeshDocument is not empty when MLSceneGLSharedDataContext is constructed."));
 
 	connect(&_timer,SIGNAL(timeout()),this,SLOT(updateGPUMemInfo()));
+	connect(&_md,SIGNAL(meshesAboutToBeModified()),this,SLOT(waitForLODSnapshots()),Qt::DirectConnection);
 
 	/*connection intended for the plugins living in another thread*/
 	connect(this,SIGNAL(initPerMeshViewRequestMT(int,QGLContext*,const MLRenderingData&)),this,SLOT(initPerMeshViewRequested(int,QGLContext*,const MLRenderingData&)),Qt::BlockingQueuedConnection);
@@ -67,6 +68,8 @@ MLSceneGLSharedDataContext::~MLSceneGLSharedDataContext()
 {
 	for (auto& p : _meshboman)
 		delete p.second;
+	for (auto& p : _meshlod)
+		delete p.second;
 }
 
 void MLSceneGLSharedDataContext::setMinFacesForSmoothRendering(size_t fcnum)
@@ -228,6 +231,7 @@ void MLSceneGLSharedDataContext::meshInserted( int mmid )
 
 void MLSceneGLSharedDataContext::meshRemoved(int mmid)
 {
+	invalidateLOD(mmid);
 	MeshIDManMap::iterator it = _meshboman.find(mmid);
 	if (it == _meshboman.end())
 		return;
@@ -269,6 +273,76 @@ void MLSceneGLSharedDataContext::draw( int mmid,QGLContext* viewid ) const
 		man->draw(viewid);
 }
 
+/*
+ * Draws the level of detail proxy of the mesh, if available, following the
+ * primitive modality and the colors chosen for the given view.
+ * Returns false (and does nothing) if the proxy is not ready, or if the view
+ * does not render the mesh as solid or as points.
+ */
+bool MLSceneGLSharedDataContext::drawLOD(int mmid, QGLContext* viewid, float pixeltolerance, size_t primitivebudget, size_t& drawnprimitives)
+{
+	drawnprimitives = 0;
+	MeshModel* mm = _md.getMesh(mmid);
+	auto it = _meshlod.find(mmid);
+	if ((mm == NULL) || (it == _meshlod.end()) || !it->second->isReady())
+		return false;
+
+	MLRenderingData dt;
+	getRenderInfoPerMeshView(mmid, viewid, dt);
+	MLRenderingData::RendAtts atts;
+	bool points = false;
+	if (!dt.get(MLRenderingData::PR_SOLID, atts))
+	{
+		if (!dt.get(MLRenderingData::PR_POINTS, atts))
+			return false;
+		points = true;
+	}
+	MLPerViewGLOptions opts;
+	dt.get(opts);
+
+	bool usecolor = atts[MLRenderingData::ATT_NAMES::ATT_VERTCOLOR] && it->second->hasColor();
+	vcg::Color4b col(vcg::Color4b::LightGray);
+	if (points && opts._perpoint_fixed_color_enabled)
+		col = opts._perpoint_fixed_color;
+	else if (!points && opts._persolid_fixed_color_enabled)
+		col = opts._persolid_fixed_color;
+
+	glPushAttrib(GL_ALL_ATTRIB_BITS);
+	glPushMatrix();
+	glMultMatrix(mm->cm.Tr);
+	glEnable(GL_COLOR_MATERIAL);
+	if ((points && opts._perpoint_noshading) || (!points && opts._persolid_noshading))
+		glDisable(GL_LIGHTING);
+	else
+		glEnable(GL_LIGHTING);
+	if (points)
+		glPointSize(opts._perpoint_pointsize);
+	glColor4ubv(col.V());
+	drawnprimitives = it->second->draw(points, usecolor, pixeltolerance, primitivebudget);
+	glPopMatrix();
+	glPopAttrib();
+	return true;
+}
+
+/*
+ * Enables the level of detail proxies for the meshes having at least
+ * minprimitives faces (vertices for point clouds).
+ */
+void MLSceneGLSharedDataContext::setLODParameters(bool enabled, size_t minprimitives)
+{
+	if ((enabled == _lodenabled) && (minprimitives == _lodminprimitives))
+		return;
+	_lodenabled = enabled;
+	_lodminprimitives = minprimitives;
+	std::vector<int> ids;
+	for (const auto& p : _meshlod)
+		ids.push_back(p.first);
+	for (int id : ids)
+		invalidateLOD(id);
+	for (const auto& p : _meshboman)
+		updateLOD(p.first);
+}
+
 void MLSceneGLSharedDataContext::drawAllocatedAttributesSubset(int mmid, QGLContext * viewid, const MLRenderingData & dt)
 {
 	PerMeshMultiViewManager* man = meshAttributesMultiViewerManager(mmid);
@@ -327,6 +401,7 @@ void MLSceneGLSharedDataContext::deAllocateGPUSharedData()
 		PerMeshMultiViewManager* man = it->second;
 		deAllocateTexturesPerMesh(it->first);
 		man->removeAllViewsAndDeallocateBO();
+		invalidateLOD(it->first);
 	}
 	doneCurrentGLContext(ctx);
 }
@@ -339,6 +414,8 @@ void MLSceneGLSharedDataContext::meshAttributesUpdated(int mmid,bool conntectivi
 	PerMeshMultiViewManager* man = meshAttributesMultiViewerManager(mmid);
 	if (man != NULL)
 		man->meshAttributesUpdated(conntectivitychanged,atts);
+	if (conntectivitychanged || atts[MLRenderingData::ATT_NAMES::ATT_VERTPOSITION] || atts[MLRenderingData::ATT_NAMES::ATT_VERTCOLOR])
+		invalidateLOD(mmid);
 }
 
 void MLSceneGLSharedDataContext::meshDeallocated( int /*mmid*/ )
@@ -383,6 +460,7 @@ bool MLSceneGLSharedDataContext::manageBuffers( int mmid )
 		man->manageBuffers();
 		doneCurrentGLContext(ctx);
 	}
+	updateLOD(mmid);
 	return didsomething;
 }
 
@@ -536,3 +614,45 @@ void MLSceneGLSharedDataContext::doneCurrentGLContext( QGLContext* oldone /*= NU
 		oldone->makeCurrent();
 }
 
+/*
+ * Starts building the level of detail proxy of a mesh, if it is large enough
+ * and it has not one yet. The proxy is built in background, and it is used
+ * by drawLOD as soon as it is ready.
+ */
+void MLSceneGLSharedDataContext::updateLOD(int mmid)
+{
+	MeshModel* mm = _md.getMesh(mmid);
+	if (!_lodenabled || (mm == NULL) || (_meshlod.find(mmid) != _meshlod.end()))
+		return;
+	size_t primitives = (mm->cm.fn > 0) ? size_t(mm->cm.fn) : size_t(mm->cm.vn);
+	if ((primitives == 0) || (primitives < _lodminprimitives))
+		return;
+	_meshlod[mmid] = new MLMeshLOD(mm->cm, mm->hasDataMask(MeshModel::MM_VERTCOLOR));
+}
+
+/*
+ * Waits until all the level of detail proxies being built have taken the
+ * snapshot of their mesh. Must be called before modifying or deleting any
+ * mesh (e.g. when the document becomes busy, or by an edit tool).
+ */
+void MLSceneGLSharedDataContext::waitForLODSnapshots()
+{
+	for (auto& p : _meshlod)
+		p.second->waitForSnapshot();
+}
+
+/*
+ * Deletes the level of detail proxy of a mesh (e.g. because the mesh has
+ * been modified); a new one will be built by the next manageBuffers.
+ */
+void MLSceneGLSharedDataContext::invalidateLOD(int mmid)
+{
+	auto it = _meshlod.find(mmid);
+	if (it == _meshlod.end())
+		return;
+	QGLContext* ctx = makeCurrentGLContext();
+	it->second->releaseGL();
+	doneCurrentGLContext(ctx);
+	delete it->second;
+	_meshlod.erase(it);
+}
@@ -25,6 +25,7 @@
 #define ML_SCENE_GL_SHARED_DATA_CONTEXT_H
 
 #include "ml_shared_data_context.h"
+#include "ml_mesh_lod.h"
 
 class MLSceneGLSharedDataContext : public QGLWidget
 {
@@ -58,6 +59,8 @@ public:
 	void deAllocateGPUSharedData();
 
 	void draw(int mmid, QGLContext* viewid) const;
+	bool drawLOD(int mmid, QGLContext* viewid, float pixeltolerance, size_t primitivebudget, size_t& drawnprimitives);
+	void setLODParameters(bool enabled, size_t minprimitives);
 	void drawAllocatedAttributesSubset(int mmid, QGLContext* viewid, const MLRenderingData& dt);
 	void setSceneTransformationMatrix(const Matrix44m& m);
 	void setMeshTransformationMatrix(int mmid, const Matrix44m& m);
@@ -95,6 +98,7 @@ public:
 
 	void removeView(QGLContext* viewerid);
 	void meshAttributesUpdated(int mmid, bool conntectivitychanged, const MLRenderingData::RendAtts& dt);
+	void waitForLODSnapshots();
 	void updateGPUMemInfo();
 	//void updateRequested(int meshid,MLRenderingData::ATT_NAMES name);
 
@@ -110,6 +114,8 @@ private:
 	PerMeshMultiViewManager* meshAttributesMultiViewerManager(int mmid) const;
 	QGLContext* makeCurrentGLContext();
 	void doneCurrentGLContext(QGLContext* oldone = NULL);
+	void updateLOD(int mmid);
+	void invalidateLOD(int mmid);
 
 	MeshDocument& _md;
 	typedef std::map<int, PerMeshMultiViewManager*> MeshIDManMap;
@@ -120,6 +126,11 @@ private:
 	bool _highprecision;
 	QTimer _timer;
 
+	//level of detail proxies of the meshes having at least _lodminprimitives faces (or vertices, for point clouds)
+	std::map<int, MLMeshLOD*> _meshlod;
+	bool _lodenabled;
+	size_t _lodminprimitives;
+
 signals:
 
 	void currentAllocatedGPUMem(int nv_all, int nv_current, int ati_tex, int ati_vbo);
@@ -480,8 +480,8 @@ QString RichAbsPerc::stringType() const
 QDomElement RichAbsPerc::fillToXMLDocument(QDomDocument& doc, bool saveDescriptionAndTooltip) const
 {
 	QDomElement parElem = RichParameter::fillToXMLDocument(doc, saveDescriptionAndTooltip);
-	parElem.setAttribute("min",QString::number(min));
-	parElem.setAttribute("max",QString::number(max));
+	parElem.setAttribute("min",scalarToString(min));
+	parElem.setAttribute("max",scalarToString(max));
 	return parElem;
 }
 
@@ -564,8 +564,8 @@ QString RichDynamicFloat::stringType() const
 QDomElement RichDynamicFloat::fillToXMLDocument(QDomDocument& doc, bool saveDescriptionAndTooltip) const
 {
 	QDomElement parElem = RichParameter::fillToXMLDocument(doc, saveDescriptionAndTooltip);
-	parElem.setAttribute("min",QString::number(min));
-	parElem.setAttribute("max",QString::number(max));
+	parElem.setAttribute("min",scalarToString(min));
+	parElem.setAttribute("max",scalarToString(max));
 	return parElem;
 }
 
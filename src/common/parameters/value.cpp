@@ -23,8 +23,18 @@
 
 #include "value.h"
 
+#include <limits>
+
 #include "../ml_document/mesh_document.h"
 
+QString scalarToString(Scalarm v)
+{
+	QString s = QString::number(v);
+	if (Scalarm(s.toDouble()) != v)
+		s = QString::number(v, 'g', std::numeric_limits<Scalarm>::max_digits10);
+	return s;
+}
+
 void BoolValue::fillToXMLElement(QDomElement& element) const
 {
 	QString v =  pval ? "true" : "false";
@@ -38,7 +48,7 @@ void IntValue::fillToXMLElement(QDomElement& element) const
 
 void FloatValue::fillToXMLElement(QDomElement& element) const
 {
-	element.setAttribute("value", QString::number(pval));
+	element.setAttribute("value", scalarToString(pval));
 }
 
 void StringValue::fillToXMLElement(QDomElement& element) const
@@ -49,14 +59,14 @@ void StringValue::fillToXMLElement(QDomElement& element) const
 void Matrix44fValue::fillToXMLElement(QDomElement& element) const
 {
 	for(unsigned int ii = 0;ii < 16;++ii)
-		element.setAttribute(QString("val")+QString::number(ii),QString::number(pval.V()[ii]));
+		element.setAttribute(QString("val")+QString::number(ii),scalarToString(pval.V()[ii]));
 }
 
 void Point3fValue::fillToXMLElement(QDomElement& element) const
 {
-	element.setAttribute("x",QString::number(pval.X()));
-	element.setAttribute("y",QString::number(pval.Y()));
-	element.setAttribute("z",QString::number(pval.Z()));
+	element.setAttribute("x",scalarToString(pval.X()));
+	element.setAttribute("y",scalarToString(pval.Y()));
+	element.setAttribute("z",scalarToString(pval.Z()));
 }
 
 void ShotfValue::fillToXMLElement(QDomElement&) const
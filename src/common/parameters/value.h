@@ -31,6 +31,13 @@ class MeshModel;
 class MeshDocument;
 class QDomElement;
 
+/**
+ * @brief Converts a scalar into the shortest string (up to the default six
+ * significant digits, more if needed) that is read back exactly as the
+ * same scalar.
+ */
+QString scalarToString(Scalarm v);
+
 /**
  * @brief The Value class
  *
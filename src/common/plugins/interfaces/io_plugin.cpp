@@ -31,6 +31,7 @@ void IOPlugin::open(
 void IOPlugin::reportWarning(const QString& warningMessage) const
 {
 	if (!warningMessage.isEmpty()){
+		QMutexLocker locker(&warnMutex);
 		MeshLabPluginLogger::log(GLLogStream::WARNING, warningMessage.toStdString());
 		warnString += "\n" + warningMessage;
 	}
@@ -48,6 +49,7 @@ void IOPlugin::wrongSaveFormat(const QString& format) const
 
 QString IOPlugin::warningMessageString() const
 {
+	QMutexLocker locker(&warnMutex);
 	QString tmp = warnString;
 	warnString.clear();
 	return tmp;
@@ -24,6 +24,8 @@
 #ifndef MESHLAB_IO_PLUGIN_H
 #define MESHLAB_IO_PLUGIN_H
 
+#include <QMutex>
+
 #include <wrap/callback.h>
 
 #include "meshlab_plugin_logger.h"
@@ -164,6 +166,21 @@ public:
 			const RichParameterList & par,
 			vcg::CallBackPos *cb = nullptr) = 0;
 
+	/**
+	 * @brief The isOpenReentrant function tells to the framework whether the
+	 * open function can be called concurrently, from different threads, to
+	 * load different files of the given format (e.g. when all the meshes of a
+	 * project are loaded).
+	 * Re-implement this function returning true only if your open function
+	 * does not modify any member of the plugin (reportWarning is thread safe)
+	 * and does not depend on the current working directory.
+	 * Default value is false.
+	 */
+	virtual bool isOpenReentrant(const QString& /*format*/) const
+	{
+		return false;
+	}
+
 	/***********************
 	 * Save Mesh Functions *
 	 ***********************/
@@ -256,6 +273,18 @@ public:
 		return QImage();
 	};
 
+	/**
+	 * @brief The isOpenImageReentrant function tells to the framework whether
+	 * the openImage function can be called concurrently, from different
+	 * threads, to load different images of the given format (e.g. when all the
+	 * rasters of a project are loaded).
+	 * Default value is false.
+	 */
+	virtual bool isOpenImageReentrant(const QString& /*format*/) const
+	{
+		return false;
+	}
+
 	/************************
 	 * Save Image Functions *
 	 ************************/
@@ -397,6 +426,19 @@ public:
 		wrongSaveFormat(format);
 	}
 
+	/**
+	 * @brief The isSaveReentrant function tells to the framework whether the
+	 * save function can be called concurrently, from different threads, to
+	 * save different meshes in the given format.
+	 * Re-implement this function returning true only if your save function
+	 * does not modify any member of the plugin (reportWarning is thread safe).
+	 * Default value is false.
+	 */
+	virtual bool isSaveReentrant(const QString& /*format*/) const
+	{
+		return false;
+	}
+
 	/***************************
 	 * Other utility Functions *
 	 ***************************/
@@ -406,7 +448,7 @@ public:
 	 * non-critical error while loading or saving a file happens. This function
 	 * appends the warning message passed as parameter to a string that will be
 	 * shown by the framework at the end of the execution of the load/save
-	 * function
+	 * function. It can be called concurrently from different threads.
 	 * @param warningMessage
 	 */
 	void reportWarning(const QString& warningMessage) const;
@@ -433,6 +475,7 @@ public:
 	QString warningMessageString() const;
 
 private:
+	mutable QMutex  warnMutex;
 	mutable QString warnString;
 };
 
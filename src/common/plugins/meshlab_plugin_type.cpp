@@ -62,6 +62,16 @@ MeshLabPluginType::MeshLabPluginType(const MeshLabPlugin* fpi) : type(0)
 		type = UNKNOWN;
 }
 
+/**
+ * @brief Builds the type from the flags returned by the flags() member
+ * function (e.g. stored in a plugin metadata cache).
+ */
+MeshLabPluginType::MeshLabPluginType(int typeFlags) : type(typeFlags)
+{
+	if (type == 0)
+		type = UNKNOWN;
+}
+
 bool MeshLabPluginType::isValid() const
 {
 	return !(type & UNKNOWN);
@@ -133,3 +143,8 @@ QString MeshLabPluginType::pluginTypeString() const
 	}
 	return type;
 }
+
+int MeshLabPluginType::flags() const
+{
+	return type;
+}
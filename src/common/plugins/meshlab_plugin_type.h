@@ -32,6 +32,7 @@ class MeshLabPluginType
 {
 public:
 	MeshLabPluginType(const MeshLabPlugin* fpi);
+	explicit MeshLabPluginType(int typeFlags);
 
 	bool isValid() const;
 	bool isDecoratePlugin() const;
@@ -42,6 +43,7 @@ public:
 
 	bool isMultipleTypePlugin() const;
 	QString pluginTypeString() const;
+	int flags() const;
 
 private:
 	enum MLPType {
@@ -26,6 +26,7 @@
 #include <QObject>
 #include <QDir>
 #include <QApplication>
+#include <QElapsedTimer>
 
 #include <vcg/complex/algorithms/create/platonic.h>
 
@@ -47,7 +48,12 @@ static QStringList fileNamePluginDLLs() {
 #endif
 }
 
-PluginManager::PluginManager()
+PluginManager::PluginManager() :
+	deferredPluginNumber(0),
+	lazy(true),
+	cacheFile(PluginMetadataCache::defaultFileName()),
+	metadataCacheLoaded(false),
+	cacheLoadingNsecs(0)
 {
 }
 
@@ -79,6 +85,48 @@ MeshLabPluginType PluginManager::checkPlugin(const QString& filename)
 		throw MLException(fin.fileName() + " does not seem to be a Qt Plugin.\n\n" + loader.errorString());
 	}
 
+	MeshLabPluginType type = checkPlugin(plugin, fin);
+	loader.unload();
+	return type;
+}
+
+/**
+ * @brief Enables or disables the lazy loading of the plugins (enabled by
+ * default). Must be set before calling loadPlugins.
+ */
+void PluginManager::setLazyLoading(bool lazy)
+{
+	this->lazy = lazy;
+}
+
+bool PluginManager::lazyLoading() const
+{
+	return lazy;
+}
+
+/**
+ * @brief Sets the file of the persistent plugin metadata cache. By default,
+ * it is a file in the user cache directory (see
+ * PluginMetadataCache::defaultFileName). An empty file name disables the
+ * persistent cache.
+ */
+void PluginManager::setMetadataCacheFile(const QString& fileName)
+{
+	cacheFile = fileName;
+	metadataCacheLoaded = false;
+}
+
+QString PluginManager::metadataCacheFile() const
+{
+	return cacheFile;
+}
+
+/**
+ * @brief Checks that the given instance of a plugin, contained in the given
+ * file, is a valid MeshLab plugin. Throws a MLException otherwise.
+ */
+MeshLabPluginType PluginManager::checkPlugin(QObject* plugin, const QFileInfo& fin)
+{
 	MeshLabPlugin* ifp = dynamic_cast<MeshLabPlugin *>(plugin);
 	if (!ifp){
 		throw MLException(fin.fileName() + " is not a MeshLab plugin.");
@@ -124,7 +172,6 @@ MeshLabPluginType PluginManager::checkPlugin(const QString& filename)
 		checkFilterPlugin(qobject_cast<FilterPlugin *>(plugin));
 	}
 
-	loader.unload();
 	return type;
 }
 
@@ -157,15 +204,30 @@ void PluginManager::loadPlugins(QDir pluginsDirectory)
 		pluginsDirectory.setNameFilters(nameFiltersPlugins);
 		
 		//qDebug("Current Plugins Dir is: %s ", qUtf8Printable(pluginsDirectory.absolutePath()));
+		loadMetadataCache();
 		std::list<std::pair<QString, QString>> errors;
 		for(QString fileName : pluginsDirectory.entryList(QDir::Files)) {
 			try {
-				loadPlugin(pluginsDirectory.absoluteFilePath(fileName));
+				QFileInfo fin(pluginsDirectory.absoluteFilePath(fileName));
+				const PluginMetadata* md = lazy ? metadataCache.find(fin.absoluteFilePath()) : nullptr;
+				if (md != nullptr && pluginFiles.find(fin.absoluteFilePath()) == pluginFiles.end()) {
+					// the plugin will be instantiated when needed
+					QElapsedTimer timer;
+					timer.start();
+					pluginEntries.push_back(PluginEntry{*md, nullptr, false});
+					pluginFiles.insert(fin.absoluteFilePath());
+					++deferredPluginNumber;
+					loadingTimes.push_back(LoadingTime{fin.fileName(), timer.nsecsElapsed(), "deferred"});
+				}
+				else {
+					loadPlugin(fin.absoluteFilePath());
+				}
 			}
 			catch(const MLException& e){
 				errors.push_back(std::make_pair(fileName, e.what()));
 			}
 		}
+		saveMetadataCache();
 		if (errors.size() > 0){
 			QString singleError = "Unable to load the following plugins:\n\n";
 			for (const auto& p : errors){
@@ -190,11 +252,48 @@ MeshLabPlugin* PluginManager::loadPlugin(const QString& fileName)
 	if (pluginFiles.find(fin.absoluteFilePath()) != pluginFiles.end())
 		throw MLException(fin.fileName() + " has been already loaded.");
 
-	checkPlugin(fileName);
+	loadMetadataCache();
+	QElapsedTimer timer;
+	timer.start();
+	MeshLabPlugin* ifp = createPlugin(fin);
+	// the cached entry may contain also the function signatures of the plugin
+	const PluginMetadata& md = metadataCache.insert(PluginMetadata(fin, ifp));
+	pluginEntries.push_back(PluginEntry{md, ifp, false});
+	pluginFiles.insert(fin.absoluteFilePath());
+	loadingTimes.push_back(LoadingTime{fin.fileName(), timer.nsecsElapsed(), "loaded"});
+	return ifp;
+}
 
-	//load the plugin depending on the type (can be more than one type!)
+/**
+ * @brief Loads the plugin library contained in the given file, checks that it
+ * is a valid MeshLab plugin and adds it to the plugin containers.
+ * The library is loaded only once: the same instance is used for the checks
+ * and for the registration.
+ *
+ * Throws a MLException if the load of the plugin fails.
+ */
+MeshLabPlugin* PluginManager::createPlugin(const QFileInfo& fin) const
+{
+	if (!fin.exists()){
+		throw MLException(fin.filePath() + " does not exists.");
+	}
 	QPluginLoader* loader = new QPluginLoader(fin.absoluteFilePath());
 	QObject *plugin = loader->instance();
+	if (!plugin) {
+		QString error = loader->errorString();
+		delete loader;
+		throw MLException(fin.fileName() + " does not seem to be a Qt Plugin.\n\n" + error);
+	}
+	try {
+		checkPlugin(plugin, fin);
+	}
+	catch (const MLException&) {
+		loader->unload();
+		delete loader;
+		throw;
+	}
+
+	//load the plugin depending on the type (can be more than one type!)
 	MeshLabPlugin* ifp = dynamic_cast<MeshLabPlugin *>(plugin);
 	MeshLabPluginType type(ifp);
 	
@@ -219,7 +318,6 @@ MeshLabPlugin* PluginManager::loadPlugin(const QString& fileName)
 	ifp->plugFileInfo = fin;
 	allPlugins.push_back(ifp);
 	allPluginLoaders.push_back(loader);
-	pluginFiles.insert(fin.absoluteFilePath());
 	return ifp;
 }
 
@@ -247,6 +345,12 @@ void PluginManager::unloadPlugin(MeshLabPlugin* ifp)
 		QPluginLoader* l = allPluginLoaders[index];
 		allPluginLoaders.erase(allPluginLoaders.begin() + index);
 		allPlugins.erase(it);
+		for (auto eit = pluginEntries.begin(); eit != pluginEntries.end(); ++eit) {
+			if (eit->plugin == ifp) {
+				pluginEntries.erase(eit);
+				break;
+			}
+		}
 		l->unload();
 		delete l;
 	}
@@ -270,25 +374,110 @@ void PluginManager::disablePlugin(MeshLabPlugin* ifp)
 	}
 }
 
+/**
+ * @brief Returns the metadata of all the plugins (instantiated or not), in
+ * the order they have been loaded. Plugins that are not instantiated yet are
+ * always enabled.
+ */
+std::vector<PluginMetadata> PluginManager::pluginMetadataList(bool iterateAlsoDisabledPlugins) const
+{
+	QMutexLocker locker(&mutex);
+	std::vector<PluginMetadata> list;
+	for (const PluginEntry& e : pluginEntries){
+		if (!e.failed && (iterateAlsoDisabledPlugins || e.plugin == nullptr || e.plugin->isEnabled()))
+			list.push_back(e.metadata);
+	}
+	return list;
+}
+
+/**
+ * @brief Returns the instance of the plugin contained in the given file,
+ * instantiating it if it was not instantiated yet.
+ * Returns nullptr if the plugin has not been loaded. Throws a MLException if
+ * its instantiation fails.
+ */
+MeshLabPlugin* PluginManager::pluginInstance(const QString& fileName) const
+{
+	QString path = QFileInfo(fileName).absoluteFilePath();
+	QMutexLocker locker(&mutex);
+	for (PluginEntry& e : pluginEntries){
+		if (e.metadata.fileName == path)
+			return instantiate(e);
+	}
+	return nullptr;
+}
+
+/**
+ * @brief Stores in the metadata cache the python function signatures of
+ * the plugin contained in the given file (see pymeshlab::FunctionSet).
+ * The cache file is written by saveMetadataCache.
+ */
+void PluginManager::setFunctionSignatures(const QString& fileName, const QString& signatures) const
+{
+	QString path = QFileInfo(fileName).absoluteFilePath();
+	QMutexLocker locker(&mutex);
+	for (PluginEntry& e : pluginEntries){
+		if (e.metadata.fileName == path)
+			e.metadata.functionSignatures = signatures;
+	}
+	metadataCache.setFunctionSignatures(path, signatures);
+}
+
+/**
+ * @brief Returns a report of the time spent loading the plugins: the time
+ * spent to read the metadata cache, and for each plugin library the time
+ * spent to load, check and register it (or to defer it, when lazy loading is
+ * enabled). Plugins instantiated on demand are reported with the time of their
+ * instantiation.
+ */
+QString PluginManager::loadingTimesReport() const
+{
+	QMutexLocker locker(&mutex);
+	qint64 total = cacheLoadingNsecs;
+	QString report = "Plugin loading times (ms):\n";
+	report += "\tmetadata cache: " + QString::number(cacheLoadingNsecs / 1e6, 'f', 3) + "\n";
+	for (const LoadingTime& lt : loadingTimes){
+		report += "\t" + lt.fileName + " (" + lt.mode + "): " + QString::number(lt.nsecs / 1e6, 'f', 3) + "\n";
+		total += lt.nsecs;
+	}
+	report += "\ttotal: " + QString::number(total / 1e6, 'f', 3) + "\n";
+	report += "\tinstantiated plugins: " + QString::number(allPlugins.size()) + "/" +
+		QString::number(allPlugins.size() + deferredPluginNumber) + "\n";
+	return report;
+}
+
 unsigned int PluginManager::size() const
 {
+	instantiateDeferredPlugins();
 	return allPlugins.size();
 }
 
 int PluginManager::numberIOPlugins() const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isIOPlugin);
 	return ioPlugins.size();
 }
 
 // Search among all the decorator plugins the one that contains a decoration with the given name
 DecoratePlugin *PluginManager::getDecoratePlugin(const QString& name)
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isDecoratePlugin);
 	return decoratePlugins.decoratePlugin(name);
 }
 
 QAction* PluginManager::filterAction(const QString& name)
 {
-	return filterPlugins.filterAction(name);
+	QMutexLocker locker(&mutex);
+	QAction* act = filterPlugins.filterAction(name);
+	if (act == nullptr && deferredPluginNumber > 0){
+		for (PluginEntry& e : pluginEntries){
+			if (e.plugin == nullptr && !e.failed && e.metadata.hasFilter(name)){
+				instantiate(e);
+				return filterPlugins.filterAction(name);
+			}
+		}
+	}
+	return act;
 }
 
 FilterPlugin* PluginManager::getFilterPluginFromAction(const QAction *action) const
@@ -298,91 +487,127 @@ FilterPlugin* PluginManager::getFilterPluginFromAction(const QAction *action) co
 
 IOPlugin* PluginManager::inputMeshPlugin(const QString& inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::importFormats, inputFormat);
 	return ioPlugins.inputMeshPlugin(inputFormat);
 }
 
 IOPlugin* PluginManager::outputMeshPlugin(const QString& outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::exportFormats, outputFormat);
 	return ioPlugins.outputMeshPlugin(outputFormat);
 }
 
 IOPlugin* PluginManager::inputImagePlugin(const QString inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::importImageFormats, inputFormat);
 	return ioPlugins.inputImagePlugin(inputFormat);
 }
 
 IOPlugin* PluginManager::outputImagePlugin(const QString& outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::exportImageFormats, outputFormat);
 	return ioPlugins.outputImagePlugin(outputFormat);
 }
 
 IOPlugin* PluginManager::inputProjectPlugin(const QString& inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::importProjectFormats, inputFormat);
 	return ioPlugins.inputProjectPlugin(inputFormat);
 }
 
 IOPlugin* PluginManager::outputProjectPlugin(const QString& outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPlugin(&PluginMetadata::exportProjectFormats, outputFormat);
 	return ioPlugins.outputProjectPlugin(outputFormat);
 }
 
 bool PluginManager::isInputMeshFormatSupported(const QString inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::importFormats, inputFormat) >= 0;
 	return ioPlugins.isInputMeshFormatSupported(inputFormat);
 }
 
 bool PluginManager::isOutputMeshFormatSupported(const QString outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::exportFormats, outputFormat) >= 0;
 	return ioPlugins.isOutputMeshFormatSupported(outputFormat);
 }
 
 bool PluginManager::isInputImageFormatSupported(const QString inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::importImageFormats, inputFormat) >= 0;
 	return ioPlugins.isInputImageFormatSupported(inputFormat);
 }
 
 bool PluginManager::isOutputImageFormatSupported(const QString outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::exportImageFormats, outputFormat) >= 0;
 	return ioPlugins.isOutputImageFormatSupported(outputFormat);
 }
 
 bool PluginManager::isInputProjectFormatSupported(const QString inputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::importProjectFormats, inputFormat) >= 0;
 	return ioPlugins.isInputProjectFormatSupported(inputFormat);
 }
 
 bool PluginManager::isOutputProjectFormatSupported(const QString outputFormat) const
 {
+	if (deferredPluginNumber > 0)
+		return formatPluginEntry(&PluginMetadata::exportProjectFormats, outputFormat) >= 0;
 	return ioPlugins.isOutputProjectFormatSupported(outputFormat);
 }
 
 QStringList PluginManager::inputMeshFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::importFormats);
 	return ioPlugins.inputMeshFormatList();
 }
 
 QStringList PluginManager::outputMeshFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::exportFormats);
 	return ioPlugins.outputMeshFormatList();
 }
 
 QStringList PluginManager::inputImageFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::importImageFormats);
 	return ioPlugins.inputImageFormatList();
 }
 
 QStringList PluginManager::outputImageFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::exportImageFormats);
 	return ioPlugins.outputImageFormatList();
 }
 
 QStringList PluginManager::inputProjectFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::importProjectFormats);
 	return ioPlugins.inputProjectFormatList();
 }
 
 QStringList PluginManager::outputProjectFormatList() const
 {
+	if (deferredPluginNumber > 0)
+		return formatList(&PluginMetadata::exportProjectFormats);
 	return ioPlugins.outputProjectFormatList();
 }
 
@@ -413,36 +638,43 @@ QStringList PluginManager::outputProjectFormatListDialog() const
 
 MeshLabPlugin* PluginManager::operator[](unsigned int i) const
 {
+	instantiateDeferredPlugins();
 	return allPlugins[i];
 }
 
 PluginManager::PluginRangeIterator PluginManager::pluginIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins();
 	return PluginRangeIterator(this, iterateAlsoDisabledPlugins);
 }
 
 FilterPluginContainer::FilterPluginRangeIterator PluginManager::filterPluginIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isFilterPlugin);
 	return filterPlugins.filterPluginIterator(iterateAlsoDisabledPlugins);
 }
 
 IOPluginContainer::IOPluginRangeIterator PluginManager::ioPluginIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isIOPlugin);
 	return ioPlugins.ioPluginIterator(iterateAlsoDisabledPlugins);
 }
 
 RenderPluginContainer::RenderPluginRangeIterator PluginManager::renderPluginIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isRenderPlugin);
 	return renderPlugins.renderPluginIterator(iterateAlsoDisabledPlugins);
 }
 
 DecoratePluginContainer::DecoratePluginRangeIterator PluginManager::decoratePluginIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isDecoratePlugin);
 	return decoratePlugins.decoratePluginIterator(iterateAlsoDisabledPlugins);
 }
 
 EditPluginContainer::EditPluginFactoryRangeIterator PluginManager::editPluginFactoryIterator(bool iterateAlsoDisabledPlugins) const
 {
+	instantiateDeferredPlugins(&MeshLabPluginType::isEditPlugin);
 	return editPlugins.editPluginIterator(iterateAlsoDisabledPlugins);
 }
 
@@ -467,6 +699,147 @@ void PluginManager::checkFilterPlugin(FilterPlugin* iFilter)
 	}
 }
 
+/**
+ * @brief Instantiates a deferred plugin. If the instantiation fails (e.g. the
+ * library has been modified or removed after loadPlugins), the plugin is
+ * discarded and a MLException is thrown.
+ * Must be called while holding the mutex.
+ */
+MeshLabPlugin* PluginManager::instantiate(PluginEntry& entry) const
+{
+	if (entry.plugin == nullptr && !entry.failed){
+		QElapsedTimer timer;
+		timer.start();
+		QFileInfo fin(entry.metadata.fileName);
+		--deferredPluginNumber;
+		try {
+			if (!entry.metadata.isUpToDate())
+				throw MLException(fin.fileName() + " has been modified after it was loaded.");
+			entry.plugin = createPlugin(fin);
+		}
+		catch (const MLException& e) {
+			entry.failed = true;
+			metadataCache.erase(entry.metadata.fileName);
+			if (!cacheFile.isEmpty())
+				metadataCache.save(cacheFile);
+			loadingTimes.push_back(LoadingTime{fin.fileName(), timer.nsecsElapsed(), "failed"});
+			throw MLException(fin.fileName() + ": " + e.what());
+		}
+		loadingTimes.push_back(LoadingTime{fin.fileName(), timer.nsecsElapsed(), "on demand"});
+	}
+	return entry.plugin;
+}
+
+/**
+ * @brief Instantiates all the deferred plugins of the given type (all the
+ * deferred plugins if isType is nullptr), in load order.
+ * If at least one plugin fails to be instantiated, the other ones are
+ * instantiated anyway and a MLException is thrown, as in loadPlugins.
+ */
+void PluginManager::instantiateDeferredPlugins(bool (MeshLabPluginType::*isType)() const) const
+{
+	if (deferredPluginNumber == 0)
+		return;
+	QMutexLocker locker(&mutex);
+	std::list<QString> errors;
+	for (PluginEntry& e : pluginEntries){
+		if (e.plugin == nullptr && !e.failed && (isType == nullptr || (e.metadata.pluginType().*isType)())) {
+			try {
+				instantiate(e);
+			}
+			catch (const MLException& exc) {
+				errors.push_back(exc.what());
+			}
+		}
+	}
+	if (!errors.empty()){
+		QString singleError = "Unable to load the following plugins:\n\n";
+		for (const QString& err : errors){
+			singleError += "\t" + err + "\n";
+		}
+		throw MLException(singleError);
+	}
+}
+
+void PluginManager::loadMetadataCache()
+{
+	if (!metadataCacheLoaded){
+		QElapsedTimer timer;
+		timer.start();
+		if (!cacheFile.isEmpty())
+			metadataCache.load(cacheFile);
+		metadataCacheLoaded = true;
+		cacheLoadingNsecs += timer.nsecsElapsed();
+	}
+}
+
+/**
+ * @brief Writes the metadata cache file, if the cache has been modified.
+ */
+void PluginManager::saveMetadataCache() const
+{
+	QMutexLocker locker(&mutex);
+	if (!cacheFile.isEmpty() && metadataCache.isModified())
+		metadataCache.save(cacheFile);
+}
+
+/**
+ * @brief Returns the index of the first (in load order) plugin entry that
+ * supports the given format, or -1 if no plugin supports it.
+ * This is the same plugin that would be returned by the IOPluginContainer if
+ * all the plugins were instantiated.
+ */
+int PluginManager::formatPluginEntry(FormatList formats, const QString& format) const
+{
+	QMutexLocker locker(&mutex);
+	for (unsigned int i = 0; i < pluginEntries.size(); ++i){
+		const PluginEntry& e = pluginEntries[i];
+		if (!e.failed && PluginMetadata::supportsFormat(e.metadata.*formats, format))
+			return i;
+	}
+	return -1;
+}
+
+IOPlugin* PluginManager::formatPlugin(FormatList formats, const QString& format) const
+{
+	QMutexLocker locker(&mutex);
+	QString error;
+	for (PluginEntry& e : pluginEntries){
+		if (!e.failed && PluginMetadata::supportsFormat(e.metadata.*formats, format)){
+			try {
+				return dynamic_cast<IOPlugin*>(instantiate(e));
+			}
+			catch (const MLException& exc) {
+				// instantiation failed, try with the next one
+				if (error.isEmpty())
+					error = exc.what();
+			}
+		}
+	}
+	if (!error.isEmpty())
+		throw MLException("Unable to load the plugin for the format " + format + ":\n\n" + error);
+	return nullptr;
+}
+
+QStringList PluginManager::formatList(FormatList formats) const
+{
+	// same (sorted) order of the keys of the maps of the IOPluginContainer
+	QMutexLocker locker(&mutex);
+	std::set<QString> exts;
+	for (const PluginEntry& e : pluginEntries){
+		if (e.failed)
+			continue;
+		for (const FileFormat& ff : e.metadata.*formats){
+			for (const QString& ext : ff.extensions)
+				exts.insert(ext.toLower());
+		}
+	}
+	QStringList list;
+	for (const QString& ext : exts)
+		list.push_back(ext);
+	return list;
+}
+
 template<typename RangeIterator>
 QStringList PluginManager::inputFormatListDialog(RangeIterator iterator)
 {
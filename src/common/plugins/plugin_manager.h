@@ -30,12 +30,31 @@
 #include "containers/io_plugin_container.h"
 #include "containers/render_plugin_container.h"
 #include "meshlab_plugin_type.h"
+#include "plugin_metadata_cache.h"
 
+#include <QMutex>
 #include <QPluginLoader>
 #include <QObject>
 
+#include <atomic>
+
 /**
  * @brief The PluginManager class provides the basic tools for managing all the plugins.
+ *
+ * The metadata of the loaded plugins (type, filter names, file formats) is
+ * stored in a persistent PluginMetadataCache. When lazy loading is enabled
+ * (the default), plugins having up-to-date metadata in the cache are not instantiated by
+ * loadPlugins: a plugin library is loaded only the first time the plugin is
+ * actually needed (e.g. one of its filters is requested, one of its formats
+ * is opened, or all the plugins of its type are iterated). Queries that can
+ * be answered using only the metadata (e.g. the supported formats) do not
+ * instantiate any plugin. A plugin that fails to be instantiated on demand
+ * is discarded, and the failure is reported with a MLException.
+ *
+ * The const member functions can be called concurrently (e.g. by the threads
+ * that load the images of a mesh): the on demand instantiation is serialized
+ * by a mutex. Loading, unloading, enabling and disabling plugins is not
+ * thread safe.
  */
 class PluginManager
 {
@@ -48,11 +67,22 @@ public:
 	/** Member functions **/
 	static MeshLabPluginType checkPlugin(const QString& filename);
 
+	void setLazyLoading(bool lazy);
+	bool lazyLoading() const;
+	void setMetadataCacheFile(const QString& fileName);
+	QString metadataCacheFile() const;
+
 	void loadPlugins();
 	void loadPlugins(QDir pluginsDirectory);
 	MeshLabPlugin* loadPlugin(const QString& filename);
 	void unloadPlugin(MeshLabPlugin* ifp);
 
+	std::vector<PluginMetadata> pluginMetadataList(bool iterateAlsoDisabledPlugins = false) const;
+	MeshLabPlugin* pluginInstance(const QString& fileName) const;
+	void setFunctionSignatures(const QString& fileName, const QString& signatures) const;
+	void saveMetadataCache() const;
+	QString loadingTimesReport() const;
+
 	void enablePlugin(MeshLabPlugin* ifp);
 	void disablePlugin(MeshLabPlugin* ifp);
 
@@ -99,21 +129,66 @@ public:
 	EditPluginContainer::EditPluginFactoryRangeIterator editPluginFactoryIterator(bool iterateAlsoDisabledPlugins = false) const;
 
 private:
+	typedef std::list<FileFormat> PluginMetadata::* FormatList;
+
+	struct PluginEntry
+	{
+		PluginMetadata metadata;
+		MeshLabPlugin* plugin; // nullptr if not instantiated yet
+		bool           failed; // the instantiation of a deferred plugin failed
+	};
+
+	struct LoadingTime
+	{
+		QString fileName;
+		qint64  nsecs;
+		QString mode; // "loaded", "deferred", "on demand"
+	};
+
+	// note: when lazy loading is enabled, plugins can be instantiated on demand
+	// also by const member functions: the members modified by instantiate are
+	// mutable, and are modified only while holding the mutex. The plugin
+	// containers of a type are not modified anymore once all the deferred
+	// plugins of that type have been instantiated, and can be read without
+	// holding the mutex.
+	mutable QMutex mutex;
+
 	//all plugins
-	std::vector<MeshLabPlugin*> allPlugins;
-	std::vector<QPluginLoader*> allPluginLoaders;
+	mutable std::vector<MeshLabPlugin*> allPlugins;
+	mutable std::vector<QPluginLoader*> allPluginLoaders;
 	std::set<QString> pluginFiles; //used to check if a plugin file has been already loaded
 
+	//all plugins (instantiated or not) in load order, with their metadata
+	mutable std::vector<PluginEntry> pluginEntries;
+	mutable std::atomic<unsigned int> deferredPluginNumber;
+
+	bool lazy;
+	QString cacheFile;
+	mutable PluginMetadataCache metadataCache;
+	bool metadataCacheLoaded;
+	mutable std::vector<LoadingTime> loadingTimes;
+	qint64 cacheLoadingNsecs;
+
 	//Plugin containers: used for better organization of each type of plugin
 	// note: these containers do not own any plugin. Plugins are owned by the PluginManager
-	IOPluginContainer ioPlugins;
-	FilterPluginContainer filterPlugins;
-	RenderPluginContainer renderPlugins;
-	DecoratePluginContainer decoratePlugins;
-	EditPluginContainer editPlugins;
+	mutable IOPluginContainer ioPlugins;
+	mutable FilterPluginContainer filterPlugins;
+	mutable RenderPluginContainer renderPlugins;
+	mutable DecoratePluginContainer decoratePlugins;
+	mutable EditPluginContainer editPlugins;
 
+	static MeshLabPluginType checkPlugin(QObject* plugin, const QFileInfo& fin);
 	static void checkFilterPlugin(FilterPlugin* iFilter);
 
+	MeshLabPlugin* createPlugin(const QFileInfo& fin) const;
+	MeshLabPlugin* instantiate(PluginEntry& entry) const;
+	void instantiateDeferredPlugins(bool (MeshLabPluginType::*isType)() const = nullptr) const;
+	void loadMetadataCache();
+
+	int formatPluginEntry(FormatList formats, const QString& format) const;
+	IOPlugin* formatPlugin(FormatList formats, const QString& format) const;
+	QStringList formatList(FormatList formats) const;
+
 	template <typename RangeIterator>
 	static QStringList inputFormatListDialog(RangeIterator iterator);
 
@@ -0,0 +1,321 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "plugin_metadata_cache.h"
+
+#include <QDateTime>
+#include <QDir>
+#include <QDomDocument>
+#include <QFile>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <QTextStream>
+
+#include "interfaces/filter_plugin.h"
+#include "interfaces/io_plugin.h"
+#include "../globals.h"
+
+static const QString formatListTags[6] = {
+	"ImportFormat", "ExportFormat",
+	"ImportImageFormat", "ExportImageFormat",
+	"ImportProjectFormat", "ExportProjectFormat"};
+
+static std::list<FileFormat> PluginMetadata::* const formatLists[6] = {
+	&PluginMetadata::importFormats, &PluginMetadata::exportFormats,
+	&PluginMetadata::importImageFormats, &PluginMetadata::exportImageFormats,
+	&PluginMetadata::importProjectFormats, &PluginMetadata::exportProjectFormats};
+
+static bool sameFormats(const std::list<FileFormat>& f1, const std::list<FileFormat>& f2)
+{
+	if (f1.size() != f2.size())
+		return false;
+	auto it2 = f2.begin();
+	for (const FileFormat& ff : f1){
+		if (ff.description != it2->description || ff.extensions != it2->extensions)
+			return false;
+		++it2;
+	}
+	return true;
+}
+
+PluginMetadata::PluginMetadata() : lastModified(0), fileSize(0), type(0)
+{
+}
+
+/**
+ * @brief Extracts the metadata from an instance of the plugin contained in
+ * the given library file.
+ */
+PluginMetadata::PluginMetadata(const QFileInfo& file, const MeshLabPlugin* plugin) :
+	fileName(file.absoluteFilePath()),
+	lastModified(file.lastModified().toMSecsSinceEpoch()),
+	fileSize(file.size()),
+	pluginName(plugin->pluginName()),
+	type(MeshLabPluginType(plugin).flags())
+{
+	const FilterPlugin* fp = dynamic_cast<const FilterPlugin*>(plugin);
+	if (fp != nullptr){
+		for (QAction* act : fp->actions())
+			filterNames.push_back(act->text());
+	}
+	const IOPlugin* iop = dynamic_cast<const IOPlugin*>(plugin);
+	if (iop != nullptr){
+		importFormats = iop->importFormats();
+		exportFormats = iop->exportFormats();
+		importImageFormats = iop->importImageFormats();
+		exportImageFormats = iop->exportImageFormats();
+		importProjectFormats = iop->importProjectFormats();
+		exportProjectFormats = iop->exportProjectFormats();
+		// as read by fromXML, so that an unchanged plugin matches its cached metadata
+		for (unsigned int i = 0; i < 6; ++i){
+			for (FileFormat& ff : this->*formatLists[i])
+				ff.extensions.removeAll(QString());
+		}
+	}
+}
+
+/**
+ * @brief Returns true if the library file has not been modified since the
+ * metadata has been extracted.
+ */
+bool PluginMetadata::isUpToDate() const
+{
+	QFileInfo fin(fileName);
+	return fin.exists() &&
+		fin.lastModified().toMSecsSinceEpoch() == lastModified &&
+		fin.size() == fileSize;
+}
+
+MeshLabPluginType PluginMetadata::pluginType() const
+{
+	return MeshLabPluginType(type);
+}
+
+bool PluginMetadata::hasFilter(const QString& filterName) const
+{
+	return filterNames.contains(filterName);
+}
+
+bool PluginMetadata::supportsFormat(const std::list<FileFormat>& formats, const QString& format)
+{
+	for (const FileFormat& ff : formats){
+		for (const QString& ext : ff.extensions){
+			if (ext.toLower() == format.toLower())
+				return true;
+		}
+	}
+	return false;
+}
+
+QDomElement PluginMetadata::toXML(QDomDocument& doc) const
+{
+	QDomElement elem = doc.createElement("Plugin");
+	elem.setAttribute("fileName", fileName);
+	elem.setAttribute("lastModified", QString::number(lastModified));
+	elem.setAttribute("fileSize", QString::number(fileSize));
+	elem.setAttribute("name", pluginName);
+	elem.setAttribute("type", type);
+	for (const QString& fn : filterNames){
+		QDomElement f = doc.createElement("Filter");
+		f.setAttribute("name", fn);
+		elem.appendChild(f);
+	}
+	for (unsigned int i = 0; i < 6; ++i){
+		for (const FileFormat& ff : this->*formatLists[i]){
+			QDomElement f = doc.createElement(formatListTags[i]);
+			f.setAttribute("description", ff.description);
+			f.setAttribute("extensions", ff.extensions.join(';'));
+			elem.appendChild(f);
+		}
+	}
+	if (!functionSignatures.isEmpty()){
+		QDomElement f = doc.createElement("FunctionSignatures");
+		f.appendChild(doc.createTextNode(functionSignatures));
+		elem.appendChild(f);
+	}
+	return elem;
+}
+
+bool PluginMetadata::fromXML(const QDomElement& elem, PluginMetadata& md)
+{
+	bool ok1, ok2, ok3;
+	md = PluginMetadata();
+	md.fileName = elem.attribute("fileName");
+	md.lastModified = elem.attribute("lastModified").toLongLong(&ok1);
+	md.fileSize = elem.attribute("fileSize").toLongLong(&ok2);
+	md.pluginName = elem.attribute("name");
+	md.type = elem.attribute("type").toInt(&ok3);
+	if (!ok1 || !ok2 || !ok3 || md.fileName.isEmpty())
+		return false;
+
+	for (QDomElement f = elem.firstChildElement(); !f.isNull(); f = f.nextSiblingElement()){
+		if (f.tagName() == "Filter"){
+			md.filterNames.push_back(f.attribute("name"));
+		}
+		else if (f.tagName() == "FunctionSignatures"){
+			md.functionSignatures = f.text();
+		}
+		else {
+			for (unsigned int i = 0; i < 6; ++i){
+				if (f.tagName() == formatListTags[i]){
+					(md.*formatLists[i]).push_back(FileFormat(
+						f.attribute("description"),
+						f.attribute("extensions").split(';', Qt::SkipEmptyParts)));
+				}
+			}
+		}
+	}
+	return true;
+}
+
+PluginMetadataCache::PluginMetadataCache() : modified(false)
+{
+}
+
+/**
+ * @brief Returns the default path of the cache file, in the user cache
+ * directory. The file name depends on the MeshLab version and precision.
+ */
+QString PluginMetadataCache::defaultFileName()
+{
+	QString dir = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+	if (dir.isEmpty())
+		return QString();
+	return dir + "/MeshLab/plugins_" + QString::fromStdString(meshlab::meshlabVersion()) +
+		(meshlab::builtWithDoublePrecision() ? "_d" : "") + ".xml";
+}
+
+/**
+ * @brief Loads the cache from the given file, replacing the current content.
+ * Returns false (and leaves the cache empty) if the file does not exist, is
+ * not valid or has been written by a different MeshLab version.
+ */
+bool PluginMetadataCache::load(const QString& fileName)
+{
+	plugins.clear();
+	modified = false;
+
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		return false;
+	QDomDocument doc;
+	if (!doc.setContent(&file))
+		return false;
+
+	QDomElement root = doc.documentElement();
+	if (root.tagName() != "PluginMetadataCache" ||
+		root.attribute("version") != QString::fromStdString(meshlab::meshlabVersion()) ||
+		root.attribute("doublePrecision").toInt() != int(meshlab::builtWithDoublePrecision()))
+		return false;
+
+	for (QDomElement e = root.firstChildElement("Plugin"); !e.isNull(); e = e.nextSiblingElement("Plugin")){
+		PluginMetadata md;
+		if (PluginMetadata::fromXML(e, md))
+			plugins[md.fileName] = md;
+	}
+	return true;
+}
+
+/**
+ * @brief Saves the cache in the given file. The file is replaced atomically,
+ * therefore concurrent MeshLab processes never read a partially written cache.
+ */
+bool PluginMetadataCache::save(const QString& fileName) const
+{
+	QDomDocument doc;
+	QDomElement root = doc.createElement("PluginMetadataCache");
+	root.setAttribute("version", QString::fromStdString(meshlab::meshlabVersion()));
+	root.setAttribute("doublePrecision", int(meshlab::builtWithDoublePrecision()));
+	doc.appendChild(root);
+	for (const auto& p : plugins)
+		root.appendChild(p.second.toXML(doc));
+
+	QDir().mkpath(QFileInfo(fileName).absolutePath());
+	QSaveFile file(fileName);
+	if (!file.open(QIODevice::WriteOnly))
+		return false;
+	QTextStream stream(&file);
+	stream.setCodec("UTF-8");
+	doc.save(stream, 1);
+	stream.flush();
+	if (!file.commit())
+		return false;
+	modified = false;
+	return true;
+}
+
+bool PluginMetadataCache::isModified() const
+{
+	return modified;
+}
+
+/**
+ * @brief Returns the metadata of the given library, or nullptr if it is not in
+ * the cache or if the library has been modified after it was cached.
+ */
+const PluginMetadata* PluginMetadataCache::find(const QString& pluginFile) const
+{
+	auto it = plugins.find(QFileInfo(pluginFile).absoluteFilePath());
+	if (it == plugins.end() || !it->second.isUpToDate())
+		return nullptr;
+	return &it->second;
+}
+
+/**
+ * @brief Inserts (or updates) the metadata of a library, and returns the
+ * stored metadata. If the cache already contains the same metadata, the
+ * cache is not marked as modified and the function signatures already cached
+ * for the same version of the library are kept.
+ */
+const PluginMetadata& PluginMetadataCache::insert(const PluginMetadata& md)
+{
+	auto it = plugins.find(md.fileName);
+	if (it != plugins.end()){
+		const PluginMetadata& old = it->second;
+		bool same =
+			old.lastModified == md.lastModified && old.fileSize == md.fileSize &&
+			old.type == md.type && old.pluginName == md.pluginName &&
+			old.filterNames == md.filterNames;
+		for (unsigned int i = 0; same && i < 6; ++i)
+			same = sameFormats(old.*formatLists[i], md.*formatLists[i]);
+		if (same)
+			return old;
+	}
+	modified = true;
+	return plugins[md.fileName] = md;
+}
+
+void PluginMetadataCache::erase(const QString& pluginFile)
+{
+	if (plugins.erase(QFileInfo(pluginFile).absoluteFilePath()) > 0)
+		modified = true;
+}
+
+void PluginMetadataCache::setFunctionSignatures(const QString& pluginFile, const QString& signatures)
+{
+	auto it = plugins.find(QFileInfo(pluginFile).absoluteFilePath());
+	if (it != plugins.end() && it->second.functionSignatures != signatures){
+		it->second.functionSignatures = signatures;
+		modified = true;
+	}
+}
@@ -0,0 +1,110 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MESHLAB_PLUGIN_METADATA_CACHE_H
+#define MESHLAB_PLUGIN_METADATA_CACHE_H
+
+#include <list>
+#include <map>
+
+#include <QFileInfo>
+#include <QString>
+#include <QStringList>
+
+#include "../utilities/file_format.h"
+#include "meshlab_plugin_type.h"
+
+class QDomDocument;
+class QDomElement;
+
+/**
+ * @brief The PluginMetadata class contains all the information of a plugin
+ * library that the PluginManager needs before instantiating the plugin:
+ * its type, the names of its filters and the file formats it supports.
+ *
+ * The metadata refers to a particular version of the library file, identified
+ * by its last modification time and size.
+ */
+class PluginMetadata
+{
+public:
+	PluginMetadata();
+	PluginMetadata(const QFileInfo& file, const MeshLabPlugin* plugin);
+
+	bool isUpToDate() const;
+	MeshLabPluginType pluginType() const;
+	bool hasFilter(const QString& filterName) const;
+	static bool supportsFormat(const std::list<FileFormat>& formats, const QString& format);
+
+	QDomElement toXML(QDomDocument& doc) const;
+	static bool fromXML(const QDomElement& elem, PluginMetadata& md);
+
+	QString fileName; // absolute path of the library
+	qint64  lastModified;
+	qint64  fileSize;
+	QString pluginName;
+	int     type; // see MeshLabPluginType::flags()
+
+	QStringList           filterNames; // text of the filter actions
+	std::list<FileFormat> importFormats;
+	std::list<FileFormat> exportFormats;
+	std::list<FileFormat> importImageFormats;
+	std::list<FileFormat> exportImageFormats;
+	std::list<FileFormat> importProjectFormats;
+	std::list<FileFormat> exportProjectFormats;
+
+	// signatures of the python functions of the plugin; they are computed and
+	// read by pymeshlab::FunctionSet, and are empty until then
+	QString functionSignatures;
+};
+
+/**
+ * @brief The PluginMetadataCache class is a persistent (xml file) collection
+ * of the metadata of the plugin libraries, indexed by their absolute path.
+ *
+ * Entries are valid only if the library has not been modified since they
+ * have been stored, and the whole cache is discarded if it was written by a
+ * different MeshLab version.
+ */
+class PluginMetadataCache
+{
+public:
+	PluginMetadataCache();
+
+	static QString defaultFileName();
+
+	bool load(const QString& fileName);
+	bool save(const QString& fileName) const;
+	bool isModified() const;
+
+	const PluginMetadata* find(const QString& pluginFile) const;
+	const PluginMetadata& insert(const PluginMetadata& md);
+	void erase(const QString& pluginFile);
+	void setFunctionSignatures(const QString& pluginFile, const QString& signatures);
+
+private:
+	std::map<QString, PluginMetadata> plugins;
+	mutable bool modified;
+};
+
+#endif // MESHLAB_PLUGIN_METADATA_CACHE_H
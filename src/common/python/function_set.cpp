@@ -22,6 +22,7 @@
 ****************************************************************************/
 #include "function_set.h"
 
+#include <QDomDocument>
 #include <QRegularExpression>
 #include "../mlexception.h"
 #include <algorithm>
@@ -38,16 +39,49 @@ pymeshlab::FunctionSet::FunctionSet(const PluginManager& pm)
 	//the mesh used is a 1x1x1 cube (with extremes [-0.5; 0.5])
 	initDummyMeshDocument();
 
-	for (IOPlugin* iop : pm.ioPluginIterator()){
-		loadIOPlugin(iop);
+	std::vector<PluginMetadata> plugins = pm.pluginMetadataList();
+	std::vector<PluginFunctions> funs(plugins.size());
+	for (unsigned int i = 0; i < plugins.size(); ++i){
+		const PluginMetadata& md = plugins[i];
+		MeshLabPluginType type = md.pluginType();
+		if (!type.isIOPlugin() && !type.isFilterPlugin())
+			continue;
+		if (readFunctionSignatures(md.functionSignatures, funs[i]))
+			continue;
+
+		// not cached (or not cacheable): the plugin needs to be instantiated
+		MeshLabPlugin* plugin = pm.pluginInstance(md.fileName);
+		if (plugin == nullptr)
+			continue;
+		if (type.isIOPlugin())
+			ioPluginFunctions(dynamic_cast<IOPlugin*>(plugin), funs[i]);
+		if (type.isFilterPlugin())
+			filterPluginFunctions(dynamic_cast<FilterPlugin*>(plugin), funs[i]);
+		if (md.functionSignatures.isEmpty())
+			pm.setFunctionSignatures(md.fileName, writeFunctionSignatures(funs[i]));
 	}
+	pm.saveMetadataCache();
 
-	for (FilterPlugin* fp : pm.filterPluginIterator()){
-		loadFilterPlugin(fp);
+	for (const PluginFunctions& f : funs){
+		insert(f);
 	}
 }
 
 void pymeshlab::FunctionSet::loadFilterPlugin(FilterPlugin* fp)
+{
+	PluginFunctions funs;
+	filterPluginFunctions(fp, funs);
+	insert(funs);
+}
+
+void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
+{
+	PluginFunctions funs;
+	ioPluginFunctions(iop, funs);
+	insert(funs);
+}
+
+void pymeshlab::FunctionSet::filterPluginFunctions(FilterPlugin* fp, PluginFunctions& funs)
 {
 	for (QAction* act : fp->actions()) {
 		QString originalFilterName = fp->filterName(act);
@@ -61,7 +95,7 @@ void pymeshlab::FunctionSet::loadFilterPlugin(FilterPlugin* fp)
 			FunctionParameter par(rp);
 			f.addParameter(par);
 		}
-		filterSet.insert(f);
+		funs.filters.push_back(f);
 
 		// Just for actual PyMeshLab version; this portion of code will be removed soon
 		QString oldPythonFilterName = computePythonName(fp->filterName(act));
@@ -69,11 +103,11 @@ void pymeshlab::FunctionSet::loadFilterPlugin(FilterPlugin* fp)
 		f.setDeprecated("You should use '" + pythonFilterName.toStdString() +
 						"' instead of '" + oldPythonFilterName.toStdString() + "'. See "
 						"https://pymeshlab.readthedocs.io/en/latest/index.html#filters-renaming");
-		filterSet.insert(f);
+		funs.filters.push_back(f);
 	}
 }
 
-void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
+void pymeshlab::FunctionSet::ioPluginFunctions(IOPlugin* iop, PluginFunctions& funs)
 {
 	for (const FileFormat& ff : iop->importFormats()){
 		for (const QString& inputFormat : ff.extensions){
@@ -93,7 +127,7 @@ void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
 				FunctionParameter par(rp);
 				f.addParameter(par);
 			}
-			loadMeshSet.insert(f);
+			funs.loadMesh.push_back(f);
 		}
 	}
 
@@ -137,7 +171,7 @@ void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
 			//data to save
 			updateSaveParameters(iop, outputFormat, f);
 
-			saveMeshSet.insert(f);
+			funs.saveMesh.push_back(f);
 		}
 	}
 
@@ -154,9 +188,118 @@ void pymeshlab::FunctionSet::loadIOPlugin(IOPlugin* iop)
 			FunctionParameter par(of);
 			f.addParameter(par);
 
-			loadImageSet.insert(f);
+			funs.loadImage.push_back(f);
+		}
+	}
+}
+
+void pymeshlab::FunctionSet::insert(const PluginFunctions& funs)
+{
+	for (const Function& f : funs.filters)
+		filterSet.insert(f);
+	for (const Function& f : funs.loadMesh)
+		loadMeshSet.insert(f);
+	for (const Function& f : funs.saveMesh)
+		saveMeshSet.insert(f);
+	for (const Function& f : funs.loadImage)
+		loadImageSet.insert(f);
+}
+
+/**
+ * @brief Serializes the functions of a plugin in a xml string.
+ * Each parameter is written and read back: if some parameter cannot be
+ * restored exactly (e.g. shot parameters, that have no xml representation),
+ * the functions are marked as not cacheable.
+ */
+QString pymeshlab::FunctionSet::writeFunctionSignatures(const PluginFunctions& funs)
+{
+	QDomDocument doc;
+	QDomElement root = doc.createElement("Functions");
+	doc.appendChild(root);
+
+	bool cacheable = true;
+	const std::list<Function>* sets[4] = {&funs.filters, &funs.loadMesh, &funs.saveMesh, &funs.loadImage};
+	const char* setNames[4] = {"filter", "loadMesh", "saveMesh", "loadImage"};
+	for (unsigned int i = 0; i < 4 && cacheable; ++i){
+		for (const Function& f : *sets[i]){
+			QDomElement fe = doc.createElement("Function");
+			fe.setAttribute("set", setNames[i]);
+			fe.setAttribute("pythonName", f.pythonFunctionName());
+			fe.setAttribute("meshlabName", f.meshlabFunctionName());
+			fe.setAttribute("description", f.description());
+			fe.setAttribute("deprecated", QString::fromStdString(f.deprecatedString()));
+			for (const FunctionParameter& fp : f){
+				const RichParameter& rp = fp.richParameter();
+				if (rp.value().isShotf()){
+					cacheable = false;
+					break;
+				}
+				QDomElement pe = rp.fillToXMLDocument(doc);
+				RichParameter* restored = nullptr;
+				bool sameParameter =
+					RichParameterAdapter::create(pe, restored) &&
+					restored->stringType() == rp.stringType() &&
+					restored->fieldDescription() == rp.fieldDescription() &&
+					restored->toolTip() == rp.toolTip() &&
+					*restored == rp;
+				delete restored;
+				if (!sameParameter){
+					cacheable = false;
+					break;
+				}
+				fe.appendChild(pe);
+			}
+			root.appendChild(fe);
+		}
+	}
+	if (!cacheable)
+		return "<Functions cacheable=\"0\"/>";
+	root.setAttribute("cacheable", 1);
+	return doc.toString(-1);
+}
+
+/**
+ * @brief Reads the functions of a plugin written by writeFunctionSignatures.
+ * Returns false if the signatures are empty, not valid or not cacheable.
+ */
+bool pymeshlab::FunctionSet::readFunctionSignatures(const QString& signatures, PluginFunctions& funs)
+{
+	if (signatures.isEmpty())
+		return false;
+	QDomDocument doc;
+	if (!doc.setContent(signatures))
+		return false;
+	QDomElement root = doc.documentElement();
+	if (root.tagName() != "Functions" || root.attribute("cacheable") != "1")
+		return false;
+
+	PluginFunctions res;
+	for (QDomElement fe = root.firstChildElement("Function"); !fe.isNull(); fe = fe.nextSiblingElement("Function")){
+		Function f(fe.attribute("pythonName"), fe.attribute("meshlabName"), fe.attribute("description"));
+		QString deprecated = fe.attribute("deprecated");
+		if (!deprecated.isEmpty())
+			f.setDeprecated(deprecated.toStdString());
+		for (QDomElement pe = fe.firstChildElement("Param"); !pe.isNull(); pe = pe.nextSiblingElement("Param")){
+			RichParameter* rp = nullptr;
+			if (!RichParameterAdapter::create(pe, rp))
+				return false;
+			f.addParameter(FunctionParameter(*rp));
+			delete rp;
 		}
+		QString set = fe.attribute("set");
+		if (set == "filter")
+			res.filters.push_back(f);
+		else if (set == "loadMesh")
+			res.loadMesh.push_back(f);
+		else if (set == "saveMesh")
+			res.saveMesh.push_back(f);
+		else if (set == "loadImage")
+			res.loadImage.push_back(f);
+		else
+			return false;
 	}
+	funs = res;
+	return true;
 }
 
 std::list<std::string> pymeshlab::FunctionSet::pythonFilterFunctionNames() const
@@ -43,6 +43,12 @@ namespace pymeshlab {
  * This cointainer just allows to access and iterate through all the contained
  * Functions. Please refer to the pymeshlab::Function class to see how to manage
  * a Function.
+ *
+ * The functions of each plugin are computed once (calling initParameterList
+ * and the other parameter initialization functions of the plugin on a dummy
+ * mesh) and stored as function signatures in the plugin metadata cache of the
+ * PluginManager: in the next runs they are read from the cache, without
+ * instantiating the plugin.
  */
 class FunctionSet
 {
@@ -86,6 +92,20 @@ public:
 	FunctionRangeIterator loadRasterFunctionIterator() const;
 
 private:
+	struct PluginFunctions
+	{
+		std::list<Function> filters;
+		std::list<Function> loadMesh;
+		std::list<Function> saveMesh;
+		std::list<Function> loadImage;
+	};
+
+	void filterPluginFunctions(FilterPlugin* fp, PluginFunctions& funs);
+	void ioPluginFunctions(IOPlugin* iop, PluginFunctions& funs);
+	void insert(const PluginFunctions& funs);
+	static QString writeFunctionSignatures(const PluginFunctions& funs);
+	static bool readFunctionSignatures(const QString& signatures, PluginFunctions& funs);
+
 	void updateSaveParameters(
 			IOPlugin* plugin,
 			const QString& outputFormat,
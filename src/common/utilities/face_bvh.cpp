@@ -0,0 +1,633 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "face_bvh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace meshlab {
+
+namespace {
+
+const int     BIN_NUMBER    = 16;
+const int     MAX_LEAF_SIZE = 4;
+const int     STACK_SIZE    = 128;
+const int     MAX_DEPTH     = STACK_SIZE - 2;
+const Scalarm TRAVERSAL_COST = 1; // relative to the cost of a ray-triangle test
+
+Scalarm halfArea(const Box3m& b)
+{
+	if (b.IsNull())
+		return 0;
+	Point3m d = b.Dim();
+	return d[0] * d[1] + d[1] * d[2] + d[2] * d[0];
+}
+
+} // namespace
+
+FaceBVH::FaceBVH()
+{
+}
+
+FaceBVH::FaceBVH(const CMeshO& m, const Matrix44m& tr)
+{
+	build(m, tr);
+}
+
+/**
+ * @brief Builds the hierarchy over the non deleted faces of m, transformed
+ * by tr (which is usually the identity or the Tr matrix of the mesh).
+ *
+ * Each node is split along the axis of maximum extent of the centroids of
+ * its faces, at the position that minimizes the SAH cost estimated on
+ * BIN_NUMBER uniform bins. The two children of an inner node are stored
+ * in consecutive positions.
+ */
+void FaceBVH::build(const CMeshO& m, const Matrix44m& tr)
+{
+	clear();
+
+	std::vector<Box3m>   faceBox;
+	std::vector<Point3m> centroid;
+	std::vector<int>     order;
+	faceBox.reserve(m.fn);
+	centroid.reserve(m.fn);
+	order.reserve(m.fn);
+	triV0.reserve(m.fn);
+	triE1.reserve(m.fn);
+	triE2.reserve(m.fn);
+
+	std::vector<int> meshFace;
+	meshFace.reserve(m.fn);
+	for (unsigned int i = 0; i < m.face.size(); ++i) {
+		const CFaceO& f = m.face[i];
+		if (f.IsD())
+			continue;
+		Point3m p0 = tr * f.cP(0);
+		Point3m p1 = tr * f.cP(1);
+		Point3m p2 = tr * f.cP(2);
+		Box3m   b;
+		b.Add(p0);
+		b.Add(p1);
+		b.Add(p2);
+		order.push_back((int) faceBox.size());
+		meshFace.push_back(i);
+		faceBox.push_back(b);
+		centroid.push_back((p0 + p1 + p2) / 3);
+		triV0.push_back(p0);
+		triE1.push_back(p1 - p0);
+		triE2.push_back(p2 - p0);
+	}
+	if (order.empty())
+		return;
+
+	struct BuildItem
+	{
+		int node;
+		int begin;
+		int end;
+		int depth;
+	};
+	std::vector<BuildItem> stack;
+	nodes.reserve(2 * order.size());
+	nodes.push_back(Node());
+	stack.push_back({0, 0, (int) order.size(), 0});
+
+	while (!stack.empty()) {
+		BuildItem item = stack.back();
+		stack.pop_back();
+
+		Box3m box, centroidBox;
+		for (int i = item.begin; i < item.end; ++i) {
+			box.Add(faceBox[order[i]]);
+			centroidBox.Add(centroid[order[i]]);
+		}
+		nodes[item.node].bmin  = box.min;
+		nodes[item.node].bmax  = box.max;
+		nodes[item.node].first = item.begin;
+		nodes[item.node].count = item.end - item.begin;
+
+		const int count = item.end - item.begin;
+		if (count <= MAX_LEAF_SIZE || item.depth >= MAX_DEPTH)
+			continue;
+
+		const int     axis   = centroidBox.MaxDim();
+		const Scalarm cmin   = centroidBox.min[axis];
+		const Scalarm extent = centroidBox.max[axis] - cmin;
+		int           mid    = item.begin;
+
+		if (extent > 0) {
+			Box3m binBox[BIN_NUMBER];
+			int   binCount[BIN_NUMBER] = {0};
+			const Scalarm scale = BIN_NUMBER / extent;
+			auto binOf = [&](int f) {
+				return std::min(BIN_NUMBER - 1, int((centroid[f][axis] - cmin) * scale));
+			};
+			for (int i = item.begin; i < item.end; ++i) {
+				int b = binOf(order[i]);
+				binBox[b].Add(faceBox[order[i]]);
+				++binCount[b];
+			}
+
+			// cost of the split placed after bin i: rightCost[i] sweeps from the right
+			Scalarm rightCost[BIN_NUMBER];
+			Box3m   acc;
+			int     accCount = 0;
+			for (int i = BIN_NUMBER - 1; i > 0; --i) {
+				acc.Add(binBox[i]);
+				accCount += binCount[i];
+				rightCost[i - 1] = halfArea(acc) * accCount;
+			}
+			acc.SetNull();
+			accCount          = 0;
+			int     bestSplit = -1;
+			Scalarm bestCost  = std::numeric_limits<Scalarm>::max();
+			for (int i = 0; i < BIN_NUMBER - 1; ++i) {
+				acc.Add(binBox[i]);
+				accCount += binCount[i];
+				Scalarm cost = halfArea(acc) * accCount + rightCost[i];
+				if (accCount > 0 && accCount < count && cost < bestCost) {
+					bestCost  = cost;
+					bestSplit = i;
+				}
+			}
+
+			const Scalarm leafCost = halfArea(box) * count;
+			const Scalarm splitCost = TRAVERSAL_COST * halfArea(box) + bestCost;
+			if (bestSplit >= 0 && splitCost < leafCost) {
+				mid = int(
+					std::partition(
+						order.begin() + item.begin,
+						order.begin() + item.end,
+						[&](int f) { return binOf(f) <= bestSplit; }) -
+					order.begin());
+			}
+			else if (count <= 4 * MAX_LEAF_SIZE) {
+				continue; // splitting does not pay off
+			}
+		}
+
+		if (mid == item.begin || mid == item.end) {
+			// degenerate distribution of the centroids: median split
+			mid = item.begin + count / 2;
+			std::nth_element(
+				order.begin() + item.begin,
+				order.begin() + mid,
+				order.begin() + item.end,
+				[&](int a, int b) { return centroid[a][axis] < centroid[b][axis]; });
+		}
+
+		const int left         = (int) nodes.size();
+		nodes[item.node].first = left;
+		nodes[item.node].count = 0;
+		nodes.push_back(Node());
+		nodes.push_back(Node());
+		stack.push_back({left + 1, mid, item.end, item.depth + 1});
+		stack.push_back({left, item.begin, mid, item.depth + 1});
+	}
+
+	// store the triangles in leaf order
+	std::vector<Point3m> v0(order.size()), e1(order.size()), e2(order.size());
+	faceIndex.resize(order.size());
+	for (unsigned int i = 0; i < order.size(); ++i) {
+		faceIndex[i] = meshFace[order[i]];
+		v0[i]        = triV0[order[i]];
+		e1[i]        = triE1[order[i]];
+		e2[i]        = triE2[order[i]];
+	}
+	triV0.swap(v0);
+	triE1.swap(e1);
+	triE2.swap(e2);
+}
+
+void FaceBVH::clear()
+{
+	nodes.clear();
+	faceIndex.clear();
+	triV0.clear();
+	triE1.clear();
+	triE2.clear();
+}
+
+bool FaceBVH::isEmpty() const
+{
+	return nodes.empty();
+}
+
+unsigned int FaceBVH::faceNumber() const
+{
+	return faceIndex.size();
+}
+
+unsigned int FaceBVH::nodeNumber() const
+{
+	return nodes.size();
+}
+
+Box3m FaceBVH::boundingBox() const
+{
+	Box3m b;
+	if (!nodes.empty()) {
+		b.min = nodes[0].bmin;
+		b.max = nodes[0].bmax;
+	}
+	return b;
+}
+
+/**
+ * @brief Returns the closest intersection of the ray orig + t*dir with
+ * t in [tMin, tMax]. Returns false if there is no intersection.
+ */
+bool FaceBVH::closestHit(
+	const Point3m& orig,
+	const Point3m& dir,
+	Scalarm        tMin,
+	Scalarm        tMax,
+	RayHit&        hit) const
+{
+	if (nodes.empty())
+		return false;
+	Ray r     = makeRay(orig, dir, tMin, tMax);
+	int found = -1;
+	int stack[STACK_SIZE];
+	int sp     = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		Scalarm     tEntry;
+		if (!intersectBox(n, r, tEntry))
+			continue;
+		if (n.count > 0) {
+			for (int i = n.first; i < n.first + n.count; ++i) {
+				Scalarm t, u, v;
+				if (intersectTriangle(i, r, t, u, v)) {
+					r.tMax = t;
+					found  = i;
+					hit.u  = u;
+					hit.v  = v;
+				}
+			}
+		}
+		else {
+			// visit the nearest child first
+			Scalarm tl, tr;
+			bool    hl = intersectBox(nodes[n.first], r, tl);
+			bool    hr = intersectBox(nodes[n.first + 1], r, tr);
+			if (hl && hr) {
+				if (tl <= tr) {
+					stack[sp++] = n.first + 1;
+					stack[sp++] = n.first;
+				}
+				else {
+					stack[sp++] = n.first;
+					stack[sp++] = n.first + 1;
+				}
+			}
+			else if (hl) {
+				stack[sp++] = n.first;
+			}
+			else if (hr) {
+				stack[sp++] = n.first + 1;
+			}
+		}
+	}
+	if (found < 0)
+		return false;
+	hit.face   = faceIndex[found];
+	hit.t      = r.tMax;
+	hit.normal = triE1[found] ^ triE2[found];
+	return true;
+}
+
+/**
+ * @brief Returns true if the ray orig + t*dir, with t in [tMin, tMax],
+ * intersects any face. The traversal stops at the first intersection found.
+ */
+bool FaceBVH::isOccluded(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax) const
+{
+	if (nodes.empty())
+		return false;
+	Ray r = makeRay(orig, dir, tMin, tMax);
+	int stack[STACK_SIZE];
+	int sp     = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		Scalarm     tEntry;
+		if (!intersectBox(n, r, tEntry))
+			continue;
+		if (n.count > 0) {
+			for (int i = n.first; i < n.first + n.count; ++i) {
+				Scalarm t, u, v;
+				if (intersectTriangle(i, r, t, u, v))
+					return true;
+			}
+		}
+		else {
+			stack[sp++] = n.first + 1;
+			stack[sp++] = n.first;
+		}
+	}
+	return false;
+}
+
+/**
+ * @brief Returns the number of faces intersected by the ray orig + t*dir,
+ * with t in [tMin, tMax] (i.e. the depth complexity along the ray).
+ */
+unsigned int FaceBVH::countHits(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax) const
+{
+	if (nodes.empty())
+		return 0;
+	Ray          r     = makeRay(orig, dir, tMin, tMax);
+	unsigned int count = 0;
+	int          stack[STACK_SIZE];
+	int          sp     = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		Scalarm     tEntry;
+		if (!intersectBox(n, r, tEntry))
+			continue;
+		if (n.count > 0) {
+			for (int i = n.first; i < n.first + n.count; ++i) {
+				Scalarm t, u, v;
+				if (intersectTriangle(i, r, t, u, v))
+					++count;
+			}
+		}
+		else {
+			stack[sp++] = n.first + 1;
+			stack[sp++] = n.first;
+		}
+	}
+	return count;
+}
+
+/**
+ * @brief Finds the point of the faces closest to p, within distance
+ * maxDist. Returns false if there are no faces within maxDist.
+ *
+ * If hit.tri is set by a previous query (usually at a nearby point), that
+ * triangle is tested first and its distance bounds the search: for
+ * sequences of coherent queries most of the nodes are then culled. The
+ * result does not depend on the hint, except for the choice among faces at
+ * exactly the same distance.
+ */
+bool FaceBVH::closestPoint(const Point3m& p, Scalarm maxDist, PointHit& hit) const
+{
+	if (nodes.empty())
+		return false;
+	int     found = -1;
+	Scalarm best2 = maxDist * maxDist;
+	Scalarm bu = 0, bv = 0;
+	if (hit.tri >= 0 && hit.tri < (int) faceIndex.size()) {
+		Scalarm u, v;
+		Scalarm d2 = closestTrianglePoint(hit.tri, p, u, v);
+		if (d2 <= best2) {
+			best2 = d2;
+			found = hit.tri;
+			bu    = u;
+			bv    = v;
+		}
+	}
+	int stack[STACK_SIZE];
+	int sp     = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const Node& n = nodes[stack[--sp]];
+		if (squaredBoxDistance(n, p) >= best2)
+			continue;
+		if (n.count > 0) {
+			for (int i = n.first; i < n.first + n.count; ++i) {
+				Scalarm u, v;
+				Scalarm d2 = closestTrianglePoint(i, p, u, v);
+				if (d2 < best2) {
+					best2 = d2;
+					found = i;
+					bu    = u;
+					bv    = v;
+				}
+			}
+		}
+		else {
+			// visit the nearest child first
+			Scalarm dl = squaredBoxDistance(nodes[n.first], p);
+			Scalarm dr = squaredBoxDistance(nodes[n.first + 1], p);
+			if (dl <= dr) {
+				stack[sp++] = n.first + 1;
+				stack[sp++] = n.first;
+			}
+			else {
+				stack[sp++] = n.first;
+				stack[sp++] = n.first + 1;
+			}
+		}
+	}
+	if (found < 0)
+		return false;
+	hit.face  = faceIndex[found];
+	hit.tri   = found;
+	hit.dist  = std::sqrt(best2);
+	hit.u     = bu;
+	hit.v     = bv;
+	hit.point = triV0[found] + triE1[found] * bu + triE2[found] * bv;
+	return true;
+}
+
+/**
+ * @brief Collects the faces in a region, given by a classifier of the boxes
+ * of the nodes. The faces of the nodes classified as INSIDE are appended to
+ * inside; the ones of the STRADDLING leaves, that must be tested by the
+ * caller, are appended to straddling. Faces are appended in leaf order.
+ */
+void FaceBVH::regionQuery(
+	const BoxClassifier& classify,
+	std::vector<int>&    inside,
+	std::vector<int>&    straddling) const
+{
+	if (nodes.empty())
+		return;
+	int stack[STACK_SIZE];
+	int sp     = 0;
+	stack[sp++] = 0;
+	while (sp > 0) {
+		const int   ni = stack[--sp];
+		const Node& n  = nodes[ni];
+		Box3m       b(n.bmin, n.bmax);
+		BoxClass    c = classify(b);
+		if (c == OUTSIDE)
+			continue;
+		if (c == INSIDE) {
+			// the faces of a subtree are contiguous: the range goes from the
+			// leftmost to the rightmost leaf
+			int lo = ni, hi = ni;
+			while (nodes[lo].count == 0)
+				lo = nodes[lo].first;
+			while (nodes[hi].count == 0)
+				hi = nodes[hi].first + 1;
+			inside.insert(
+				inside.end(),
+				faceIndex.begin() + nodes[lo].first,
+				faceIndex.begin() + nodes[hi].first + nodes[hi].count);
+		}
+		else if (n.count > 0) {
+			straddling.insert(
+				straddling.end(), faceIndex.begin() + n.first, faceIndex.begin() + n.first + n.count);
+		}
+		else {
+			stack[sp++] = n.first + 1;
+			stack[sp++] = n.first;
+		}
+	}
+}
+
+FaceBVH::Ray FaceBVH::makeRay(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax)
+{
+	// avoid infinities * 0 in the slab test
+	const Scalarm tiny = std::numeric_limits<Scalarm>::min();
+	Ray           r;
+	r.orig = orig;
+	r.dir  = dir;
+	for (int i = 0; i < 3; ++i) {
+		Scalarm d   = std::abs(dir[i]) > tiny ? dir[i] : (dir[i] < 0 ? -tiny : tiny);
+		r.invDir[i] = Scalarm(1) / d;
+	}
+	r.tMin = tMin;
+	r.tMax = tMax;
+	return r;
+}
+
+bool FaceBVH::intersectBox(const Node& n, const Ray& r, Scalarm& tEntry)
+{
+	Scalarm t0 = r.tMin;
+	Scalarm t1 = r.tMax;
+	for (int i = 0; i < 3; ++i) {
+		Scalarm tNear = (n.bmin[i] - r.orig[i]) * r.invDir[i];
+		Scalarm tFar  = (n.bmax[i] - r.orig[i]) * r.invDir[i];
+		if (tNear > tFar)
+			std::swap(tNear, tFar);
+		t0 = std::max(t0, tNear);
+		t1 = std::min(t1, tFar);
+		if (t0 > t1)
+			return false;
+	}
+	tEntry = t0;
+	return true;
+}
+
+/**
+ * Moller-Trumbore ray-triangle intersection, two-sided.
+ */
+bool FaceBVH::intersectTriangle(int tri, const Ray& r, Scalarm& t, Scalarm& u, Scalarm& v) const
+{
+	const Point3m& e1  = triE1[tri];
+	const Point3m& e2  = triE2[tri];
+	Point3m        p   = r.dir ^ e2;
+	Scalarm        det = e1 * p;
+	if (det == 0)
+		return false;
+	Scalarm invDet = Scalarm(1) / det;
+	Point3m s      = r.orig - triV0[tri];
+	u              = (s * p) * invDet;
+	if (u < 0 || u > 1)
+		return false;
+	Point3m q = s ^ e1;
+	v         = (r.dir * q) * invDet;
+	if (v < 0 || u + v > 1)
+		return false;
+	t = (e2 * q) * invDet;
+	return t >= r.tMin && t <= r.tMax;
+}
+
+Scalarm FaceBVH::squaredBoxDistance(const Node& n, const Point3m& p)
+{
+	Scalarm d2 = 0;
+	for (int i = 0; i < 3; ++i) {
+		Scalarm d = 0;
+		if (p[i] < n.bmin[i])
+			d = n.bmin[i] - p[i];
+		else if (p[i] > n.bmax[i])
+			d = p[i] - n.bmax[i];
+		d2 += d * d;
+	}
+	return d2;
+}
+
+/**
+ * Closest point of a triangle (Ericson, Real-Time Collision Detection,
+ * 5.1.5): returns the squared distance and the barycentric coords of the
+ * point w.r.t. V1 and V2.
+ */
+Scalarm FaceBVH::closestTrianglePoint(int tri, const Point3m& p, Scalarm& u, Scalarm& v) const
+{
+	const Point3m& ab = triE1[tri];
+	const Point3m& ac = triE2[tri];
+	const Point3m  ap = p - triV0[tri];
+	const Scalarm  d1 = ab * ap;
+	const Scalarm  d2 = ac * ap;
+	u = v = 0;
+	if (d1 <= 0 && d2 <= 0) {
+		// vertex region of V0
+	}
+	else {
+		const Point3m bp = ap - ab;
+		const Scalarm d3 = ab * bp;
+		const Scalarm d4 = ac * bp;
+		const Point3m cp = ap - ac;
+		const Scalarm d5 = ab * cp;
+		const Scalarm d6 = ac * cp;
+		const Scalarm vc = d1 * d4 - d3 * d2;
+		const Scalarm vb = d5 * d2 - d1 * d6;
+		const Scalarm va = d3 * d6 - d5 * d4;
+		if (d3 >= 0 && d4 <= d3) {
+			u = 1;
+		}
+		else if (vc <= 0 && d1 >= 0 && d3 <= 0) {
+			u = d1 / (d1 - d3);
+		}
+		else if (d6 >= 0 && d5 <= d6) {
+			v = 1;
+		}
+		else if (vb <= 0 && d2 >= 0 && d6 <= 0) {
+			v = d2 / (d2 - d6);
+		}
+		else if (va <= 0 && d4 - d3 >= 0 && d5 - d6 >= 0) {
+			v = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+			u = 1 - v;
+		}
+		else {
+			const Scalarm sum = va + vb + vc;
+			if (sum > 0) {
+				u = vb / sum;
+				v = vc / sum;
+			}
+		}
+	}
+	Point3m d = ap - ab * u - ac * v;
+	return d * d;
+}
+
+} // namespace meshlab
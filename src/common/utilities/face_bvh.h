@@ -0,0 +1,134 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef MESHLAB_FACE_BVH_H
+#define MESHLAB_FACE_BVH_H
+
+#include "../ml_document/cmesh.h"
+
+#include <functional>
+#include <vector>
+
+namespace meshlab {
+
+/**
+ * @brief The FaceBVH class is a bounding volume hierarchy over the (non
+ * deleted) faces of a CMeshO, built with the binned Surface Area Heuristic.
+ *
+ * The BVH stores its own copy of the triangles, therefore it does not
+ * depend on the mesh after its construction (the mesh can be modified, but
+ * the results of the queries will refer to the geometry at build time).
+ * All the query member functions are const and do not use any shared
+ * scratch data: they can be called concurrently from any number of threads.
+ *
+ * Faces are identified by their index in the face vector of the mesh.
+ */
+class FaceBVH
+{
+public:
+	struct RayHit
+	{
+		int     face = -1;  // index of the hit face in the mesh face vector
+		Scalarm t    = 0;   // ray parameter of the hit point
+		Scalarm u    = 0;   // barycentric coords of the hit point w.r.t. V1 and V2
+		Scalarm v    = 0;
+		Point3m normal;     // geometric (not normalized) normal of the hit face
+	};
+
+	struct PointHit
+	{
+		int     face = -1;  // index of the closest face in the mesh face vector
+		Scalarm dist = 0;   // distance of the closest point from the query point
+		Point3m point;      // closest point
+		Scalarm u    = 0;   // barycentric coords of the closest point w.r.t. V1 and V2
+		Scalarm v    = 0;
+		int     tri  = -1;  // triangle of the hierarchy, used as hint by closestPoint
+	};
+
+	// position of a box with respect to the region of a regionQuery
+	enum BoxClass { OUTSIDE, INSIDE, STRADDLING };
+	typedef std::function<BoxClass(const Box3m&)> BoxClassifier;
+
+	FaceBVH();
+	FaceBVH(const CMeshO& m, const Matrix44m& tr = Matrix44m::Identity());
+
+	void build(const CMeshO& m, const Matrix44m& tr = Matrix44m::Identity());
+	void clear();
+
+	bool         isEmpty() const;
+	unsigned int faceNumber() const;
+	unsigned int nodeNumber() const;
+	Box3m        boundingBox() const;
+
+	bool closestHit(
+		const Point3m& orig,
+		const Point3m& dir,
+		Scalarm        tMin,
+		Scalarm        tMax,
+		RayHit&        hit) const;
+
+	bool isOccluded(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax) const;
+
+	unsigned int countHits(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax) const;
+
+	bool closestPoint(const Point3m& p, Scalarm maxDist, PointHit& hit) const;
+
+	void regionQuery(
+		const BoxClassifier& classify,
+		std::vector<int>&    inside,
+		std::vector<int>&    straddling) const;
+
+private:
+	struct Node
+	{
+		Point3m bmin;
+		Point3m bmax;
+		int     first; // leaf: first triangle; inner node: index of the left child (right is first+1)
+		int     count; // leaf: number of triangles; inner node: 0
+	};
+
+	struct Ray
+	{
+		Point3m orig;
+		Point3m dir;
+		Point3m invDir;
+		Scalarm tMin;
+		Scalarm tMax;
+	};
+
+	static Ray makeRay(const Point3m& orig, const Point3m& dir, Scalarm tMin, Scalarm tMax);
+	static bool intersectBox(const Node& n, const Ray& r, Scalarm& tEntry);
+	bool intersectTriangle(int tri, const Ray& r, Scalarm& t, Scalarm& u, Scalarm& v) const;
+	static Scalarm squaredBoxDistance(const Node& n, const Point3m& p);
+	Scalarm closestTrianglePoint(int tri, const Point3m& p, Scalarm& u, Scalarm& v) const;
+
+	std::vector<Node>    nodes;
+	std::vector<int>     faceIndex; // BVH triangle -> mesh face index
+	std::vector<Point3m> triV0;     // triangle as (V0, V1-V0, V2-V0)
+	std::vector<Point3m> triE1;
+	std::vector<Point3m> triE2;
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_FACE_BVH_H
@@ -0,0 +1,416 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "laplacian_cache.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+
+#include <QMutexLocker>
+
+#include <Eigen/Geometry>
+
+#include "../mlexception.h"
+
+namespace meshlab {
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+double secondsSince(const Clock::time_point& start)
+{
+	return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+std::uint64_t mix(std::uint64_t h)
+{
+	h ^= h >> 33;
+	h *= 0xff51afd7ed558ccdULL;
+	h ^= h >> 33;
+	h *= 0xc4ceb9fe1a85ec53ULL;
+	h ^= h >> 33;
+	return h;
+}
+
+// hash of a memory buffer, computed in parallel on fixed size chunks
+std::uint64_t hashBytes(const unsigned char* data, std::size_t size)
+{
+	const std::size_t chunkSize   = std::size_t(1) << 16;
+	const int         chunkNumber = int((size + chunkSize - 1) / chunkSize);
+	std::vector<std::uint64_t> chunkHash(chunkNumber);
+	#pragma omp parallel for schedule(static)
+	for (int c = 0; c < chunkNumber; ++c) {
+		std::size_t   i   = c * chunkSize;
+		std::size_t   end = std::min(size, i + chunkSize);
+		std::uint64_t h   = 0xcbf29ce484222325ULL;
+		for (; i + 8 <= end; i += 8) {
+			std::uint64_t w;
+			std::memcpy(&w, data + i, 8);
+			h = mix(h ^ w);
+		}
+		for (; i < end; ++i)
+			h = (h ^ data[i]) * 0x100000001b3ULL;
+		chunkHash[c] = h;
+	}
+	std::uint64_t h = mix(size);
+	for (std::uint64_t ch : chunkHash)
+		h = mix(h ^ ch);
+	return h;
+}
+
+} // namespace
+
+bool LaplacianCache::Fingerprint::operator==(const Fingerprint& o) const
+{
+	return vn == o.vn && fn == o.fn && hash == o.hash;
+}
+
+/**
+ * @brief Returns the cache shared by all the filters.
+ */
+LaplacianCache& LaplacianCache::instance()
+{
+	static LaplacianCache cache;
+	return cache;
+}
+
+/**
+ * @brief Builds a cache that keeps at most (about) maxBytes of matrices.
+ */
+LaplacianCache::LaplacianCache(std::size_t maxBytes) : maxBytes(maxBytes), usedBytes(0)
+{
+}
+
+/**
+ * @brief Minimizes x^T Q x subject to x(fixed(i)) = fixedValues(i, c), for
+ * each column c of fixedValues, where Q is the system called systemName
+ * built by the builder from the cotangent Laplacian of the mesh (V, F),
+ * extracted from the owner mesh. Returns a matrix with a row for each row of Q and the same columns of
+ * fixedValues.
+ *
+ * The Laplacian, the system and its factorization are taken from the cache
+ * when possible: the builder must always return the same system for the
+ * same mesh and systemName. Throws an MLException if the system cannot be
+ * factorized (e.g. no entries are fixed on a connected component).
+ */
+Eigen::MatrixXd LaplacianCache::solve(
+	const MeshModel*        owner,
+	const Eigen::MatrixX3d& V,
+	const Eigen::MatrixX3i& F,
+	const std::string&      systemName,
+	const SystemBuilder&    builder,
+	const Eigen::VectorXi&  fixed,
+	const Eigen::MatrixXd&  fixedValues,
+	Timings&                timings)
+{
+	timings = Timings();
+	Clock::time_point start = Clock::now();
+	const Fingerprint key = fingerprint(V, F);
+
+	// sorted fixed entries, without duplicates, with the row of their values
+	std::vector<std::pair<int, int>> fixedRows(fixed.size());
+	for (Eigen::Index i = 0; i < fixed.size(); ++i)
+		fixedRows[i] = std::make_pair(fixed(i), int(i));
+	std::stable_sort(fixedRows.begin(), fixedRows.end(),
+		[](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first < b.first; });
+	fixedRows.erase(std::unique(fixedRows.begin(), fixedRows.end(),
+		[](const std::pair<int, int>& a, const std::pair<int, int>& b) { return a.first == b.first; }),
+		fixedRows.end());
+	std::vector<int> sortedFixed(fixedRows.size());
+	for (std::size_t i = 0; i < fixedRows.size(); ++i)
+		sortedFixed[i] = fixedRows[i].first;
+
+	std::shared_ptr<Eigen::SparseMatrix<double>> L;
+	std::shared_ptr<Factorization>               fact;
+	{
+		QMutexLocker locker(&mutex);
+		Entry*       e = findEntry(key, owner);
+		if (e != nullptr) {
+			L = e->L;
+			for (auto it = e->factorizations.begin(); it != e->factorizations.end(); ++it) {
+				if ((*it)->systemName == systemName && (*it)->fixed == sortedFixed) {
+					e->factorizations.splice(e->factorizations.begin(), e->factorizations, it);
+					fact = e->factorizations.front();
+					break;
+				}
+			}
+		}
+	}
+	timings.cachedLaplacian     = (L != nullptr);
+	timings.cachedFactorization = (fact != nullptr);
+
+	if (!fact) {
+		if (!L)
+			L = std::make_shared<Eigen::SparseMatrix<double>>(cotangentLaplacian(V, F));
+		Eigen::SparseMatrix<double> Q = builder(*L);
+		timings.assembly = secondsSince(start);
+
+		start = Clock::now();
+		fact = factorize(Q, systemName, sortedFixed);
+		timings.factorization = secondsSince(start);
+
+		// the entry may have been evicted (or added by another solve) meanwhile
+		QMutexLocker locker(&mutex);
+		Entry*       e = findEntry(key, owner);
+		if (e == nullptr) {
+			entries.push_front(Entry());
+			e = &entries.front();
+			e->key    = key;
+			e->owners.push_back(owner);
+			e->L      = L;
+			e->bytes  = matrixBytes(*L);
+			usedBytes += e->bytes;
+		}
+		e->factorizations.push_front(fact);
+		usedBytes += fact->bytes;
+		shrink();
+	}
+	else {
+		timings.assembly = secondsSince(start);
+	}
+
+	start = Clock::now();
+	const Eigen::Index n = Eigen::Index(fact->freeRows.size() + fact->fixed.size());
+	Eigen::MatrixXd xk(fact->fixed.size(), fixedValues.cols());
+	for (std::size_t i = 0; i < fixedRows.size(); ++i)
+		xk.row(i) = fixedValues.row(fixedRows[i].second);
+	Eigen::MatrixXd xf;
+	if (!fact->freeRows.empty()) {
+		Eigen::MatrixXd rhs = -(fact->Qfk * xk);
+		xf = fact->ldlt.solve(rhs);
+	}
+
+	Eigen::MatrixXd x(n, fixedValues.cols());
+	for (std::size_t i = 0; i < fact->freeRows.size(); ++i)
+		x.row(fact->freeRows[i]) = xf.row(i);
+	for (std::size_t i = 0; i < fact->fixed.size(); ++i)
+		x.row(fact->fixed[i]) = xk.row(i);
+	timings.solve = secondsSince(start);
+	return x;
+}
+
+/**
+ * @brief Removes the owner mesh from the cache entries, and discards the
+ * entries that are left without owners. Must be called before destroying a
+ * mesh that has been passed to solve(): a new mesh could be allocated at the
+ * same address.
+ */
+void LaplacianCache::evict(const MeshModel* owner)
+{
+	QMutexLocker locker(&mutex);
+	for (auto it = entries.begin(); it != entries.end();) {
+		it->owners.erase(std::remove(it->owners.begin(), it->owners.end(), owner), it->owners.end());
+		if (it->owners.empty()) {
+			usedBytes -= it->bytes;
+			for (const std::shared_ptr<Factorization>& f : it->factorizations)
+				usedBytes -= f->bytes;
+			it = entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void LaplacianCache::clear()
+{
+	QMutexLocker locker(&mutex);
+	entries.clear();
+	usedBytes = 0;
+}
+
+/**
+ * @brief Returns the estimated bytes of the matrices kept in the cache.
+ */
+std::size_t LaplacianCache::bytes() const
+{
+	QMutexLocker locker(&mutex);
+	return usedBytes;
+}
+
+/**
+ * Returns the entry with the given key moved to the front of the list, with
+ * the owner added to its owners, or nullptr if there is no such entry.
+ * Must be called while holding the mutex.
+ */
+LaplacianCache::Entry* LaplacianCache::findEntry(const Fingerprint& key, const MeshModel* owner)
+{
+	for (auto it = entries.begin(); it != entries.end(); ++it) {
+		if (it->key == key) {
+			entries.splice(entries.begin(), entries, it);
+			Entry& e = entries.front();
+			if (std::find(e.owners.begin(), e.owners.end(), owner) == e.owners.end())
+				e.owners.push_back(owner);
+			return &e;
+		}
+	}
+	return nullptr;
+}
+
+/**
+ * Discards the least recently used factorizations, and then the Laplacian of
+ * the least recently used entry, until the cache fits in maxBytes. The ones
+ * in use by a running solve are kept alive by their shared pointers.
+ * Must be called while holding the mutex.
+ */
+void LaplacianCache::shrink()
+{
+	while (usedBytes > maxBytes && !entries.empty()) {
+		Entry& e = entries.back();
+		if (!e.factorizations.empty()) {
+			usedBytes -= e.factorizations.back()->bytes;
+			e.factorizations.pop_back();
+		}
+		else {
+			usedBytes -= e.bytes;
+			entries.pop_back();
+		}
+	}
+}
+
+/**
+ * Estimated memory of a compressed sparse matrix: values, inner indices and
+ * outer starts.
+ */
+std::size_t LaplacianCache::matrixBytes(const Eigen::SparseMatrix<double>& A)
+{
+	return std::size_t(A.nonZeros()) * (sizeof(double) + sizeof(int)) +
+		   std::size_t(A.outerSize() + 1) * sizeof(int);
+}
+
+/**
+ * @brief Computes the cotangent Laplacian of the triangle mesh (V, F), with
+ * the same conventions of igl::cotmatrix: L(i,j) is half the sum of the
+ * cotangents of the angles opposite to the edge (i,j), and the diagonal
+ * makes the rows sum to zero. Degenerate faces give no contribution.
+ *
+ * The entries of the faces are computed in parallel.
+ */
+Eigen::SparseMatrix<double>
+LaplacianCache::cotangentLaplacian(const Eigen::MatrixX3d& V, const Eigen::MatrixX3i& F)
+{
+	typedef Eigen::Triplet<double> Triplet;
+	const int            fn = int(F.rows());
+	std::vector<Triplet> triplets(std::size_t(fn) * 12);
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn; ++f) {
+		for (int i = 0; i < 3; ++i) {
+			const int       a  = F(f, i);
+			const int       b  = F(f, (i + 1) % 3);
+			const int       c  = F(f, (i + 2) % 3);
+			Eigen::Vector3d e1 = (V.row(b) - V.row(a)).transpose();
+			Eigen::Vector3d e2 = (V.row(c) - V.row(a)).transpose();
+			double          dblA = e1.cross(e2).norm();
+			double          w    = dblA > 0 ? 0.5 * e1.dot(e2) / dblA : 0;
+
+			Triplet* t = &triplets[std::size_t(f) * 12 + i * 4];
+			t[0] = Triplet(b, c, w);
+			t[1] = Triplet(c, b, w);
+			t[2] = Triplet(b, b, -w);
+			t[3] = Triplet(c, c, -w);
+		}
+	}
+	Eigen::SparseMatrix<double> L(V.rows(), V.rows());
+	L.setFromTriplets(triplets.begin(), triplets.end());
+	return L;
+}
+
+LaplacianCache::Fingerprint
+LaplacianCache::fingerprint(const Eigen::MatrixX3d& V, const Eigen::MatrixX3i& F)
+{
+	Fingerprint fp;
+	fp.vn   = V.rows();
+	fp.fn   = F.rows();
+	fp.hash = mix(
+		hashBytes((const unsigned char*) V.data(), V.size() * sizeof(double)) ^
+		mix(hashBytes((const unsigned char*) F.data(), F.size() * sizeof(int))));
+	return fp;
+}
+
+/**
+ * Splits the (symmetrized) system in free and fixed entries, and factorizes
+ * the free-free block.
+ */
+std::shared_ptr<LaplacianCache::Factorization> LaplacianCache::factorize(
+	const Eigen::SparseMatrix<double>& Q,
+	const std::string&                 systemName,
+	const std::vector<int>&            fixed)
+{
+	typedef Eigen::Triplet<double> Triplet;
+	const int n = int(Q.rows());
+
+	auto fact        = std::make_shared<Factorization>();
+	fact->systemName = systemName;
+	fact->fixed      = fixed;
+
+	// position of each row in the free or in the fixed entries
+	std::vector<int>  pos(n);
+	std::vector<bool> isFixed(n, false);
+	for (std::size_t i = 0; i < fixed.size(); ++i) {
+		if (fixed[i] < 0 || fixed[i] >= n)
+			throw MLException("Invalid constrained entry in the linear system.");
+		isFixed[fixed[i]] = true;
+		pos[fixed[i]]     = int(i);
+	}
+	for (int r = 0; r < n; ++r) {
+		if (!isFixed[r]) {
+			pos[r] = int(fact->freeRows.size());
+			fact->freeRows.push_back(r);
+		}
+	}
+
+	Eigen::SparseMatrix<double> Qt = Q.transpose();
+	Eigen::SparseMatrix<double> Qs = 0.5 * (Q + Qt);
+	std::vector<Triplet>        ff, fk;
+	for (int k = 0; k < Qs.outerSize(); ++k) {
+		for (Eigen::SparseMatrix<double>::InnerIterator it(Qs, k); it; ++it) {
+			int r = int(it.row()), c = int(it.col());
+			if (isFixed[r])
+				continue;
+			if (isFixed[c])
+				fk.push_back(Triplet(pos[r], pos[c], it.value()));
+			else
+				ff.push_back(Triplet(pos[r], pos[c], it.value()));
+		}
+	}
+	const int nf = int(fact->freeRows.size());
+	fact->Qfk.resize(nf, int(fixed.size()));
+	fact->Qfk.setFromTriplets(fk.begin(), fk.end());
+	if (nf > 0) {
+		Eigen::SparseMatrix<double> Qff(nf, nf);
+		Qff.setFromTriplets(ff.begin(), ff.end());
+		fact->ldlt.compute(Qff);
+		if (fact->ldlt.info() != Eigen::Success)
+			throw MLException("Factorization of the linear system failed.");
+		// factor L, diagonal D and the two fill-reducing permutations
+		fact->bytes = matrixBytes(fact->ldlt.matrixL().nestedExpression()) +
+					  std::size_t(nf) * (sizeof(double) + 2 * sizeof(int));
+	}
+	fact->bytes += matrixBytes(fact->Qfk) +
+				   (fact->fixed.size() + fact->freeRows.size()) * sizeof(int);
+	return fact;
+}
+
+} // namespace meshlab
@@ -0,0 +1,152 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005-2021                                           \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MESHLAB_LAPLACIAN_CACHE_H
+#define MESHLAB_LAPLACIAN_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QMutex>
+
+#include <Eigen/Core>
+#include <Eigen/Sparse>
+
+class MeshModel;
+
+namespace meshlab {
+
+/**
+ * @brief The LaplacianCache class keeps the cotangent Laplacians of the
+ * recently used meshes, and the factorizations of the linear systems built
+ * on them, so that filters that are run again on the same mesh with
+ * different constraint values only pay for the solve.
+ *
+ * A mesh is identified by a fingerprint of its topology and vertex
+ * positions: any change of the mesh gives a new entry. The cache is
+ * bounded by the (estimated) bytes of its matrices: when the bound is
+ * exceeded the least recently used factorizations and Laplacians are
+ * discarded. Every entry also records the meshes it has been computed for,
+ * and it is discarded when all of them are evicted (i.e. when they are
+ * removed from their MeshDocument or the document is closed).
+ *
+ * A system is a symmetric positive semidefinite matrix Q, built from the
+ * Laplacian by a SystemBuilder and identified by a name: solve() minimizes
+ * x^T Q x with the values of some entries of x fixed. The factorization
+ * depends on the set of fixed entries, but not on their values.
+ *
+ * All the member functions are thread safe; solves on the same cached
+ * factorization can run concurrently.
+ */
+class LaplacianCache
+{
+public:
+	// wall clock seconds spent in each phase of a solve
+	struct Timings
+	{
+		double assembly            = 0;
+		double factorization       = 0;
+		double solve               = 0;
+		bool   cachedLaplacian     = false;
+		bool   cachedFactorization = false;
+	};
+
+	typedef std::function<Eigen::SparseMatrix<double>(const Eigen::SparseMatrix<double>& L)>
+		SystemBuilder;
+
+	static LaplacianCache& instance();
+
+	LaplacianCache(std::size_t maxBytes = std::size_t(512) << 20);
+
+	Eigen::MatrixXd solve(
+		const MeshModel*        owner,
+		const Eigen::MatrixX3d& V,
+		const Eigen::MatrixX3i& F,
+		const std::string&      systemName,
+		const SystemBuilder&    builder,
+		const Eigen::VectorXi&  fixed,
+		const Eigen::MatrixXd&  fixedValues,
+		Timings&                timings);
+
+	void evict(const MeshModel* owner);
+	void clear();
+
+	std::size_t bytes() const;
+
+	static Eigen::SparseMatrix<double>
+	cotangentLaplacian(const Eigen::MatrixX3d& V, const Eigen::MatrixX3i& F);
+
+private:
+	struct Fingerprint
+	{
+		Eigen::Index  vn = 0;
+		Eigen::Index  fn = 0;
+		std::uint64_t hash = 0;
+
+		bool operator==(const Fingerprint& o) const;
+	};
+
+	// factorization of the free-free block of a system, for a set of fixed entries
+	struct Factorization
+	{
+		std::string                                        systemName;
+		std::vector<int>                                   fixed;    // sorted
+		std::vector<int>                                   freeRows; // free entry -> row of Q
+		Eigen::SparseMatrix<double>                        Qfk;      // free-fixed block
+		Eigen::SimplicialLDLT<Eigen::SparseMatrix<double>> ldlt;
+		std::size_t                                        bytes = 0;
+	};
+
+	struct Entry
+	{
+		Fingerprint                                  key;
+		std::vector<const MeshModel*>                owners;
+		std::shared_ptr<Eigen::SparseMatrix<double>> L;
+		std::size_t                                  bytes = 0; // of L
+		std::list<std::shared_ptr<Factorization>>    factorizations; // most recently used first
+	};
+
+	static Fingerprint fingerprint(const Eigen::MatrixX3d& V, const Eigen::MatrixX3i& F);
+	static std::shared_ptr<Factorization> factorize(
+		const Eigen::SparseMatrix<double>& Q,
+		const std::string&                 systemName,
+		const std::vector<int>&            fixed);
+	static std::size_t matrixBytes(const Eigen::SparseMatrix<double>& A);
+
+	Entry* findEntry(const Fingerprint& key, const MeshModel* owner);
+	void   shrink();
+
+	std::size_t      maxBytes;
+	std::size_t      usedBytes;
+	std::list<Entry> entries; // most recently used first
+	mutable QMutex   mutex;
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_LAPLACIAN_CACHE_H
@@ -23,6 +23,9 @@
 
 #include "load_save.h"
 
+#include <atomic>
+#include <thread>
+
 #include <QDir>
 #include <QElapsedTimer>
 
@@ -33,50 +36,52 @@
 
 namespace meshlab {
 
+namespace {
+
 /**
- * @brief This function assumes that you already have the following data:
- * - the plugin that is needed to load the mesh
- * - the number of meshes that will be loaded from the file
- * - the list of MeshModel(s) that will contain the loaded mesh(es)
- * - the open parameters that will be used to load the mesh(es)
- *
- * The function will take care to load the mesh, load textures if needed
- * and make all the clean operations after loading the meshes.
- * If load fails, throws a MLException.
- *
- * @param[i] fileName: the filename
- * @param[i] ioPlugin: the plugin that supports the file format to load
- * @param[i] prePar: the pre open parameters
- * @param[i/o] meshList: the list of meshes that will be loaded from the file
- * @param[o] maskList: masks of loaded components for each loaded mesh
- * @param cb: callback
- * @return the list of texture names that could not be loaded
+ * A mesh file that must be loaded into a list of already existing meshes.
  */
-std::list<std::string> loadMesh(
-	const QString&               fileName,
-	IOPlugin*                    ioPlugin,
-	const RichParameterList&     prePar,
-	const std::list<MeshModel*>& meshList,
-	std::list<int>&              maskList,
-	vcg::CallBackPos*            cb)
+struct MeshFileToLoad
 {
-	std::list<std::string> unloadedTextures;
-	QFileInfo              fi(fileName);
-	QString                extension = fi.suffix();
+	QString                fileName; // absolute path
+	IOPlugin*              ioPlugin = nullptr;
+	RichParameterList      params;
+	std::list<MeshModel*>  meshList;
+	std::list<int>         maskList;
+	std::list<std::string> logMessages; // logged by the calling thread
+	QString                error; // empty if the file has been loaded
+};
 
-	QDir oldDir = QDir::current();
-	QDir::setCurrent(fi.absolutePath());
-	ioPlugin->open(extension, fi.fileName(), meshList, maskList, prePar, cb);
-	QDir::setCurrent(oldDir.absolutePath());
+/**
+ * A mesh that must be saved, with all the data computed before calling the
+ * save function of its plugin.
+ */
+struct MeshFileToSave
+{
+	QString           fileName;
+	MeshModel*        mesh     = nullptr;
+	IOPlugin*         ioPlugin = nullptr;
+	int               mask     = 0;
+	RichParameterList params;
+	QString           error; // empty if the mesh has been saved
+};
 
-	auto itmesh = meshList.begin();
+/**
+ * Makes all the clean operations on the meshes just opened by the plugin:
+ * normals, bounding box, degenerate elements and compaction.
+ * It does not touch anything but the given meshes, therefore it can be called
+ * concurrently on different meshes. The messages that must be logged by the
+ * plugin are appended to logMessages, since the log is not thread safe.
+ */
+void cleanLoadedMeshes(
+	IOPlugin*                    ioPlugin,
+	const std::list<MeshModel*>& meshList,
+	const std::list<int>&        maskList,
+	std::list<std::string>&      logMessages)
+{
 	auto itmask = maskList.begin();
-	for (unsigned int i = 0; i < meshList.size(); ++i) {
-		MeshModel* mm   = *itmesh;
-		int        mask = *itmask;
-
-		std::list<std::string> tmp = mm->loadTextures(nullptr, cb);
-		unloadedTextures.insert(unloadedTextures.end(), tmp.begin(), tmp.end());
+	for (MeshModel* mm : meshList) {
+		int mask = *itmask;
 
 		// In case of polygonal meshes the normal should be updated accordingly
 		if (mask & vcg::tri::io::Mask::IOM_BITPOLYGONAL) {
@@ -84,7 +89,7 @@ std::list<std::string> loadMesh(
 														 // done in the plugin...
 			int degNum = vcg::tri::Clean<CMeshO>::RemoveDegenerateFace(mm->cm);
 			if (degNum)
-				ioPlugin->log(
+				logMessages.push_back(
 					"Warning model contains " + std::to_string(degNum) +
 					" degenerate faces. Removed them.");
 			mm->updateDataMask(MeshModel::MM_FACEFACETOPO);
@@ -103,7 +108,6 @@ std::list<std::string> loadMesh(
 				mm->updateDataMask(MeshModel::MM_VERTNORMAL);
 		}
 
-		// updateMenus();
 		int delVertNum = vcg::tri::Clean<CMeshO>::RemoveDegenerateVertex(mm->cm);
 		int delFaceNum = vcg::tri::Clean<CMeshO>::RemoveDegenerateFace(mm->cm);
 		vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
@@ -112,11 +116,160 @@ std::list<std::string> loadMesh(
 											"%2 degenerated faces.\nCorrected.")
 										.arg(delVertNum)
 										.arg(delFaceNum));
-
-		// computeRenderingDataOnLoading(mm,isareload, rendOpt);
-		++itmesh;
 		++itmask;
 	}
+}
+
+/**
+ * Loads all the given files that have not an error yet.
+ *
+ * Files whose plugin has a reentrant open function are opened and cleaned
+ * concurrently, using their absolute path and without changing the current
+ * directory; the other files are loaded serially with loadMesh.
+ * Textures are always loaded from the calling thread (loadTextures is
+ * already parallel), and the callback is called only from the calling thread.
+ * Errors are stored in the files, and do not stop the loading of the others.
+ */
+void loadMeshFiles(std::vector<MeshFileToLoad>& files, vcg::CallBackPos* cb)
+{
+	std::vector<unsigned int> concurrent, serial;
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		if (files[i].error.isEmpty()) {
+			if (files[i].ioPlugin->isOpenReentrant(QFileInfo(files[i].fileName).suffix()))
+				concurrent.push_back(i);
+			else
+				serial.push_back(i);
+		}
+	}
+
+	const int             total = concurrent.size() + serial.size();
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<int>      loaded(0);
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int k = 0; k < (int) concurrent.size(); ++k) {
+		MeshFileToLoad& f = files[concurrent[k]];
+		try {
+			f.ioPlugin->open(
+				QFileInfo(f.fileName).suffix(), f.fileName, f.meshList, f.maskList, f.params, nullptr);
+			cleanLoadedMeshes(f.ioPlugin, f.meshList, f.maskList, f.logMessages);
+		}
+		catch (const std::exception& e) {
+			f.error = e.what();
+		}
+		int n = ++loaded;
+		if (cb != nullptr && std::this_thread::get_id() == caller)
+			cb(100 * n / total, "Loading meshes...");
+	}
+
+	for (unsigned int i : concurrent) {
+		for (const std::string& msg : files[i].logMessages)
+			files[i].ioPlugin->log(msg);
+		if (files[i].error.isEmpty()) {
+			for (MeshModel* mm : files[i].meshList)
+				mm->loadTextures(nullptr, cb);
+		}
+	}
+
+	for (unsigned int i : serial) {
+		MeshFileToLoad& f = files[i];
+		try {
+			loadMesh(f.fileName, f.ioPlugin, f.params, f.meshList, f.maskList, cb);
+		}
+		catch (const MLException& e) {
+			f.error = e.what();
+		}
+	}
+}
+
+/**
+ * Computes all the data required to save the given mesh with the standard
+ * save parameters, without saving it. Throws if there is no plugin that
+ * supports the format.
+ */
+MeshFileToSave prepareSaveMesh(const QString& fileName, MeshModel& m, GLLogStream* log)
+{
+	QFileInfo fi(fileName);
+	QString   extension = fi.suffix().toLower();
+
+	PluginManager& pm       = meshlab::pluginManagerInstance();
+	IOPlugin*      ioPlugin = pm.outputMeshPlugin(extension);
+	if (ioPlugin == nullptr) {
+		throw MLException(
+			"Mesh " + fileName +
+			" cannot be saved. Your MeshLab "
+			"version has not plugin to save " +
+			extension + " file format");
+	}
+	ioPlugin->setLog(log);
+	MeshFileToSave f;
+	f.fileName = fileName;
+	f.mesh = &m;
+	f.ioPlugin = ioPlugin;
+	int capability = 0;
+	ioPlugin->exportMaskCapability(extension, capability, f.mask);
+	f.params = ioPlugin->initSaveParameter(extension, m);
+
+	if (f.mask & vcg::tri::io::Mask::IOM_BITPOLYGONAL)
+		m.updateDataMask(MeshModel::MM_FACEFACETOPO);
+	return f;
+}
+
+/**
+ * Saves the textures of a mesh just saved by its plugin, and sets its new file name.
+ */
+void completeSaveMesh(const MeshFileToSave& f, GLLogStream* log, vcg::CallBackPos* cb)
+{
+	f.mesh->setFileName(f.fileName);
+	f.mesh->saveTextures(QFileInfo(f.fileName).absolutePath(), -1, log, cb);
+}
+
+} // namespace
+
+/**
+ * @brief This function assumes that you already have the following data:
+ * - the plugin that is needed to load the mesh
+ * - the number of meshes that will be loaded from the file
+ * - the list of MeshModel(s) that will contain the loaded mesh(es)
+ * - the open parameters that will be used to load the mesh(es)
+ *
+ * The function will take care to load the mesh, load textures if needed
+ * and make all the clean operations after loading the meshes.
+ * If load fails, throws a MLException.
+ *
+ * @param[i] fileName: the filename
+ * @param[i] ioPlugin: the plugin that supports the file format to load
+ * @param[i] prePar: the pre open parameters
+ * @param[i/o] meshList: the list of meshes that will be loaded from the file
+ * @param[o] maskList: masks of loaded components for each loaded mesh
+ * @param cb: callback
+ * @return the list of texture names that could not be loaded
+ */
+std::list<std::string> loadMesh(
+	const QString&               fileName,
+	IOPlugin*                    ioPlugin,
+	const RichParameterList&     prePar,
+	const std::list<MeshModel*>& meshList,
+	std::list<int>&              maskList,
+	vcg::CallBackPos*            cb)
+{
+	std::list<std::string> unloadedTextures;
+	QFileInfo              fi(fileName);
+	QString                extension = fi.suffix();
+
+	QDir oldDir = QDir::current();
+	QDir::setCurrent(fi.absolutePath());
+	ioPlugin->open(extension, fi.fileName(), meshList, maskList, prePar, cb);
+	QDir::setCurrent(oldDir.absolutePath());
+
+	for (MeshModel* mm : meshList) {
+		std::list<std::string> tmp = mm->loadTextures(nullptr, cb);
+		unloadedTextures.insert(unloadedTextures.end(), tmp.begin(), tmp.end());
+	}
+	std::list<std::string> logMessages;
+	cleanLoadedMeshes(ioPlugin, meshList, maskList, logMessages);
+	for (const std::string& msg : logMessages)
+		ioPlugin->log(msg);
 	return unloadedTextures;
 }
 
@@ -201,6 +354,77 @@ std::list<MeshModel*> loadMeshWithStandardParameters(
 	return meshList;
 }
 
+/**
+ * @brief loads the given files and puts the loaded meshes into the given
+ * MeshDocument, using the standard open parameters. Returns, for each file,
+ * the list of meshes loaded from it.
+ *
+ * The meshes are added to the document in the order of the files, before
+ * loading them, therefore their ids do not depend on the loading order.
+ * Files whose plugin supports it are loaded concurrently.
+ *
+ * A file that cannot be loaded does not stop the loading of the others: its
+ * list of meshes is empty, and its error message is stored in the
+ * corresponding element of the errors vector (that is empty for the files
+ * that have been loaded).
+ */
+std::vector<std::list<MeshModel*>> loadMeshesWithStandardParameters(
+	const QStringList&    filenames,
+	MeshDocument&         md,
+	std::vector<QString>& errors,
+	vcg::CallBackPos*     cb)
+{
+	PluginManager&              pm = meshlab::pluginManagerInstance();
+	std::vector<MeshFileToLoad> files(filenames.size());
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		MeshFileToLoad& f = files[i];
+		QFileInfo       fi(filenames[i]);
+		QString         extension = fi.suffix();
+		f.fileName = fi.absoluteFilePath();
+		f.ioPlugin = pm.inputMeshPlugin(extension);
+		if (f.ioPlugin == nullptr) {
+			f.error = "Mesh " + filenames[i] +
+					  " cannot be opened. Your MeshLab version "
+					  "has not plugin to read " +
+					  extension + " file format";
+			continue;
+		}
+		f.ioPlugin->setLog(&md.Log);
+		f.params = f.ioPlugin->initPreOpenParameter(extension);
+		f.params.join(meshlab::defaultGlobalParameterList());
+
+		unsigned int nMeshes = 0;
+		try {
+			nMeshes = f.ioPlugin->numberMeshesContainedInFile(extension, f.fileName, f.params);
+		}
+		catch (const MLException& e) {
+			f.error = e.what();
+		}
+		for (unsigned int j = 0; j < nMeshes; j++) {
+			MeshModel* mm = md.addNewMesh(f.fileName, fi.fileName());
+			if (nMeshes != 1)
+				mm->setIdInFile(j);
+			f.meshList.push_back(mm);
+		}
+	}
+
+	loadMeshFiles(files, cb);
+
+	std::vector<std::list<MeshModel*>> meshLists(files.size());
+	errors.assign(files.size(), QString());
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		if (files[i].error.isEmpty()) {
+			meshLists[i] = files[i].meshList;
+		}
+		else {
+			for (const MeshModel* mm : files[i].meshList)
+				md.delMesh(mm->id());
+			errors[i] = files[i].error;
+		}
+	}
+	return meshLists;
+}
+
 void reloadMesh(
 	const QString&               filename,
 	const std::list<MeshModel*>& meshList,
@@ -240,36 +464,87 @@ void reloadMesh(
 	loadMesh(filename, ioPlugin, prePar, meshList, masks, cb);
 }
 
+/**
+ * @brief reloads the given files into the given lists of meshes (each list
+ * contains all the meshes previously loaded from the corresponding file).
+ * Files whose plugin supports it are loaded concurrently.
+ *
+ * A file that cannot be reloaded does not stop the reloading of the others:
+ * its error message is stored in the corresponding element of the errors
+ * vector (that is empty for the files that have been reloaded).
+ */
+void reloadMeshes(
+	const QStringList&                        filenames,
+	const std::vector<std::list<MeshModel*>>& meshLists,
+	std::vector<QString>&                     errors,
+	GLLogStream*                              log,
+	vcg::CallBackPos*                         cb)
+{
+	PluginManager&              pm = meshlab::pluginManagerInstance();
+	std::vector<MeshFileToLoad> files(filenames.size());
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		MeshFileToLoad& f = files[i];
+		QFileInfo       fi(filenames[i]);
+		QString         extension = fi.suffix();
+		f.fileName = fi.absoluteFilePath();
+		f.ioPlugin = pm.inputMeshPlugin(extension);
+		if (f.ioPlugin == nullptr) {
+			f.error = "Mesh " + filenames[i] +
+					  " cannot be opened. Your MeshLab "
+					  "version has not plugin to read " +
+					  extension + " file format";
+			continue;
+		}
+		f.ioPlugin->setLog(log);
+		f.params = f.ioPlugin->initPreOpenParameter(extension);
+		f.params.join(meshlab::defaultGlobalParameterList());
+
+		try {
+			unsigned int nMeshes =
+				f.ioPlugin->numberMeshesContainedInFile(extension, f.fileName, f.params);
+			if (meshLists[i].size() != nMeshes) {
+				f.error = "Cannot reload " + filenames[i] +
+						  ": expected number layers is "
+						  "different from the number of meshes contained in th file.";
+				continue;
+			}
+		}
+		catch (const MLException& e) {
+			f.error = e.what();
+			continue;
+		}
+		f.meshList = meshLists[i];
+		for (MeshModel* mm : f.meshList)
+			mm->clear();
+	}
+
+	loadMeshFiles(files, cb);
+
+	errors.resize(files.size());
+	for (unsigned int i = 0; i < files.size(); ++i)
+		errors[i] = files[i].error;
+}
+
 void saveMeshWithStandardParameters(
 	const QString&    fileName,
 	MeshModel&        m,
 	GLLogStream*      log,
 	vcg::CallBackPos* cb)
 {
-	QFileInfo fi(fileName);
-	QString   extension = fi.suffix().toLower();
-
-	PluginManager& pm       = meshlab::pluginManagerInstance();
-	IOPlugin*      ioPlugin = pm.outputMeshPlugin(extension);
-	if (ioPlugin == nullptr) {
-		throw MLException(
-			"Mesh " + fileName +
-			" cannot be saved. Your MeshLab "
-			"version has not plugin to save " +
-			extension + " file format");
-	}
-	ioPlugin->setLog(log);
-	int capability = 0, defaultBits = 0;
-	ioPlugin->exportMaskCapability(extension, capability, defaultBits);
-	RichParameterList saveParams = ioPlugin->initSaveParameter(extension, m);
-
-	if (defaultBits & vcg::tri::io::Mask::IOM_BITPOLYGONAL)
-		m.updateDataMask(MeshModel::MM_FACEFACETOPO);
-	ioPlugin->save(extension, fileName, m, defaultBits, saveParams, cb);
-	m.setFileName(fileName);
-	m.saveTextures(fi.absolutePath(), -1, log, cb);
+	MeshFileToSave f = prepareSaveMesh(fileName, m, log);
+	f.ioPlugin->save(QFileInfo(fileName).suffix().toLower(), fileName, m, f.mask, f.params, cb);
+	completeSaveMesh(f, log, cb);
 }
 
+/**
+ * @brief saves all the meshes (or only the visible ones) of the document in
+ * the given directory, using the standard save parameters.
+ * Meshes whose plugin supports it are saved concurrently.
+ *
+ * A mesh that cannot be saved does not stop the saving of the others; if some
+ * meshes could not be saved, a MLException listing all the errors is thrown at
+ * the end.
+ */
 void saveAllMeshes(
 	const QString&    basePath,
 	MeshDocument&     md,
@@ -279,6 +554,7 @@ void saveAllMeshes(
 {
 	PluginManager& pm = meshlab::pluginManagerInstance();
 
+	std::vector<MeshFileToSave> files;
 	for (MeshModel& m : md.meshIterator()) {
 		if (m.isVisible() || !onlyVisible) {
 			QString filename, extension;
@@ -308,9 +584,73 @@ void saveAllMeshes(
 				filename += ("." + extension.toLower());
 			}
 			filename = basePath + "/" + filename;
-			saveMeshWithStandardParameters(filename, m, log, cb);
+			try {
+				files.push_back(prepareSaveMesh(filename, m, log));
+			}
+			catch (const MLException& e) {
+				MeshFileToSave f;
+				f.fileName = filename;
+				f.error    = e.what();
+				files.push_back(f);
+			}
+		}
+	}
+
+	std::vector<unsigned int> concurrent, serial;
+	for (unsigned int i = 0; i < files.size(); ++i) {
+		if (files[i].error.isEmpty()) {
+			if (files[i].ioPlugin->isSaveReentrant(QFileInfo(files[i].fileName).suffix().toLower()))
+				concurrent.push_back(i);
+			else
+				serial.push_back(i);
 		}
 	}
+
+	const int             total = concurrent.size();
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<int>      saved(0);
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int k = 0; k < (int) concurrent.size(); ++k) {
+		MeshFileToSave& f = files[concurrent[k]];
+		try {
+			f.ioPlugin->save(
+				QFileInfo(f.fileName).suffix().toLower(), f.fileName, *f.mesh, f.mask, f.params, nullptr);
+		}
+		catch (const std::exception& e) {
+			f.error = e.what();
+		}
+		int n = ++saved;
+		if (cb != nullptr && std::this_thread::get_id() == caller)
+			cb(100 * n / total, "Saving meshes...");
+	}
+
+	for (unsigned int i : serial) {
+		MeshFileToSave& f = files[i];
+		try {
+			f.ioPlugin->save(
+				QFileInfo(f.fileName).suffix().toLower(), f.fileName, *f.mesh, f.mask, f.params, cb);
+		}
+		catch (const MLException& e) {
+			f.error = e.what();
+		}
+	}
+
+	QString errorString;
+	for (MeshFileToSave& f : files) {
+		if (f.error.isEmpty()) {
+			try {
+				completeSaveMesh(f, log, cb);
+			}
+			catch (const MLException& e) {
+				f.error = e.what();
+			}
+		}
+		if (!f.error.isEmpty())
+			errorString += f.error + "\n";
+	}
+	if (!errorString.isEmpty())
+		throw MLException(errorString);
 }
 
 QImage loadImage(const QString& filename, GLLogStream* log, vcg::CallBackPos* cb)
@@ -337,6 +677,68 @@ QImage loadImage(const QString& filename, GLLogStream* log, vcg::CallBackPos* cb
 	}
 }
 
+/**
+ * @brief loads the given images. Images whose plugin supports it are loaded
+ * concurrently.
+ *
+ * An image that cannot be loaded does not stop the loading of the others: it
+ * is returned as a null image, and its error message is stored in the
+ * corresponding element of the errors vector (that is empty for the images
+ * that have been loaded).
+ */
+std::vector<QImage> loadImages(
+	const QStringList&    filenames,
+	std::vector<QString>& errors,
+	GLLogStream*          log,
+	vcg::CallBackPos*     cb)
+{
+	PluginManager&         pm = meshlab::pluginManagerInstance();
+	std::vector<QImage>    images(filenames.size());
+	std::vector<IOPlugin*> plugins(filenames.size(), nullptr);
+	errors.assign(filenames.size(), QString());
+
+	std::vector<unsigned int> concurrent, serial;
+	for (unsigned int i = 0; i < images.size(); ++i) {
+		QString extension = QFileInfo(filenames[i]).suffix();
+		plugins[i]        = pm.inputImagePlugin(extension);
+		if (plugins[i] != nullptr && plugins[i]->isOpenImageReentrant(extension)) {
+			plugins[i]->setLog(log);
+			concurrent.push_back(i);
+		}
+		else {
+			serial.push_back(i);
+		}
+	}
+
+	const int             total = images.size();
+	const std::thread::id caller = std::this_thread::get_id();
+	std::atomic<int>      loaded(0);
+
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int k = 0; k < (int) concurrent.size(); ++k) {
+		unsigned int i = concurrent[k];
+		try {
+			images[i] = plugins[i]->openImage(QFileInfo(filenames[i]).suffix(), filenames[i], nullptr);
+		}
+		catch (const std::exception& e) {
+			errors[i] = e.what();
+		}
+		int n = ++loaded;
+		if (cb != nullptr && std::this_thread::get_id() == caller)
+			cb(100 * n / total, "Loading images...");
+	}
+
+	for (unsigned int i : serial) {
+		try {
+			images[i] = loadImage(filenames[i], log, cb);
+		}
+		catch (const MLException& e) {
+			errors[i] = e.what();
+		}
+	}
+	return images;
+}
+
 QImage getDummyTexture()
 {
 	return QImage(":/img/dummy.png");
@@ -48,12 +48,25 @@ std::list<MeshModel*> loadMeshWithStandardParameters(
 	vcg::CallBackPos* cb     = nullptr,
 	RichParameterList prePar = RichParameterList());
 
+std::vector<std::list<MeshModel*>> loadMeshesWithStandardParameters(
+	const QStringList&    filenames,
+	MeshDocument&         md,
+	std::vector<QString>& errors,
+	vcg::CallBackPos*     cb = nullptr);
+
 void reloadMesh(
 	const QString&               filename,
 	const std::list<MeshModel*>& meshList,
 	GLLogStream*                 log = nullptr,
 	vcg::CallBackPos*            cb  = nullptr);
 
+void reloadMeshes(
+	const QStringList&                        filenames,
+	const std::vector<std::list<MeshModel*>>& meshLists,
+	std::vector<QString>&                     errors,
+	GLLogStream*                              log = nullptr,
+	vcg::CallBackPos*                         cb  = nullptr);
+
 void saveMeshWithStandardParameters(
 	const QString&    fileName,
 	MeshModel&        m,
@@ -70,6 +83,12 @@ void saveAllMeshes(
 QImage
 loadImage(const QString& filename, GLLogStream* log = nullptr, vcg::CallBackPos* cb = nullptr);
 
+std::vector<QImage> loadImages(
+	const QStringList&    filenames,
+	std::vector<QString>& errors,
+	GLLogStream*          log = nullptr,
+	vcg::CallBackPos*     cb  = nullptr);
+
 QImage getDummyTexture();
 
 void saveImage(
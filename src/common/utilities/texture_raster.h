@@ -0,0 +1,292 @@
+/*****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005-2021                                           \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef MESHLAB_TEXTURE_RASTER_H
+#define MESHLAB_TEXTURE_RASTER_H
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <vector>
+
+#include <vcg/complex/complex.h>
+#include <vcg/space/box2.h>
+#include <vcg/space/segment2.h>
+
+namespace meshlab {
+
+/**
+ * @brief Parallel version of vcg::tri::SurfaceSampling::Texture: calls the
+ * sampler for the texels covered by the faces of a mesh in a texture of
+ * size width x height, rasterized as SurfaceSampling::SingleFaceRaster does
+ * (including the texels just outside the border edges, with edgeDist > 0).
+ *
+ * The texture space is split in square tiles of TILE_SIZE texels, that are
+ * rasterized in parallel; in a tile, the faces are rasterized one after the
+ * other in index order, clipped to the tile. A texel belongs to a single
+ * tile, therefore it is visited by the same faces and in the same order of
+ * the serial rasterization, and samplers that write on images do not need
+ * any synchronization, as long as they write only the texel they are
+ * called for. Texels outside the texture (faces with texture coords outside
+ * [0, 1]) are visited too, as in the serial version.
+ *
+ * The Sampler must provide:
+ * - a default constructible type Tile, the state of the sampler local to a
+ *   tile (e.g. a cache for the closest point queries);
+ * - void BeginTiles(int tileNum), called before the rasterization with the
+ *   number of non empty tiles;
+ * - void AddTextureSample(Tile&, const FaceType&, const CoordType& bary,
+ *   const vcg::Point2i& tp, ScalarType edgeDist), called concurrently for
+ *   different tiles;
+ * - void EndTile(int tile, Tile&), called concurrently at the end of each
+ *   tile; non empty tiles are numbered by rows, from the bottom of the
+ *   texture (the row of the texels with texture coord v = 0).
+ */
+template<class MeshType>
+class TextureRaster
+{
+public:
+	typedef typename MeshType::ScalarType ScalarType;
+	typedef typename MeshType::CoordType  CoordType;
+	typedef typename MeshType::FaceType   FaceType;
+	typedef vcg::Point2<ScalarType>       Point2x;
+
+	static const int TILE_SIZE = 64;
+
+	template<class Sampler>
+	static void rasterize(
+		MeshType&         m,
+		Sampler&          ps,
+		int               width,
+		int               height,
+		bool              correctSafePointsBaryCoords = true,
+		vcg::CallBackPos* cb                          = nullptr,
+		int               cbStart                     = 0,
+		int               cbOffset                    = 100)
+	{
+		// (tile, face) pairs, sorted by tile; faces of a tile are in index order
+		std::vector<TileFace> pairs;
+		for (size_t i = 0; i < m.face.size(); ++i) {
+			const FaceType& f = m.face[i];
+			if (f.IsD())
+				continue;
+			FaceSetup s;
+			if (!setup(f, width, height, s))
+				continue;
+			const int tx0 = tileOf(s.region.min[0]), tx1 = tileOf(s.region.max[0]);
+			const int ty0 = tileOf(s.region.min[1]), ty1 = tileOf(s.region.max[1]);
+			for (int ty = ty0; ty <= ty1; ++ty)
+				for (int tx = tx0; tx <= tx1; ++tx)
+					pairs.push_back(TileFace {ty, tx, int(i)});
+		}
+		std::stable_sort(pairs.begin(), pairs.end());
+
+		std::vector<size_t> tileStart;
+		for (size_t k = 0; k < pairs.size(); ++k)
+			if (k == 0 || pairs[k - 1] < pairs[k])
+				tileStart.push_back(k);
+		tileStart.push_back(pairs.size());
+		const int tileNum = int(tileStart.size()) - 1;
+
+		ps.BeginTiles(tileNum);
+
+		// tiles are processed in batches, to report the progress between them
+		const int batchSize = 256;
+		for (int begin = 0; begin < tileNum; begin += batchSize) {
+			if (cb != nullptr)
+				cb(cbStart + (cbOffset * begin) / tileNum, "Rasterizing faces ...");
+			const int end = std::min(tileNum, begin + batchSize);
+			#pragma omp parallel for schedule(dynamic, 1)
+			for (int t = begin; t < end; ++t) {
+				const TileFace& first = pairs[tileStart[t]];
+				vcg::Box2i      clip;
+				clip.min = vcg::Point2i(first.tx * TILE_SIZE, first.ty * TILE_SIZE);
+				clip.max = clip.min + vcg::Point2i(TILE_SIZE - 1, TILE_SIZE - 1);
+
+				typename Sampler::Tile tile;
+				for (size_t k = tileStart[t]; k < tileStart[t + 1]; ++k) {
+					FaceType& f = m.face[pairs[k].face];
+					FaceSetup s;
+					setup(f, width, height, s);
+					faceRaster(f, s, clip, ps, tile, correctSafePointsBaryCoords);
+				}
+				ps.EndTile(t, tile);
+			}
+		}
+	}
+
+private:
+	struct TileFace
+	{
+		int ty, tx;
+		int face;
+
+		bool operator<(const TileFace& o) const
+		{
+			return ty < o.ty || (ty == o.ty && tx < o.tx);
+		}
+	};
+
+	// the face in texture space, as prepared by SingleFaceRaster
+	struct FaceSetup
+	{
+		Point2x                   v[3];
+		Point2x                   d[3];   // edges v1-v0, v2-v1, v0-v2
+		vcg::Box2i                region; // rasterized texels
+		bool                      flipped;
+		unsigned char             edgeMask;
+		vcg::Segment2<ScalarType> borderEdges[3];
+		ScalarType                edgeLength[3];
+		double                    de;
+	};
+
+	static int tileOf(int x)
+	{
+		// floor division, texels can have negative coords
+		return x >= 0 ? x / TILE_SIZE : -((-x + TILE_SIZE - 1) / TILE_SIZE);
+	}
+
+	static bool setup(const FaceType& f, int width, int height, FaceSetup& s)
+	{
+		for (int i = 0; i < 3; ++i) {
+			// - 0.5 constants are used to obtain correct texture mapping
+			s.v[i] = Point2x(f.cWT(i).U() * width - 0.5, f.cWT(i).V() * height - 0.5);
+			if (!std::isfinite(s.v[i][0]) || !std::isfinite(s.v[i][1]))
+				return false;
+		}
+		vcg::Box2<ScalarType> bboxf;
+		bboxf.Add(s.v[0]);
+		bboxf.Add(s.v[1]);
+		bboxf.Add(s.v[2]);
+		s.region.min[0] = int(std::floor(bboxf.min[0])) - 1;
+		s.region.min[1] = int(std::floor(bboxf.min[1])) - 1;
+		s.region.max[0] = int(std::ceil(bboxf.max[0])) + 1;
+		s.region.max[1] = int(std::ceil(bboxf.max[1])) + 1;
+
+		for (int i = 0; i < 3; ++i)
+			s.d[i] = s.v[(i + 1) % 3] - s.v[i];
+		s.flipped = !(s.d[2] * Point2x(-s.d[0][1], s.d[0][0]) >= 0);
+
+		s.edgeMask = 0;
+		for (int i = 0; i < 3; ++i) {
+			if (f.IsB(i)) {
+				s.borderEdges[i] = vcg::Segment2<ScalarType>(s.v[i], s.v[(i + 1) % 3]);
+				s.edgeLength[i]  = s.borderEdges[i].Length();
+				s.edgeMask |= (1 << i);
+			}
+		}
+
+		const Point2x* v = s.v;
+		s.de = v[0][0] * v[1][1] - v[0][0] * v[2][1] - v[1][0] * v[0][1] + v[1][0] * v[2][1] -
+			   v[2][0] * v[1][1] + v[2][0] * v[0][1];
+		// faces degenerate in texture space cover no texel and have no
+		// barycentric coordinates: they are not rasterized
+		return s.de != 0;
+	}
+
+	template<class Sampler>
+	static void faceRaster(
+		FaceType&               f,
+		const FaceSetup&        s,
+		const vcg::Box2i&       clip,
+		Sampler&                ps,
+		typename Sampler::Tile& tile,
+		bool                    correctSafePointsBaryCoords)
+	{
+		if (s.de == 0)
+			return;
+		const Point2x* v  = s.v;
+		const Point2x* d  = s.d;
+		const int      x0 = std::max(s.region.min[0], clip.min[0]);
+		const int      x1 = std::min(s.region.max[0], clip.max[0]);
+		const int      y0 = std::max(s.region.min[1], clip.min[1]);
+		const int      y1 = std::min(s.region.max[1], clip.max[1]);
+
+		for (int x = x0; x <= x1; ++x) {
+			for (int y = y0; y <= y1; ++y) {
+				// the edge functions are evaluated directly (and not
+				// incrementally) so that they do not depend on the clipping
+				ScalarType n[3];
+				for (int i = 0; i < 3; ++i)
+					n[i] = (x - v[i][0]) * d[i][1] - (y - v[i][1]) * d[i][0];
+
+				if ((n[0] >= 0 && n[1] >= 0 && n[2] >= 0) || (n[0] <= 0 && n[1] <= 0 && n[2] <= 0)) {
+					CoordType baryCoord;
+					baryCoord[0] = double(-y * v[1][0] + v[2][0] * y + v[1][1] * x - v[2][0] * v[1][1] +
+										  v[1][0] * v[2][1] - x * v[2][1]) / s.de;
+					baryCoord[1] = -double(x * v[0][1] - x * v[2][1] - v[0][0] * y + v[0][0] * v[2][1] -
+										   v[2][0] * v[0][1] + v[2][0] * y) / s.de;
+					baryCoord[2] = 1 - baryCoord[0] - baryCoord[1];
+					ps.AddTextureSample(tile, f, baryCoord, vcg::Point2i(x, y), 0);
+				}
+				else if (s.edgeMask != 0) {
+					// check whether a texel outside the triangle (on the side of a
+					// border edge) affects its color: find the closest point on
+					// a border edge in the 2x2 neighborhood of the texel
+					Point2x    px(x, y);
+					Point2x    closePoint;
+					int        closeEdge = -1;
+					ScalarType minDst    = FLT_MAX;
+					for (int i = 0; i < 3; ++i) {
+						if (!(s.edgeMask & (1 << i)))
+							continue;
+						if ((!s.flipped && n[i] < 0) || (s.flipped && n[i] > 0)) {
+							Point2x    close = vcg::ClosestPoint(s.borderEdges[i], px);
+							ScalarType dst   = (close - px).Norm();
+							if (dst < minDst && close.X() > px.X() - 1 && close.X() < px.X() + 1 &&
+								close.Y() > px.Y() - 1 && close.Y() < px.Y() + 1) {
+								minDst     = dst;
+								closePoint = close;
+								closeEdge  = i;
+							}
+						}
+					}
+					if (closeEdge >= 0) {
+						CoordType baryCoord;
+						if (correctSafePointsBaryCoords) {
+							// sample with the barycentric coords of closePoint (on the edge)
+							baryCoord[closeEdge] = (closePoint - s.borderEdges[closeEdge].P(1)).Norm() /
+												   s.edgeLength[closeEdge];
+							baryCoord[(closeEdge + 1) % 3] = 1 - baryCoord[closeEdge];
+							baryCoord[(closeEdge + 2) % 3] = 0;
+						}
+						else {
+							// sample with its own barycentric coords (off the edge)
+							baryCoord[0] = double(-y * v[1][0] + v[2][0] * y + v[1][1] * x - v[2][0] * v[1][1] +
+												  v[1][0] * v[2][1] - x * v[2][1]) / s.de;
+							baryCoord[1] = -double(x * v[0][1] - x * v[2][1] - v[0][0] * y + v[0][0] * v[2][1] -
+												   v[2][0] * v[0][1] + v[2][0] * y) / s.de;
+							baryCoord[2] = 1 - baryCoord[0] - baryCoord[1];
+						}
+						ps.AddTextureSample(tile, f, baryCoord, vcg::Point2i(x, y), minDst);
+					}
+				}
+			}
+		}
+	}
+};
+
+} // namespace meshlab
+
+#endif // MESHLAB_TEXTURE_RASTER_H
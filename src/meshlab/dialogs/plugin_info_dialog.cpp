@@ -227,6 +227,7 @@ void PluginInfoDialog::populateTreeWidget()
 		
 		std::string lbl = "Number of plugin loaded: " + std::to_string(pm.size());
 		ui->label->setText(tr(lbl.c_str()));
+		ui->label->setToolTip(pm.loadingTimesReport());
 	}
 }
 
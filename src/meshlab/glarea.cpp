@@ -64,6 +64,13 @@ GLArea::GLArea(QWidget *parent, MultiViewer_Container *mvcont, RichParameterList
     lastModelEdited = 0;
     cfps=0;
     lastTime=0;
+    lodInteraction=false;
+    lodPrimitiveBudget=2000000;
+    renderedPrimitives=0;
+    lodUsedLastFrame=false;
+    lodWheelTimer.setSingleShot(true);
+    lodWheelTimer.setInterval(200);
+    connect(&lodWheelTimer, &QTimer::timeout, this, [this]() {lodInteraction = false; update();});
     hasToPick=false;
     hasToSelectMesh=false;
     hasToGetPickPos=false;
@@ -514,6 +521,9 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
             if (datacont == NULL)
                 return;
 
+            const bool interacting = glas.lodEnabled && (lodInteraction || (animMode != AnimNone));
+            renderedPrimitives = 0;
+            lodUsedLastFrame = false;
             for(const MeshModel& mp : md()->meshIterator())
             {
                 if (meshVisibilityMap[mp.id()])
@@ -532,7 +542,17 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
                         glDisable(GL_CULL_FACE);
 
                     datacont->setMeshTransformationMatrix(mp.id(),mp.cm.Tr);
-                    datacont->draw(mp.id(),context());
+                    size_t drawn = 0;
+                    if (interacting && datacont->drawLOD(mp.id(), context(), glas.lodPixelTolerance, lodPrimitiveBudget, drawn))
+                    {
+                        lodUsedLastFrame = true;
+                    }
+                    else
+                    {
+                        datacont->draw(mp.id(),context());
+                        drawn = (mp.cm.fn > 0) ? size_t(mp.cm.fn) : size_t(mp.cm.vn);
+                    }
+                    renderedPrimitives += drawn;
                 }
             }
             for(MeshModel& mp : md()->meshIterator())
@@ -670,6 +690,16 @@ void GLArea::paintEvent(QPaintEvent* /*event*/)
     glFinish();
     painter.endNativePainting();
 
+    // adapt the primitive budget of the level of detail to the frame time
+    if (lodUsedLastFrame && (glas.lodFrameTimeBudget > 0))
+    {
+        qint64 frametime = time.elapsed();
+        if (frametime > glas.lodFrameTimeBudget)
+            lodPrimitiveBudget = std::max(size_t(lodPrimitiveBudget * 0.8), size_t(100000));
+        else if (frametime < 0.6 * glas.lodFrameTimeBudget)
+            lodPrimitiveBudget = std::min(size_t(lodPrimitiveBudget * 1.25), size_t(200000000));
+    }
+
     emit currentViewerRefreshed();
 }
 
@@ -837,6 +867,8 @@ void GLArea::displayInfo(QPainter *painter)
         else col0Text += QString("FOV: Ortho\n");
         if ((cfps>0) && (cfps<1999))
             col0Text += QString("FPS: %1\n").arg(cfps,7,'f',1);
+        if (glas.lodEnabled)
+            col0Text += "Rendered: " + engLocale.toString(qulonglong(renderedPrimitives)) + (lodUsedLastFrame ? " (LOD)\n" : "\n");
 
         col0Text += renderfacility + QString("\n");
 
@@ -1113,6 +1145,8 @@ void GLArea::setCurrentEditAction(QAction *editAction)
 	}
 	if (mw() != NULL)
 		mw()->updateLayerDialog();
+	// edit tools modify the meshes directly, without making the document busy
+	parentmultiview->sharedDataContext()->waitForLODSnapshots();
 	if (!iEdit->startEdit(*this->md(), this,parentmultiview->sharedDataContext())) {
 		//iEdit->EndEdit(*(this->md()->mm()), this);
 		endEdit();
@@ -1174,7 +1208,10 @@ void GLArea::keyReleaseEvent ( QKeyEvent * e )
 {
 	makeCurrent();
     e->ignore();
-    if(iEdit && !suspendedEditor)  iEdit->keyReleaseEvent(e,*mm(),this);
+    if(iEdit && !suspendedEditor) {
+        parentmultiview->sharedDataContext()->waitForLODSnapshots();
+        iEdit->keyReleaseEvent(e,*mm(),this);
+    }
     else{
         if(e->key()==Qt::Key_Control) trackball.ButtonUp(QT2VCG(Qt::NoButton, Qt::ControlModifier ) );
         if(e->key()==Qt::Key_Shift) trackball.ButtonUp(QT2VCG(Qt::NoButton, Qt::ShiftModifier ) );
@@ -1186,7 +1223,10 @@ void GLArea::keyPressEvent ( QKeyEvent * e )
 {
 	makeCurrent();
     e->ignore();
-    if(iEdit && !suspendedEditor)  iEdit->keyPressEvent(e,*mm(),this);
+    if(iEdit && !suspendedEditor) {
+        parentmultiview->sharedDataContext()->waitForLODSnapshots();
+        iEdit->keyPressEvent(e,*mm(),this);
+    }
     else{
         if(e->key()==Qt::Key_Control) trackball.ButtonDown(QT2VCG(Qt::NoButton, Qt::ControlModifier ) );
         if(e->key()==Qt::Key_Shift) trackball.ButtonDown(QT2VCG(Qt::NoButton, Qt::ShiftModifier ) );
@@ -1206,6 +1246,7 @@ void GLArea::mousePressEvent(QMouseEvent*e)
 	{
 		if ((iEdit != NULL) && !suspendedEditor)
 		{
+			parentmultiview->sharedDataContext()->waitForLODSnapshots();
 			iEdit->mousePressEvent(e, *mm(), this);
 		}
 		else
@@ -1233,6 +1274,7 @@ void GLArea::mousePressEvent(QMouseEvent*e)
 					else trackball.ButtonUp(QT2VCG(Qt::NoButton, Qt::AltModifier));
 
 					trackball.MouseDown(QT2VCG_X(this, e), QT2VCG_Y(this, e), QT2VCG(e->button(), e->modifiers()));
+					lodInteraction = true;
 				}
 				else trackball_light.MouseDown(QT2VCG_X(this, e), QT2VCG_Y(this, e), QT2VCG(e->button(), Qt::NoModifier));
 			}
@@ -1244,8 +1286,10 @@ void GLArea::mousePressEvent(QMouseEvent*e)
 void GLArea::mouseMoveEvent(QMouseEvent*e)
 {
 	makeCurrent();
-    if( (iEdit && !suspendedEditor) )
+    if( (iEdit && !suspendedEditor) ) {
+        parentmultiview->sharedDataContext()->waitForLODSnapshots();
         iEdit->mouseMoveEvent(e,*mm(),this);
+    }
     else {
         if (isDefaultTrackBall())
         {
@@ -1263,8 +1307,11 @@ void GLArea::mouseReleaseEvent(QMouseEvent*e)
 	makeCurrent();
     //clearFocus();
     activeDefaultTrackball=true;
-    if( (iEdit && !suspendedEditor) )
+    lodInteraction=false;
+    if( (iEdit && !suspendedEditor) ) {
+        parentmultiview->sharedDataContext()->waitForLODSnapshots();
         iEdit->mouseReleaseEvent(e,*mm(),this);
+    }
     else {
         if (isDefaultTrackBall()) trackball.MouseUp(QT2VCG_X(this,e), QT2VCG_Y(this,e), QT2VCG(e->button(), e->modifiers() ) );
         else trackball_light.MouseUp(QT2VCG_X(this,e), QT2VCG_Y(this,e), QT2VCG(e->button(),e->modifiers()) );
@@ -1278,7 +1325,10 @@ void GLArea::mouseReleaseEvent(QMouseEvent*e)
 void GLArea::tabletEvent(QTabletEvent*e)
 {
 	makeCurrent();
-    if(iEdit && !suspendedEditor) iEdit->tabletEvent(e,*mm(),this);
+    if(iEdit && !suspendedEditor) {
+        parentmultiview->sharedDataContext()->waitForLODSnapshots();
+        iEdit->tabletEvent(e,*mm(),this);
+    }
     else e->ignore();
 }
 
@@ -1288,6 +1338,7 @@ void GLArea::wheelEvent(QWheelEvent*e)
 	setFocus();
 	if( (iEdit && !suspendedEditor) )
 	{
+		parentmultiview->sharedDataContext()->waitForLODSnapshots();
 		iEdit->wheelEvent(e,*mm(),this);
 	}
 	else
@@ -1350,6 +1401,8 @@ void GLArea::wheelEvent(QWheelEvent*e)
 				this->opacity = math::Clamp( opacity*powf(1.2f, notchY),0.1f,1.0f);
 			else {
 				trackball.MouseWheel(notchY);
+				lodInteraction = true;
+				lodWheelTimer.start();
 			}
 			break;
 		}
@@ -1779,6 +1832,9 @@ void GLArea::updateCustomSettingValues( const RichParameterList& rps )
 {
 	makeCurrent();
     glas.updateGlobalParameterSet(rps);
+    MLSceneGLSharedDataContext* datacont = (mvc() != NULL) ? mvc()->sharedDataContext() : NULL;
+    if (datacont != NULL)
+        datacont->setLODParameters(glas.lodEnabled, size_t(std::max(glas.lodMinPrimitives, 0)));
 
     this->update();
 }
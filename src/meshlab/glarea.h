@@ -231,6 +231,7 @@ public slots:
 	{
         if(iEdit && currentEditor)
         {
+			parentmultiview->sharedDataContext()->waitForLODSnapshots();
 			if (md() != NULL)
 				iEdit->endEdit(*md(), this, parentmultiview->sharedDataContext());
 
@@ -511,6 +512,13 @@ private:
 
     enum AnimMode { AnimNone, AnimSpin, AnimInterp};
     AnimMode animMode;
+
+    // level of detail rendering of the large meshes while the view is changing
+    bool lodInteraction;     // true while the trackball is dragged
+    QTimer lodWheelTimer;    // keeps lodInteraction after the last wheel event
+    size_t lodPrimitiveBudget;
+    size_t renderedPrimitives;
+    bool lodUsedLastFrame;
     int tileCol, tileRow, totalCols, totalRows;   // snapshot: total number of subparts and current subpart rendered
     void setCursorTrack(vcg::TrackMode *tm);
 
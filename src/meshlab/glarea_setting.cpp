@@ -26,6 +26,11 @@ void GLAreaSetting::initGlobalParameterList(RichParameterList& defaultGlobalPara
 
 	defaultGlobalParamSet.addParam(RichBool(wheelDirectionParam(), false, "Wheel Direction", "If true, inverts the direction of the mouse wheel for zooming in/out in the MeshLab canvas."));
 	defaultGlobalParamSet.addParam(RichInt(matrixDecimalPrecisionParam(), 2, "Rotation Matrix Precision", "Number of decimal values shown in the rotation matrix"));
+
+	defaultGlobalParamSet.addParam(RichBool(lodEnabledParam(), true, "Level of Detail While Moving", "If true, while the view is changing the very large meshes are drawn using a simplified, view dependent, proxy that is built in background."));
+	defaultGlobalParamSet.addParam(RichInt(lodMinPrimitivesParam(), 10000000, "Level of Detail Min Primitives", "Minimum number of faces (or vertices, for point clouds) of a mesh for using the level of detail proxy."));
+	defaultGlobalParamSet.addParam(RichFloat(lodPixelToleranceParam(), 2.0, "Level of Detail Pixel Tolerance", "Maximum error, in pixels, of the level of detail proxy. It is increased when the frame time budget cannot be met."));
+	defaultGlobalParamSet.addParam(RichInt(lodFrameTimeBudgetParam(), 33, "Level of Detail Frame Time (ms)", "Target time for drawing a frame while the view is changing; the number of primitives drawn by the level of detail proxy is adapted to meet it."));
 }
 
 
@@ -50,5 +55,9 @@ void GLAreaSetting::updateGlobalParameterSet( const RichParameterList& rps )
 	pointSize = rps.getFloat(this->pointSizeParam());
 	wheelDirection = rps.getBool(this->wheelDirectionParam());
 	matrixDecimalPrecision = rps.getInt(this->matrixDecimalPrecisionParam());
+	lodEnabled = rps.getBool(this->lodEnabledParam());
+	lodMinPrimitives = rps.getInt(this->lodMinPrimitivesParam());
+	lodPixelTolerance = rps.getFloat(this->lodPixelToleranceParam());
+	lodFrameTimeBudget = rps.getInt(this->lodFrameTimeBudgetParam());
 	currentGlobalParamSet=&rps;
 }
@@ -71,6 +71,15 @@ public:
 	int matrixDecimalPrecision;
 	inline static QString matrixDecimalPrecisionParam() {return "MeshLab::Appearance::matrixDecimalPrecision";}
 
+	bool lodEnabled;
+	inline static QString lodEnabledParam() {return "MeshLab::Appearance::lodEnabled";}
+	int lodMinPrimitives;
+	inline static QString lodMinPrimitivesParam() {return "MeshLab::Appearance::lodMinPrimitives";}
+	Scalarm lodPixelTolerance;
+	inline static QString lodPixelToleranceParam() {return "MeshLab::Appearance::lodPixelTolerance";}
+	int lodFrameTimeBudget;
+	inline static QString lodFrameTimeBudgetParam() {return "MeshLab::Appearance::lodFrameTimeBudget";}
+
 
 	void updateGlobalParameterSet(const RichParameterList& rps );
 	static void initGlobalParameterList(RichParameterList& defaultGlobalParamSet);
@@ -88,6 +88,14 @@ MainWindow::MainWindow() :
 		QMessageBox::warning(this, "Error while loading plugins.", e.what());
 	}
 
+	//the menus need all the plugins: instantiate the ones deferred by the lazy loading
+	try {
+		PM.size();
+	}
+	catch (const MLException& e) {
+		QMessageBox::warning(this, "Error while loading plugins.", e.what());
+	}
+
 	//disable previously disabled plugins
 	QStringList disabledPlugins = settings.value("DisabledPlugins").value<QStringList>();
 	for (MeshLabPlugin* fp : PM.pluginIterator(true)){
@@ -756,6 +756,30 @@ void MainWindow::showFilterScript()
 	}
 }
 
+/*
+ * Before running a filter: the changes of all the meshes are unknown, unless
+ * the filter reports them in the dirty masks of the meshes.
+ */
+static void resetDirtyMasksBeforeFilter(MeshDocument& md)
+{
+	for (MeshModel& mm : md.meshIterator())
+		mm.dirtyMask().reset();
+}
+
+/*
+ * After running a filter: compacts the meshes; the changes of the meshes
+ * that have deleted elements are considered unknown.
+ */
+static void compactMeshesAfterFilter(MeshDocument& md)
+{
+	for (MeshModel& mm : md.meshIterator()) {
+		if ((size_t(mm.cm.vn) != mm.cm.vert.size()) || (size_t(mm.cm.fn) != mm.cm.face.size()) ||
+				(size_t(mm.cm.en) != mm.cm.edge.size()))
+			mm.dirtyMask().reset();
+		vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm.cm);
+	}
+}
+
 void MainWindow::runFilterScript()
 {
 	if (meshDoc() == nullptr)
@@ -813,11 +837,11 @@ void MainWindow::runFilterScript()
 			if ((!created) || (!iFilter->glContext->isValid()))
 				throw MLException("A valid GLContext is required by the filter to work.\n");
 			meshDoc()->setBusy(true);
+			resetDirtyMasksBeforeFilter(*meshDoc());
 			iFilter->applyFilter(action, pair.second, *meshDoc(), postCondMask, QCallBack);
 			if (postCondMask == MeshModel::MM_UNKNOWN)
 				postCondMask = iFilter->postCondition(action);
-			for (MeshModel* mm = meshDoc()->nextMesh(); mm != NULL; mm = meshDoc()->nextMesh(mm))
-				vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm->cm);
+			compactMeshesAfterFilter(*meshDoc());
 			meshDoc()->setBusy(false);
 			if (shar != NULL)
 				shar->removeView(iFilter->glContext);
@@ -993,12 +1017,16 @@ void MainWindow::updateSharedContextDataAfterFilterExecution(int postcondmask,in
 
 					//masks differences bitwise operator (^) -> remove the attributes that didn't apparently change + the ones that for sure changed according to the postCondition function
 					//this operation has been introduced in order to minimize problems with filters that didn't declared properly the postCondition mask
-					int updatemask = (existit->_mask ^ mm->dataMask()) | postcondmask;
+					//if the filter reported what it modified in this mesh, the postCondition is restricted to it
+					//(e.g. the layers left untouched by a transformation or by a vertex color filter)
+					const MeshDirtyMask& dirty = mm->dirtyMask();
+					int meshpostcondmask = dirty.isTracked() ? (postcondmask & dirty.mask()) : postcondmask;
+					int updatemask = (existit->_mask ^ mm->dataMask()) | meshpostcondmask;
 					bool connectivitychanged = false;
 					if (((unsigned int)mm->cm.VN() != existit->_nvert) || ((unsigned int)mm->cm.FN() != existit->_nface) ||
-							bool(postcondmask & MeshModel::MM_UNKNOWN) || bool(postcondmask & MeshModel::MM_VERTNUMBER) ||
-							bool(postcondmask & MeshModel::MM_FACENUMBER) || bool(postcondmask & MeshModel::MM_FACEVERT) ||
-							bool(postcondmask & MeshModel::MM_VERTFACETOPO) || bool(postcondmask & MeshModel::MM_FACEFACETOPO))
+							bool(meshpostcondmask & MeshModel::MM_UNKNOWN) || bool(meshpostcondmask & MeshModel::MM_VERTNUMBER) ||
+							bool(meshpostcondmask & MeshModel::MM_FACENUMBER) || bool(meshpostcondmask & MeshModel::MM_FACEVERT) ||
+							bool(meshpostcondmask & MeshModel::MM_VERTFACETOPO) || bool(meshpostcondmask & MeshModel::MM_FACEFACETOPO))
 					{
 						connectivitychanged = true;
 					}
@@ -1172,11 +1200,11 @@ void MainWindow::executeFilter(
 		meshDoc()->meshDocStateData().clear();
 		meshDoc()->meshDocStateData().create(*meshDoc());
 		unsigned int postCondMask = MeshModel::MM_UNKNOWN;
+		resetDirtyMasksBeforeFilter(*meshDoc());
 		iFilter->applyFilter(action, mergedenvironment, *(meshDoc()), postCondMask, QCallBack);
 		if (postCondMask == MeshModel::MM_UNKNOWN)
 			postCondMask = iFilter->postCondition(action);
-		for (MeshModel& mm : meshDoc()->meshIterator())
-			vcg::tri::Allocator<CMeshO>::CompactEveryVector(mm.cm);
+		compactMeshesAfterFilter(*meshDoc());
 		
 		if (shar != NULL) {
 			shar->removeView(iFilter->glContext);
@@ -2285,30 +2313,33 @@ void MainWindow::reloadAllMesh()
 	MeshDocument* md = meshDoc();
 	md->setBusy(true);
 	qApp->setOverrideCursor(QCursor(Qt::WaitCursor));
+	// all the files are reloaded together
+	QStringList fileNames;
+	std::vector<std::list<MeshModel*>> meshLists;
 	for(MeshModel& mmm : md->meshIterator()) {
 		if (mmm.idInFile() <= 0){
 			QString fileName = mmm.fullName();
 			if (!fileName.isEmpty()){
-				std::list<MeshModel* > meshList = meshDoc()->getMeshesLoadedFromSameFile(mmm);
-				std::vector<bool> isReload(meshList.size(), true);
-				unsigned int i = 0;
-				for (MeshModel* m : meshList) {
-					if (m->cm.VN() == 0)
-						isReload[i] = false;
-					i++;
-				}
-				try {
-					meshlab::reloadMesh(fileName, meshList, &meshDoc()->Log, QCallBack);
-					for (MeshModel* m : meshList){
-						computeRenderingDataOnLoading(m, true, nullptr);
-					}
-				}
-				catch (const MLException& e) {
-					QMessageBox::critical(this, "Reload Error", e.what());
-				}
+				fileNames.push_back(fileName);
+				meshLists.push_back(meshDoc()->getMeshesLoadedFromSameFile(mmm));
 			}
 		}
 	}
+	std::vector<QString> errors;
+	meshlab::reloadMeshes(fileNames, meshLists, errors, &meshDoc()->Log, QCallBack);
+	QString errorString;
+	for (unsigned int i = 0; i < meshLists.size(); ++i) {
+		if (errors[i].isEmpty()) {
+			for (MeshModel* m : meshLists[i]){
+				computeRenderingDataOnLoading(m, true, nullptr);
+			}
+		}
+		else {
+			errorString += errors[i] + "\n";
+		}
+	}
+	if (!errorString.isEmpty())
+		QMessageBox::critical(this, "Reload Error", errorString);
 	md->setBusy(false);
 	qApp->restoreOverrideCursor();
 	GLA()->Log(0, ("All meshes reloaded in " + std::to_string(t.elapsed()) + " msec.").c_str());
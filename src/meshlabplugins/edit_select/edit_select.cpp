@@ -191,77 +191,29 @@ void EditSelectPlugin::keyReleaseEvent(QKeyEvent *e, MeshModel &m, GLArea *gla)
 
 void EditSelectPlugin::doSelection(MeshModel &m, GLArea *gla, int mode)
 {
-  QImage bufQImg(this->viewpSize[2],this->viewpSize[3],QImage::Format_RGB32);
-  bufQImg.fill(Qt::white);
-  QPainter bufQPainter(&bufQImg);
-  vector<QPointF> qpoints;
-  for(size_t i=0;i<selPolyLine.size();++i)
-    qpoints.push_back(QPointF(selPolyLine[i][0],selPolyLine[i][1]));    
-  bufQPainter.setBrush(QBrush(Qt::black));
-  bufQPainter.drawPolygon(&qpoints[0],qpoints.size(), Qt::WindingFill); 
-  QRgb blk=QColor(Qt::black).rgb();
-  
-    
-  static Eigen::Matrix<Scalarm,4,4> LastSelMatrix;
-  static vector<Point3m> projVec;
-  static MeshModel *lastMeshModel=0;
-  if((LastSelMatrix != SelMatrix) || lastMeshModel != &m)
-  {
-    GLPickTri<CMeshO>::FillProjectedVector(m.cm,projVec,this->SelMatrix,this->SelViewport);
-    LastSelMatrix=this->SelMatrix;
-    lastMeshModel=&m;
-  }    
-  
-    if (areaMode == 0) // vertices
-    {   
-      for (size_t vi = 0; vi<m.cm.vert.size(); ++vi) if (!m.cm.vert[vi].IsD())
-      {
-        bool res=false;
-        if ((projVec[vi][2] <= -1.0) || (projVec[vi][2] >= 1.0) ||
-            (projVec[vi][0] <= 0) || (projVec[vi][0] >= this->viewpSize[2]) ||
-            (projVec[vi][1] <= 0) || (projVec[vi][1] >= this->viewpSize[3]))
-          res = false;
-        else
-        {
-          res = (bufQImg.pixel( projVec[vi][0],projVec[vi][1]) == blk);
-        }
-        if (res)
-          switch(mode){
-          case 0: m.cm.vert[vi].SetS(); break;
-          case 1: m.cm.vert[vi].ClearS(); break;
-          case 2: m.cm.vert[vi].IsS() ? m.cm.vert[vi].ClearS() : m.cm.vert[vi].SetS();
-          }
-      }
-      gla->updateSelection(m.id(), true, false);
-    }
-    else if (areaMode == 1) //faces
-	{
-      for (size_t fi = 0; fi < m.cm.face.size(); ++fi) if (!m.cm.face[fi].IsD())
-      {
-        bool res=false;
-        for (int vi = 0; vi < 3 && !res ; vi++)
-        {
-          int vInd=tri::Index(m.cm,m.cm.face[fi].V(vi));
-          if ((projVec[vInd][2] <= -1.0) || (projVec[vInd][2] >= 1.0) ||
-              (projVec[vInd][0] <= 0) || (projVec[vInd][0] >= this->viewpSize[2]) ||
-              (projVec[vInd][1] <= 0) || (projVec[vInd][1] >= this->viewpSize[3]))
-            res = false; 
-          else
-            res = (bufQImg.pixel( projVec[vInd][0],projVec[vInd][1]) == blk);
-        }
+	vector<Point2m> poly;
+	for (size_t i = 0; i < selPolyLine.size(); ++i)
+		poly.push_back(Point2m(selPolyLine[i][0], selPolyLine[i][1]));
 
-        if (res) // do the actual selection
-        {
-          switch(mode){
-          case 0: m.cm.face[fi].SetS(); break;
-          case 1: m.cm.face[fi].ClearS(); break;
-          case 2: m.cm.face[fi].IsS() ? m.cm.face[fi].ClearS() : m.cm.face[fi].SetS();
-          }
-        }
-      }
-      gla->updateSelection(m.id(), false, true);
-    }
-    
+	SelectionEngine::Op op = SelectionEngine::SET;
+	if (mode == 1)
+		op = SelectionEngine::CLEAR;
+	else if (mode == 2)
+		op = SelectionEngine::TOGGLE;
+
+	selEngine.update(m.cm);
+	selEngine.setView(this->SelMatrix, this->SelViewport);
+
+	if (areaMode == 0) // vertices
+	{
+		SelectionEngine::selectVertices(m.cm, selEngine.polygonVertices(m.cm, poly), op);
+		gla->updateSelection(m.id(), true, false);
+	}
+	else if (areaMode == 1) //faces
+	{
+		SelectionEngine::selectFaces(m.cm, selEngine.polygonFaces(m.cm, poly), op);
+		gla->updateSelection(m.id(), false, true);
+	}
 }
 
 void EditSelectPlugin::keyPressEvent(QKeyEvent * /*event*/, MeshModel & /*m*/, GLArea *gla)
@@ -539,20 +491,23 @@ void EditSelectPlugin::decorate(MeshModel &m, GLArea * gla)
 		DrawXORRect(gla, false);
 		vector<CMeshO::FacePointer>::iterator fpi;
 		// Starting Sel
-		vector<CMeshO::FacePointer> NewSelFace;
 		Point2f mid = (start + cur) / 2;
 		Point2f wid = vcg::Abs(start - cur);
+		Point2m selMin(mid[0] - wid[0] / 2, mid[1] - wid[1] / 2);
+		Point2m selMax(mid[0] + wid[0] / 2, mid[1] + wid[1] / 2);
 
 		glPushMatrix();
 		glMultMatrix(m.cm.Tr);
+		GLPickTri<CMeshO>::glGetMatrixAndViewport(this->SelMatrix, this->SelViewport);
+		glPopMatrix();
+		selEngine.update(m.cm);
+		selEngine.setView(this->SelMatrix, this->SelViewport);
 		if (selectionMode == SELECT_VERT_MODE)
 		{
 			//m.cm.selvert.clear();
-			vector<CMeshO::VertexPointer> NewSelVert;
 			vector<CMeshO::VertexPointer>::iterator vpi;
 
-			GLPickTri<CMeshO>::PickVert(mid[0], mid[1], m.cm, NewSelVert, wid[0], wid[1]);
-			glPopMatrix();
+			vector<int> NewSelVert = selEngine.rectVertices(m.cm, selMin, selMax);
 			tri::UpdateSelection<CMeshO>::VertexClear(m.cm);
 
 			switch (composingSelMode)
@@ -560,15 +515,13 @@ void EditSelectPlugin::decorate(MeshModel &m, GLArea * gla)
 			case SMSub:  // Subtract mode : The faces in the rect must be de-selected
 				for (vpi = LastSelVert.begin(); vpi != LastSelVert.end(); ++vpi)
 					(*vpi)->SetS();
-				for (vpi = NewSelVert.begin(); vpi != NewSelVert.end(); ++vpi)
-					(*vpi)->ClearS();
+				SelectionEngine::selectVertices(m.cm, NewSelVert, SelectionEngine::CLEAR);
 				break;
 			case SMAdd:  // Subtract mode : The faces in the rect must be de-selected
 				for (vpi = LastSelVert.begin(); vpi != LastSelVert.end(); ++vpi)
 					(*vpi)->SetS();
 			case SMClear:  // Subtract mode : The faces in the rect must be de-selected
-				for (vpi = NewSelVert.begin(); vpi != NewSelVert.end(); ++vpi)
-					(*vpi)->SetS();
+				SelectionEngine::selectVertices(m.cm, NewSelVert, SelectionEngine::SET);
 				break;
 			}
 			//for (unsigned int ii = 0; ii < m.cm.VN(); ++ii)
@@ -585,37 +538,32 @@ void EditSelectPlugin::decorate(MeshModel &m, GLArea * gla)
 		else
 		{
 			//m.cm.selface.clear();
-			if (selectFrontFlag)	GLPickTri<CMeshO>::PickVisibleFace(mid[0], mid[1], m.cm, NewSelFace, wid[0], wid[1]);
-			else                GLPickTri<CMeshO>::PickFace(mid[0], mid[1], m.cm, NewSelFace, wid[0], wid[1]);
+			vector<int> NewSelFace = selEngine.rectFaces(m.cm, selMin, selMax, selectFrontFlag);
 
 			//    qDebug("Pickface: rect %i %i - %i %i",mid.x(),mid.y(),wid.x(),wid.y());
 			//    qDebug("Pickface: Got  %i on %i",int(NewSelFace.size()),int(m.cm.face.size()));
-			glPopMatrix();
 			tri::UpdateSelection<CMeshO>::FaceClear(m.cm);
 			switch (composingSelMode)
 			{
 			case SMSub:  // Subtract mode : The faces in the rect must be de-selected
 				if (selectionMode == SELECT_CONN_MODE)
 				{
-					for (fpi = NewSelFace.begin(); fpi != NewSelFace.end(); ++fpi)
-						(*fpi)->SetS();
+					SelectionEngine::selectFaces(m.cm, NewSelFace, SelectionEngine::SET);
 					tri::UpdateSelection<CMeshO>::FaceConnectedFF(m.cm);
 					NewSelFace.clear();
-					for (CMeshO::FaceIterator fi = m.cm.face.begin(); fi != m.cm.face.end(); ++fi)
-						if (!(*fi).IsD() && (*fi).IsS()) NewSelFace.push_back(&*fi);
+					for (size_t fi = 0; fi < m.cm.face.size(); ++fi)
+						if (!m.cm.face[fi].IsD() && m.cm.face[fi].IsS()) NewSelFace.push_back(int(fi));
 				}
 				// Normal case: simply deselect what has been selected.
 				for (fpi = LastSelFace.begin(); fpi != LastSelFace.end(); ++fpi)
 					(*fpi)->SetS();
-				for (fpi = NewSelFace.begin(); fpi != NewSelFace.end(); ++fpi)
-					(*fpi)->ClearS();
+				SelectionEngine::selectFaces(m.cm, NewSelFace, SelectionEngine::CLEAR);
 				break;
 			case SMAdd:
 				for (fpi = LastSelFace.begin(); fpi != LastSelFace.end(); ++fpi)
 					(*fpi)->SetS();
 			case SMClear:
-				for (fpi = NewSelFace.begin(); fpi != NewSelFace.end(); ++fpi)
-					(*fpi)->SetS();
+				SelectionEngine::selectFaces(m.cm, NewSelFace, SelectionEngine::SET);
 				if (selectionMode == SELECT_CONN_MODE)
 					tri::UpdateSelection<CMeshO>::FaceConnectedFF(m.cm);
 				break;
@@ -654,5 +602,9 @@ bool EditSelectPlugin::startEdit(MeshModel & m, GLArea * gla, MLSceneGLSharedDat
 
 	if (selectionMode == SELECT_CONN_MODE)
 		m.updateDataMask(MeshModel::MM_FACEFACETOPO);
+
+	// the mesh may have been changed while the tool was not active
+	selEngine.clear();
+	selEngine.update(m.cm);
 	return true;
 }
@@ -24,6 +24,7 @@
 #define EDITPLUGIN_H
 
 #include <common/plugins/interfaces/edit_plugin.h>
+#include "selection_engine.h"
 
 class EditSelectPlugin : public QObject, public EditTool
 {
@@ -74,6 +75,7 @@ private:
 	typedef enum { SMAdd, SMClear, SMSub } ComposingSelMode; // How the selection are composed
 	ComposingSelMode composingSelMode;
 	bool selectFrontFlag;
+	SelectionEngine selEngine;
 	void DrawXORRect(GLArea * gla, bool doubleDraw);
 	void DrawXORPolyLine(GLArea * gla);
 	void doSelection(MeshModel &m, GLArea *gla, int mode);
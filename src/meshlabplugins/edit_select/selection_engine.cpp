@@ -0,0 +1,441 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#include "selection_engine.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace meshlab;
+
+namespace {
+
+// depth tolerance of the visibility test, in [0, 1] window depth (as GLPickTri)
+const float DEPTH_EPSILON = 0.001f;
+// rows of the depth buffer rasterized by each task
+const int BAND_HEIGHT = 32;
+
+std::vector<int> flaggedIndices(const std::vector<int>& indices, const std::vector<char>& flags)
+{
+	std::vector<int> res;
+	for (size_t i = 0; i < flags.size(); ++i)
+		if (flags[i])
+			res.push_back(indices.empty() ? int(i) : indices[i]);
+	return res;
+}
+
+bool insidePolygon(const std::vector<Point2m>& poly, Scalarm x, Scalarm y)
+{
+	int winding = 0;
+	for (size_t i = 0; i < poly.size(); ++i) {
+		const Point2m& a    = poly[i];
+		const Point2m& b    = poly[(i + 1) % poly.size()];
+		Scalarm        side = (b[0] - a[0]) * (y - a[1]) - (x - a[0]) * (b[1] - a[1]);
+		if (a[1] <= y) {
+			if (b[1] > y && side > 0)
+				++winding;
+		}
+		else if (b[1] <= y && side < 0) {
+			--winding;
+		}
+	}
+	return winding != 0;
+}
+
+// separating axis test between a 2D triangle and an axis aligned rectangle
+bool triangleIntersectsRect(const Point2m t[3], const Point2m& pmin, const Point2m& pmax)
+{
+	for (int a = 0; a < 2; ++a) {
+		Scalarm lo = std::min(t[0][a], std::min(t[1][a], t[2][a]));
+		Scalarm hi = std::max(t[0][a], std::max(t[1][a], t[2][a]));
+		if (hi < pmin[a] || lo > pmax[a])
+			return false;
+	}
+	const Point2m corner[4] = {
+		pmin, Point2m(pmax[0], pmin[1]), pmax, Point2m(pmin[0], pmax[1])};
+	for (int i = 0; i < 3; ++i) {
+		const Point2m& p = t[i];
+		const Point2m& q = t[(i + 1) % 3];
+		Point2m        n(q[1] - p[1], p[0] - q[0]);
+		Scalarm        opposite = n * (t[(i + 2) % 3] - p);
+		if (opposite == 0)
+			continue;
+		bool separated = true;
+		for (int k = 0; k < 4 && separated; ++k) {
+			Scalarm s = n * (corner[k] - p);
+			separated = opposite > 0 ? s < 0 : s > 0;
+		}
+		if (separated)
+			return false;
+	}
+	return true;
+}
+
+} // namespace
+
+SelectionEngine::SelectionEngine()
+{
+	M.setIdentity();
+	std::fill(viewport, viewport + 4, Scalarm(0));
+}
+
+/**
+ * @brief Rebuilds the hierarchy if m is not the mesh it has been built on,
+ * or if the mesh changed since then.
+ */
+void SelectionEngine::update(const CMeshO& m)
+{
+	if (mesh == &m && vertNum == m.vert.size() && faceNum == m.face.size() && vn == m.vn &&
+		fn == m.fn && bbox == m.bbox)
+		return;
+	bvh.build(m);
+	mesh    = &m;
+	vertNum = m.vert.size();
+	faceNum = m.face.size();
+	vn      = m.vn;
+	fn      = m.fn;
+	bbox    = m.bbox;
+}
+
+void SelectionEngine::clear()
+{
+	bvh.clear();
+	mesh = nullptr;
+}
+
+void SelectionEngine::setView(const ProjectionMatrix& projModel, const Scalarm vp[4])
+{
+	M = projModel;
+	std::copy(vp, vp + 4, viewport);
+}
+
+std::vector<int>
+SelectionEngine::rectVertices(const CMeshO& m, const Point2m& pmin, const Point2m& pmax) const
+{
+	const int         n = (int) m.vert.size();
+	std::vector<char> in(n, 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; ++i) {
+		if (m.vert[i].IsD())
+			continue;
+		Projected p = project(m.vert[i].cP());
+		in[i] = p.front && p.x >= pmin[0] && p.x <= pmax[0] && p.y >= pmin[1] && p.y <= pmax[1];
+	}
+	return flaggedIndices(std::vector<int>(), in);
+}
+
+std::vector<int> SelectionEngine::rectFaces(
+	const CMeshO&  m,
+	const Point2m& pmin,
+	const Point2m& pmax,
+	bool           visibleOnly) const
+{
+	std::vector<int> res, toTest;
+	candidateFaces(pmin, pmax, true, res, toTest);
+
+	std::vector<char> in(toTest.size(), 0);
+	#pragma omp parallel for schedule(dynamic, 4096)
+	for (int i = 0; i < (int) toTest.size(); ++i) {
+		const CFaceO& f = m.face[toTest[i]];
+		Point2m       t[3];
+		bool          front = true;
+		for (int k = 0; k < 3 && front; ++k) {
+			Projected p = project(f.cP(k));
+			front       = p.front;
+			t[k]        = Point2m(p.x, p.y);
+		}
+		in[i] = front && triangleIntersectsRect(t, pmin, pmax);
+	}
+	std::vector<int> tested = flaggedIndices(toTest, in);
+	res.insert(res.end(), tested.begin(), tested.end());
+	std::sort(res.begin(), res.end());
+
+	if (visibleOnly)
+		return visibleFaces(m, res);
+	return res;
+}
+
+std::vector<int>
+SelectionEngine::polygonVertices(const CMeshO& m, const std::vector<Point2m>& poly) const
+{
+	if (poly.size() < 3)
+		return std::vector<int>();
+	const int         n = (int) m.vert.size();
+	std::vector<char> in(n, 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < n; ++i) {
+		if (m.vert[i].IsD())
+			continue;
+		Projected p = project(m.vert[i].cP());
+		in[i] = p.front && p.z > -1 && p.z < 1 && p.x > viewport[0] &&
+				p.x < viewport[0] + viewport[2] && p.y > viewport[1] &&
+				p.y < viewport[1] + viewport[3] && insidePolygon(poly, p.x, p.y);
+	}
+	return flaggedIndices(std::vector<int>(), in);
+}
+
+std::vector<int>
+SelectionEngine::polygonFaces(const CMeshO& m, const std::vector<Point2m>& poly) const
+{
+	if (poly.size() < 3)
+		return std::vector<int>();
+	Point2m pmin = poly[0], pmax = poly[0];
+	for (const Point2m& p : poly) {
+		pmin = Point2m(std::min(pmin[0], p[0]), std::min(pmin[1], p[1]));
+		pmax = Point2m(std::max(pmax[0], p[0]), std::max(pmax[1], p[1]));
+	}
+	std::vector<int> inside, toTest;
+	candidateFaces(pmin, pmax, false, inside, toTest);
+
+	std::vector<char> in(toTest.size(), 0);
+	#pragma omp parallel for schedule(dynamic, 4096)
+	for (int i = 0; i < (int) toTest.size(); ++i) {
+		const CFaceO& f = m.face[toTest[i]];
+		for (int k = 0; k < 3 && !in[i]; ++k) {
+			Projected p = project(f.cP(k));
+			in[i] = p.front && p.z > -1 && p.z < 1 && p.x > viewport[0] &&
+					p.x < viewport[0] + viewport[2] && p.y > viewport[1] &&
+					p.y < viewport[1] + viewport[3] && insidePolygon(poly, p.x, p.y);
+		}
+	}
+	std::vector<int> res = flaggedIndices(toTest, in);
+	std::sort(res.begin(), res.end());
+	return res;
+}
+
+void SelectionEngine::selectVertices(CMeshO& m, const std::vector<int>& verts, Op op)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) verts.size(); ++i) {
+		CVertexO& v = m.vert[verts[i]];
+		switch (op) {
+		case SET: v.SetS(); break;
+		case CLEAR: v.ClearS(); break;
+		case TOGGLE: v.IsS() ? v.ClearS() : v.SetS(); break;
+		}
+	}
+}
+
+void SelectionEngine::selectFaces(CMeshO& m, const std::vector<int>& faces, Op op)
+{
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) faces.size(); ++i) {
+		CFaceO& f = m.face[faces[i]];
+		switch (op) {
+		case SET: f.SetS(); break;
+		case CLEAR: f.ClearS(); break;
+		case TOGGLE: f.IsS() ? f.ClearS() : f.SetS(); break;
+		}
+	}
+}
+
+SelectionEngine::Projected SelectionEngine::project(const Point3m& p) const
+{
+	Eigen::Matrix<Scalarm, 4, 1> c = M * Eigen::Matrix<Scalarm, 4, 1>(p[0], p[1], p[2], 1);
+	Projected r;
+	r.front   = c[3] > 0 && c[2] >= -c[3] && c[2] <= c[3];
+	Scalarm w = c[3] != 0 ? c[3] : std::numeric_limits<Scalarm>::min();
+	r.x       = viewport[2] / 2 * (c[0] / w) + viewport[0] + viewport[2] / 2;
+	r.y       = viewport[3] / 2 * (c[1] / w) + viewport[1] + viewport[3] / 2;
+	r.z       = c[2] / w;
+	return r;
+}
+
+/**
+ * @brief The six half spaces of the frustum of the window rectangle
+ * [pmin, pmax] (x and y between the rectangle sides, z between the near and
+ * far planes), as rows to be applied to homogeneous object space points.
+ */
+void SelectionEngine::regionPlanes(const Point2m& pmin, const Point2m& pmax, Plane planes[6]) const
+{
+	// rectangle in normalized device coordinates
+	Scalarm x0 = (pmin[0] - viewport[0]) / viewport[2] * 2 - 1;
+	Scalarm x1 = (pmax[0] - viewport[0]) / viewport[2] * 2 - 1;
+	Scalarm y0 = (pmin[1] - viewport[1]) / viewport[3] * 2 - 1;
+	Scalarm y1 = (pmax[1] - viewport[1]) / viewport[3] * 2 - 1;
+
+	const Plane clip[6] = {
+		Plane(1, 0, 0, -x0),
+		Plane(-1, 0, 0, x1),
+		Plane(0, 1, 0, -y0),
+		Plane(0, -1, 0, y1),
+		Plane(0, 0, 1, 1),
+		Plane(0, 0, -1, 1)};
+	for (int k = 0; k < 6; ++k)
+		planes[k] = clip[k] * M;
+}
+
+/**
+ * @brief Faces whose nodes are inside the frustum of the rectangle, and faces
+ * of the leaves that straddle it, that must be tested. When exactRect is
+ * false the region is only bounded by the rectangle, and all the faces must
+ * be tested.
+ */
+void SelectionEngine::candidateFaces(
+	const Point2m&    pmin,
+	const Point2m&    pmax,
+	bool              exactRect,
+	std::vector<int>& inside,
+	std::vector<int>& toTest) const
+{
+	Plane planes[6];
+	regionPlanes(pmin, pmax, planes);
+	auto classify = [&](const Box3m& b) {
+		bool in = true;
+		for (int k = 0; k < 6; ++k) {
+			// range of the plane function on the box
+			Scalarm lo = planes[k][3], hi = planes[k][3];
+			for (int i = 0; i < 3; ++i) {
+				Scalarm a = planes[k][i] * b.min[i];
+				Scalarm c = planes[k][i] * b.max[i];
+				lo += std::min(a, c);
+				hi += std::max(a, c);
+			}
+			if (hi < 0)
+				return FaceBVH::OUTSIDE;
+			in = in && lo > 0;
+		}
+		return (in && exactRect) ? FaceBVH::INSIDE : FaceBVH::STRADDLING;
+	};
+	bvh.regionQuery(classify, inside, toTest);
+}
+
+/**
+ * @brief The faces whose barycenter is not occluded. The depth buffer is
+ * rasterized on the CPU only on the pixels that contain a barycenter, with
+ * the faces that overlap them; faces crossing the near or far plane are not
+ * clipped but skipped.
+ */
+std::vector<int> SelectionEngine::visibleFaces(const CMeshO& m, const std::vector<int>& faces) const
+{
+	const int w = int(viewport[2]);
+	const int h = int(viewport[3]);
+
+	// barycenters, in pixels from the viewport origin
+	std::vector<Projected> bary(faces.size());
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) faces.size(); ++i) {
+		const CFaceO& f = m.face[faces[i]];
+		bary[i]         = project((f.cP(0) + f.cP(1) + f.cP(2)) / 3);
+		bary[i].x -= viewport[0];
+		bary[i].y -= viewport[1];
+	}
+	int x0 = w, y0 = h, x1 = -1, y1 = -1;
+	for (const Projected& b : bary) {
+		if (b.x >= 0 && b.x < w && b.y >= 0 && b.y < h) {
+			x0 = std::min(x0, int(b.x));
+			y0 = std::min(y0, int(b.y));
+			x1 = std::max(x1, int(b.x));
+			y1 = std::max(y1, int(b.y));
+		}
+	}
+	if (x1 < x0)
+		return std::vector<int>();
+	const int rw = x1 - x0 + 1;
+	const int rh = y1 - y0 + 1;
+
+	// occluders: faces overlapping the region, projected with depth in [0, 1]
+	std::vector<int> occ, toTest;
+	candidateFaces(
+		Point2m(viewport[0] + x0, viewport[1] + y0),
+		Point2m(viewport[0] + x1 + 1, viewport[1] + y1 + 1),
+		true,
+		occ,
+		toTest);
+	occ.insert(occ.end(), toTest.begin(), toTest.end());
+	std::vector<Point3m> tri(3 * occ.size());
+	std::vector<char>    valid(occ.size(), 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) occ.size(); ++i) {
+		const CFaceO& f = m.face[occ[i]];
+		valid[i]        = 1;
+		for (int k = 0; k < 3; ++k) {
+			Projected p = project(f.cP(k));
+			valid[i]    = valid[i] && p.front;
+			tri[3 * i + k] = Point3m(p.x - viewport[0] - x0, p.y - viewport[1] - y0, (p.z + 1) / 2);
+		}
+	}
+
+	// bin the occluders in horizontal bands of the region
+	const int                     bandNum = (rh + BAND_HEIGHT - 1) / BAND_HEIGHT;
+	std::vector<std::vector<int>> bands(bandNum);
+	for (int i = 0; i < (int) occ.size(); ++i) {
+		if (!valid[i])
+			continue;
+		const Point3m* t    = &tri[3 * i];
+		Scalarm        ymin = std::min(t[0][1], std::min(t[1][1], t[2][1]));
+		Scalarm        ymax = std::max(t[0][1], std::max(t[1][1], t[2][1]));
+		if (ymax < 0 || ymin >= rh)
+			continue;
+		int b0 = int(std::max<Scalarm>(ymin, 0)) / BAND_HEIGHT;
+		int b1 = int(std::min<Scalarm>(ymax, rh - 1)) / BAND_HEIGHT;
+		for (int b = b0; b <= b1; ++b)
+			bands[b].push_back(i);
+	}
+
+	std::vector<float> depth(size_t(rw) * rh, 1.0f);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int b = 0; b < bandNum; ++b) {
+		const int by0 = b * BAND_HEIGHT;
+		const int by1 = std::min(rh, by0 + BAND_HEIGHT);
+		for (int i : bands[b]) {
+			const Point3m* t    = &tri[3 * i];
+			const Scalarm  area = (t[1][0] - t[0][0]) * (t[2][1] - t[0][1]) -
+								 (t[1][1] - t[0][1]) * (t[2][0] - t[0][0]);
+			if (area == 0)
+				continue;
+			int xmin = int(std::max<Scalarm>(0, std::floor(std::min(t[0][0], std::min(t[1][0], t[2][0])))));
+			int xmax = int(std::min<Scalarm>(rw - 1, std::ceil(std::max(t[0][0], std::max(t[1][0], t[2][0])))));
+			int ymin = int(std::max<Scalarm>(by0, std::floor(std::min(t[0][1], std::min(t[1][1], t[2][1])))));
+			int ymax = int(std::min<Scalarm>(by1 - 1, std::ceil(std::max(t[0][1], std::max(t[1][1], t[2][1])))));
+			for (int y = ymin; y <= ymax; ++y) {
+				const Scalarm py = y + Scalarm(0.5);
+				for (int x = xmin; x <= xmax; ++x) {
+					const Scalarm px = x + Scalarm(0.5);
+					// window depth is affine in screen space
+					Scalarm w0 = ((t[2][0] - t[1][0]) * (py - t[1][1]) - (t[2][1] - t[1][1]) * (px - t[1][0])) / area;
+					Scalarm w1 = ((t[0][0] - t[2][0]) * (py - t[2][1]) - (t[0][1] - t[2][1]) * (px - t[2][0])) / area;
+					Scalarm w2 = 1 - w0 - w1;
+					if (w0 < 0 || w1 < 0 || w2 < 0)
+						continue;
+					float  z = float(w0 * t[0][2] + w1 * t[1][2] + w2 * t[2][2]);
+					float& d = depth[size_t(y) * rw + x];
+					if (z < d)
+						d = z;
+				}
+			}
+		}
+	}
+
+	std::vector<char> visible(faces.size(), 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < (int) faces.size(); ++i) {
+		const Projected& b = bary[i];
+		if (b.x >= 0 && b.x < w && b.y >= 0 && b.y < h) {
+			float d    = depth[size_t(int(b.y) - y0) * rw + (int(b.x) - x0)];
+			visible[i] = d + DEPTH_EPSILON >= float(b.z + 1) / 2;
+		}
+	}
+	return flaggedIndices(faces, visible);
+}
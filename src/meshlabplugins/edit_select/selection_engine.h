@@ -0,0 +1,113 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef EDIT_SELECT_SELECTION_ENGINE_H
+#define EDIT_SELECT_SELECTION_ENGINE_H
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <common/ml_document/cmesh.h>
+#include <common/utilities/face_bvh.h>
+
+/*
+CPU replacement of the GLPickTri queries used by the selection editor.
+
+The engine keeps a FaceBVH of the mesh, rebuilt by update() only when the
+mesh changes (different mesh, number of elements or bounding box): an
+editing that moves vertices without changing the bounding box needs an
+explicit clear(). Queries
+take the view as the projection * modelview matrix and the viewport returned
+by GLPickTri::glGetMatrixAndViewport, and work in window coordinates:
+- rectVertices / polygonVertices: vertices projected inside the region and
+  between the near and far planes;
+- rectFaces: faces with all the vertices between the near and far planes and
+  whose projection intersects the rectangle; with visibleOnly, only the faces
+  whose barycenter passes the depth test against a depth buffer rasterized on
+  the CPU, as GLPickTri::PickVisibleFace does with the GL depth buffer;
+- polygonFaces: faces with at least one vertex projected inside the polygon.
+Polygons are filled with the non-zero winding rule.
+
+The nodes of the hierarchy are classified against the frustum of the region
+bounding rectangle: faces of the nodes entirely inside are taken without
+further tests, the others are tested in parallel. Results are sorted by index
+and do not depend on the number of threads.
+*/
+class SelectionEngine
+{
+public:
+	typedef Eigen::Matrix<Scalarm, 4, 4> ProjectionMatrix;
+	enum Op { SET, CLEAR, TOGGLE };
+
+	SelectionEngine();
+
+	void update(const CMeshO& m);
+	void clear();
+
+	void setView(const ProjectionMatrix& projModel, const Scalarm vp[4]);
+
+	std::vector<int> rectVertices(const CMeshO& m, const Point2m& pmin, const Point2m& pmax) const;
+	std::vector<int> rectFaces(const CMeshO& m, const Point2m& pmin, const Point2m& pmax, bool visibleOnly) const;
+	std::vector<int> polygonVertices(const CMeshO& m, const std::vector<Point2m>& poly) const;
+	std::vector<int> polygonFaces(const CMeshO& m, const std::vector<Point2m>& poly) const;
+
+	static void selectVertices(CMeshO& m, const std::vector<int>& verts, Op op);
+	static void selectFaces(CMeshO& m, const std::vector<int>& faces, Op op);
+
+private:
+	// window coordinates and ndc depth of a point
+	struct Projected
+	{
+		Scalarm x, y, z;
+		bool    front; // in front of the camera, between the near and far planes
+	};
+
+	// a clip space half space, as a row applied to object space points
+	typedef Eigen::Matrix<Scalarm, 1, 4> Plane;
+
+	Projected project(const Point3m& p) const;
+	void regionPlanes(const Point2m& pmin, const Point2m& pmax, Plane planes[6]) const;
+	void candidateFaces(
+		const Point2m&    pmin,
+		const Point2m&    pmax,
+		bool              exactRect,
+		std::vector<int>& inside,
+		std::vector<int>& toTest) const;
+	std::vector<int> visibleFaces(const CMeshO& m, const std::vector<int>& faces) const;
+
+	meshlab::FaceBVH bvh;
+
+	// the mesh the hierarchy has been built on
+	const CMeshO* mesh    = nullptr;
+	size_t        vertNum = 0; // size of the containers
+	size_t        faceNum = 0;
+	int           vn      = 0; // non deleted elements
+	int           fn      = 0;
+	Box3m         bbox;
+
+	ProjectionMatrix M;
+	Scalarm          viewport[4];
+};
+
+#endif // EDIT_SELECT_SELECTION_ENGINE_H
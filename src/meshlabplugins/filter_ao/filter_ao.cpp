@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include <common/GLExtensionsManager.h>
+#include <common/utilities/face_bvh.h>
 #include "filter_ao.h"
 #include <QGLFramebufferObject>
 #include <QElapsedTimer>
@@ -31,6 +32,7 @@
 #include <wrap/qt/checkGLError.h>
 
 #include <iostream>
+#include <limits>
 #include <random>
 
 #define AMBOCC_MAX_TEXTURE_SIZE 2048
@@ -92,7 +94,7 @@ QString AmbientOcclusionPlugin::filterInfo(ActionIDType filterId) const
 {
 	switch(filterId) {
 	case FP_AMBIENT_OCCLUSION: 
-		return QString("Compute ambient occlusions values; it takes a number of well distributed view direction and for point of the surface it computes how many time it is visible from these directions. This value is saved into quality and automatically mapped into a gray shade. The average direction is saved into an attribute named 'BentNormal'");
+		return QString("Compute ambient occlusions values; it takes a number of well distributed view direction and for point of the surface it computes how many time it is visible from these directions. This value is saved into quality and automatically mapped into a gray shade. The average direction is saved into an attribute named 'BentNormal'. When an OpenGL context is not available (e.g. on headless machines) the occlusion is computed on the CPU by ray casting.");
 	default : assert(0);
 	}
 	return QString("");
@@ -154,51 +156,51 @@ RichParameterList AmbientOcclusionPlugin::initParameterList(const QAction *actio
 std::map<std::string, QVariant> AmbientOcclusionPlugin::applyFilter(const QAction * filter, const RichParameterList & par, MeshDocument &md, unsigned int& /*postConditionMask*/, vcg::CallBackPos *cb)
 {
 	if (ID(filter) == FP_AMBIENT_OCCLUSION) {
-		if (glContext != nullptr) {
-			MeshModel &m=*(md.mm());
-
-			int occlusionMode = par.getEnum("occMode");
-			if (occlusionMode == 1)
-				perFace = true;
-			else
-				perFace = false;
-
-			useGPU = par.getBool("useGPU");
-			if (perFace) //GPU only works per-vertex
-				useGPU = false;
-			depthTexSize = par.getInt("depthTexSize");
-			depthTexArea = depthTexSize*depthTexSize;
-			numViews = par.getInt("reqViews");
-			errInit = false;
-			Scalarm dirBias = par.getFloat("dirBias");
-			Point3m coneDir = par.getPoint3m("coneDir");
-			Scalarm coneAngle = par.getFloat("coneAngle");
-
-			if(perFace)
-				m.updateDataMask(MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
-			else
-				m.updateDataMask(MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTCOLOR);
-
-			std::vector<Point3m> unifDirVec;
-			GenNormal<Scalarm>::Fibonacci(numViews,unifDirVec);
-
-			std::vector<Point3m> coneDirVec;
-			GenNormal<Scalarm>::UniformCone(numViews, coneDirVec, math::ToRad(coneAngle), coneDir);
-
-			{
-				std::random_device rd;
-				std::shuffle(unifDirVec.begin(),unifDirVec.end(),std::mt19937(rd()));
-				std::shuffle(coneDirVec.begin(),coneDirVec.end(), std::mt19937(rd()));
-			}
+		MeshModel &m=*(md.mm());
+
+		int occlusionMode = par.getEnum("occMode");
+		if (occlusionMode == 1)
+			perFace = true;
+		else
+			perFace = false;
+
+		useGPU = par.getBool("useGPU");
+		if (perFace) //GPU only works per-vertex
+			useGPU = false;
+		depthTexSize = par.getInt("depthTexSize");
+		depthTexArea = depthTexSize*depthTexSize;
+		numViews = par.getInt("reqViews");
+		errInit = false;
+		Scalarm dirBias = par.getFloat("dirBias");
+		Point3m coneDir = par.getPoint3m("coneDir");
+		Scalarm coneAngle = par.getFloat("coneAngle");
+
+		if(perFace)
+			m.updateDataMask(MeshModel::MM_FACEQUALITY | MeshModel::MM_FACECOLOR);
+		else
+			m.updateDataMask(MeshModel::MM_VERTQUALITY | MeshModel::MM_VERTCOLOR);
+
+		std::vector<Point3m> unifDirVec;
+		GenNormal<Scalarm>::Fibonacci(numViews,unifDirVec);
+
+		std::vector<Point3m> coneDirVec;
+		GenNormal<Scalarm>::UniformCone(numViews, coneDirVec, math::ToRad(coneAngle), coneDir);
+
+		{
+			std::random_device rd;
+			std::shuffle(unifDirVec.begin(),unifDirVec.end(),std::mt19937(rd()));
+			std::shuffle(coneDirVec.begin(),coneDirVec.end(), std::mt19937(rd()));
+		}
 
-			int unifNum = floor(unifDirVec.size() * (1.0 - dirBias ));
-			int coneNum = floor(coneDirVec.size() * (dirBias ));
+		int unifNum = floor(unifDirVec.size() * (1.0 - dirBias ));
+		int coneNum = floor(coneDirVec.size() * (dirBias ));
 
-			viewDirVec.clear();
-			viewDirVec.insert(viewDirVec.end(),unifDirVec.begin(),unifDirVec.begin()+unifNum);
-			viewDirVec.insert(viewDirVec.end(),coneDirVec.begin(),coneDirVec.begin()+coneNum);
-			numViews = viewDirVec.size();
+		viewDirVec.clear();
+		viewDirVec.insert(viewDirVec.end(),unifDirVec.begin(),unifDirVec.begin()+unifNum);
+		viewDirVec.insert(viewDirVec.end(),coneDirVec.begin(),coneDirVec.begin()+coneNum);
+		numViews = viewDirVec.size();
 
+		if (glContext != nullptr && glContext->isValid()) {
 			this->glContext->makeCurrent();
 			this->initGL(cb,m.cm.vn);
 			unsigned int widgetSize = std::min(maxTexSize, depthTexSize);
@@ -221,9 +223,9 @@ std::map<std::string, QVariant> AmbientOcclusionPlugin::applyFilter(const QActio
 			}
 		}
 		else {
-			throw MLException("Fatal error: glContext not initialized");
-			//errorMessage = "Fatal error: glContext not initialized";
-			//return false;
+			// no OpenGL context available (e.g. headless machines): ray trace on the CPU
+			log("OpenGL context not available, ambient occlusion computed on the CPU");
+			processCPU(m, viewDirVec, cb);
 		}
 	}
 	else {
@@ -418,6 +420,87 @@ bool AmbientOcclusionPlugin::processGL(MeshModel &m, vector<Point3f> &posVect)
     return true;
 }
 
+/**
+ * @brief CPU version of processGL: instead of rendering a depth map for each
+ * view direction, a ray is cast from each vertex (or face barycenter) towards
+ * each direction against a BVH of the mesh. The accumulated values are the
+ * same of the OpenGL path: sum of max(N*dir, 0) over the directions from
+ * which the point is not occluded, and the average of these directions as
+ * bent normal.
+ */
+void AmbientOcclusionPlugin::processCPU(MeshModel &m, const vector<Point3f> &posVect, vcg::CallBackPos *cb)
+{
+	QElapsedTimer tAll;
+	tAll.start();
+
+	tri::Allocator<CMeshO>::CompactVertexVector(m.cm);
+	tri::Allocator<CMeshO>::CompactFaceVector(m.cm);
+	tri::UpdateNormal<CMeshO>::PerVertexNormalizedPerFaceNormalized(m.cm);
+
+	CMeshO::PerVertexAttributeHandle<Point3m> BN;
+	CMeshO::PerFaceAttributeHandle<Point3m> FBN;
+	if (perFace)
+		FBN = tri::Allocator<CMeshO>::GetPerFaceAttribute<Point3m>(m.cm, "BentNormal");
+	else
+		BN = tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3m>(m.cm, "BentNormal");
+
+	meshlab::FaceBVH bvh(m.cm);
+	int tInitElapsed = tAll.elapsed();
+
+	// rays start slightly away from the surface, to skip the faces incident on the origin
+	const Scalarm eps = m.cm.bbox.Diag() * 1e-4;
+	const Scalarm maxDist = std::numeric_limits<Scalarm>::max();
+	const int n = perFace ? m.cm.fn : m.cm.vn;
+
+	std::vector<Point3m> dirs(posVect.size());
+	for (size_t j = 0; j < posVect.size(); ++j)
+		dirs[j] = Point3m::Construct(posVect[j]).Normalize();
+
+	// the parallel loop is split in blocks to report the progress from the main thread
+	const int blockSize = std::max(n / 100, 1024);
+	for (int begin = 0; begin < n; begin += blockSize) {
+		const int end = std::min(begin + blockSize, n);
+		if (cb)
+			cb(int(100.0 * begin / n), "Computing ambient occlusion");
+
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = begin; i < end; ++i) {
+			Point3m p, nrm;
+			if (perFace) {
+				p = Barycenter(m.cm.face[i]);
+				nrm = m.cm.face[i].cN();
+			}
+			else {
+				p = m.cm.vert[i].cP();
+				nrm = m.cm.vert[i].cN();
+			}
+			Scalarm q = 0;
+			Point3m bn(0, 0, 0);
+			for (const Point3m& d : dirs) {
+				if (!bvh.isOccluded(p, d, eps, maxDist)) {
+					q += std::max<Scalarm>(nrm.dot(d), 0);
+					bn += d;
+				}
+			}
+			if (perFace) {
+				m.cm.face[i].Q() = q / numViews;
+				FBN[i] = bn.Normalize();
+			}
+			else {
+				m.cm.vert[i].Q() = q / numViews;
+				BN[i] = bn.Normalize();
+			}
+		}
+	}
+
+	if (perFace)
+		tri::UpdateColor<CMeshO>::PerFaceQualityGray(m.cm);
+	else
+		tri::UpdateColor<CMeshO>::PerVertexQualityGray(m.cm, 0.0f, 0.0f);
+
+	log(GLLogStream::SYSTEM,"Successfully calculated A.O. after %3.2f sec, %3.2f of which is due to BVH construction", ((float)tAll.elapsed()/1000.0f), ((float)tInitElapsed/1000.0f) );
+}
+
 void AmbientOcclusionPlugin::initGL(vcg::CallBackPos *cb, unsigned int numVertices)
 {
     //******* INIT GLEW ********/
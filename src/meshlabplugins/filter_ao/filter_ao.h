@@ -79,6 +79,7 @@ public:
 	void initTextures(void);
 	void initGL(vcg::CallBackPos* cb, unsigned int numVertices);
 	bool processGL(MeshModel& m, std::vector<vcg::Point3f>& posVect);
+	void processCPU(MeshModel& m, const std::vector<vcg::Point3f>& posVect, vcg::CallBackPos* cb);
 	bool checkFramebuffer();
 
 	void vertexCoordsToTexture(MeshModel& m);
@@ -22,6 +22,7 @@
  ****************************************************************************/
 
 #include "cleanfilter.h"
+#include "partitioned_ball_pivoting.h"
 
 #include <QCoreApplication>
 #include <vcg/complex/algorithms/clean.h>
@@ -130,7 +131,9 @@ QString CleanFilter::filterInfo(ActionIDType filterId) const
 			"disk subsampling of the point cloud. <br>"
 			"Bernardini F., Mittleman J., Rushmeier H., Silva C., Taubin G.<br>"
 			"<b>The ball-pivoting algorithm for surface reconstruction.</b><br>"
-			"IEEE TVCG 1999");
+			"IEEE TVCG 1999<br>"
+			"In partitioned mode the cloud is split in tiles whose fronts are grown in parallel, "
+			"then stitched along the seams with the same pivoting criterion.");
 	case FP_REMOVE_ISOLATED_COMPLEXITY:
 		return QString(
 			"Delete isolated connected components composed by a limited number of triangles");
@@ -295,6 +298,20 @@ RichParameterList CleanFilter::initParameterList(const QAction* action, const Me
 			"if true all the initial faces of the mesh are deleted and the whole surface is "
 			"rebuilt from scratch. Otherwise the current faces are used as a starting point. "
 			"Useful if you run the algorithm multiple times with an increasing ball radius."));
+		parlst.addParam(RichInt(
+			"RadiusSteps",
+			1,
+			"Radius steps",
+			"Number of passes of the ball; the i-th pass uses i times the ball radius, starting "
+			"from the faces built by the previous ones."));
+		parlst.addParam(RichBool(
+			"Partitioned",
+			true,
+			"Partitioned (parallel)",
+			"if true the point cloud is split in spatial tiles whose fronts are grown in "
+			"parallel, and then stitched along the seams with the same pivoting criterion; all "
+			"the passes share the same spatial index of the points. Otherwise the classic serial "
+			"advancing front is used."));
 		break;
 	case FP_REMOVE_ISOLATED_DIAMETER:
 		parlst.addParam(RichAbsPerc(
@@ -430,12 +447,38 @@ std::map<std::string, QVariant> CleanFilter::applyFilter(
 			m.cm.fn = 0;
 			m.cm.face.resize(0);
 		}
-		m.updateDataMask(MeshModel::MM_VERTFACETOPO);
-		int                       startingFn = m.cm.fn;
-		tri::BallPivoting<CMeshO> pivot(m.cm, Radius, Clustering, CreaseThr);
-		// the main processing
-		pivot.BuildMesh(cb);
-		m.clearDataMask(MeshModel::MM_FACEFACETOPO);
+		int  steps       = std::max(1, par.getInt("RadiusSteps"));
+		bool partitioned = par.getBool("Partitioned");
+		if (Radius == 0) // the same guess of tri::BallPivoting
+			Radius = std::sqrt(m.cm.bbox.SquaredDiag() / m.cm.vn);
+		int startingFn = m.cm.fn;
+		if (partitioned && m.cm.vn > 0) {
+			PartitionedBallPivoting pivot(m.cm, Radius * steps);
+			std::vector<Point3i>    faces;
+			for (const CFaceO& f : m.cm.face)
+				faces.push_back(Point3i(
+					tri::Index(m.cm, f.cV(0)), tri::Index(m.cm, f.cV(1)), tri::Index(m.cm, f.cV(2))));
+			PartitionedBallPivoting::Stats stats;
+			for (int i = 1; i <= steps; ++i) {
+				pivot.pivot(faces, Radius * i, Clustering, CreaseThr, cb, &stats);
+				log("Pass %i: %i tiles, %i edges deferred to the seams, %i seam faces",
+					i, stats.tileNum, stats.deferredEdgeNum, stats.seamFaceNum);
+			}
+			int newFn = int(faces.size()) - startingFn;
+			auto fi   = tri::Allocator<CMeshO>::AddFaces(m.cm, newFn);
+			for (int i = startingFn; i < int(faces.size()); ++i, ++fi)
+				for (int k = 0; k < 3; ++k)
+					fi->V(k) = &m.cm.vert[faces[i][k]];
+		}
+		else {
+			m.updateDataMask(MeshModel::MM_VERTFACETOPO);
+			for (int i = 1; i <= steps; ++i) {
+				tri::BallPivoting<CMeshO> pivot(m.cm, Radius * i, Clustering, CreaseThr);
+				// the main processing
+				pivot.BuildMesh(cb);
+			}
+			m.clearDataMask(MeshModel::MM_FACEFACETOPO);
+		}
 		log("Reconstructed surface. Added %i faces", m.cm.fn - startingFn);
 	} break;
 
@@ -0,0 +1,721 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "partitioned_ball_pivoting.h"
+
+#include <algorithm>
+#include <cmath>
+#include <deque>
+#include <limits>
+#include <utility>
+
+using namespace vcg;
+
+namespace {
+
+const int CELLS = PartitionedBallPivoting::TILE_CELLS;
+// tiles processed between two calls of the progress callback
+const int TILE_BATCH = 64;
+// bits of each coordinate in the key of a tile
+const int KEY_BITS = 21;
+
+enum PointState : unsigned char {
+	FREE,      // not used by any face
+	USED,      // vertex of a face
+	CLUSTERED, // too near to a vertex, never used
+	FROZEN     // vertex of a face present before the pass: left to the seam phase
+};
+
+const double TWO_PI = 6.283185307179586;
+
+/*
+ * Center of the ball of the given radius that touches a, b and c, on the side
+ * of the normal of the triangle (a, b, c). False if the ball is too small.
+ */
+bool ballCenter(const Point3d& a, const Point3d& b, const Point3d& c, double radius, Point3d& center)
+{
+	const Point3d ab = b - a;
+	const Point3d ac = c - a;
+	const Point3d n  = ab ^ ac;
+	const double  n2 = n.SquaredNorm();
+	if (n2 <= 0)
+		return false;
+	// circumcenter of the triangle
+	const Point3d off = ((n ^ ab) * ac.SquaredNorm() + (ac ^ n) * ab.SquaredNorm()) / (2 * n2);
+	const double  h2  = radius * radius - off.SquaredNorm();
+	if (h2 < 0)
+		return false;
+	center = a + off + n * (std::sqrt(h2) / std::sqrt(n2));
+	return true;
+}
+
+} // namespace
+
+long long PartitionedBallPivoting::tileKey(long long x, long long y, long long z)
+{
+	return (x << (2 * KEY_BITS)) | (y << KEY_BITS) | z;
+}
+
+// calls visit for the points of the 27 cells around p, a superset of the
+// points within cellSize from p
+template <class Visitor>
+void PartitionedBallPivoting::forEachNeighbour(const Point3d& p, Visitor visit) const
+{
+	long long g[3];
+	for (int i = 0; i < 3; ++i)
+		g[i] = (long long) std::floor((p[i] - origin[i]) / cellSize);
+	long long lastKey  = -1;
+	int       lastTile = -1;
+	for (long long x = g[0] - 1; x <= g[0] + 1; ++x)
+		for (long long y = g[1] - 1; y <= g[1] + 1; ++y)
+			for (long long z = g[2] - 1; z <= g[2] + 1; ++z) {
+				if (x < 0 || y < 0 || z < 0)
+					continue;
+				const long long key = tileKey(x / CELLS, y / CELLS, z / CELLS);
+				if (key != lastKey) {
+					auto it  = tileIndex.find(key);
+					lastKey  = key;
+					lastTile = it == tileIndex.end() ? -1 : it->second;
+				}
+				if (lastTile < 0)
+					continue;
+				const int  cell  = int(((x % CELLS) * CELLS + y % CELLS) * CELLS + z % CELLS);
+				const int* first = cellIndex.data() + tileCellBegin[lastTile];
+				const int* last  = cellIndex.data() + tileCellBegin[lastTile + 1];
+				const int* c     = std::lower_bound(first, last, cell);
+				if (c == last || *c != cell)
+					continue;
+				const size_t k = c - cellIndex.data();
+				for (int j = cellBegin[k]; j < cellBegin[k + 1]; ++j)
+					visit(order[j]);
+			}
+}
+
+/*
+ * The advancing fronts of a tile (tile >= 0), or of the whole cloud (tile ==
+ * -1). The fronts are closed loops of directed edges, each one oriented as the
+ * face it belongs to; an edge keeps the center of the ball that touches its
+ * face, from which the ball pivots. The faces and the edges are stored here,
+ * the head of the list of the faces and of the front edges of each vertex in
+ * the vectors of PartitionedBallPivoting, that a tile only writes for its
+ * points.
+ */
+class PartitionedBallPivoting::Front
+{
+public:
+	enum EdgeStatus : unsigned char { ACTIVE, BOUNDARY, DEFERRED, DEAD };
+
+	struct Edge
+	{
+		int           v0, v1, opp; // the face is (v0, v1, opp)
+		int           prev, next;  // along the front loop
+		int           nextOut;     // next front edge starting from v0
+		Point3d       center;
+		unsigned char status;
+	};
+
+	std::vector<Edge> edges;
+	std::vector<int>  faceVert;   // 3 vertices per face
+	std::vector<int>  nextCorner; // next face corner around the same vertex
+	std::deque<int>   queue;      // active edges
+	int               clusteredNum = 0;
+
+	Front(PartitionedBallPivoting& bp, int tile, double radius, double minEdge, double cosCrease) :
+			bp(bp), tile(tile), radius(radius), minEdge(minEdge), cosCrease(cosCrease)
+	{
+	}
+
+	int faceNum() const { return int(faceVert.size() / 3); }
+
+	// a seed triangle made of v and of two free points near it, whose ball
+	// does not contain other points
+	bool seed(int v)
+	{
+		if (!owned(v) || bp.state[v] != FREE)
+			return false;
+		const Point3d pv = P(v);
+		std::vector<std::pair<double, int>> near;
+		bp.forEachNeighbour(pv, [&](int q) {
+			if (q == v || (owned(q) && bp.state[q] == CLUSTERED))
+				return;
+			const double d = SquaredDistance(P(q), pv);
+			if (d <= 4 * radius * radius)
+				near.push_back(std::make_pair(d, q));
+		});
+		std::sort(near.begin(), near.end());
+
+		for (size_t i = 0; i < near.size(); ++i) {
+			const int p = near[i].second;
+			if (!isFree(p))
+				continue;
+			for (size_t j = i + 1; j < near.size(); ++j) {
+				int a = p, b = near[j].second;
+				if (!isFree(b))
+					continue;
+				Point3d n = (P(a) - pv) ^ (P(b) - pv);
+				if (n * (N(v) + N(a) + N(b)) < 0) {
+					std::swap(a, b);
+					n = -n;
+				}
+				if (n * N(v) < 0 || n * N(a) < 0 || n * N(b) < 0)
+					continue;
+				Point3d c;
+				if (!ballCenter(pv, P(a), P(b), radius, c))
+					continue;
+				bool empty = true;
+				for (size_t k = 0; k < near.size() && empty; ++k) {
+					const int q = near[k].second;
+					if (q != a && q != b && SquaredDistance(P(q), c) < radius * radius * (1 - 1e-7))
+						empty = false;
+				}
+				if (!empty)
+					continue;
+
+				addFace(v, a, b);
+				const int e0 = addEdge(v, a, b, c);
+				const int e1 = addEdge(a, b, v, c);
+				const int e2 = addEdge(b, v, a, c);
+				link(e0, e1);
+				link(e1, e2);
+				link(e2, e0);
+				for (int u : {v, a, b}) {
+					bp.state[u] = USED;
+					cluster(u);
+				}
+				return true;
+			}
+		}
+		return false;
+	}
+
+	// pivots the active edges until the front stops
+	void expand()
+	{
+		while (!queue.empty()) {
+			const int e = queue.front();
+			queue.pop_front();
+			if (edges[e].status == ACTIVE)
+				pivotEdge(e);
+		}
+	}
+
+	int addFace(int a, int b, int c)
+	{
+		const int f = faceNum();
+		for (int v : {a, b, c}) {
+			faceVert.push_back(v);
+			nextCorner.push_back(bp.vertCorner[v]);
+			bp.vertCorner[v] = int(faceVert.size()) - 1;
+		}
+		return f;
+	}
+
+	int addEdge(int v0, int v1, int opp, const Point3d& center, unsigned char status = ACTIVE)
+	{
+		Edge e;
+		e.v0       = v0;
+		e.v1       = v1;
+		e.opp      = opp;
+		e.prev     = -1;
+		e.next     = -1;
+		e.nextOut  = bp.vertEdge[v0];
+		e.center   = center;
+		e.status   = status;
+		const int i = int(edges.size());
+		edges.push_back(e);
+		bp.vertEdge[v0] = i;
+		if (status == ACTIVE)
+			queue.push_back(i);
+		return i;
+	}
+
+	void link(int p, int n)
+	{
+		if (p >= 0)
+			edges[p].next = n;
+		if (n >= 0)
+			edges[n].prev = p;
+	}
+
+	// the front edge from u to w
+	int findEdge(int u, int w) const
+	{
+		for (int e = bp.vertEdge[u]; e >= 0; e = edges[e].nextOut)
+			if (edges[e].v1 == w)
+				return e;
+		return -1;
+	}
+
+	// number of faces with the edge (u, w), in any direction
+	int edgeFaceNum(int u, int w) const
+	{
+		int cnt = 0;
+		for (int c = bp.vertCorner[u]; c >= 0; c = nextCorner[c]) {
+			const int f = c / 3;
+			if (faceVert[3 * f] == w || faceVert[3 * f + 1] == w || faceVert[3 * f + 2] == w)
+				++cnt;
+		}
+		return cnt;
+	}
+
+	// true if some face has the directed edge (u, w)
+	bool hasFaceEdge(int u, int w) const
+	{
+		for (int c = bp.vertCorner[u]; c >= 0; c = nextCorner[c]) {
+			const int f = c / 3;
+			if (faceVert[3 * f + (c % 3 + 1) % 3] == w)
+				return true;
+		}
+		return false;
+	}
+
+private:
+	Point3d P(int v) const { return Point3d::Construct(bp.pos[v]); }
+	Point3d N(int v) const { return Point3d::Construct(bp.nrm[v]); }
+
+	// the state of the points of the other tiles is never read
+	bool owned(int v) const { return tile < 0 || bp.tileOf[v] == tile; }
+	bool isFree(int v) const { return owned(v) && bp.state[v] == FREE; }
+
+	void removeEdge(int e)
+	{
+		edges[e].status = DEAD;
+		const int v = edges[e].v0;
+		if (bp.vertEdge[v] == e) {
+			bp.vertEdge[v] = edges[e].nextOut;
+			return;
+		}
+		for (int x = bp.vertEdge[v]; x >= 0; x = edges[x].nextOut)
+			if (edges[x].nextOut == e) {
+				edges[x].nextOut = edges[e].nextOut;
+				return;
+			}
+	}
+
+	// the free points too near to a new vertex are merged with it
+	void cluster(int v)
+	{
+		const Point3d pv = P(v);
+		bp.forEachNeighbour(pv, [&](int q) {
+			if (q != v && isFree(q) && SquaredDistance(P(q), pv) < minEdge * minEdge) {
+				bp.state[q] = CLUSTERED;
+				++clusteredNum;
+			}
+		});
+	}
+
+	/*
+	 * Rotates the ball of the edge around it, away from its face, and returns
+	 * the first point hit (or -1), with the center of the ball when it hits
+	 * it. foreign is set if that point can not be used by this front.
+	 */
+	int rollBall(const Edge& e, Point3d& center, bool& foreign) const
+	{
+		foreign = false;
+		const Point3d a  = P(e.v0);
+		const Point3d b  = P(e.v1);
+		const Point3d m  = (a + b) / 2;
+		const Point3d ax = (b - a).Normalize();
+		Point3d x = e.center - m;
+		x -= ax * (x * ax);
+		const double rc = x.Norm();
+		if (rc <= 0)
+			return -1;
+		x /= rc;
+		Point3d y = ax ^ x;
+		if (y * (P(e.opp) - m) > 0)
+			y = -y;
+
+		int    best      = -1;
+		double bestAngle = std::numeric_limits<double>::max();
+		bp.forEachNeighbour(m, [&](int q) {
+			if (q == e.v0 || q == e.v1 || q == e.opp || (owned(q) && bp.state[q] == CLUSTERED))
+				return;
+			const Point3d pq = P(q);
+			if (SquaredDistance(pq, m) > 4 * radius * radius)
+				return;
+			Point3d c;
+			if (!ballCenter(a, b, pq, radius, c))
+				return;
+			// the two balls through a, b and q are where the rotating ball
+			// enters and leaves q: the first one is the hit
+			const Point3d c2 = a + (ballCenterOff(a, b, pq) * 2 - (c - a));
+			double angle = std::numeric_limits<double>::max();
+			Point3d hit;
+			for (const Point3d& cc : {c, c2}) {
+				double t = std::atan2((cc - m) * y, (cc - m) * x);
+				if (t < 0)
+					t += TWO_PI;
+				if (t < angle) {
+					angle = t;
+					hit   = cc;
+				}
+			}
+			if (angle < bestAngle || (angle == bestAngle && q < best)) {
+				bestAngle = angle;
+				best      = q;
+				center    = hit;
+			}
+		});
+		if (best >= 0 && (!owned(best) || bp.state[best] == FROZEN))
+			foreign = true;
+		return best;
+	}
+
+	// offset of the circumcenter of (a, b, c) from a
+	static Point3d ballCenterOff(const Point3d& a, const Point3d& b, const Point3d& c)
+	{
+		const Point3d ab = b - a;
+		const Point3d ac = c - a;
+		const Point3d n  = ab ^ ac;
+		return ((n ^ ab) * ac.SquaredNorm() + (ac ^ n) * ab.SquaredNorm()) / (2 * n.SquaredNorm());
+	}
+
+	void pivotEdge(int ei)
+	{
+		const Edge e = edges[ei];
+		const int  a = e.v0;
+		const int  b = e.v1;
+		if (!owned(a) || !owned(b) || bp.state[a] == FROZEN || bp.state[b] == FROZEN) {
+			edges[ei].status = DEFERRED;
+			return;
+		}
+		Point3d c;
+		bool    foreign;
+		const int k = rollBall(e, c, foreign);
+		if (k < 0 || foreign) {
+			edges[ei].status = foreign ? DEFERRED : BOUNDARY;
+			return;
+		}
+		// an inner vertex can not get other faces
+		if (bp.state[k] == USED && bp.vertEdge[k] < 0) {
+			edges[ei].status = BOUNDARY;
+			return;
+		}
+		// the new face (b, a, k) must have the ball on its outer side, and
+		// must not fold too much on the face of the edge
+		const Point3d pa = P(a), pb = P(b), pk = P(k);
+		Point3d nNew = (pa - pb) ^ (pk - pb);
+		Point3d nOld = (pb - pa) ^ (P(e.opp) - pa);
+		if ((c - pb) * nNew <= 0 || nNew.Norm() == 0 || nOld.Norm() == 0) {
+			edges[ei].status = BOUNDARY;
+			return;
+		}
+		if (nNew.Normalize() * nOld.Normalize() < cosCrease) {
+			edges[ei].status = BOUNDARY;
+			return;
+		}
+		// the new edges (a, k) and (k, b) can only close on front edges with
+		// the opposite direction, that are glued with them
+		int ea = -1, eb = -1;
+		if (bp.state[k] == USED) {
+			ea = findEdge(k, a);
+			eb = findEdge(b, k);
+			const int na = edgeFaceNum(a, k);
+			const int nb = edgeFaceNum(k, b);
+			if ((ea < 0 && na > 0) || (ea >= 0 && na != 1) || (eb < 0 && nb > 0) || (eb >= 0 && nb != 1)) {
+				edges[ei].status = BOUNDARY;
+				return;
+			}
+		}
+
+		const bool wasFree = bp.state[k] == FREE;
+		addFace(b, a, k);
+		const int e1 = addEdge(a, k, b, c);
+		const int e2 = addEdge(k, b, a, c);
+		const int p  = e.prev;
+		const int n  = e.next;
+		removeEdge(ei);
+		link(p, e1);
+		link(e1, e2);
+		link(e2, n);
+		bp.state[k] = USED;
+		if (wasFree)
+			cluster(k);
+		if (ea >= 0)
+			glue(e1, ea);
+		if (eb >= 0)
+			glue(e2, eb);
+	}
+
+	// removes two coincident front edges with opposite directions, joining
+	// (or splitting) their loops
+	void glue(int x, int y)
+	{
+		const int px = edges[x].prev, nx = edges[x].next;
+		const int py = edges[y].prev, ny = edges[y].next;
+		if (nx == y && ny == x) {
+			// a loop of two edges vanishes
+		}
+		else if (nx == y)
+			link(px, ny);
+		else if (ny == x)
+			link(py, nx);
+		else {
+			link(px, ny);
+			link(py, nx);
+		}
+		removeEdge(x);
+		removeEdge(y);
+	}
+
+	PartitionedBallPivoting& bp;
+	const int                tile;
+	const double             radius;
+	const double             minEdge;
+	const double             cosCrease;
+};
+
+PartitionedBallPivoting::PartitionedBallPivoting(const CMeshO& m, Scalarm maxRadius)
+{
+	const int vn = int(m.vert.size());
+	pos.resize(vn);
+	nrm.resize(vn);
+	Box3d box;
+	for (int i = 0; i < vn; ++i) {
+		pos[i] = m.vert[i].cP();
+		nrm[i] = m.vert[i].cN();
+		box.Add(Point3d::Construct(pos[i]));
+	}
+	origin   = box.min;
+	cellSize = 2 * maxRadius;
+	const double tileSize = double(cellSize) * CELLS;
+
+	// tiles are numbered in order of their first point
+	tileOf.resize(vn);
+	std::vector<long long> key(vn);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		const Point3d d = Point3d::Construct(pos[i]) - origin;
+		key[i] = tileKey((long long) (d[0] / tileSize), (long long) (d[1] / tileSize), (long long) (d[2] / tileSize));
+	}
+	std::vector<int> count;
+	long long lastKey  = -1;
+	int       lastTile = -1;
+	for (int i = 0; i < vn; ++i) {
+		if (key[i] != lastKey) {
+			auto it = tileIndex.find(key[i]);
+			if (it == tileIndex.end()) {
+				it = tileIndex.insert(std::make_pair(key[i], int(count.size()))).first;
+				count.push_back(0);
+			}
+			lastKey  = key[i];
+			lastTile = it->second;
+		}
+		tileOf[i] = lastTile;
+		++count[lastTile];
+	}
+	const int tileNum = int(count.size());
+	tileBegin.assign(tileNum + 1, 0);
+	for (int t = 0; t < tileNum; ++t)
+		tileBegin[t + 1] = tileBegin[t] + count[t];
+	order.resize(vn);
+	std::vector<int> fill(tileBegin.begin(), tileBegin.end() - 1);
+	for (int i = 0; i < vn; ++i)
+		order[fill[tileOf[i]]++] = i;
+
+	// the points of each tile sorted by cell and index; only the non empty
+	// cells of a tile are stored, so the index stays linear in the points
+	std::vector<int> cellOf(vn); // cell of each position of order
+	std::vector<int> cellCount(tileNum + 1, 0);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int t = 0; t < tileNum; ++t) {
+		const int n = tileBegin[t + 1] - tileBegin[t];
+		std::vector<std::pair<int, int>> pts(n); // (cell, point)
+		for (int j = 0; j < n; ++j) {
+			const int     p = order[tileBegin[t] + j];
+			const Point3d d = Point3d::Construct(pos[p]) - origin;
+			int l[3];
+			for (int i = 0; i < 3; ++i)
+				l[i] = int((long long) (d[i] / cellSize) % CELLS);
+			pts[j] = std::make_pair((l[0] * CELLS + l[1]) * CELLS + l[2], p);
+		}
+		std::sort(pts.begin(), pts.end());
+		for (int j = 0; j < n; ++j) {
+			cellOf[tileBegin[t] + j] = pts[j].first;
+			order[tileBegin[t] + j]  = pts[j].second;
+			if (j == 0 || pts[j].first != pts[j - 1].first)
+				++cellCount[t + 1];
+		}
+	}
+	tileCellBegin.assign(tileNum + 1, 0);
+	for (int t = 0; t < tileNum; ++t)
+		tileCellBegin[t + 1] = tileCellBegin[t] + cellCount[t + 1];
+	cellIndex.resize(tileCellBegin[tileNum]);
+	cellBegin.resize(tileCellBegin[tileNum] + 1);
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int t = 0; t < tileNum; ++t) {
+		int k = tileCellBegin[t];
+		for (int j = tileBegin[t]; j < tileBegin[t + 1]; ++j)
+			if (j == tileBegin[t] || cellOf[j] != cellOf[j - 1]) {
+				cellIndex[k] = cellOf[j];
+				cellBegin[k] = j;
+				++k;
+			}
+	}
+	cellBegin.back() = vn;
+
+	state.assign(vn, FREE);
+}
+
+void PartitionedBallPivoting::pivot(
+	std::vector<Point3i>& faces,
+	Scalarm               radius,
+	Scalarm               clustering,
+	Scalarm               creaseAngle,
+	vcg::CallBackPos*     cb,
+	Stats*                stats)
+{
+	const int    vn        = int(pos.size());
+	const int    tileNum   = int(tileBegin.size()) - 1;
+	const double r         = std::min(radius, maxRadius());
+	const double minEdge   = r * clustering;
+	// as vcg::tri::BallPivoting: the normals of two adjacent faces can not
+	// differ by more than pi - creaseAngle
+	const double cosCrease = -std::cos(double(creaseAngle));
+
+	for (int i = 0; i < vn; ++i)
+		if (state[i] != CLUSTERED)
+			state[i] = FREE;
+	for (const Point3i& f : faces)
+		for (int k = 0; k < 3; ++k)
+			state[f[k]] = FROZEN;
+	vertCorner.assign(vn, -1);
+	vertEdge.assign(vn, -1);
+
+	// first phase: the fronts of each tile
+	std::vector<Front> tiles;
+	tiles.reserve(tileNum);
+	for (int t = 0; t < tileNum; ++t)
+		tiles.push_back(Front(*this, t, r, minEdge, cosCrease));
+	for (int begin = 0; begin < tileNum; begin += TILE_BATCH) {
+		if (cb)
+			cb(int((90 * begin) / std::max(1, tileNum)), "Pivoting tiles");
+		const int end = std::min(tileNum, begin + TILE_BATCH);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int t = begin; t < end; ++t) {
+			Front& front = tiles[t];
+			for (int j = tileBegin[t]; j < tileBegin[t + 1]; ++j)
+				if (front.seed(order[j]))
+					front.expand();
+		}
+	}
+
+	// second phase: a single front with all the faces and edges of the tiles
+	if (cb)
+		cb(90, "Stitching tiles");
+	Front all(*this, -1, r, minEdge, cosCrease);
+	std::vector<int> faceOffset(tileNum + 1, 0);
+	std::vector<int> edgeOffset(tileNum + 1, 0);
+	for (int t = 0; t < tileNum; ++t) {
+		faceOffset[t + 1] = faceOffset[t] + tiles[t].faceNum();
+		edgeOffset[t + 1] = edgeOffset[t] + int(tiles[t].edges.size());
+	}
+	all.faceVert.resize(3 * size_t(faceOffset[tileNum]));
+	all.nextCorner.resize(3 * size_t(faceOffset[tileNum]));
+	all.edges.resize(edgeOffset[tileNum]);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int t = 0; t < tileNum; ++t) {
+		const Front& front = tiles[t];
+		const int    fo    = 3 * faceOffset[t];
+		const int    eo    = edgeOffset[t];
+		for (size_t i = 0; i < front.faceVert.size(); ++i) {
+			all.faceVert[fo + i]   = front.faceVert[i];
+			all.nextCorner[fo + i] = front.nextCorner[i] < 0 ? -1 : front.nextCorner[i] + fo;
+		}
+		for (size_t i = 0; i < front.edges.size(); ++i) {
+			Front::Edge e = front.edges[i];
+			e.prev    = e.prev < 0 ? -1 : e.prev + eo;
+			e.next    = e.next < 0 ? -1 : e.next + eo;
+			e.nextOut = e.nextOut < 0 ? -1 : e.nextOut + eo;
+			all.edges[eo + i] = e;
+		}
+	}
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		const int t = tileOf[i];
+		if (vertCorner[i] >= 0)
+			vertCorner[i] += 3 * faceOffset[t];
+		if (vertEdge[i] >= 0)
+			vertEdge[i] += edgeOffset[t];
+		if (state[i] == FROZEN)
+			state[i] = USED;
+	}
+	int clusteredNum = 0;
+	for (const Front& front : tiles)
+		clusteredNum += front.clusteredNum;
+	tiles.clear();
+	tiles.shrink_to_fit();
+
+	int deferredNum = 0;
+	for (size_t i = 0; i < all.edges.size(); ++i)
+		if (all.edges[i].status == Front::DEFERRED) {
+			all.edges[i].status = Front::ACTIVE;
+			all.queue.push_back(int(i));
+			++deferredNum;
+		}
+
+	// the faces present before the pass, and the front along their border
+	const int newFaceBegin = all.faceNum();
+	for (const Point3i& f : faces)
+		all.addFace(f[0], f[1], f[2]);
+	const int oldBorderBegin = int(all.edges.size());
+	for (int f = newFaceBegin; f < all.faceNum(); ++f)
+		for (int k = 0; k < 3; ++k) {
+			const int u = all.faceVert[3 * f + k];
+			const int w = all.faceVert[3 * f + (k + 1) % 3];
+			const int o = all.faceVert[3 * f + (k + 2) % 3];
+			if (all.hasFaceEdge(w, u) || all.findEdge(u, w) >= 0)
+				continue;
+			Point3d c;
+			if (ballCenter(Point3d::Construct(pos[u]), Point3d::Construct(pos[w]), Point3d::Construct(pos[o]), r, c))
+				all.addEdge(u, w, o, c);
+			else
+				all.addEdge(u, w, o, c, Front::BOUNDARY);
+		}
+	for (int e = oldBorderBegin; e < int(all.edges.size()); ++e)
+		for (int x = vertEdge[all.edges[e].v1]; x >= 0; x = all.edges[x].nextOut)
+			if (x >= oldBorderBegin && all.edges[x].prev < 0) {
+				all.link(e, x);
+				break;
+			}
+
+	const int seamFaceBegin = all.faceNum();
+	all.expand();
+	for (int j = 0; j < vn; ++j)
+		if (all.seed(order[j]))
+			all.expand();
+	clusteredNum += all.clusteredNum;
+
+	for (int f = 0; f < all.faceNum(); ++f)
+		if (f < newFaceBegin || f >= seamFaceBegin)
+			faces.push_back(Point3i(all.faceVert[3 * f], all.faceVert[3 * f + 1], all.faceVert[3 * f + 2]));
+
+	if (stats) {
+		stats->tileNum         = tileNum;
+		stats->deferredEdgeNum = deferredNum;
+		stats->seamFaceNum     = all.faceNum() - seamFaceBegin;
+		stats->clusteredNum    = clusteredNum;
+	}
+}
@@ -0,0 +1,111 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_CLEAN_PARTITIONED_BALL_PIVOTING_H
+#define FILTER_CLEAN_PARTITIONED_BALL_PIVOTING_H
+
+#include <unordered_map>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/*
+Ball pivoting surface reconstruction (as vcg::tri::BallPivoting) with the point
+cloud partitioned in tiles that are reconstructed in parallel.
+
+The points are indexed once in a grid of cells of side 2*maxRadius, grouped in
+tiles of TILE_CELLS^3 cells; the same index is used by all the passes (e.g. with
+growing radii) run on the cloud.
+
+Each pass has two phases:
+ - every tile grows its own advancing fronts from seeds made of its points.
+   The pivoting sees all the points around an edge, also the ones of the
+   neighbouring tiles (the overlap margin), so the first point hit by the ball
+   is the same of a serial run; but a tile only builds triangles made of its
+   own points: when the ball hits a point of another tile, or a vertex of the
+   faces already present before the pass, the edge is deferred;
+ - the fronts of all the tiles are joined, and a single front pivots the
+   deferred edges and the border of the faces present before the pass, with the
+   same criterion: this stitches the tiles along their seams. Then the points
+   left free are tried as seeds.
+
+A tile only writes the data of its own points, so the result does not depend on
+the number of threads.
+*/
+class PartitionedBallPivoting
+{
+public:
+	static const int TILE_CELLS = 16;
+
+	struct Stats
+	{
+		int tileNum         = 0; // non empty tiles
+		int deferredEdgeNum = 0; // front edges left by the tiles to the seam phase
+		int seamFaceNum     = 0; // faces built in the seam phase
+		int clusteredNum    = 0; // points merged with a near vertex
+	};
+
+	PartitionedBallPivoting(const CMeshO& m, Scalarm maxRadius);
+
+	Scalarm maxRadius() const { return cellSize / 2; }
+
+	// one pass with the given radius (not larger than maxRadius()): faces holds
+	// the faces present before the pass, as indices of the vertices of the
+	// mesh, and gets the new ones appended
+	void pivot(
+		std::vector<vcg::Point3i>& faces,
+		Scalarm                    radius,
+		Scalarm                    clustering,
+		Scalarm                    creaseAngle,
+		vcg::CallBackPos*          cb    = nullptr,
+		Stats*                     stats = nullptr);
+
+private:
+	class Front;
+
+	template <class Visitor>
+	void forEachNeighbour(const vcg::Point3d& p, Visitor visit) const;
+
+	static long long tileKey(long long x, long long y, long long z);
+
+	std::vector<Point3m> pos;
+	std::vector<Point3m> nrm;
+	vcg::Point3d         origin;
+	Scalarm              cellSize;
+
+	std::unordered_map<long long, int> tileIndex; // key of a tile -> its index
+	std::vector<int> tileOf;    // point -> its tile
+	std::vector<int> tileBegin; // tile -> range of its points in order
+	std::vector<int> order;     // points sorted by tile, cell and index
+	std::vector<int> tileCellBegin; // tile -> range of its non empty cells
+	std::vector<int> cellIndex;     // non empty cells of each tile, sorted (index in the tile)
+	std::vector<int> cellBegin;     // first position in order of each non empty cell, plus vn
+
+	// per point state, kept between the passes to remember the clustered points
+	std::vector<unsigned char> state;
+	std::vector<int>           vertCorner; // first face corner of each vertex
+	std::vector<int>           vertEdge;   // first front edge starting from each vertex
+};
+
+#endif // FILTER_CLEAN_PARTITIONED_BALL_PIVOTING_H
@@ -0,0 +1,191 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef _DEPTH_RASTERIZER_H
+#define _DEPTH_RASTERIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+#include "floatbuffer.h"
+
+/*
+CPU replacement of the depth rendering done by RenderHelper::renderScene.
+
+The mesh (already in world coordinates) is rendered from the given shot into
+a floatbuffer of the size of the shot viewport. As in RenderHelper, each pixel
+stores the camera depth (Shot::Depth) of the closest surface, in world units,
+and 0 where nothing is rendered; rows are bottom-up, like a glReadPixels
+readback, so the buffer is addressed directly with the coordinates returned
+by Shot::Project.
+
+Depth is interpolated perspective-correctly (linearly in 1/z) and sampled at
+pixel centers. Faces with a vertex closer than camNear are skipped instead of
+being clipped, and depths beyond camFar are discarded.
+
+The image is split in horizontal bands, rasterized in parallel: each band
+owns its pixels, so no synchronization is needed and the result does not
+depend on the number of threads. When called inside a parallel region (e.g.
+one raster per thread) the loops run serially in the calling thread.
+*/
+class DepthRasterizer
+{
+public:
+	static void render(const CMeshO& m, const Shotm& shot, Scalarm camNear, Scalarm camFar, floatbuffer& depth)
+	{
+		const int wt = shot.Intrinsics.ViewportPx[0];
+		const int ht = shot.Intrinsics.ViewportPx[1];
+
+		depth.destroy();
+		depth.init(wt, ht);
+		depth.fillwith(0);
+
+		if (camNear <= 0 || camFar <= camNear) // not provided by caller: no clipping planes
+		{
+			camNear = std::numeric_limits<Scalarm>::min();
+			camFar  = std::numeric_limits<Scalarm>::max();
+		}
+
+		// project all the vertices: screen x, y and camera depth
+		const int vn = (int) m.vert.size();
+		std::vector<Point3m> sp(vn);
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < vn; ++i)
+		{
+			if (m.vert[i].IsD())
+				continue;
+			Point2m pp = shot.Project(m.vert[i].cP());
+			sp[i] = Point3m(pp[0], pp[1], shot.Depth(m.vert[i].cP()));
+		}
+
+		if (m.fn == 0) // point cloud: one pixel per point, as GL_POINTS
+		{
+			for (int i = 0; i < vn; ++i)
+				if (!m.vert[i].IsD())
+					writePixel(depth, int(sp[i][0]), int(sp[i][1]), sp[i][2], camNear, camFar);
+			return;
+		}
+
+		// bin the faces in horizontal bands
+		const int bandHeight = 32;
+		const int bandNum    = (ht + bandHeight - 1) / bandHeight;
+		std::vector<std::vector<int> > bands(bandNum);
+		for (int fi = 0; fi < (int) m.face.size(); ++fi)
+		{
+			const CFaceO& f = m.face[fi];
+			if (f.IsD())
+				continue;
+			const Point3m& a = sp[vcg::tri::Index(m, f.cV(0))];
+			const Point3m& b = sp[vcg::tri::Index(m, f.cV(1))];
+			const Point3m& c = sp[vcg::tri::Index(m, f.cV(2))];
+			if (a[2] < camNear || b[2] < camNear || c[2] < camNear)
+				continue;
+			Scalarm xmin = std::min(a[0], std::min(b[0], c[0]));
+			Scalarm xmax = std::max(a[0], std::max(b[0], c[0]));
+			Scalarm ymin = std::min(a[1], std::min(b[1], c[1]));
+			Scalarm ymax = std::max(a[1], std::max(b[1], c[1]));
+			if (xmax < 0 || ymax < 0 || xmin >= wt || ymin >= ht)
+				continue;
+			int b0 = int(std::max<Scalarm>(ymin, 0)) / bandHeight;
+			int b1 = int(std::min<Scalarm>(ymax, ht - 1)) / bandHeight;
+			for (int bi = b0; bi <= b1; ++bi)
+				bands[bi].push_back(fi);
+		}
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int bi = 0; bi < bandNum; ++bi)
+		{
+			const int y0 = bi * bandHeight;
+			const int y1 = std::min(ht, y0 + bandHeight);
+			for (int fi : bands[bi])
+			{
+				const CFaceO& f = m.face[fi];
+				rasterizeTriangle(
+					depth,
+					sp[vcg::tri::Index(m, f.cV(0))],
+					sp[vcg::tri::Index(m, f.cV(1))],
+					sp[vcg::tri::Index(m, f.cV(2))],
+					y0, y1, camNear, camFar);
+			}
+		}
+	}
+
+private:
+	static void writePixel(floatbuffer& depth, int x, int y, Scalarm z, Scalarm camNear, Scalarm camFar)
+	{
+		if (x < 0 || y < 0 || x >= depth.sx || y >= depth.sy || z < camNear || z > camFar)
+			return;
+		float& d = depth.data[y * depth.sx + x];
+		if (d == 0 || z < d)
+			d = z;
+	}
+
+	// rasterizes the triangle on the rows [y0, y1), sampling at pixel centers
+	static void rasterizeTriangle(
+			floatbuffer& depth,
+			const Point3m& a,
+			const Point3m& b,
+			const Point3m& c,
+			int y0,
+			int y1,
+			Scalarm camNear,
+			Scalarm camFar)
+	{
+		const double area = edge(a, b, c[0], c[1]);
+		if (area == 0)
+			return;
+
+		// clamp before the conversion to int, projections of points close to the camera plane can be huge
+		int xmin = int(std::max<Scalarm>(0, std::floor(std::min(a[0], std::min(b[0], c[0])))));
+		int xmax = int(std::min<Scalarm>(depth.sx - 1, std::ceil(std::max(a[0], std::max(b[0], c[0])))));
+		int ymin = int(std::max<Scalarm>(y0, std::floor(std::min(a[1], std::min(b[1], c[1])))));
+		int ymax = int(std::min<Scalarm>(y1 - 1, std::ceil(std::max(a[1], std::max(b[1], c[1])))));
+
+		const double iza = 1.0 / a[2], izb = 1.0 / b[2], izc = 1.0 / c[2];
+		for (int y = ymin; y <= ymax; ++y)
+		{
+			const double py = y + 0.5;
+			for (int x = xmin; x <= xmax; ++x)
+			{
+				const double px = x + 0.5;
+				double wa = edge(b, c, px, py) / area;
+				double wb = edge(c, a, px, py) / area;
+				double wc = 1.0 - wa - wb;
+				if (wa < 0 || wb < 0 || wc < 0)
+					continue;
+				double z = 1.0 / (wa * iza + wb * izb + wc * izc);
+				writePixel(depth, x, y, z, camNear, camFar);
+			}
+		}
+	}
+
+	static double edge(const Point3m& p, const Point3m& q, double x, double y)
+	{
+		return (double(q[0]) - p[0]) * (y - p[1]) - (double(q[1]) - p[1]) * (x - p[0]);
+	}
+};
+
+#endif
@@ -36,6 +36,7 @@
 #include "render_helper.cpp"
 
 #include "pushpull.h"
+#include "raster_projection.h"
 #include "rastering.h"
 #include <vcg/complex/algorithms/update/texture.h>
 
@@ -130,9 +131,10 @@ int FilterColorProjectionPlugin::getRequirements(const QAction* action)
 bool FilterColorProjectionPlugin::requiresGLContext(const QAction* action) const
 {
 	switch (ID(action)) {
-	case FP_SINGLEIMAGEPROJ:
+	case FP_SINGLEIMAGEPROJ: return true;
+	// depth maps of the multi image projections are computed on the CPU
 	case FP_MULTIIMAGETRIVIALPROJ:
-	case FP_MULTIIMAGETRIVIALPROJTEXTURE: return true;
+	case FP_MULTIIMAGETRIVIALPROJTEXTURE: return false;
 	default: assert(0);
 	}
 	return false;
@@ -289,7 +291,8 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 	unsigned int& /*postConditionMask*/,
 	vcg::CallBackPos* cb)
 {
-	if (glContext != nullptr) {
+	// only the single image projection renders with OpenGL
+	if (glContext != nullptr || ID(filter) != FP_SINGLEIMAGEPROJ) {
 		// CMeshO::FaceIterator fi;
 		CMeshO::VertexIterator vi;
 
@@ -395,292 +398,64 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			////--------------------------- project multi trivial ----------------------------------
 
 		case FP_MULTIIMAGETRIVIALPROJ: {
-			bool    onselection    = par.getBool("onselection");
-			Scalarm eta            = par.getFloat("deptheta");
-			bool    useangle       = par.getBool("useangle");
-			bool    usedistance    = par.getBool("usedistance");
-			bool    useborders     = par.getBool("useborders");
-			bool    usesilhouettes = par.getBool("usesilhouettes");
-			bool    usealphamask   = par.getBool("usealpha");
-			QColor  blank          = par.getColor("blankColor");
-
-			Scalarm    depth  = 0; // depth of point (distance from camera)
-			Scalarm    pdepth = 0; // depth value of projected point (from depth map)
-			double     pweight;    // pixel weight
-			MeshModel* model;
-			bool       do_project;
-			int        cam_ind;
-
-			// min max depth for depth weight normalization
-			float allcammaxdepth;
-			float allcammindepth;
-
-			// max image size for border weight normalization
-			float allcammaximagesize;
-
-			// accumulation buffers for colors and weights
-			int     buff_ind;
-			double* weights;
-			double* acc_red;
-			double* acc_grn;
-			double* acc_blu;
+			bool    onselection = par.getBool("onselection");
+			QColor  blank       = par.getColor("blankColor");
+
+			ProjectionParams ppar;
+			ppar.eta                = par.getFloat("deptheta");
+			ppar.useangle           = par.getBool("useangle");
+			ppar.usedistance        = par.getBool("usedistance");
+			ppar.useborders         = par.getBool("useborders");
+			ppar.usesilhouettes     = par.getBool("usesilhouettes");
+			ppar.usealphamask       = par.getBool("usealpha");
+			ppar.includeImageBorder = true;
 
 			// get current model
-			model = md.mm();
+			MeshModel* model = md.mm();
 
 			// the mesh has to be correctly transformed before mapping
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, model->cm.Tr, true);
 			tri::UpdateBounding<CMeshO>::Box(model->cm);
 
-			// init accumulation buffers for colors and weights
-			log("init color accumulation buffers");
-			weights = new double[model->cm.vn];
-			acc_red = new double[model->cm.vn];
-			acc_grn = new double[model->cm.vn];
-			acc_blu = new double[model->cm.vn];
-			for (int buff_ind = 0; buff_ind < model->cm.vn; buff_ind++) {
-				weights[buff_ind] = 0.0;
-				acc_red[buff_ind] = 0.0;
-				acc_grn[buff_ind] = 0.0;
-				acc_blu[buff_ind] = 0.0;
-			}
-
-			// calculate accuratenear/far for all cameras
-			std::vector<float> my_near;
-			std::vector<float> my_far;
-			calculateNearFarAccurate(md, &my_near, &my_far);
-
-			allcammaxdepth     = -1000000;
-			allcammindepth     = 1000000;
-			allcammaximagesize = -1000000;
-			cam_ind            = 0;
-			for (const RasterModel& rm : md.rasterIterator()) {
-				if (my_far[cam_ind] > allcammaxdepth)
-					allcammaxdepth = my_far[cam_ind];
-				if (my_near[cam_ind] < allcammindepth)
-					allcammindepth = my_near[cam_ind];
-
-				float imgdiag = sqrt(
-					double(rm.shot.Intrinsics.ViewportPx[0] * rm.shot.Intrinsics.ViewportPx[1]));
-				if (imgdiag > allcammaximagesize)
-					allcammaximagesize = imgdiag;
-				cam_ind++;
+			// one projection sample for each vertex to be colored
+			std::vector<ProjectionSample> samples;
+			std::vector<CVertexO*>        sampleVert;
+			for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
+				if (!(*vi).IsD() && (!onselection || (*vi).IsS())) {
+					ProjectionSample s;
+					s.point  = (*vi).P();
+					s.normal = (*vi).N();
+					samples.push_back(s);
+					sampleVert.push_back(&*vi);
+				}
 			}
 
-			//-- cycle all cameras
-			cam_ind = 0;
-			for (const RasterModel& raster : md.rasterIterator()) {
-				if (raster.isVisible()) {
-					do_project = true;
-
-					// no drawing if camera not valid
-					if (!raster.shot.IsValid())
-						do_project = false;
-
-					// no drawing if raster is not active
-					// if(!raster->shot.IsValid())
-					//  do_project = false;
-
-					if (do_project) {
-						// making context current
-						glContext->makeCurrent();
-
-						// delete & reinit rendermanager
-						if (rendermanager != NULL)
-							delete rendermanager;
-						rendermanager = new RenderHelper();
-						if (rendermanager->initializeGL(cb) != 0) {
-							delete rendermanager;
-							throw MLException("Failed on initializing GL rendermanager.");
-						}
-						log("init GL");
-						/*if( rendermanager->initializeMeshBuffers(model, cb) != 0 )
-							return false;
-						Log("init Buffers");*/
-
-						// render normal & depth
-						rendermanager->renderScene(
-							raster.shot,
-							model,
-							RenderHelper::NORMAL,
-							glContext,
-							my_near[cam_ind] * 0.5,
-							my_far[cam_ind] * 1.25);
-
-						// unmaking context current
-						glContext->doneCurrent();
-
-						buff_ind = 0;
-
-						// If should be used silhouette weighting, it is needed to compute depth
-						// discontinuities and per-pixel distance from detected borders on the
-						// entire image here the weight is then applied later, per-vertex, when
-						// needed
-						floatbuffer* silhouette_buff = NULL;
-						float maxsildist = rendermanager->depth->sx + rendermanager->depth->sy;
-						if (usesilhouettes) {
-							silhouette_buff = new floatbuffer();
-							silhouette_buff->init(
-								rendermanager->depth->sx, rendermanager->depth->sy);
-
-							silhouette_buff->applysobel(rendermanager->depth);
-							// sprintf(dumpFileName,"Abord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-
-							silhouette_buff->initborder(rendermanager->depth);
-							// sprintf(dumpFileName,"Bbord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-
-							maxsildist = silhouette_buff->distancefield();
-							// sprintf(dumpFileName,"Cbord%i.pfm",cam_ind);
-							// silhouette_buff->dumppfm(dumpFileName);
-						}
-
-						for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
-							if (!(*vi).IsD() && (!onselection || (*vi).IsS())) {
-								// pp is the projected point in image space
-								Point2m pp = raster.shot.Project((*vi).P());
-								// pray is the vector from the point-to-be-colored to the camera
-								// center
-								Point3m pray = (raster.shot.GetViewPoint() - (*vi).P()).Normalize();
-
-								// if inside image
-								if (pp[0] >= 0 && pp[1] >= 0 &&
-									pp[0] < raster.shot.Intrinsics.ViewportPx[0] &&
-									pp[1] < raster.shot.Intrinsics.ViewportPx[1]) {
-									if ((pray.dot(-raster.shot.Axis(2))) <= 0.0) {
-										depth  = raster.shot.Depth((*vi).P());
-										pdepth = rendermanager->depth->getval(
-											int(pp[0]),
-											int(pp[1])); //  rendermanager->depth[(int(pp[1]) *
-														 //  raster->shot.Intrinsics.ViewportPx[0])
-														 //  + int(pp[0])];
-
-										if (depth <= (pdepth + eta)) {
-											// determine color
-											QRgb pcolor = raster.currentPlane->image.pixel(
-												pp[0],
-												raster.shot.Intrinsics.ViewportPx[1] - pp[1]);
-											// determine weight
-											pweight = 1.0;
-
-											if (useangle) {
-												Point3m pixnorm = (*vi).N();
-												Point3m viewaxis =
-													raster.shot.GetViewPoint() - (*vi).P();
-												pixnorm.Normalize();
-												viewaxis.Normalize();
-
-												float ang = abs(pixnorm * viewaxis);
-												ang       = min(1.0f, ang);
-
-												pweight *= ang;
-											}
-
-											if (usedistance) {
-												float distw = depth;
-												distw = 1.0 - (distw - (allcammindepth * 0.99)) /
-																  ((allcammaxdepth * 1.01) -
-																   (allcammindepth * 0.99));
-
-												pweight *= distw;
-												pweight *= distw;
-											}
-
-											if (useborders) {
-												double xdist =
-													1.0 -
-													(abs(pp[0] -
-														 (raster.shot.Intrinsics.ViewportPx[0] /
-														  2.0)) /
-													 (raster.shot.Intrinsics.ViewportPx[0] / 2.0));
-												double ydist =
-													1.0 -
-													(abs(pp[1] -
-														 (raster.shot.Intrinsics.ViewportPx[1] /
-														  2.0)) /
-													 (raster.shot.Intrinsics.ViewportPx[1] / 2.0));
-												double borderw = min(xdist, ydist);
-												// borderw = min(1.0,borderw); //debug debug
-												// borderw = max(0.0,borderw); //debug debug
-
-												pweight *= borderw;
-											}
-
-											if (usesilhouettes) {
-												// here the silhouette weight is applied, but it is
-												// calculated before, on a per-image basis
-												float silw = 1.0;
-												silw       = silhouette_buff->getval(
-                                                           int(pp[0]), int(pp[1])) /
-													   maxsildist;
-												// silw = min(1.0f,silw); //debug debug
-												// silw = max(0.0f,silw); //debug debug
-
-												pweight *= silw;
-											}
-
-											if (usealphamask) { // alpha channel of image is an
-																// additional mask
-												pweight *= (qAlpha(pcolor) / 255.0);
-											}
-
-											weights[buff_ind] += pweight;
-											acc_red[buff_ind] += (qRed(pcolor) * pweight / 255.0);
-											acc_grn[buff_ind] += (qGreen(pcolor) * pweight / 255.0);
-											acc_blu[buff_ind] += (qBlue(pcolor) * pweight / 255.0);
-										}
-									}
-								}
-							}
-							buff_ind++;
-						}
-						cam_ind++;
-
-						if (usesilhouettes) {
-							delete silhouette_buff;
-						}
-
-					} // end foreach camera
-				}     // end foreach camera
-			}
+			std::vector<ProjectionAccum> accums;
+			RasterProjector::project(md, model->cm, samples, ppar, accums, cb, 0, 100);
 
-			buff_ind = 0;
-			for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
-				if (!(*vi).IsD() && (!onselection || (*vi).IsS())) {
-					if (weights[buff_ind] !=
-						0) // if 0, it has not found any valid projection on any camera
-					{
-						(*vi).C() = vcg::Color4b(
-							(acc_red[buff_ind] / weights[buff_ind]) * 255.0,
-							(acc_grn[buff_ind] / weights[buff_ind]) * 255.0,
-							(acc_blu[buff_ind] / weights[buff_ind]) * 255.0,
-							255);
-					}
-					else {
-						if ((blank.red() != 0) || (blank.green() != 0) || (blank.blue() != 0) ||
-							(blank.alpha() != 0))
-							(*vi).C() = vcg::Color4b(
-								blank.red(), blank.green(), blank.blue(), blank.alpha());
-					}
+			for (size_t si = 0; si < samples.size(); ++si) {
+				CVertexO& v = *sampleVert[si];
+				if (accums[si].weights !=
+					0) // if 0, it has not found any valid projection on any camera
+				{
+					v.C() = vcg::Color4b(
+						(accums[si].acc_red / accums[si].weights) * 255.0,
+						(accums[si].acc_grn / accums[si].weights) * 255.0,
+						(accums[si].acc_blu / accums[si].weights) * 255.0,
+						255);
+				}
+				else {
+					if ((blank.red() != 0) || (blank.green() != 0) || (blank.blue() != 0) ||
+						(blank.alpha() != 0))
+						v.C() = vcg::Color4b(
+							blank.red(), blank.green(), blank.blue(), blank.alpha());
 				}
-				buff_ind++;
 			}
 
 			// the mesh has to return to its original position
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, Inverse(model->cm.Tr), true);
 			tri::UpdateBounding<CMeshO>::Box(model->cm);
 
-			// delete rendermanager
-			if (rendermanager != NULL)
-				delete rendermanager;
-
-			// delete accumulation buffers
-			delete[] weights;
-			delete[] acc_red;
-			delete[] acc_grn;
-			delete[] acc_blu;
-
 		} break;
 
 		case FP_MULTIIMAGETRIVIALPROJTEXTURE: {
@@ -690,35 +465,24 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 			}
 
 			// bool onselection = par.getBool("onselection");
-			int     texsize        = par.getInt("texsize");
-			bool    dorefill       = par.getBool("dorefill");
-			Scalarm eta            = par.getFloat("deptheta");
-			bool    useangle       = par.getBool("useangle");
-			bool    usedistance    = par.getBool("usedistance");
-			bool    useborders     = par.getBool("useborders");
-			bool    usesilhouettes = par.getBool("usesilhouettes");
-			bool    usealphamask   = par.getBool("usealpha");
-			QString textName       = par.getString("textName");
+			int     texsize  = par.getInt("texsize");
+			bool    dorefill = par.getBool("dorefill");
+			QString textName = par.getString("textName");
+
+			ProjectionParams ppar;
+			ppar.eta                = par.getFloat("deptheta");
+			ppar.useangle           = par.getBool("useangle");
+			ppar.usedistance        = par.getBool("usedistance");
+			ppar.useborders         = par.getBool("useborders");
+			ppar.usesilhouettes     = par.getBool("usesilhouettes");
+			ppar.usealphamask       = par.getBool("usealpha");
+			ppar.includeImageBorder = false;
 
 			int textW = texsize;
 			int textH = texsize;
 
-			Scalarm    depth  = 0; // depth of point (distance from camera)
-			Scalarm    pdepth = 0; // depth value of projected point (from depth map)
-			double     pweight;    // pixel weight
-			MeshModel* model;
-			bool       do_project;
-			int        cam_ind;
-
-			// min max depth for depth weight normalization
-			float allcammaxdepth;
-			float allcammindepth;
-
-			// max image size for border weight normalization
-			float allcammaximagesize;
-
 			// get the working model
-			model = md.mm();
+			MeshModel* model = md.mm();
 
 			// the mesh has to be correctly transformed before mapping
 			tri::UpdatePosition<CMeshO>::Matrix(model->cm, model->cm.Tr, true);
@@ -750,27 +514,14 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 				tri::UpdateFlags<CMeshO>::FaceBorderFromFF(model->cm);
 			}
 
-			// create a list of to-be-filled texels and accumulators
+			// create a list of to-be-filled texels
 			// storing texel 2d coords, texel mesh-space point, texel mesh normal
-
+			cb(0, "Rasterizing texture ...");
 			vector<TexelDesc> texels;
-			texels.clear();
-			texels.reserve(textW * textH); // just to avoid the 2x reallocate rule...
-
-			vector<TexelAccum> accums;
-			accums.clear();
-			accums.reserve(textW * textH); // just to avoid the 2x reallocate rule...
-
-			// Rasterizing triangles in the list of voxels
-			TexFillerSampler tfs(img);
-			tfs.texelspointer = &texels;
-			tfs.accumpointer  = &accums;
-			tfs.InitCallback(cb, model->cm.fn, 0, 80);
-			tri::SurfaceSampling<CMeshO, TexFillerSampler>::Texture(
-				model->cm, tfs, textW, textH, true);
+			ParallelTexelSampling(model->cm, img, textW, textH, texels);
 
 			// Revert alpha values for border edge pixels to 255
-			cb(81, "Cleaning up texture ...");
+			cb(20, "Cleaning up texture ...");
 			for (int y = 0; y < textH; ++y) {
 				for (int x = 0; x < textW; ++x) {
 					QRgb px = img.pixel(x, y);
@@ -779,195 +530,14 @@ std::map<std::string, QVariant> FilterColorProjectionPlugin::applyFilter(
 				}
 			}
 
-			// calculate accuratenear/far for all cameras
-			std::vector<float> my_near;
-			std::vector<float> my_far;
-			calculateNearFarAccurate(md, &my_near, &my_far);
-
-			allcammaxdepth     = -1000000;
-			allcammindepth     = 1000000;
-			allcammaximagesize = -1000000;
-			cam_ind            = 0;
-			for (const RasterModel& rm : md.rasterIterator()) {
-				if (my_far[cam_ind] > allcammaxdepth)
-					allcammaxdepth = my_far[cam_ind];
-				if (my_near[cam_ind] < allcammindepth)
-					allcammindepth = my_near[cam_ind];
-
-				float imgdiag = sqrt(
-					double(rm.shot.Intrinsics.ViewportPx[0] * rm.shot.Intrinsics.ViewportPx[1]));
-				if (imgdiag > allcammaximagesize)
-					allcammaximagesize = imgdiag;
-				cam_ind++;
+			std::vector<ProjectionSample> samples(texels.size());
+			for (size_t texcount = 0; texcount < texels.size(); texcount++) {
+				samples[texcount].point  = texels[texcount].meshpoint;
+				samples[texcount].normal = texels[texcount].meshnormal;
 			}
 
-			//-- cycle all cameras
-			cam_ind = 0;
-			for (const RasterModel& raster : md.rasterIterator()) {
-				if (raster.isVisible()) {
-					do_project = true;
-
-					// no drawing if camera not valid
-					if (!raster.shot.IsValid())
-						do_project = false;
-
-					// no drawing if raster is not active
-					// if(!raster->shot.IsValid())
-					//  do_project = false;
-
-					if (do_project) {
-						// making context current
-						glContext->makeCurrent();
-
-						// delete & reinit rendermanager
-						if (rendermanager != NULL)
-							delete rendermanager;
-						rendermanager = new RenderHelper();
-						if (rendermanager->initializeGL(cb) != 0) {
-							delete rendermanager;
-							throw MLException("Failed on initializing GL rendermanager.");
-						}
-						log("init GL");
-						/*if( rendermanager->initializeMeshBuffers(model, cb) != 0 )
-							return false;
-						Log("init Buffers");*/
-
-						// render normal & depth
-						rendermanager->renderScene(
-							raster.shot,
-							model,
-							RenderHelper::NORMAL,
-							glContext,
-							my_near[cam_ind] * 0.5,
-							my_far[cam_ind] * 1.25);
-
-						// unmaking context current
-						glContext->doneCurrent();
-
-						// If should be used silhouette weighting, it is needed to compute depth
-						// discontinuities and per-pixel distance from detected borders on the
-						// entire image here the weight is then applied later, per-vertex, when
-						// needed
-						floatbuffer* silhouette_buff = NULL;
-						float maxsildist = rendermanager->depth->sx + rendermanager->depth->sy;
-						if (usesilhouettes) {
-							silhouette_buff = new floatbuffer();
-							silhouette_buff->init(
-								rendermanager->depth->sx, rendermanager->depth->sy);
-
-							silhouette_buff->applysobel(rendermanager->depth);
-							// sprintf(dumpFileName,"Abord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-
-							silhouette_buff->initborder(rendermanager->depth);
-							// sprintf(dumpFileName,"Bbord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-
-							maxsildist = silhouette_buff->distancefield();
-							// sprintf(dumpFileName,"Cbord%i.bmp",cam_ind);
-							// silhouette_buff->dumpbmp(dumpFileName);
-						}
-
-						for (size_t texcount = 0; texcount < texels.size(); texcount++) {
-							Point2m pp = raster.shot.Project(texels[texcount].meshpoint);
-							// pray is the vector from the point-to-be-colored to the camera center
-							Point3m pray = (raster.shot.GetViewPoint() - texels[texcount].meshpoint)
-											   .Normalize();
-
-							// if inside image
-							if (pp[0] > 0 && pp[1] > 0 &&
-								pp[0] < raster.shot.Intrinsics.ViewportPx[0] &&
-								pp[1] < raster.shot.Intrinsics.ViewportPx[1]) {
-								if ((pray.dot(-raster.shot.Axis(2))) <= 0.0) {
-									depth  = raster.shot.Depth(texels[texcount].meshpoint);
-									pdepth = rendermanager->depth->getval(
-										int(pp[0]),
-										int(pp[1])); //  rendermanager->depth[(int(pp[1]) *
-													 //  raster->shot.Intrinsics.ViewportPx[0]) +
-													 //  int(pp[0])];
-
-									if (depth <= (pdepth + eta)) {
-										// determine color
-										QRgb pcolor = raster.currentPlane->image.pixel(
-											pp[0], raster.shot.Intrinsics.ViewportPx[1] - pp[1]);
-										// determine weight
-										pweight = 1.0;
-
-										if (useangle) {
-											Point3m pixnorm = texels[texcount].meshnormal;
-											pixnorm.Normalize();
-
-											Point3m viewaxis = raster.shot.GetViewPoint() -
-															   texels[texcount].meshpoint;
-											viewaxis.Normalize();
-
-											float ang = abs(pixnorm * viewaxis);
-											ang       = min(1.0f, ang);
-
-											pweight *= ang;
-										}
-
-										if (usedistance) {
-											float distw = depth;
-											distw       = 1.0 - (distw - (allcammindepth * 0.99)) /
-															  ((allcammaxdepth * 1.01) -
-															   (allcammindepth * 0.99));
-
-											pweight *= distw;
-											pweight *= distw;
-										}
-
-										if (useborders) {
-											double xdist =
-												1.0 -
-												(abs(pp[0] -
-													 (raster.shot.Intrinsics.ViewportPx[0] / 2.0)) /
-												 (raster.shot.Intrinsics.ViewportPx[0] / 2.0));
-											double ydist =
-												1.0 -
-												(abs(pp[1] -
-													 (raster.shot.Intrinsics.ViewportPx[1] / 2.0)) /
-												 (raster.shot.Intrinsics.ViewportPx[1] / 2.0));
-											double borderw = min(xdist, ydist);
-
-											pweight *= borderw;
-										}
-
-										if (usesilhouettes) {
-											// here the silhouette weight is applied, but it is
-											// calculated before, on a per-image basis
-											float silw = 1.0;
-											silw = silhouette_buff->getval(int(pp[0]), int(pp[1])) /
-												   maxsildist;
-											pweight *= silw;
-										}
-
-										if (usealphamask) { // alpha channel of image is an
-															// additional mask
-											pweight *= (qAlpha(pcolor) / 255.0);
-										}
-
-										accums[texcount].weights += pweight;
-										accums[texcount].acc_red +=
-											(qRed(pcolor) * pweight / 255.0);
-										accums[texcount].acc_grn +=
-											(qGreen(pcolor) * pweight / 255.0);
-										accums[texcount].acc_blu +=
-											(qBlue(pcolor) * pweight / 255.0);
-									}
-								}
-							}
-
-						} // end foreach texel
-						cam_ind++;
-
-						if (usesilhouettes) {
-							delete silhouette_buff;
-						}
-
-					} // end if(do_project)
-				}
-			} // end foreach camera
+			std::vector<ProjectionAccum> accums;
+			RasterProjector::project(md, model->cm, samples, ppar, accums, cb, 21, 64);
 
 			// for each texel.... divide accumulated values by weight and write to texture
 			for (size_t texcount = 0; texcount < texels.size(); texcount++) {
@@ -1046,74 +616,4 @@ int FilterColorProjectionPlugin::postCondition(const QAction* a) const
 	}
 }
 
-//--- this function calculates the near and far values
-int FilterColorProjectionPlugin::calculateNearFarAccurate(
-	MeshDocument&       md,
-	std::vector<float>* near_acc,
-	std::vector<float>* far_acc)
-{
-	CMeshO::VertexIterator vi;
-	int                    rasterindex;
-
-	if (near_acc != nullptr) {
-		near_acc->clear();
-		near_acc->resize(md.rasterNumber());
-	}
-	else
-		return -1;
-
-	if (far_acc != nullptr) {
-		far_acc->clear();
-		far_acc->resize(md.rasterNumber());
-	}
-	else
-		return -1;
-
-	// init near and far vectors
-	for (unsigned int rasterindex = 0; rasterindex < md.rasterNumber(); rasterindex++) {
-		(*near_acc)[rasterindex] = 1000000;
-		(*far_acc)[rasterindex]  = -1000000;
-	}
-
-	// current model
-	MeshModel* model = md.mm();
-
-	// scan all vertices
-	for (vi = model->cm.vert.begin(); vi != model->cm.vert.end(); ++vi) {
-		if (!(*vi).IsD()) {
-			// check against all cameras
-			rasterindex = 0;
-			for (const RasterModel& raster : md.rasterIterator()) {
-				if (raster.shot.IsValid()) {
-					Point2m pp = raster.shot.Project((*vi).P());
-
-					Point3m viewaxis = raster.shot.GetViewPoint() - (*vi).P();
-					viewaxis.Normalize();
-
-					// if(viewaxis * raster->shot.GetViewDir() > 0.0)     // if facing
-					if (pp[0] > 0 && pp[1] > 0 && pp[0] < raster.shot.Intrinsics.ViewportPx[0] &&
-						pp[1] < raster.shot.Intrinsics.ViewportPx[1]) { // if inside image
-						// then update near and far
-						if (raster.shot.Depth((*vi).P()) < (*near_acc)[rasterindex])
-							(*near_acc)[rasterindex] = raster.shot.Depth((*vi).P());
-						if (raster.shot.Depth((*vi).P()) > (*far_acc)[rasterindex])
-							(*far_acc)[rasterindex] = raster.shot.Depth((*vi).P());
-					}
-				}
-				rasterindex++;
-			}
-		}
-	}
-
-	for (unsigned rasterindex = 0; rasterindex < md.rasterNumber();
-		 rasterindex++) { // set to 0 0 invalid and "strange" cameras
-		if (((*near_acc)[rasterindex] == 1000000) || ((*far_acc)[rasterindex] == -1000000)) {
-			(*near_acc)[rasterindex] = 0;
-			(*far_acc)[rasterindex]  = 0;
-		}
-	}
-
-	return 0;
-}
-
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterColorProjectionPlugin)
@@ -51,8 +51,6 @@ class FilterColorProjectionPlugin : public QObject, public FilterPlugin
 	std::map<std::string, QVariant> applyFilter(const QAction* action, const RichParameterList & /*parent*/, MeshDocument &md, unsigned int& postConditionMask, vcg::CallBackPos * cb);
 
 	FilterArity filterArity(const QAction *) const {return SINGLE_MESH;}
-private:
-	int calculateNearFarAccurate(MeshDocument &md, std::vector<float> *near, std::vector<float> *far);
 };
 
 #endif
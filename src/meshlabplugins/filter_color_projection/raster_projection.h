@@ -0,0 +1,328 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef _RASTER_PROJECTION_H
+#define _RASTER_PROJECTION_H
+
+#include <algorithm>
+#include <vector>
+
+#include <QImage>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <common/ml_document/mesh_document.h>
+#include "depth_rasterizer.h"
+#include "floatbuffer.h"
+
+//----------- RASTER IMAGE ------------------------------
+/*
+The image of a raster. Images resident in the raster plane are returned as
+they are (QImage is implicitly shared, no copy is done); images that are not
+in core are decoded from their file, and released when the caller is done
+with the raster, so at most one image per thread of a batch is alive.
+*/
+inline QImage rasterImage(const RasterModel& raster)
+{
+	const RasterPlane* plane = raster.currentPlane;
+	if (plane == nullptr)
+		return QImage();
+	if (!plane->image.isNull())
+		return plane->image;
+	return QImage(plane->fullPathFileName);
+}
+
+//----------- MULTI RASTER PROJECTION ------------------------------
+
+// a point of the mesh to be colored (a vertex or a texel)
+typedef struct{
+
+  Point3m point;
+  Point3m normal;
+
+} ProjectionSample;
+
+typedef struct{
+
+  double weights;
+  double acc_red;
+  double acc_grn;
+  double acc_blu;
+
+} ProjectionAccum;
+
+typedef struct{
+
+  bool    useangle;
+  bool    usedistance;
+  bool    useborders;
+  bool    usesilhouettes;
+  bool    usealphamask;
+  bool    includeImageBorder; // accept samples projected on the first row/column of the image
+  Scalarm eta;
+
+} ProjectionParams;
+
+/*
+Projects the color of all the visible rasters with a valid shot on a set of
+samples, with the weighting scheme of the "trivial" multi image projection.
+
+The rasters are processed in batches, one raster per thread: each thread
+renders the depth map of its raster with the CPU DepthRasterizer, computes
+the silhouette distance field if needed and evaluates the contribution of
+the raster to each sample into a private list. The lists of a batch are then
+summed into the accumulators in raster order, therefore the result is the
+same of a serial projection regardless of the number of threads.
+At most one batch of depth maps and images is in memory at the same time.
+*/
+class RasterProjector
+{
+public:
+	typedef struct{
+
+	  unsigned int sample;
+	  double weight;
+	  double red;
+	  double green;
+	  double blue;
+
+	} Contribution;
+
+	// m must be already transformed in world coordinates
+	static void project(
+			MeshDocument& md,
+			const CMeshO& m,
+			const std::vector<ProjectionSample>& samples,
+			const ProjectionParams& par,
+			std::vector<ProjectionAccum>& accums,
+			vcg::CallBackPos* cb = nullptr,
+			int cbStart = 0,
+			int cbOffset = 100)
+	{
+		accums.assign(samples.size(), ProjectionAccum{0.0, 0.0, 0.0, 0.0});
+
+		std::vector<const RasterModel*> rasters;
+		for (const RasterModel& rm : md.rasterIterator())
+			rasters.push_back(&rm);
+
+		std::vector<float> nearDepth, farDepth;
+		computeNearFar(m, rasters, nearDepth, farDepth);
+
+		// min max depth for depth weight normalization
+		float allcammaxdepth = -1000000;
+		float allcammindepth = 1000000;
+		for (size_t i = 0; i < rasters.size(); ++i) {
+			allcammaxdepth = std::max(allcammaxdepth, farDepth[i]);
+			allcammindepth = std::min(allcammindepth, nearDepth[i]);
+		}
+
+		std::vector<int> active;
+		for (size_t i = 0; i < rasters.size(); ++i)
+			if (rasters[i]->isVisible() && rasters[i]->shot.IsValid())
+				active.push_back(i);
+
+		int threadNum = 1;
+#ifdef _OPENMP
+		threadNum = omp_get_max_threads();
+#endif
+		const int batchSize = std::max(1, threadNum);
+
+		for (size_t begin = 0; begin < active.size(); begin += batchSize) {
+			const int batchNum = std::min<int>(batchSize, active.size() - begin);
+			if (cb != nullptr)
+				cb(cbStart + (cbOffset * begin) / active.size(), "Projecting rasters...");
+
+			std::vector<std::vector<Contribution> > contributions(batchNum);
+			#pragma omp parallel for schedule(dynamic, 1)
+			for (int k = 0; k < batchNum; ++k) {
+				const int ri = active[begin + k];
+				const RasterModel& raster = *rasters[ri];
+				QImage img = rasterImage(raster);
+				if (img.isNull())
+					continue;
+
+				floatbuffer depth;
+				DepthRasterizer::render(m, raster.shot, nearDepth[ri] * 0.5, farDepth[ri] * 1.25, depth);
+
+				// If should be used silhouette weighting, it is needed to compute depth
+				// discontinuities and per-pixel distance from detected borders on the
+				// entire image here the weight is then applied later, per-sample
+				floatbuffer* silhouette_buff = NULL;
+				float maxsildist = depth.sx + depth.sy;
+				if (par.usesilhouettes) {
+					silhouette_buff = new floatbuffer();
+					silhouette_buff->init(depth.sx, depth.sy);
+					silhouette_buff->applysobel(&depth);
+					silhouette_buff->initborder(&depth);
+					maxsildist = silhouette_buff->distancefield();
+				}
+
+				evaluateRaster(
+					raster, img, depth, silhouette_buff, maxsildist,
+					allcammindepth, allcammaxdepth, samples, par, contributions[k]);
+
+				delete silhouette_buff;
+			}
+
+			// deterministic reduction: rasters are summed in their order
+			for (int k = 0; k < batchNum; ++k) {
+				for (const Contribution& c : contributions[k]) {
+					ProjectionAccum& acc = accums[c.sample];
+					acc.weights += c.weight;
+					acc.acc_red += c.red;
+					acc.acc_grn += c.green;
+					acc.acc_blu += c.blue;
+				}
+			}
+		}
+	}
+
+	// near and far values of each raster, computed on the vertices projected inside the image
+	static void computeNearFar(
+			const CMeshO& m,
+			const std::vector<const RasterModel*>& rasters,
+			std::vector<float>& near_acc,
+			std::vector<float>& far_acc)
+	{
+		near_acc.assign(rasters.size(), 1000000);
+		far_acc.assign(rasters.size(), -1000000);
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int ri = 0; ri < (int) rasters.size(); ++ri) {
+			const Shotm& shot = rasters[ri]->shot;
+			if (!shot.IsValid())
+				continue;
+			float n = 1000000, f = -1000000;
+			for (const CVertexO& v : m.vert) {
+				if (v.IsD())
+					continue;
+				Point2m pp = shot.Project(v.cP());
+				if (pp[0] > 0 && pp[1] > 0 && pp[0] < shot.Intrinsics.ViewportPx[0] &&
+					pp[1] < shot.Intrinsics.ViewportPx[1]) { // if inside image
+					float d = shot.Depth(v.cP());
+					n = std::min(n, d);
+					f = std::max(f, d);
+				}
+			}
+			near_acc[ri] = n;
+			far_acc[ri]  = f;
+		}
+
+		for (size_t ri = 0; ri < rasters.size(); ++ri) { // set to 0 0 invalid and "strange" cameras
+			if ((near_acc[ri] == 1000000) || (far_acc[ri] == -1000000)) {
+				near_acc[ri] = 0;
+				far_acc[ri]  = 0;
+			}
+		}
+	}
+
+private:
+	static void evaluateRaster(
+			const RasterModel& raster,
+			const QImage& img,
+			floatbuffer& depthBuff,
+			floatbuffer* silhouette_buff,
+			float maxsildist,
+			float allcammindepth,
+			float allcammaxdepth,
+			const std::vector<ProjectionSample>& samples,
+			const ProjectionParams& par,
+			std::vector<Contribution>& out)
+	{
+		const Shotm& shot = raster.shot;
+		const int    wt   = shot.Intrinsics.ViewportPx[0];
+		const int    ht   = shot.Intrinsics.ViewportPx[1];
+		const Point3m viewPoint = shot.GetViewPoint();
+		const Point3m axis      = shot.Axis(2);
+
+		for (unsigned int si = 0; si < samples.size(); ++si) {
+			const ProjectionSample& s = samples[si];
+			// pp is the projected point in image space
+			Point2m pp = shot.Project(s.point);
+
+			// if inside image
+			bool inside = par.includeImageBorder ? (pp[0] >= 0 && pp[1] >= 0) : (pp[0] > 0 && pp[1] > 0);
+			if (!inside || pp[0] >= wt || pp[1] >= ht)
+				continue;
+
+			// pray is the vector from the point-to-be-colored to the camera center
+			Point3m pray = (viewPoint - s.point).Normalize();
+			if (pray.dot(-axis) > 0.0)
+				continue;
+
+			Scalarm depth  = shot.Depth(s.point);
+			Scalarm pdepth = depthBuff.getval(int(pp[0]), int(pp[1]));
+			if (depth > (pdepth + par.eta))
+				continue;
+
+			// determine color
+			QRgb pcolor = img.pixel(pp[0], ht - pp[1]);
+			// determine weight
+			double pweight = 1.0;
+
+			if (par.useangle) {
+				Point3m pixnorm = s.normal;
+				pixnorm.Normalize();
+				float ang = std::abs(pixnorm * pray);
+				ang       = std::min(1.0f, ang);
+				pweight *= ang;
+			}
+
+			if (par.usedistance) {
+				float distw = depth;
+				distw = 1.0 - (distw - (allcammindepth * 0.99)) /
+								  ((allcammaxdepth * 1.01) - (allcammindepth * 0.99));
+				pweight *= distw;
+				pweight *= distw;
+			}
+
+			if (par.useborders) {
+				double xdist = 1.0 - (std::abs(pp[0] - (wt / 2.0)) / (wt / 2.0));
+				double ydist = 1.0 - (std::abs(pp[1] - (ht / 2.0)) / (ht / 2.0));
+				pweight *= std::min(xdist, ydist);
+			}
+
+			if (par.usesilhouettes) {
+				// here the silhouette weight is applied, but it is
+				// calculated before, on a per-image basis
+				pweight *= silhouette_buff->getval(int(pp[0]), int(pp[1])) / maxsildist;
+			}
+
+			if (par.usealphamask) { // alpha channel of image is an additional mask
+				pweight *= (qAlpha(pcolor) / 255.0);
+			}
+
+			Contribution c;
+			c.sample = si;
+			c.weight = pweight;
+			c.red    = qRed(pcolor) * pweight / 255.0;
+			c.green  = qGreen(pcolor) * pweight / 255.0;
+			c.blue   = qBlue(pcolor) * pweight / 255.0;
+			out.push_back(c);
+		}
+	}
+};
+
+#endif
@@ -207,6 +207,43 @@ public:
     }
 }; // end class TexFillerSampler
 
+// Parallel version of SurfaceSampling::Texture with a TexFillerSampler.
+// Faces are split in contiguous ranges, sampled in parallel, and the texels
+// of the ranges are concatenated in face order: the resulting list is the
+// same of the serial sampling.
+inline void ParallelTexelSampling(CMeshO &m, QImage &img, int textureWidth, int textureHeight, vector<TexelDesc> &texels)
+{
+    typedef vcg::tri::SurfaceSampling<CMeshO, TexFillerSampler> Sampling;
+    const long long fn = m.face.size();
+    const int chunkNum = 256;
+    vector< vector<TexelDesc> > chunkTexels(chunkNum);
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for (int c = 0; c < chunkNum; ++c)
+    {
+        vector<TexelAccum> chunkAccums; // not used, required by the sampler
+        TexFillerSampler tfs(img);
+        tfs.texelspointer = &chunkTexels[c];
+        tfs.accumpointer  = &chunkAccums;
+        for (long long i = fn * c / chunkNum; i < fn * (c + 1) / chunkNum; ++i)
+        {
+            CFaceO &f = m.face[i];
+            if (f.IsD())
+                continue;
+            vcg::Point2<Scalarm> ti[3];
+            for (int k = 0; k < 3; ++k) // - 0.5 constants are used to obtain correct texture mapping
+                ti[k] = vcg::Point2<Scalarm>(f.WT(k).U() * textureWidth - 0.5, f.WT(k).V() * textureHeight - 0.5);
+            Sampling::SingleFaceRaster(f, tfs, ti[0], ti[1], ti[2], true);
+        }
+    }
 
+    size_t total = 0;
+    for (const vector<TexelDesc> &ct : chunkTexels)
+        total += ct.size();
+    texels.clear();
+    texels.reserve(total);
+    for (const vector<TexelDesc> &ct : chunkTexels)
+        texels.insert(texels.end(), ct.begin(), ct.end());
+}
 
 #endif
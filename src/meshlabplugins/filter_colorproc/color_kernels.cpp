@@ -0,0 +1,237 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "color_kernels.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstring>
+
+#include <vcg/complex/algorithms/stat.h>
+#include <vcg/complex/algorithms/update/color.h>
+
+using namespace vcg;
+
+namespace {
+
+inline int lightness(const Color4b& c)
+{
+	return (std::max(std::max(c[0], c[1]), c[2]) + std::min(std::min(c[0], c[1]), c[2])) / 2;
+}
+
+inline unsigned char equalizedValue(long long cdfValue, long long cdfMin, long long cdfMax, unsigned char value)
+{
+	if (cdfMax == cdfMin) // a single value in the histogram, nothing to stretch
+		return value;
+	return (unsigned char) (float(cdfValue - cdfMin) / float(cdfMax - cdfMin) * 255.0f);
+}
+
+} // namespace
+
+ColorLUT::ColorLUT()
+{
+	for (int ch = 0; ch < 4; ++ch)
+		for (int i = 0; i < 256; ++i)
+			table[ch][i] = i;
+}
+
+/**
+ * @brief Returns the LUT that applies first this LUT and then the next one.
+ */
+ColorLUT ColorLUT::then(const ColorLUT& next) const
+{
+	ColorLUT res;
+	for (int ch = 0; ch < 4; ++ch)
+		for (int i = 0; i < 256; ++i)
+			res.table[ch][i] = next.table[ch][table[ch][i]];
+	return res;
+}
+
+void ColorLUT::applyPerVertex(CMeshO& m, bool selected) const
+{
+	const int vn = (int) m.vert.size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		if (!v.IsD() && (!selected || v.IsS())) {
+			Color4b& c = v.C();
+			c[0] = table[0][c[0]];
+			c[1] = table[1][c[1]];
+			c[2] = table[2][c[2]];
+			c[3] = table[3][c[3]];
+		}
+	}
+}
+
+void ColorKernels::perVertexThresholding(
+		CMeshO& m,
+		float threshold,
+		Color4b c1,
+		Color4b c2,
+		bool selected)
+{
+	const int vn = (int) m.vert.size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		if (!v.IsD() && (!selected || v.IsS())) {
+			const Color4b& c = v.C();
+			float l = (std::max(std::max(c[0], c[1]), c[2]) + std::min(std::min(c[0], c[1]), c[2])) / 2.0f;
+			v.C() = l <= threshold ? c1 : c2;
+		}
+	}
+}
+
+/**
+ * @brief Desaturation methods, as in the "method" parameter of the filter:
+ * 0: lightness, (max(r,g,b) + min(r,g,b)) / 2
+ * 1: luminosity, 0.2126 r + 0.7152 g + 0.0722 b
+ * 2: average, (r + g + b) / 3
+ */
+void ColorKernels::perVertexDesaturation(CMeshO& m, int method, bool selected)
+{
+	const int vn = (int) m.vert.size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		if (!v.IsD() && (!selected || v.IsS())) {
+			const Color4b& c = v.C();
+			int val = 0;
+			switch (method) {
+			case 0: val = lightness(c); break;
+			case 1: val = int(0.2126f * c[0] + 0.7152f * c[1] + 0.0722f * c[2]); break;
+			case 2: val = (c[0] + c[1] + c[2]) / 3; break;
+			default: assert(0);
+			}
+			v.C() = Color4b(val, val, val, 255);
+		}
+	}
+}
+
+/**
+ * @brief Histogram equalization of the vertex colors.
+ * The histograms of the three channels are built in a single parallel pass
+ * (one private histogram per thread, merged at the end); the colors are then
+ * remapped in a second parallel pass.
+ * The channels not in rgbMask are left unchanged, and the alpha is set to
+ * 255, as in vcg::tri::UpdateColor::PerVertexEqualize.
+ */
+void ColorKernels::perVertexEqualize(CMeshO& m, unsigned int rgbMask, bool selected)
+{
+	typedef tri::UpdateColor<CMeshO> UC;
+	const int vn = (int) m.vert.size();
+
+	// hist[0..2]: red, green and blue
+	long long hist[3][256];
+	std::memset(hist, 0, sizeof(hist));
+
+	#pragma omp parallel
+	{
+		long long localHist[3][256];
+		std::memset(localHist, 0, sizeof(localHist));
+
+		#pragma omp for schedule(static) nowait
+		for (int i = 0; i < vn; ++i) {
+			const CVertexO& v = m.vert[i];
+			if (!v.IsD() && (!selected || v.IsS())) {
+				const Color4b& c = v.cC();
+				++localHist[0][c[0]];
+				++localHist[1][c[1]];
+				++localHist[2][c[2]];
+			}
+		}
+
+		#pragma omp critical
+		{
+			for (int h = 0; h < 3; ++h)
+				for (int j = 0; j < 256; ++j)
+					hist[h][j] += localHist[h][j];
+		}
+	}
+
+	// cumulative distribution functions, turned into per channel LUTs
+	long long cdf[3][256];
+	unsigned char lut[3][256];
+	for (int h = 0; h < 3; ++h) {
+		cdf[h][0] = hist[h][0];
+		for (int j = 1; j < 256; ++j)
+			cdf[h][j] = cdf[h][j - 1] + hist[h][j];
+		for (int j = 0; j < 256; ++j)
+			lut[h][j] = equalizedValue(cdf[h][j], cdf[h][0], cdf[h][255], j);
+	}
+
+	const bool eqR = (rgbMask & UC::RED_CHANNEL) != 0;
+	const bool eqG = (rgbMask & UC::GREEN_CHANNEL) != 0;
+	const bool eqB = (rgbMask & UC::BLUE_CHANNEL) != 0;
+
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		if (!v.IsD() && (!selected || v.IsS())) {
+			const Color4b c = v.C();
+			v.C() = Color4b(
+				eqR ? lut[0][c[0]] : c[0],
+				eqG ? lut[1][c[1]] : c[1],
+				eqB ? lut[2][c[2]] : c[2],
+				255);
+		}
+	}
+}
+
+/**
+ * @brief Parallel version of vcg::tri::UpdateColor::PerVertexQualityRamp.
+ */
+void ColorKernels::perVertexQualityRamp(CMeshO& m, Scalarm minq, Scalarm maxq)
+{
+	if (minq == maxq) {
+		std::pair<Scalarm, Scalarm> minmax = tri::Stat<CMeshO>::ComputePerVertexQualityMinMax(m);
+		minq = minmax.first;
+		maxq = minmax.second;
+	}
+	const int vn = (int) m.vert.size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		if (!v.IsD())
+			v.C().SetColorRamp(minq, maxq, v.Q());
+	}
+}
+
+/**
+ * @brief Parallel version of vcg::tri::UpdateColor::PerFaceQualityRamp.
+ */
+void ColorKernels::perFaceQualityRamp(CMeshO& m, Scalarm minq, Scalarm maxq)
+{
+	if (minq == maxq) {
+		std::pair<Scalarm, Scalarm> minmax = tri::Stat<CMeshO>::ComputePerFaceQualityMinMax(m);
+		minq = minmax.first;
+		maxq = minmax.second;
+	}
+	const int fn = (int) m.face.size();
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < fn; ++i) {
+		CFaceO& f = m.face[i];
+		if (!f.IsD())
+			f.C().SetColorRamp(minq, maxq, f.Q());
+	}
+}
@@ -0,0 +1,88 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef FILTERCOLORPROC_COLOR_KERNELS_H
+#define FILTERCOLORPROC_COLOR_KERNELS_H
+
+#include <common/ml_document/cmesh.h>
+#include <vcg/complex/allocate.h>
+
+/**
+ * @brief The ColorLUT class is a per channel look up table (RGBA, 8 bit per
+ * channel) that represents any color operation in which each output channel
+ * depends only on the same input channel (gamma, brightness/contrast, invert,
+ * levels, white balance...).
+ *
+ * A LUT is built by probing the corresponding vcg::tri::UpdateColor function
+ * on a 256 vertex mesh, therefore it gives exactly the same results of the
+ * vcg function. LUTs can be chained, so that a sequence of separable
+ * operations is applied to the mesh with a single parallel pass.
+ */
+class ColorLUT
+{
+public:
+	ColorLUT();
+
+	/**
+	 * Builds the LUT of a separable per vertex color operation.
+	 * op must be a callable that takes a CMeshO& and applies the operation
+	 * to all its vertices.
+	 */
+	template <class SeparableOp>
+	static ColorLUT fromPerVertexOp(SeparableOp op)
+	{
+		CMeshO probe;
+		vcg::tri::Allocator<CMeshO>::AddVertices(probe, 256);
+		for (int i = 0; i < 256; ++i)
+			probe.vert[i].C() = vcg::Color4b(i, i, i, i);
+		op(probe);
+		ColorLUT lut;
+		for (int i = 0; i < 256; ++i)
+			for (int ch = 0; ch < 4; ++ch)
+				lut.table[ch][i] = probe.vert[i].C()[ch];
+		return lut;
+	}
+
+	ColorLUT then(const ColorLUT& next) const;
+
+	void applyPerVertex(CMeshO& m, bool selected) const;
+
+private:
+	unsigned char table[4][256];
+};
+
+/**
+ * @brief Parallel (OpenMP) versions of the non separable per vertex color
+ * operations of vcg::tri::UpdateColor used by the plugin.
+ */
+class ColorKernels
+{
+public:
+	static void perVertexThresholding(CMeshO& m, float threshold, vcg::Color4b c1, vcg::Color4b c2, bool selected);
+	static void perVertexDesaturation(CMeshO& m, int method, bool selected);
+	static void perVertexEqualize(CMeshO& m, unsigned int rgbMask, bool selected);
+	static void perVertexQualityRamp(CMeshO& m, Scalarm minq, Scalarm maxq);
+	static void perFaceQualityRamp(CMeshO& m, Scalarm minq, Scalarm maxq);
+};
+
+#endif // FILTERCOLORPROC_COLOR_KERNELS_H
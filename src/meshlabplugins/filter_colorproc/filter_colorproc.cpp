@@ -23,6 +23,7 @@
 
 #include <vcg/space/colorspace.h>
 #include "filter_colorproc.h"
+#include "color_kernels.h"
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/stat.h>
@@ -422,6 +423,15 @@ RichParameterList FilterColorProc::initParameterList(const QAction *a, const Mes
 	return par;
 }
 
+// reports to the rendering that only the vertex colors of the current mesh
+// are going to be modified
+static void markVertexColors(MeshDocument &md)
+{
+	for (MeshModel& mm : md.meshIterator())
+		mm.dirtyMask().setUnchanged();
+	md.mm()->dirtyMask().mark(MeshModel::MM_VERTCOLOR);
+}
+
 std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filter, const RichParameterList &par, MeshDocument &md, unsigned int& /*postConditionMask*/, vcg::CallBackPos *cb)
 {
 	std::map<std::string, QVariant> values;
@@ -435,6 +445,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			Color4b new_col = Color4b(temp.red(), temp.green(), temp.blue(), temp.alpha());
 
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
 			vcg::tri::UpdateColor<CMeshO>::PerVertexConstant(m->cm, new_col, selected);
 		}
@@ -448,8 +459,9 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			temp = par.getColor("color2");
 			Color4b c2 = Color4b(temp.red(), temp.green(), temp.blue(), temp.alpha());
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
-			vcg::tri::UpdateColor<CMeshO>::PerVertexThresholding(m->cm, threshold, c1, c2, selected);
+			ColorKernels::perVertexThresholding(m->cm, threshold, c1, c2, selected);
 			break;
 		}
 
@@ -459,17 +471,27 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			Scalarm contrast = par.getDynamicFloat("contrast");
 			Scalarm gamma = math::Clamp<Scalarm>(par.getDynamicFloat("gamma"), 0.1, 5.0);
 			bool selected = par.getBool("onSelected");
-
-			vcg::tri::UpdateColor<CMeshO>::PerVertexGamma(m->cm, gamma, selected);
-			vcg::tri::UpdateColor<CMeshO>::PerVertexBrightnessContrast(m->cm, brightness/256.0,contrast/256.0 , selected);
+			markVertexColors(md);
+
+			// gamma and brightness/contrast are fused in a single pass on the mesh
+			ColorLUT gammaLUT = ColorLUT::fromPerVertexOp([&](CMeshO& probe) {
+				vcg::tri::UpdateColor<CMeshO>::PerVertexGamma(probe, gamma);
+			});
+			ColorLUT bcLUT = ColorLUT::fromPerVertexOp([&](CMeshO& probe) {
+				vcg::tri::UpdateColor<CMeshO>::PerVertexBrightnessContrast(probe, brightness/256.0, contrast/256.0);
+			});
+			gammaLUT.then(bcLUT).applyPerVertex(m->cm, selected);
 			break;
 		}
 
 		case CP_INVERT :
 		{
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
-			vcg::tri::UpdateColor<CMeshO>::PerVertexInvert(m->cm, selected);
+			ColorLUT::fromPerVertexOp([](CMeshO& probe) {
+				vcg::tri::UpdateColor<CMeshO>::PerVertexInvert(probe);
+			}).applyPerVertex(m->cm, selected);
 			break;
 		}
 
@@ -482,6 +504,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			Scalarm  out_max = par.getDynamicFloat("out_max")/255;
 			bool all_levels = par.getBool("apply_to_all");
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
 			//builds incrementally a bitmask that indicates on which channels the filter works...
 			unsigned char rgbMask = vcg::tri::UpdateColor<CMeshO>::NO_CHANNELS;
@@ -491,13 +514,16 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			//if no channels are checked, we intend to work on all rgb channels, so...
 			if(rgbMask == vcg::tri::UpdateColor<CMeshO>::NO_CHANNELS) rgbMask = vcg::tri::UpdateColor<CMeshO>::ALL_CHANNELS;
 
+			ColorLUT levelsLUT = ColorLUT::fromPerVertexOp([&](CMeshO& probe) {
+				vcg::tri::UpdateColor<CMeshO>::PerVertexLevels(probe, gamma, in_min, in_max, out_min, out_max, rgbMask);
+			});
 			if (all_levels) {
 				for(MeshModel& mm: md.meshIterator())
 					if (mm.isVisible())
-						vcg::tri::UpdateColor<CMeshO>::PerVertexLevels(mm.cm, gamma, in_min, in_max, out_min, out_max, rgbMask, selected);
+						levelsLUT.applyPerVertex(mm.cm, selected);
 			}
 			else {
-				vcg::tri::UpdateColor<CMeshO>::PerVertexLevels(m->cm, gamma, in_min, in_max, out_min, out_max, rgbMask, selected);
+				levelsLUT.applyPerVertex(m->cm, selected);
 			}
 			break;
 		}
@@ -510,6 +536,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			Scalarm hue = math::Clamp<Scalarm>(par.getDynamicFloat("hue")/360, 0.0, 1.0);
 			Scalarm intensity = math::Clamp<Scalarm>(par.getDynamicFloat("intensity")/100, 0.0, 1.0);
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
 			double r, g, b;   //converts color from HSL to RGB....
 			ColorSpace<unsigned char>::HSLtoRGB( (double)hue, (double)saturation, (double)luminance, r, g, b);
@@ -523,8 +550,9 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 		{
 			int method = par.getEnum("method");
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
-			vcg::tri::UpdateColor<CMeshO>::PerVertexDesaturation(m->cm, method, selected);
+			ColorKernels::perVertexDesaturation(m->cm, method, selected);
 			break;
 		}
 
@@ -536,8 +564,9 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			if(par.getBool("gCh")) rgbMask = rgbMask | vcg::tri::UpdateColor<CMeshO>::GREEN_CHANNEL;
 			if(par.getBool("bCh")) rgbMask = rgbMask | vcg::tri::UpdateColor<CMeshO>::BLUE_CHANNEL;
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
-			vcg::tri::UpdateColor<CMeshO>::PerVertexEqualize(m->cm, rgbMask, selected);
+			ColorKernels::perVertexEqualize(m->cm, rgbMask, selected);
 			break;
 		}
 
@@ -546,8 +575,11 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			QColor tempColor = par.getColor("color");
 			Color4b color = Color4b(tempColor.red(),tempColor.green(),tempColor.blue(), 255);
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
-			vcg::tri::UpdateColor<CMeshO>::PerVertexWhiteBalance(m->cm, color, selected);
+			ColorLUT::fromPerVertexOp([&](CMeshO& probe) {
+				vcg::tri::UpdateColor<CMeshO>::PerVertexWhiteBalance(probe, color);
+			}).applyPerVertex(m->cm, selected);
 			break;
 		}
 
@@ -578,6 +610,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			Scalarm period = md.bbox().Diag() / freq;
 			Point3m offset = par.getPoint3m("offset");
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
 			tri::UpdateColor<CMeshO>::PerVertexPerlinColoring(m->cm, period, offset, c1, c2, selected);
 			break;
@@ -587,6 +620,7 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 		{
 			int noiseBits = par.getInt("noiseBits");
 			bool selected = par.getBool("onSelected");
+			markVertexColors(md);
 
 			tri::UpdateColor<CMeshO>::PerVertexAddNoise(m->cm, noiseBits, selected);
 			break;
@@ -631,11 +665,11 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 
 			if (usePerc)
 			{
-				tri::UpdateColor<CMeshO>::PerVertexQualityRamp(m->cm, PercLo, PercHi);
+				ColorKernels::perVertexQualityRamp(m->cm, PercLo, PercHi);
 				log("Quality Range: %f %f; Used (%f %f) percentile (%f %f) ", H.MinV(), H.MaxV(), PercLo, PercHi, par.getDynamicFloat("perc"), 100 - par.getDynamicFloat("perc"));
 			}
 			else {
-				tri::UpdateColor<CMeshO>::PerVertexQualityRamp(m->cm, RangeMin, RangeMax);
+				ColorKernels::perVertexQualityRamp(m->cm, RangeMin, RangeMax);
 				log("Quality Range: %f %f; Used (%f %f)", H.MinV(), H.MaxV(), RangeMin, RangeMax);
 			}
 			break;
@@ -696,12 +730,12 @@ std::map<std::string, QVariant> FilterColorProc::applyFilter(const QAction *filt
 			}
 
 			if (usePerc){
-				tri::UpdateColor<CMeshO>::PerFaceQualityRamp(m->cm, PercLo, PercHi);
+				ColorKernels::perFaceQualityRamp(m->cm, PercLo, PercHi);
 				log("Quality Range: %f %f; Used (%f %f) percentile (%f %f) ",
 					H.MinV(), H.MaxV(), PercLo, PercHi, perc, 100 - perc);
 			}
 			else {
-				tri::UpdateColor<CMeshO>::PerFaceQualityRamp(m->cm, RangeMin, RangeMax);
+				ColorKernels::perFaceQualityRamp(m->cm, RangeMin, RangeMax);
 				log("Quality Range: %f %f; Used (%f %f)", H.MinV(), H.MaxV(), RangeMin, RangeMax);
 			}
 			break;
@@ -148,16 +148,20 @@ public:
         sampleSize=size;
         DeAllocatePos();//clear old data
         AllocatePos(size);	///allocate for new one
-        inFace=0;
-        inEdge=0;
-        inStar=0;
+        int nFace=0;
+        int nEdge=0;
+        int nStar=0;
         int global=0;
 
         ///start sampling values
         /*Log("Num Diamonds: %d \n",SampledPos.size());*/
 
-
-        for (unsigned int diam=0;diam<SampledPos.size();diam++)
+        ///diamonds are sampled independently, the lookups in the
+        ///parametrization are read only
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic,1) reduction(+:nFace,nEdge,nStar,global)
+#endif
+        for (int diam=0;diam<(int)SampledPos.size();diam++)
             for (unsigned int j=0;j<sampleSize;j++)
                 for (unsigned int k=0;k<sampleSize;k++)
                 {
@@ -175,13 +179,13 @@ public:
                     int domain=isoParam->Theta(I,UV,faces,barys);
 
                     if (domain==0)
-                        inFace++;
+                        nFace++;
                     else
                         if (domain==1)
-                            inEdge++;
+                            nEdge++;
                         else
                             if (domain==2)
-                                inStar++;
+                                nStar++;
 
                     global++;
                     //printf("Find in domain: %d \n",domain);
@@ -191,6 +195,9 @@ public:
                     val=CoordType(0,0,0);*/
                     SampledPos[diam][j][k]=val;
                 }
+        inFace=nFace;
+        inEdge=nEdge;
+        inStar=nStar;
                 return true;
                 /*#ifndef _MESHLAB
                 printf("In Face: %f \n",(PScalarType)inFace/(PScalarType)global);
@@ -401,8 +401,13 @@ public:
     {
 
 
-        //Ord_HVert[index]
-        for (unsigned int i=0;i<HRES_meshes.size();i++)
+        ///the sub meshes partition the h-res vertices and each one is mapped
+        ///on its own copy of the domain, so they are optimized concurrently;
+        ///sizes vary a lot, so they are scheduled one by one
+#ifdef _USE_OMP
+        #pragma omp parallel for schedule(dynamic,1)
+#endif
+        for (int i=0;i<(int)HRES_meshes.size();i++)
         {
 
             MeshType *currMesh=HRES_meshes[i];
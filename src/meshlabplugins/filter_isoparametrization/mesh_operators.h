@@ -8,6 +8,7 @@
 #include <vcg/complex/algorithms/update/component_ep.h>
 #include <vector>
 #include <map>
+#include <algorithm>
 
 template <class MeshType>
 void UpdateStructures(MeshType *mesh)
@@ -420,10 +421,6 @@ void CopyMeshFromVertices(std::vector<typename MeshType::VertexType*> &vertices,
     typedef typename MeshType::VertexType VertexType;
     typedef typename MeshType::FaceType FaceType;
 
-    typename std::vector<VertexType*>::const_iterator iteV;
-    for (iteV=vertices.begin();iteV!=vertices.end();iteV++)
-        (*iteV)->ClearV();
-
     OrderedVertices.clear();
 
     ///vertex-vertex reference
@@ -439,10 +436,10 @@ void CopyMeshFromVertices(std::vector<typename MeshType::VertexType*> &vertices,
     new_mesh.vn=0;
     new_mesh.fn=0;
 
-    ///set vertices as selected
-
-    for (iteV=vertices.begin();iteV!=vertices.end();iteV++)
-        (*iteV)->SetV();
+    ///sorted set of vertices, used instead of the visited flag so that
+    ///disjoint sets can be copied concurrently
+    std::vector<VertexType*> inSet(vertices.begin(),vertices.end());
+    std::sort(inSet.begin(),inSet.end());
 
     ///getting inside faces
     typename std::vector<FaceType*>::const_iterator iteF;
@@ -453,7 +450,9 @@ void CopyMeshFromVertices(std::vector<typename MeshType::VertexType*> &vertices,
         VertexType* v0=(*iteF)->V(0);
         VertexType* v1=(*iteF)->V(1);
         VertexType* v2=(*iteF)->V(2);
-        bool inside=((*v0).IsV()&&(*v1).IsV()&&(*v2).IsV());
+        bool inside=(std::binary_search(inSet.begin(),inSet.end(),v0)&&
+                     std::binary_search(inSet.begin(),inSet.end(),v1)&&
+                     std::binary_search(inSet.begin(),inSet.end(),v2));
         if (inside)
             OrderedFaces.push_back((*iteF));
     }
@@ -504,11 +503,6 @@ void CopyMeshFromVertices(std::vector<typename MeshType::VertexType*> &vertices,
             (*iteF1).V(j)=(*iteMap).second;
         }
     }
-
-    ///clear flags
-    for (iteV=vertices.begin();iteV!=vertices.end();iteV++)
-        (*iteV)->ClearV();
-
 }
 
 /////create a mesh considering the faces that share at leasts one vertex
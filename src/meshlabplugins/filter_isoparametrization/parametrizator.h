@@ -343,29 +343,79 @@ private:
             {return (dist>other.dist);}
         };
 
+    ///greedy coloring of the stars centered in the given vertices, in order:
+    ///adjacent centers get different colors, so the stars of a color do not
+    ///share any face and touch disjoint sets of h-res vertices
+    void ColorStars(const std::vector<BaseVertex*> &centers,
+                    std::vector<std::vector<BaseVertex*> > &colors)
+    {
+        std::vector<int> color(base_mesh.vert.size(),-1);
+        colors.clear();
+        for (unsigned int i=0;i<centers.size();i++)
+        {
+            BaseVertex *v=centers[i];
+            std::vector<bool> used(colors.size(),false);
+            for (vcg::face::VFIterator<BaseFace> vfi(v);!vfi.End();++vfi)
+                for (int k=0;k<3;k++)
+                {
+                    int c=color[vcg::tri::Index(base_mesh,vfi.F()->V(k))];
+                    if (c>=0)
+                        used[c]=true;
+                }
+            int c=std::find(used.begin(),used.end(),false)-used.begin();
+            if (c==(int)colors.size())
+                colors.resize(c+1);
+            color[vcg::tri::Index(base_mesh,v)]=c;
+            colors[c].push_back(v);
+        }
+    }
+
   void FinalOptimization(vcg::tri::ParamEdgeCollapseParameter *pecp)
     {
         char ret[200];
         sprintf(ret," PERFORM GLOBAL OPTIMIZATION initializing... ");
         (*cb)(0,ret);
 
-        std::vector<vert_para> ord_vertex;
-        ord_vertex.resize(base_mesh.vn);
+        std::vector<BaseVertex*> centers;
         for (unsigned int i=0;i<base_mesh.vert.size();i++)
             if (!base_mesh.vert[i].IsD())
-            {
-                BaseVertex *v=&base_mesh.vert[i];
-                ScalarType val=StarDistorsion<BaseMesh>(&base_mesh.vert[i]);
-                //printf("i: %d\n",i);
-                ord_vertex[i].dist=val;
-                ord_vertex[i].v=v;
-            }
+                centers.push_back(&base_mesh.vert[i]);
 
+        ///evaluate the distortion of the stars, one color at a time
+        std::vector<std::vector<BaseVertex*> > colors;
+        ColorStars(centers,colors);
+        std::vector<ScalarType> dist(base_mesh.vert.size(),0);
+        for (unsigned int c=0;c<colors.size();c++)
+        {
+            std::vector<BaseVertex*> &stars=colors[c];
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic,1)
+#endif
+            for (int i=0;i<(int)stars.size();i++)
+                dist[vcg::tri::Index(base_mesh,stars[i])]=StarDistorsion<BaseMesh>(stars[i]);
+        }
+
+        std::vector<vert_para> ord_vertex(centers.size());
+        for (unsigned int i=0;i<centers.size();i++)
+        {
+            ord_vertex[i].dist=dist[vcg::tri::Index(base_mesh,centers[i])];
+            ord_vertex[i].v=centers[i];
+        }
         std::sort(ord_vertex.begin(),ord_vertex.end());
+
+        ///then optimize them, coloring in order of decreasing distortion
+        ///so that the worst stars go first
         for (unsigned int i=0;i<ord_vertex.size();i++)
+            centers[i]=ord_vertex[i].v;
+        ColorStars(centers,colors);
+        for (unsigned int c=0;c<colors.size();c++)
         {
-                printf("%3.3f\n",ord_vertex[i].dist);
-        SmartOptimizeStar<BaseMesh>(ord_vertex[i].v,base_mesh,pecp->Accuracy(),EType);
+            std::vector<BaseVertex*> &stars=colors[c];
+#ifdef _USE_OMP
+            #pragma omp parallel for schedule(dynamic,1)
+#endif
+            for (int i=0;i<(int)stars.size();i++)
+                SmartOptimizeStar<BaseMesh>(stars[i],base_mesh,pecp->Accuracy(),EType);
         }
     }
 
@@ -202,7 +202,14 @@ typename MeshType::ScalarType ApproxAreaDistortion(MeshType &mesh,const int &num
     ScalarType sum=0,div=0;
     ScalarType area_tot=Area<MeshType>(mesh);
 
-    for (unsigned int i=0;i<mesh.face.size();i++)
+    ///per face terms are evaluated in parallel and summed in order,
+    ///so that the result does not depend on the number of threads
+    int fn=(int)mesh.face.size();
+    std::vector<ScalarType> sumF(fn,0),divF(fn,0);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int i=0;i<fn;i++)
     {
         FaceType* f=&mesh.face[i];
         if ((f->V(0)->father==f->V(1)->father)&&(f->V(1)->father==f->V(2)->father))
@@ -215,10 +222,15 @@ typename MeshType::ScalarType ApproxAreaDistortion(MeshType &mesh,const int &num
             ScalarType r1=area_2d/area_3d;
             if (r0>maxRatio)r0=maxRatio;
             if (r1>maxRatio)r1=maxRatio;
-            sum+=area_3d*(r0+r1);
-            div+=area_3d;
+            sumF[i]=area_3d*(r0+r1);
+            divF[i]=area_3d;
         }
     }
+    for (int i=0;i<fn;i++)
+    {
+        sum+=sumF[i];
+        div+=divF[i];
+    }
     return (sum/(div*2))-1.0;
 }
 
@@ -235,7 +247,12 @@ typename MeshType::ScalarType ApproxAngleDistortion(MeshType &mesh)
     //ScalarType area_tot=Area<MeshType>(mesh);
     vcg::Point2<ScalarType> x_axis(0.5f, (ScalarType)(sqrt(3.0)/2.0));
     vcg::Point2<ScalarType> y_axis(1.0f,0);
-    for (unsigned int i=0;i<mesh.face.size();i++)
+    int fn=(int)mesh.face.size();
+    std::vector<ScalarType> sumF(fn,0),divF(fn,0);
+#ifdef _USE_OMP
+    #pragma omp parallel for schedule(static)
+#endif
+    for (int i=0;i<fn;i++)
     {
         FaceType* f=&mesh.face[i];
         if ((f->V(0)->father==f->V(1)->father)&&(f->V(1)->father==f->V(2)->father))
@@ -260,11 +277,16 @@ typename MeshType::ScalarType ApproxAngleDistortion(MeshType &mesh)
             else
                  num=(cot_a*a2+cot_b*b2+cot_c*c2)/area_2d;
 
-            sum+=num;
+            sumF[i]=num;
             //assert(num>=2.0*area_3d);
-            div+=area_3d;
+            divF[i]=area_3d;
         }
     }
+    for (int i=0;i<fn;i++)
+    {
+        sum+=sumF[i];
+        div+=divF[i];
+    }
     return (ScalarType)(fabs(sum)/(div*2)-1.0);
 }
 
@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include "filter_measure.h"
+#include "measure_engine.h"
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
@@ -222,29 +223,25 @@ std::map<std::string, QVariant> FilterMeasurePlugin::computeTopologicalMeasures(
 	md.mm()->updateDataMask(MeshModel::MM_FACEFACETOPO);
 	md.mm()->updateDataMask(MeshModel::MM_VERTFACETOPO);
 
-	int edgeNonManifFFNum = tri::Clean<CMeshO>::CountNonManifoldEdgeFF(m, true);
-	int faceEdgeManif = tri::UpdateSelection<CMeshO>::FaceCount(m);
-	tri::UpdateSelection<CMeshO>::VertexClear(m);
-	tri::UpdateSelection<CMeshO>::FaceClear(m);
-
-	int vertManifNum = tri::Clean<CMeshO>::CountNonManifoldVertexFF(m, true);
-	tri::UpdateSelection<CMeshO>::FaceFromVertexLoose(m);
-	int faceVertManif = tri::UpdateSelection<CMeshO>::FaceCount(m);
-	int edgeNum = 0, edgeBorderNum = 0, edgeNonManifNum = 0;
-	tri::Clean<CMeshO>::CountEdgeNum(m, edgeNum, edgeBorderNum, edgeNonManifNum);
-	assert(edgeNonManifFFNum == edgeNonManifNum);
+	// all the measures are computed by a few fused parallel sweeps on the mesh
+	MeasureEngine::TopologicalMeasures tm = MeasureEngine::computeTopologicalMeasures(m);
+	int edgeNonManifFFNum = tm.nonManifoldEdgeNum;
+	int faceEdgeManif = tm.facesOnNonManifoldEdges;
+	int vertManifNum = tm.nonManifoldVertexNum;
+	int faceVertManif = tm.facesOnNonManifoldVertices;
+	int edgeNum = tm.edgeNum, edgeBorderNum = tm.borderEdgeNum;
 	int holeNum;
 	log("V: %6i E: %6i F:%6i", m.vn, edgeNum, m.fn);
 	outputValues["vertices_number"] = m.vn;
 	outputValues["edges_number"] = edgeNum;
 	outputValues["faces_number"] = m.fn;
-	int unrefVertNum = tri::Clean<CMeshO>::CountUnreferencedVertex(m);
+	int unrefVertNum = tm.unreferencedVertexNum;
 	log("Unreferenced Vertices %i", unrefVertNum);
 	log("Boundary Edges %i", edgeBorderNum);
 	outputValues["unreferenced_vertices"] = unrefVertNum;
 	outputValues["boundary_edges"] = edgeBorderNum;
 
-	int connectedComponentsNum = tri::Clean<CMeshO>::CountConnectedComponents(m);
+	int connectedComponentsNum = tm.connectedComponentsNum;
 	log("Mesh is composed by %i connected component(s)\n", connectedComponentsNum);
 	outputValues["connected_components_number"] = connectedComponentsNum;
 
@@ -264,7 +261,7 @@ std::map<std::string, QVariant> FilterMeasurePlugin::computeTopologicalMeasures(
 
 	// For Manifold meshes compute some other stuff
 	if (vertManifNum == 0 && edgeNonManifFFNum == 0) {
-		holeNum = tri::Clean<CMeshO>::CountHoles(m);
+		holeNum = tm.holeNum;
 		log("Mesh has %i holes", holeNum);
 		outputValues["number_holes"] = holeNum;
 
@@ -420,35 +417,34 @@ std::map<std::string, QVariant> FilterMeasurePlugin::computeGeometricMeasures(Me
 		outputValues["pca"] = QVariant::fromValue(PCA);
 	}
 	else {
+		// area, barycenters and edges are computed by a few fused parallel sweeps
+		MeasureEngine::GeometricMeasures gm = MeasureEngine::computeGeometricMeasures(m);
+
 		// area
-		float Area = tri::Stat<CMeshO>::ComputeMeshArea(m);
+		float Area = gm.area;
 		log("Mesh Surface Area is %f", Area);
 		outputValues["surface_area"] = Area;
 
 		// edges
-		Distribution<Scalarm> eDist;
-		tri::Stat<CMeshO>::ComputeFaceEdgeLengthDistribution(m, eDist, false);
-		log("Mesh Total Len of %i Edges is %f Avg Len %f", int(eDist.Cnt()), eDist.Sum(), eDist.Avg());
-		outputValues["total_edge_length"] = eDist.Sum();
-		outputValues["avg_edge_length"] = eDist.Avg();
-		tri::Stat<CMeshO>::ComputeFaceEdgeLengthDistribution(m, eDist, true);
-		log("Mesh Total Len of %i Edges is %f Avg Len %f (including faux edges))", int(eDist.Cnt()), eDist.Sum(), eDist.Avg());
-		outputValues["total_edge_inc_faux_length"] = eDist.Sum();
-		outputValues["avg_edge_inc_faux_length"] = eDist.Avg();
-		
+		log("Mesh Total Len of %i Edges is %f Avg Len %f", gm.uniqueEdgeNum, gm.uniqueEdgeLength, gm.uniqueEdgeLength / gm.uniqueEdgeNum);
+		outputValues["total_edge_length"] = gm.uniqueEdgeLength;
+		outputValues["avg_edge_length"] = gm.uniqueEdgeLength / gm.uniqueEdgeNum;
+		log("Mesh Total Len of %i Edges is %f Avg Len %f (including faux edges))", gm.uniqueEdgeIncFauxNum, gm.uniqueEdgeIncFauxLength, gm.uniqueEdgeIncFauxLength / gm.uniqueEdgeIncFauxNum);
+		outputValues["total_edge_inc_faux_length"] = gm.uniqueEdgeIncFauxLength;
+		outputValues["avg_edge_inc_faux_length"] = gm.uniqueEdgeIncFauxLength / gm.uniqueEdgeIncFauxNum;
+
 		// Thin shell barycenter
-		Point3m bc = tri::Stat<CMeshO>::ComputeShellBarycenter(m);
+		Point3m bc = gm.shellBarycenter;
 		log("Thin shell (faces) barycenter:  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 		outputValues["shell_barycenter"] = QVariant::fromValue(bc);
 
 		// cloud barycenter
-		bc = tri::Stat<CMeshO>::ComputeCloudBarycenter(m, false);
+		bc = gm.vertexBarycenter;
 		log("Vertices barycenter  %9.6f  %9.6f  %9.6f", bc[0], bc[1], bc[2]);
 		outputValues["barycenter"] = QVariant::fromValue(bc);
 
 		// is watertight?
-		int edgeNum = 0, edgeBorderNum = 0, edgeNonManifNum = 0;
-		tri::Clean<CMeshO>::CountEdgeNum(m, edgeNum, edgeBorderNum, edgeNonManifNum);
+		int edgeBorderNum = gm.borderEdgeNum, edgeNonManifNum = gm.nonManifoldEdgeNum;
 		watertight = (edgeBorderNum == 0) && (edgeNonManifNum == 0);
 		if (watertight) {
 			tri::Inertia<CMeshO> I(m);
@@ -0,0 +1,407 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#include "measure_engine.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <vcg/simplex/face/pos.h>
+#include <vcg/simplex/face/topology.h>
+#include <vcg/space/triangle3.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+using namespace vcg;
+
+namespace {
+
+/**
+ * Lock-free union-find on integer ids: roots are always linked under the root
+ * with the smaller id, therefore concurrent unions can never create a cycle,
+ * and the number of sets does not depend on the order of the unions.
+ */
+class ConcurrentDisjointSet
+{
+public:
+	ConcurrentDisjointSet(int n) : parent(n)
+	{
+		for (int i = 0; i < n; ++i)
+			parent[i].store(i, std::memory_order_relaxed);
+	}
+
+	int find(int x)
+	{
+		while (true) {
+			int p = parent[x].load();
+			if (p == x)
+				return x;
+			int gp = parent[p].load();
+			if (p != gp) // path halving, a failure here is harmless
+				parent[x].compare_exchange_weak(p, gp);
+			x = gp;
+		}
+	}
+
+	void unite(int a, int b)
+	{
+		while (true) {
+			a = find(a);
+			b = find(b);
+			if (a == b)
+				return;
+			if (a < b)
+				std::swap(a, b);
+			int expected = a;
+			if (parent[a].compare_exchange_strong(expected, b))
+				return;
+		}
+	}
+
+private:
+	std::vector<std::atomic<int>> parent;
+};
+
+/**
+ * A face edge, identified by the (sorted) indices of its two vertices.
+ * Used to count unique edges without FF adjacency, as done by
+ * tri::UpdateTopology::FillEdgeVector.
+ */
+struct FaceEdge
+{
+	uint64_t key;  // (min vertex index << 32) | max vertex index
+	uint32_t face;
+	uint8_t  z;
+	bool     faux;
+
+	bool operator<(const FaceEdge& o) const { return key < o.key; }
+};
+
+template <typename T>
+void parallelSort(std::vector<T>& v)
+{
+#ifdef _OPENMP
+	const int nChunks = omp_get_max_threads();
+	if (nChunks > 1 && v.size() > 65536) {
+		std::vector<size_t> bounds(nChunks + 1);
+		for (int i = 0; i <= nChunks; ++i)
+			bounds[i] = v.size() * i / nChunks;
+
+		#pragma omp parallel for schedule(static, 1)
+		for (int i = 0; i < nChunks; ++i)
+			std::sort(v.begin() + bounds[i], v.begin() + bounds[i + 1]);
+
+		for (int step = 1; step < nChunks; step *= 2) {
+			#pragma omp parallel for schedule(static, 1)
+			for (int i = 0; i < nChunks - step; i += 2 * step) {
+				std::inplace_merge(
+					v.begin() + bounds[i],
+					v.begin() + bounds[i + step],
+					v.begin() + bounds[std::min(i + 2 * step, nChunks)]);
+			}
+		}
+		return;
+	}
+#endif
+	std::sort(v.begin(), v.end());
+}
+
+} // namespace
+
+/**
+ * @brief Computes all the topological measures of the mesh.
+ *
+ * Requirements: the mesh must be compact, and FF and VF adjacency must be
+ * up to date.
+ *
+ * As a side effect (like the sequence of vcg calls it replaces), the
+ * non two-manifold vertices and the faces incident on them are left selected.
+ */
+MeasureEngine::TopologicalMeasures MeasureEngine::computeTopologicalMeasures(CMeshO& m)
+{
+	TopologicalMeasures tm;
+	const int fn = (int) m.face.size();
+	const int vn = (int) m.vert.size();
+	const CFaceO* fBase = fn > 0 ? &m.face[0] : nullptr;
+	const CVertexO* vBase = vn > 0 ? &m.vert[0] : nullptr;
+
+	// 1st sweep, on faces: walk the FF ring of each face edge. Each ring is a
+	// unique edge: it is counted only by its smallest (face, edge) element.
+	std::vector<unsigned char> nmEdgeMask(fn, 0);
+	int edgeNum = 0, borderNum = 0, nmEdgeNum = 0, nmEdgeFaceNum = 0;
+	#pragma omp parallel for schedule(static) reduction(+: edgeNum, borderNum, nmEdgeNum, nmEdgeFaceNum)
+	for (int i = 0; i < fn; ++i) {
+		const CFaceO* f = &m.face[i];
+		for (int j = 0; j < 3; ++j) {
+			int ringSize = 0;
+			bool representative = true;
+			const CFaceO* cf = f;
+			int cj = j;
+			do {
+				++ringSize;
+				const CFaceO* nf = cf->cFFp(cj);
+				int nj = cf->cFFi(cj);
+				if (nf < f || (nf == f && nj < j))
+					representative = false;
+				cf = nf;
+				cj = nj;
+			} while (cf != f || cj != j);
+
+			if (ringSize > 2)
+				nmEdgeMask[i] |= (1 << j);
+			if (representative) {
+				++edgeNum;
+				if (ringSize == 1)
+					++borderNum;
+				if (ringSize > 2)
+					++nmEdgeNum;
+			}
+		}
+		if (nmEdgeMask[i] != 0)
+			++nmEdgeFaceNum;
+	}
+
+	// vertices referenced only by edges are not unreferenced, as in
+	// tri::Clean::RemoveUnreferencedVertex
+	std::vector<unsigned char> edgeRef(vn, 0);
+	for (const CEdgeO& e : m.edge) {
+		if (!e.IsD()) {
+			edgeRef[e.cV(0) - vBase] = 1;
+			edgeRef[e.cV(1) - vBase] = 1;
+		}
+	}
+
+	// 2nd sweep, on vertices: VF star size vs FF star size (as in
+	// CountNonManifoldVertexFF), unreferenced and border vertices.
+	std::vector<unsigned char> nmVert(vn, 0);
+	std::vector<unsigned char> borderVert(vn, 0);
+	int unrefNum = 0, nmVertNum = 0;
+	#pragma omp parallel for schedule(static) reduction(+: unrefNum, nmVertNum)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		v.ClearS();
+		if (v.VFp() == nullptr) {
+			if (!edgeRef[i])
+				++unrefNum;
+			continue;
+		}
+		int starSizeVF = 0;
+		bool onNonManifoldEdge = false;
+		for (face::VFIterator<CFaceO> vfi(&v); !vfi.End(); ++vfi) {
+			++starSizeVF;
+			const CFaceO* f = vfi.F();
+			const int z = vfi.I();
+			const int zPrev = (z + 2) % 3;
+			if (nmEdgeMask[f - fBase] & ((1 << z) | (1 << zPrev)))
+				onNonManifoldEdge = true;
+			if (f->cFFp(z) == f || f->cFFp(zPrev) == f)
+				borderVert[i] = 1;
+		}
+		if (!onNonManifoldEdge) {
+			face::Pos<CFaceO> pos(v.VFp(), v.VFi());
+			if (pos.NumberOfIncidentFaces() != starSizeVF) {
+				nmVert[i] = 1;
+				v.SetS();
+				++nmVertNum;
+			}
+		}
+	}
+
+	// 3rd sweep, on faces: selection of faces incident on non manifold
+	// vertices, connected components and border loops.
+	ConcurrentDisjointSet faceComponents(fn);
+	ConcurrentDisjointSet borderLoops(vn);
+	int nmVertFaceNum = 0;
+	#pragma omp parallel for schedule(static) reduction(+: nmVertFaceNum)
+	for (int i = 0; i < fn; ++i) {
+		CFaceO& f = m.face[i];
+		bool onNonManifoldVertex = false;
+		for (int j = 0; j < 3; ++j) {
+			if (nmVert[f.cV(j) - vBase])
+				onNonManifoldVertex = true;
+			const CFaceO* adj = f.cFFp(j);
+			if (adj != &f)
+				faceComponents.unite(i, int(adj - fBase));
+			else
+				borderLoops.unite(int(f.cV0(j) - vBase), int(f.cV1(j) - vBase));
+		}
+		if (onNonManifoldVertex) {
+			f.SetS();
+			++nmVertFaceNum;
+		}
+		else {
+			f.ClearS();
+		}
+	}
+
+	int ccNum = 0, loopNum = 0;
+	#pragma omp parallel for schedule(static) reduction(+: ccNum)
+	for (int i = 0; i < fn; ++i)
+		if (faceComponents.find(i) == i)
+			++ccNum;
+	#pragma omp parallel for schedule(static) reduction(+: loopNum)
+	for (int i = 0; i < vn; ++i)
+		if (borderVert[i] && borderLoops.find(i) == i)
+			++loopNum;
+
+	tm.edgeNum = edgeNum;
+	tm.borderEdgeNum = borderNum;
+	tm.nonManifoldEdgeNum = nmEdgeNum;
+	tm.facesOnNonManifoldEdges = nmEdgeFaceNum;
+	tm.nonManifoldVertexNum = nmVertNum;
+	tm.facesOnNonManifoldVertices = nmVertFaceNum;
+	tm.unreferencedVertexNum = unrefNum;
+	tm.connectedComponentsNum = ccNum;
+	// border loops are holes only when each border vertex has a single loop
+	if (nmEdgeNum == 0 && nmVertNum == 0)
+		tm.holeNum = loopNum;
+	return tm;
+}
+
+/**
+ * @brief Computes area, barycenters, edge counts and edge lengths of the mesh
+ * with a sweep on faces, a sweep on vertices and a single (parallel) sort of
+ * the face edges, shared by all the edge based measures.
+ *
+ * As a side effect (like tri::Stat::ComputeFaceEdgeLengthDistribution), the
+ * per face border flags are updated.
+ */
+MeasureEngine::GeometricMeasures MeasureEngine::computeGeometricMeasures(CMeshO& m)
+{
+	GeometricMeasures gm;
+	const int fn = (int) m.face.size();
+	const int vn = (int) m.vert.size();
+	const CVertexO* vBase = vn > 0 ? &m.vert[0] : nullptr;
+
+	// sweep on faces: area, shell barycenter and face edges
+	const uint64_t deletedKey = std::numeric_limits<uint64_t>::max();
+	std::vector<FaceEdge> edges(3 * (size_t) fn);
+	double doubleArea = 0, bx = 0, by = 0, bz = 0;
+	int aliveFaces = 0;
+	#pragma omp parallel for schedule(static) reduction(+: doubleArea, bx, by, bz, aliveFaces)
+	for (int i = 0; i < fn; ++i) {
+		CFaceO& f = m.face[i];
+		for (int j = 0; j < 3; ++j) {
+			FaceEdge& e = edges[3 * (size_t) i + j];
+			e.face = i;
+			e.z = j;
+			e.faux = f.IsF(j);
+			e.key = deletedKey;
+		}
+		if (f.IsD())
+			continue;
+		f.ClearB(0);
+		f.ClearB(1);
+		f.ClearB(2);
+		++aliveFaces;
+		const double a = DoubleArea(f);
+		const Point3m b = Barycenter(f);
+		doubleArea += a;
+		bx += b[0] * a;
+		by += b[1] * a;
+		bz += b[2] * a;
+		for (int j = 0; j < 3; ++j) {
+			uint64_t v0 = f.cV0(j) - vBase;
+			uint64_t v1 = f.cV1(j) - vBase;
+			if (v0 > v1)
+				std::swap(v0, v1);
+			edges[3 * (size_t) i + j].key = (v0 << 32) | v1;
+		}
+	}
+	gm.area = doubleArea / 2.0;
+	gm.shellBarycenter = Point3m(bx / doubleArea, by / doubleArea, bz / doubleArea);
+
+	// sweep on vertices: vertex barycenter
+	double vx = 0, vy = 0, vz = 0;
+	int aliveVerts = 0;
+	#pragma omp parallel for schedule(static) reduction(+: vx, vy, vz, aliveVerts)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = m.vert[i];
+		v.ClearB();
+		if (!v.IsD()) {
+			vx += v.cP()[0];
+			vy += v.cP()[1];
+			vz += v.cP()[2];
+			++aliveVerts;
+		}
+	}
+	gm.vertexBarycenter = Point3m(vx / aliveVerts, vy / aliveVerts, vz / aliveVerts);
+
+	// edges of deleted faces are sorted at the end of the vector, and dropped
+	parallelSort(edges);
+	edges.resize(3 * (size_t) aliveFaces);
+
+	// each group of equal keys is a unique edge, visited by the thread that
+	// owns its first element
+	const long long en = (long long) edges.size();
+	std::vector<unsigned char> borderEdge(edges.size(), 0);
+	int edgeNum = 0, borderNum = 0, nmEdgeNum = 0, edgeNoFauxNum = 0;
+	double length = 0, lengthNoFaux = 0;
+	#pragma omp parallel for schedule(static) reduction(+: edgeNum, borderNum, nmEdgeNum, edgeNoFauxNum, length, lengthNoFaux)
+	for (long long i = 0; i < en; ++i) {
+		if (i > 0 && edges[i].key == edges[i - 1].key)
+			continue;
+		long long j = i;
+		bool allFaux = true;
+		while (j < en && edges[j].key == edges[i].key) {
+			allFaux = allFaux && edges[j].faux;
+			++j;
+		}
+		const long long facesOnEdge = j - i;
+		const CVertexO& v0 = m.vert[edges[i].key >> 32];
+		const CVertexO& v1 = m.vert[edges[i].key & 0xffffffff];
+		const Scalarm len = Distance(v0.cP(), v1.cP());
+
+		++edgeNum;
+		length += len;
+		if (!allFaux) {
+			++edgeNoFauxNum;
+			lengthNoFaux += len;
+		}
+		if (facesOnEdge == 1) {
+			++borderNum;
+			borderEdge[i] = 1;
+		}
+		if (facesOnEdge > 2)
+			++nmEdgeNum;
+	}
+
+	// border flags are set serially: the edges of a face share its flags
+	for (long long i = 0; i < en; ++i)
+		if (borderEdge[i])
+			m.face[edges[i].face].SetB(edges[i].z);
+
+	gm.edgeNum = edgeNum;
+	gm.borderEdgeNum = borderNum;
+	gm.nonManifoldEdgeNum = nmEdgeNum;
+	gm.uniqueEdgeNum = edgeNoFauxNum;
+	gm.uniqueEdgeLength = lengthNoFaux;
+	gm.uniqueEdgeIncFauxNum = edgeNum;
+	gm.uniqueEdgeIncFauxLength = length;
+	return gm;
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef MEASURE_ENGINE_H
+#define MEASURE_ENGINE_H
+
+#include <common/ml_document/cmesh.h>
+
+/**
+ * @brief The MeasureEngine class computes the statistics reported by the
+ * topological and geometric measure filters with a small number of fused,
+ * OpenMP parallel sweeps over the mesh, instead of calling one
+ * vcg::tri::Clean / vcg::tri::Stat function (i.e. one full traversal) for
+ * each value.
+ *
+ * The returned values are the same computed by the corresponding vcg
+ * functions (CountEdgeNum, CountNonManifoldEdgeFF, CountNonManifoldVertexFF,
+ * CountUnreferencedVertex, CountConnectedComponents, CountHoles,
+ * ComputeMeshArea, ComputeShellBarycenter, ComputeCloudBarycenter and
+ * ComputeFaceEdgeLengthDistribution).
+ */
+class MeasureEngine
+{
+public:
+	struct TopologicalMeasures
+	{
+		int edgeNum = 0;
+		int borderEdgeNum = 0;
+		int nonManifoldEdgeNum = 0;
+		int facesOnNonManifoldEdges = 0;
+		int nonManifoldVertexNum = 0;
+		int facesOnNonManifoldVertices = 0;
+		int unreferencedVertexNum = 0;
+		int connectedComponentsNum = 0;
+		int holeNum = -1; // -1 if the mesh is not two-manifold
+	};
+
+	struct GeometricMeasures
+	{
+		Scalarm area = 0;
+		Point3m shellBarycenter;
+		Point3m vertexBarycenter;
+
+		int edgeNum = 0;
+		int borderEdgeNum = 0;
+		int nonManifoldEdgeNum = 0;
+
+		int uniqueEdgeNum = 0;             // faux edges excluded
+		double uniqueEdgeLength = 0;
+		int uniqueEdgeIncFauxNum = 0;      // faux edges included
+		double uniqueEdgeIncFauxLength = 0;
+	};
+
+	static TopologicalMeasures computeTopologicalMeasures(CMeshO& m);
+	static GeometricMeasures computeGeometricMeasures(CMeshO& m);
+};
+
+#endif // MEASURE_ENGINE_H
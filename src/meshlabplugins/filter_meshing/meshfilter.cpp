@@ -21,6 +21,7 @@
 ****************************************************************************/
 
 #include "meshfilter.h"
+#include <QFileInfo>
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/stat.h>
 #include <vcg/complex/algorithms/smooth.h>
@@ -37,6 +38,10 @@
 #include <vcg/space/fitting3.h>
 #include <wrap/gl/glu_tessellator_cap.h>
 #include "quadric_simp.h"
+#include "parallel_hole_filling.h"
+#include "parallel_isotropic_remeshing.h"
+#include "parallel_subdivision.h"
+#include "streaming_clustering.h"
 
 using namespace std;
 using namespace vcg;
@@ -49,6 +54,7 @@ ExtraMeshFilterPlugin::ExtraMeshFilterPlugin(void)
 		FP_LOOP_SS,
 		FP_BUTTERFLY_SS,
 		FP_CLUSTERING,
+		FP_STREAMING_CLUSTERING,
 		FP_QUADRIC_SIMPLIFICATION,
 		FP_QUADRIC_TEXCOORD_SIMPLIFICATION,
 		FP_EXPLICIT_ISOTROPIC_REMESHING,
@@ -138,6 +144,7 @@ ExtraMeshFilterPlugin::FilterClass ExtraMeshFilterPlugin::getClass(const QAction
 	case FP_QUAD_DOMINANT                    :
 	case FP_MAKE_PURE_TRI                    :
 	case FP_QUAD_PAIRING                     : return FilterClass(Remeshing+Polygonal);
+	case FP_STREAMING_CLUSTERING             : return FilterPlugin::MeshCreation; // it does not need a loaded mesh
 
 	case FP_NORMAL_EXTRAPOLATION             : return FilterClass( Normal + PointSet );
 	case FP_NORMAL_SMOOTH_POINTCLOUD         : return FilterClass( Normal + PointSet );
@@ -197,6 +204,7 @@ int ExtraMeshFilterPlugin::getPreConditions(const QAction *filter) const
 	case FP_NORMAL_SMOOTH_POINTCLOUD         : return MeshModel::MM_VERTNORMAL;
 	case FP_QUADRIC_TEXCOORD_SIMPLIFICATION  : return MeshModel::MM_WEDGTEXCOORD;
 	case FP_CLUSTERING                       :
+	case FP_STREAMING_CLUSTERING             :
 	case FP_SCALE                            :
 	case FP_CENTER                           :
 	case FP_ROTATE                           :
@@ -223,6 +231,14 @@ int ExtraMeshFilterPlugin::getRequirements(const QAction* filter)
 	}
 }
 
+ExtraMeshFilterPlugin::FilterArity ExtraMeshFilterPlugin::filterArity(const QAction* filter) const
+{
+	switch (ID(filter)){
+		case FP_STREAMING_CLUSTERING : return NONE; // it reads a file
+		default: return SINGLE_MESH;
+	}
+}
+
 QString ExtraMeshFilterPlugin::pythonFilterName(ActionIDType f) const
 {
 	switch (f) {
@@ -235,6 +251,7 @@ QString ExtraMeshFilterPlugin::pythonFilterName(ActionIDType f) const
 		return tr("meshing_decimation_quadric_edge_collapse_with_texture");
 	case FP_EXPLICIT_ISOTROPIC_REMESHING: return tr("meshing_isotropic_explicit_remeshing");
 	case FP_CLUSTERING: return tr("meshing_decimation_clustering");
+	case FP_STREAMING_CLUSTERING: return tr("meshing_decimation_clustering_streaming");
 	case FP_REORIENT: return tr("meshing_re_orient_faces_coherentely");
 	case FP_INVERT_FACES: return tr("meshing_invert_face_orientation");
 	case FP_SCALE: return tr("compute_matrix_from_scaling_or_normalization");
@@ -280,6 +297,7 @@ QString ExtraMeshFilterPlugin::filterName(ActionIDType filter) const
 		return tr("Simplification: Quadric Edge Collapse Decimation (with texture)");
 	case FP_EXPLICIT_ISOTROPIC_REMESHING: return tr("Remeshing: Isotropic Explicit Remeshing");
 	case FP_CLUSTERING: return tr("Simplification: Clustering Decimation");
+	case FP_STREAMING_CLUSTERING: return tr("Simplification: Streaming Clustering Decimation");
 	case FP_REORIENT: return tr("Re-Orient all faces coherentely");
 	case FP_INVERT_FACES: return tr("Invert Faces Orientation");
 	case FP_SCALE: return tr("Transform: Scale, Normalize");
@@ -340,6 +358,7 @@ QString ExtraMeshFilterPlugin::filterInfo(ActionIDType filterID) const
 			                                               "<br> <i>Luiz Velho, Denis Zorin </i>"
 			                                               "<br>CAGD, volume 18, Issue 5, Pages 397-427. ");
 	case FP_CLUSTERING                         : return tr("Collapse vertices by creating a three dimensional grid enveloping the mesh and discretizes them based on the cells of this grid");
+	case FP_STREAMING_CLUSTERING               : return tr("Clustering decimation of a binary PLY or STL file, done while reading it: the input mesh is never loaded, so it can be used to make a preview of a mesh larger than the available memory. The simplified mesh is added as a new layer.");
 	case FP_QUADRIC_SIMPLIFICATION             : return tr("Simplify a mesh using a quadric based edge-collapse strategy. A variant of the well known Garland and Heckbert simplification algorithm with different weighting schemes to better cope with aspect ration and planar/degenerate quadrics areas."
 							       "<br> See: <br>"
 							       "<i>M. Garland and P. Heckbert.</i> <br>"
@@ -407,6 +426,19 @@ QString ExtraMeshFilterPlugin::filterInfo(ActionIDType filterID) const
 // return
 //		true if has some parameters
 //		false is has no params
+RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * action, const MeshDocument & md)
+{
+	// the streaming clustering reads a file, and it is available also when no mesh is loaded
+	if (ID(action) == FP_STREAMING_CLUSTERING) {
+		RichParameterList parlst;
+		parlst.addParam(RichOpenFile("FileName", "", {"*.ply *.stl", "*.ply", "*.stl"}, "Input File", "The binary PLY or STL file to simplify. It is read in chunks and never loaded, ASCII files are not supported."));
+		parlst.addParam(RichFloat("CellSize", 0, "Cell Size", "The size of the cell of the clustering grid, in the units of the file. If zero, the cell size is 1% of the bounding box diagonal, found with an additional pass over the file."));
+		parlst.addParam(RichEnum("Representative", 1, QStringList() << "Average" << "Quadric", "Cell Representative", "Where the vertex of each cell is placed: on the average of the vertices in the cell, or on the point minimizing the quadric error of the planes of the faces in the cell (on the average when the minimum falls out of the cell)."));
+		return parlst;
+	}
+	return FilterPlugin::initParameterList(action, md);
+}
+
 RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * action, const MeshModel & m)
 {
 	RichParameterList parlst;
@@ -476,6 +508,8 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 		parlst.addParam(RichBool ("SwapFlag", lastisor_SwapFlag, "Edge-Swap Step", "If checked the remeshing operations will include a edge-swap step, aimed at improving the vertex valence of the resulting mesh."));
 		parlst.addParam(RichBool ("SmoothFlag", lastisor_SmoothFlag, "Smooth Step", "If checked the remeshing operations will include a smoothing step, aimed at relaxing the vertex positions in a Laplacian sense."));
 		parlst.addParam(RichBool ("ReprojectFlag", lastisor_ProjectFlag, "Reproject Step", "If checked the remeshing operations will include a step to reproject the mesh vertices on the original surface."));
+		parlst.addParam(RichBool ("Parallel", true, "Parallel remeshing", "If checked each step runs in parallel over spatial partitions of the mesh, and the reprojection queries a BVH of the original surface instead of a copy of the mesh. Custom per vertex and per face attributes are kept only if they are scalar or 3D point attributes. The adaptive remeshing is always serial."));
+		parlst.addParam(RichBool ("ReleaseInput", false, "Release input mesh", "Only for the parallel remeshing: the input mesh is released as soon as the remeshing starts, and the original surface is kept only in the BVH used for the reprojection. Lowers the memory peak, but the per vertex and per face attributes of the input (color, quality, texture coordinates...) are lost."));
 
 		break;
 	case FP_CLOSE_HOLES:
@@ -483,6 +517,7 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 		parlst.addParam(RichBool("Selected",m.cm.sfn>0,"Close holes with selected faces","Only the holes with at least one of the boundary faces selected are closed"));
 		parlst.addParam(RichBool("NewFaceSelected",true,"Select the newly created faces","After closing a hole the faces that have been created are left selected. Any previous selection is lost. Useful for example for smoothing the newly created holes."));
 		parlst.addParam(RichBool("SelfIntersection",true,"Prevent creation of selfIntersecting faces","When closing an holes it tries to prevent the creation of faces that intersect faces adjacent to the boundary of the hole. It is an heuristic, non intersetcting hole filling can be NP-complete."));
+		parlst.addParam(RichBool("Parallel",true,"Parallel hole filling","If checked all the holes are found at once and filled concurrently, and the self intersection test is done with a BVH against all the faces near the new face, instead of the faces adjacent to the boundary of the hole."));
 		break;
 
 	case FP_LOOP_SS:
@@ -496,6 +531,7 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 		maxVal = m.cm.bbox.Diag();
 		parlst.addParam(RichAbsPerc("Threshold",maxVal*0.01,0,maxVal,"Edge Threshold", "All the edges <b>longer</b> than this threshold will be refined.<br>Setting this value to zero will force an uniform refinement."));
 		parlst.addParam(RichBool ("Selected",m.cm.sfn>0,"Affect only selected faces","If selected the filter affect only the selected faces"));
+		parlst.addParam(RichBool ("Parallel", true, "Parallel subdivision", "If checked the new vertices are computed in parallel and the refined faces are written with their adjacency, without rebuilding the topology of the whole mesh. The result is the same of the serial subdivision."));
 		break;
 
 
@@ -505,6 +541,7 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 		parlst.addParam(RichBool ("Selected",m.cm.sfn>0,"Affect only selected faces","If selected the filter affect only the selected faces"));
 		break;
 
+
 	case FP_CYLINDER_UNWRAP:
 		parlst.addParam(RichFloat("startAngle", 0,"Start angle (deg)", "The starting angle of the unrolling process."));
 		parlst.addParam(RichFloat("endAngle",360,"End angle (deg)","The ending angle of the unrolling process. Quality threshold for penalizing bad shaped faces.<br>The value is in the range [0..1]\n 0 accept any kind of face (no penalties),\n 0.5  penalize faces with quality < 0.5, proportionally to their shape\n"));
@@ -708,6 +745,25 @@ RichParameterList ExtraMeshFilterPlugin::initParameterList(const QAction * actio
 }
 
 
+// one subdivision step, with the parallel engine or with the serial vcg one
+template <class ODD_VERT, class EVEN_VERT>
+void refineOddEvenStep(CMeshO &m, ODD_VERT odd, EVEN_VERT even, Scalarm threshold, bool selected, bool parallel, CallBackPos *cb)
+{
+	if (parallel)
+		ParallelSubdivision::refineOddEven(m, odd, even, threshold, selected, cb);
+	else
+		tri::RefineOddEven<CMeshO>(m, odd, even, threshold, selected, cb);
+}
+
+template <class MIDPOINT>
+void refineStep(CMeshO &m, MIDPOINT mid, Scalarm threshold, bool selected, bool parallel, CallBackPos *cb)
+{
+	if (parallel)
+		ParallelSubdivision::refine(m, mid, threshold, selected, cb);
+	else
+		tri::Refine<CMeshO, MIDPOINT>(m, mid, threshold, selected, cb);
+}
+
 void Freeze(MeshModel *m)
 {
 	tri::UpdatePosition<CMeshO>::Matrix(m->cm, m->cm.Tr,true);
@@ -716,9 +772,21 @@ void Freeze(MeshModel *m)
 	m->cm.Tr.SetIdentity();
 }
 
+// reports to the rendering that only the matrix (or, if frozen, the coords and
+// the normals) of the transformed meshes has been modified
+void MarkTransformed(MeshModel* m, bool freeze)
+{
+	m->dirtyMask().mark(MeshModel::MM_TRANSFMATRIX);
+	if (freeze)
+		m->dirtyMask().mark(MeshModel::MM_VERTCOORD | MeshModel::MM_VERTNORMAL | MeshModel::MM_FACENORMAL);
+}
+
 void ApplyTransform(MeshDocument &md, const Matrix44m &tr, bool toAllFlag, bool freeze,
 					bool invertFlag=false, bool composeFlage=true)
 {
+	for (MeshModel& mm : md.meshIterator())
+		mm.dirtyMask().setUnchanged();
+
 	if(toAllFlag) {
 		MeshModel* m = nullptr;
 		while ((m=md.nextVisibleMesh(m))) {
@@ -726,6 +794,7 @@ void ApplyTransform(MeshDocument &md, const Matrix44m &tr, bool toAllFlag, bool
 			if(composeFlage) m->cm.Tr = tr * m->cm.Tr;
 			else m->cm.Tr=tr;
 			if(freeze) Freeze(m);
+			MarkTransformed(m, freeze);
 		}
 
 		for (RasterModel& rm : md.rasterIterator())
@@ -738,6 +807,7 @@ void ApplyTransform(MeshDocument &md, const Matrix44m &tr, bool toAllFlag, bool
 		if(composeFlage) m->cm.Tr = tr * m->cm.Tr;
 		else m->cm.Tr=tr;
 		if(freeze) Freeze(md.mm());
+		MarkTransformed(m, freeze);
 	}
 }
 
@@ -750,6 +820,21 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 		vcg::CallBackPos * cb)
 {
 	std::map<std::string, QVariant> outputValues;
+
+	// the streaming clustering reads a file: there may be no current mesh
+	if (ID(filter) == FP_STREAMING_CLUSTERING) {
+		QString fileName = par.getOpenFileName("FileName");
+		StreamingClustering::Params params;
+		params.cellSize       = par.getFloat("CellSize");
+		params.representative = StreamingClustering::Representative(par.getEnum("Representative"));
+
+		CMeshO clustered;
+		long long triNum = StreamingClustering::extract(fileName, clustered, params, cb);
+		MeshModel* cm = md.addNewMesh(clustered, QFileInfo(fileName).baseName() + " clustered");
+		log("Clustered %lld triangles into %i vertices and %i faces", triNum, cm->cm.vn, cm->cm.fn);
+		return outputValues;
+	}
+
 	MeshModel & m = *md.mm();
 
 	switch(ID(filter))
@@ -772,6 +857,7 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 		bool  selected  = par.getBool("Selected");
 		Scalarm threshold = par.getAbsPerc("Threshold");
 		int iterations = par.getInt("Iterations");
+		bool parallel = par.getBool("Parallel");
 
 		for(int i=0; i<iterations; ++i)
 		{
@@ -782,51 +868,37 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 				switch(par.getEnum("LoopWeight"))
 				{
 				case 0:
-					tri::RefineOddEven<CMeshO/*, tri::OddPointLoop<CMeshO>, tri::EvenPointLoop<CMeshO>*/ >
-							(m.cm, tri::OddPointLoop<CMeshO>(m.cm), tri::EvenPointLoop<CMeshO>(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoop<CMeshO>(m.cm), tri::EvenPointLoop<CMeshO>(), threshold, selected, parallel, cb);
 					break;
 				case 1:
-					tri::RefineOddEven<CMeshO/*,
-								tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >,
-								tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >*/ >
-							(m.cm, tri::OddPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(m.cm),
-							 tri::EvenPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(m.cm),
+							 tri::EvenPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, RegularLoopWeight<CMeshO::ScalarType> >(), threshold, selected, parallel, cb);
 					break;
 				case 2:
-					tri::RefineOddEven<CMeshO/*,
-								tri::OddPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >,
-								tri::EvenPointLoopGeneric<CMeshO, Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >*/ >
-						(m.cm, tri::OddPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, vcg::tri::ContinuityLoopWeight<CMeshO::ScalarType> >(m.cm),
-							 tri::EvenPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, vcg::tri::ContinuityLoopWeight<CMeshO::ScalarType> >(m.cm),
+							 tri::EvenPointLoopGeneric<CMeshO, vcg::tri::Centroid<CMeshO>, ContinuityLoopWeight<CMeshO::ScalarType> >(), threshold, selected, parallel, cb);
 					break;
 				}
 				break;
 			case FP_BUTTERFLY_SS :
-				Refine<CMeshO,MidPointButterfly<CMeshO> > (m.cm, MidPointButterfly<CMeshO>(m.cm), threshold, selected, cb);
+				refineStep(m.cm, MidPointButterfly<CMeshO>(m.cm), threshold, selected, parallel, cb);
 				break;
 			case FP_MIDPOINT :
-				Refine<CMeshO,MidPoint<CMeshO> > (m.cm, MidPoint<CMeshO>(&m.cm), threshold, selected, cb);
+				refineStep(m.cm, MidPoint<CMeshO>(&m.cm), threshold, selected, parallel, cb);
 				break;
 			case FP_REFINE_LS3_LOOP :
 				switch(par.getEnum("LoopWeight"))
 				{
 				case 0:
-					tri::RefineOddEven<CMeshO/*, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >, tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >*/ >
-							(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(m.cm), tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(m.cm), tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double> >(), threshold, selected, parallel, cb);
 					break;
 				case 1:
-					tri::RefineOddEven<CMeshO/*,
-								tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >,
-								tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >*/ >
-							(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(m.cm),
-							 tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(m.cm),
+							 tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, RegularLoopWeight<double> >(), threshold, selected, parallel, cb);
 					break;
 				case 2:
-					tri::RefineOddEven<CMeshO/*,
-								tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >,
-								tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >*/ >
-							(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(m.cm),
-							 tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(), threshold, selected, cb);
+					refineOddEvenStep(m.cm, tri::OddPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(m.cm),
+							 tri::EvenPointLoopGeneric<CMeshO, LS3Projection<CMeshO, double>, ContinuityLoopWeight<double> >(), threshold, selected, parallel, cb);
 					break;
 				}
 				break;
@@ -1015,10 +1087,6 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 
 		m.updateBoxAndNormals();
 
-		CMeshO toProjectCopy = m.cm;
-
-		toProjectCopy.face.EnableMark();
-
 		tri::IsotropicRemeshing<CMeshO>::Params params;
 		params.SetTargetLen(par.getAbsPerc("TargetLen"));
 		params.SetFeatureAngleDeg(par.getFloat("FeatureDeg"));
@@ -1049,14 +1117,46 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 		lastisor_MaxSurfDist= par.getFloat("MaxSurfDist");
 		lastisor_FeatureDeg = par.getFloat("FeatureDeg");
 
-		try
+		if (par.getBool("Parallel") && !params.adapt)
 		{
-			tri::IsotropicRemeshing<CMeshO>::Do(m.cm, toProjectCopy, params, cb);
+			ParallelIsotropicRemeshing::Params pp;
+			pp.targetLen     = par.getAbsPerc("TargetLen");
+			pp.creaseAngle   = math::ToRad(par.getFloat("FeatureDeg"));
+			pp.maxSurfDist   = params.maxSurfDist;
+			pp.iter          = params.iter;
+			pp.selectedOnly  = params.selectedOnly;
+			pp.splitFlag     = params.splitFlag;
+			pp.collapseFlag  = params.collapseFlag;
+			pp.swapFlag      = params.swapFlag;
+			pp.smoothFlag    = params.smoothFlag;
+			pp.projectFlag   = params.projectFlag;
+			pp.surfDistCheck = params.surfDistCheck;
+			pp.releaseInput  = par.getBool("ReleaseInput");
+
+			ParallelIsotropicRemeshing::Stats stats = ParallelIsotropicRemeshing::remesh(m.cm, pp, cb);
+			log("Remeshed over %i partitions: %i splits, %i collapses, %i flips; %i operations across the partitions done serially",
+				stats.partitionNum, stats.splitNum, stats.collapseNum, stats.flipNum, stats.deferredNum);
+			tri::UpdateTopology<CMeshO>::FaceFace(m.cm);
+			tri::UpdateTopology<CMeshO>::VertexFace(m.cm);
 		}
-		catch(vcg::MissingPreconditionException& excp)
+		else
 		{
-			log(excp.what());
-			throw MLException(excp.what());
+			if (par.getBool("Parallel"))
+				log("Adaptive remeshing is not parallel: running the serial remeshing");
+
+			CMeshO toProjectCopy = m.cm;
+
+			toProjectCopy.face.EnableMark();
+
+			try
+			{
+				tri::IsotropicRemeshing<CMeshO>::Do(m.cm, toProjectCopy, params, cb);
+			}
+			catch(vcg::MissingPreconditionException& excp)
+			{
+				log(excp.what());
+				throw MLException(excp.what());
+			}
 		}
 		m.updateBoxAndNormals();
 
@@ -1423,7 +1523,15 @@ std::map<std::string, QVariant> ExtraMeshFilterPlugin::applyFilter(
 		bool SelfIntersectionFlag = par.getBool("SelfIntersection");
 		bool NewFaceSelectedFlag = par.getBool("NewFaceSelected");
 		int holeCnt;
-		if( SelfIntersectionFlag )
+		if (par.getBool("Parallel"))
+		{
+			ParallelHoleFilling::Params hp;
+			hp.maxHoleSize      = MaxHoleSize;
+			hp.selectedOnly     = SelectedFlag;
+			hp.selfIntersection = SelfIntersectionFlag;
+			holeCnt = ParallelHoleFilling::fill(m.cm, hp, cb);
+		}
+		else if( SelfIntersectionFlag )
 			holeCnt = tri::Hole<CMeshO>::EarCuttingIntersectionFill<tri::SelfIntersectionEar< CMeshO> >(m.cm,MaxHoleSize,SelectedFlag,cb);
 		else
 			holeCnt = tri::Hole<CMeshO>::EarCuttingFill<vcg::tri::MinimumWeightEar< CMeshO> >(m.cm,MaxHoleSize,SelectedFlag,cb);
@@ -1873,6 +1981,7 @@ int ExtraMeshFilterPlugin::postCondition(const QAction * filter) const
 
 	case FP_SLICE_WITH_A_PLANE :
 	case FP_PERIMETER_POLYLINE :
+	case FP_STREAMING_CLUSTERING :
 	case FP_CYLINDER_UNWRAP : return MeshModel::MM_NONE; // they create a new layer
 
 	default                  : return MeshModel::MM_ALL;
@@ -76,7 +76,8 @@ public:
 		FP_FAUX_CREASE,
 		FP_FAUX_EXTRACT,
 		FP_VATTR_SEAM,
-		FP_REFINE_LS3_LOOP
+		FP_REFINE_LS3_LOOP,
+		FP_STREAMING_CLUSTERING
 	} ;
 
 
@@ -89,6 +90,7 @@ public:
 	QString filterInfo(ActionIDType filter) const;
 
 	FilterClass getClass(const QAction*) const;
+	RichParameterList initParameterList(const QAction*, const MeshDocument &md);
 	RichParameterList initParameterList(const QAction*, const MeshModel &/*m*/);
 	std::map<std::string, QVariant> applyFilter(
 			const QAction* action,
@@ -99,7 +101,7 @@ public:
 	int postCondition(const QAction *filter) const;
 	int getPreConditions(const QAction *filter) const;
 	int getRequirements(const QAction* filter);
-	FilterArity filterArity(const QAction *) const {return SINGLE_MESH;}
+	FilterArity filterArity(const QAction *filter) const;
 protected:
 
 	float lastq_QualityThr;
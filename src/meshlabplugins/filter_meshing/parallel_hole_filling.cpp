@@ -0,0 +1,517 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "parallel_hole_filling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <unordered_set>
+
+#include <vcg/complex/allocate.h>
+#include <vcg/space/triangle3.h>
+
+using namespace vcg;
+
+namespace {
+
+// weight of the dihedral angle in the ear priority, as vcg::tri::MinimumWeightEar
+const Scalarm DIHEDRAL_WEIGHT = Scalarm(0.1);
+// holes filled between two calls of the callback
+const int HOLE_BATCH = 1024;
+// rotations around a vertex, at most
+const int MAX_VALENCE = 4096;
+// tolerance of the test between faces sharing a vertex, as vcg::tri::Clean
+const Scalarm EPSIL = Scalarm(0.000001);
+
+struct Ear
+{
+	int     slot;
+	int     stamp;
+	bool    concave;
+	Scalarm score; // aspect ratio minus the weighted dihedral angle
+
+	// the ears on top of the heap are the convex ones with the best score
+	bool operator<(const Ear& e) const
+	{
+		if (concave != e.concave)
+			return concave;
+		return score < e.score;
+	}
+};
+
+inline Point3m normalOf(const Point3m& a, const Point3m& b, const Point3m& c)
+{
+	Point3m n = (b - a) ^ (c - a);
+	n.Normalize();
+	return n;
+}
+
+// corners of the mesh are encoded as 3*f+e, corners of a patch as -(3*t+e)-1
+inline int patchCorner(int t, int e)
+{
+	return -(3 * t + e) - 1;
+}
+
+inline long long edgeKey(int a, int b)
+{
+	if (a > b)
+		std::swap(a, b);
+	return (long long) a << 32 | (unsigned int) b;
+}
+
+// intersection of the segment a-b with the triangle t, with its barycentric
+// coords w.r.t. t[1] and t[2]
+bool segmentTriangle(const Point3m& a, const Point3m& b, const Point3m t[3], Scalarm& u, Scalarm& v)
+{
+	const Point3m dir = b - a;
+	const Point3m e1  = t[1] - t[0];
+	const Point3m e2  = t[2] - t[0];
+	const Point3m pv  = dir ^ e2;
+	const Scalarm det = e1 * pv;
+	if (det == 0)
+		return false;
+	const Point3m tv = a - t[0];
+	u = (tv * pv) / det;
+	if (u < 0 || u > 1)
+		return false;
+	const Point3m qv = tv ^ e1;
+	v = (dir * qv) / det;
+	if (v < 0 || u + v > 1)
+		return false;
+	const Scalarm s = (e2 * qv) / det;
+	return s >= 0 && s <= 1;
+}
+
+bool edgesCross(const Point3m a[3], const Point3m b[3])
+{
+	Scalarm u, v;
+	for (int i = 0; i < 3; ++i) {
+		if (segmentTriangle(a[i], a[(i + 1) % 3], b, u, v) ||
+			segmentTriangle(b[i], b[(i + 1) % 3], a, u, v))
+			return true;
+	}
+	return false;
+}
+
+// as vcg::tri::Clean::TestFaceFaceIntersection, on vertex indices: faces
+// sharing an edge never intersect, and for faces sharing a vertex the
+// opposite edges, moved halfway towards it, are tested
+bool facesIntersect(const Point3m a[3], const int ia[3], const Point3m b[3], const int ib[3])
+{
+	int sv = 0, i0 = -1, i1 = -1;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 3; ++j) {
+			if (ia[i] == ib[j]) {
+				++sv;
+				i0 = i;
+				i1 = j;
+			}
+		}
+	}
+	if (sv == 3)
+		return true;
+	if (sv == 0)
+		return edgesCross(a, b);
+	if (sv == 2)
+		return false;
+
+	const Point3m shP = a[i0] * Scalarm(0.5);
+	Scalarm u, v;
+	if (segmentTriangle(
+			a[(i0 + 1) % 3] * Scalarm(0.5) + shP, a[(i0 + 2) % 3] * Scalarm(0.5) + shP, b, u, v))
+		return !(u + v >= 1 || u <= EPSIL || v <= EPSIL);
+	if (segmentTriangle(
+			b[(i1 + 1) % 3] * Scalarm(0.5) + shP, b[(i1 + 2) % 3] * Scalarm(0.5) + shP, a, u, v))
+		return !(u + v >= 1 || u <= EPSIL || v <= EPSIL);
+	return false;
+}
+
+} // namespace
+
+struct ParallelHoleFilling::Hole
+{
+	std::vector<int>          corners; // border corners 3*f+k of the mesh, in order along the hole
+	std::vector<vcg::Point3i> faces;   // the patch, as vertex indices
+	std::vector<vcg::Point2i> links;   // pairs of adjacent corners, at least one in the patch
+	int                       faceBase = 0;
+	bool                      shared   = false; // some vertices are also on other holes
+};
+
+ParallelHoleFilling::ParallelHoleFilling(CMeshO& m, const Params& params) :
+		m(m), par(params)
+{
+	if (par.selfIntersection)
+		bvh.build(m);
+}
+
+// border corner starting from the end of the border corner c: the faces
+// around that vertex are rotated until the other border edge is reached
+int ParallelHoleFilling::nextBorder(int c) const
+{
+	const int start = 3 * (c / 3) + (c % 3 + 1) % 3;
+	int g = start / 3;
+	int j = start % 3;
+	for (int i = 0; i < MAX_VALENCE; ++i) {
+		const CFaceO& fg = m.face[g];
+		const CFaceO* h  = fg.cFFp(j);
+		if (h == nullptr || h == &fg)
+			return 3 * g + j;
+		const int hj = fg.cFFi(j);
+		g = int(tri::Index(m, h));
+		j = (hj + 1) % 3;
+		if (3 * g + j == start)
+			return -1;
+	}
+	return -1;
+}
+
+// true if the border vertex v and w are joined by an edge of the mesh: the
+// faces of every fan of v (one for each border corner starting from it) are
+// rotated
+bool ParallelHoleFilling::meshEdge(int v, int w) const
+{
+	for (int c = vertBorder[v]; c >= 0; c = otherBorder[c]) {
+		int g = c / 3;
+		int j = c % 3;
+		for (int i = 0; i < MAX_VALENCE; ++i) {
+			const CFaceO& fg = m.face[g];
+			if (int(tri::Index(m, fg.cV((j + 1) % 3))) == w ||
+				int(tri::Index(m, fg.cV((j + 2) % 3))) == w)
+				return true;
+			const int     e = (j + 2) % 3;
+			const CFaceO* h = fg.cFFp(e);
+			if (h == nullptr || h == &fg)
+				break;
+			j = fg.cFFi(e);
+			g = int(tri::Index(m, h));
+			if (3 * g + j == c)
+				break;
+		}
+	}
+	return false;
+}
+
+void ParallelHoleFilling::findHoles()
+{
+	const int fn = int(m.face.size());
+	std::vector<int> next(3 * size_t(fn), -1);
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn; ++f) {
+		const CFaceO& fc = m.face[f];
+		if (fc.IsD())
+			continue;
+		for (int k = 0; k < 3; ++k) {
+			if (fc.cFFp(k) == nullptr || fc.cFFp(k) == &fc)
+				next[3 * f + k] = nextBorder(3 * f + k);
+		}
+	}
+
+	vertBorder.assign(m.vert.size(), -1);
+	otherBorder.assign(next.size(), -1);
+	for (int c = 0; c < 3 * fn; ++c) {
+		const CFaceO& fc = m.face[c / 3];
+		if (!fc.IsD() && (fc.cFFp(c % 3) == nullptr || fc.cFFp(c % 3) == &fc)) {
+			const int v    = int(tri::Index(m, fc.cV(c % 3)));
+			otherBorder[c] = vertBorder[v];
+			vertBorder[v]  = c;
+		}
+	}
+
+	// the loops are collected in face order; the open chains (around non
+	// manifold vertices) are skipped
+	std::vector<char> visited(next.size(), 0);
+	std::vector<int>  loop;
+	for (int c = 0; c < 3 * fn; ++c) {
+		if (next[c] < 0 || visited[c])
+			continue;
+		loop.clear();
+		int x = c;
+		while (x >= 0 && !visited[x]) {
+			visited[x] = 1;
+			loop.push_back(x);
+			x = next[x];
+		}
+		if (x != c || int(loop.size()) >= par.maxHoleSize)
+			continue;
+		bool selected = !par.selectedOnly;
+		for (size_t i = 0; i < loop.size() && !selected; ++i)
+			selected = m.face[loop[i] / 3].IsS();
+		if (selected) {
+			holes.emplace_back();
+			holes.back().corners = loop;
+		}
+	}
+
+	// two holes with a common vertex could add the same edge: they are
+	// filled one after the other
+	std::vector<int> vertHole(m.vert.size(), -1);
+	for (int i = 0; i < int(holes.size()); ++i) {
+		for (int c : holes[i].corners) {
+			int& vh = vertHole[tri::Index(m, m.face[c / 3].cV(c % 3))];
+			if (vh >= 0 && vh != i) {
+				holes[vh].shared = true;
+				holes[i].shared  = true;
+			}
+			vh = i;
+		}
+	}
+}
+
+// Ear cutting of one hole. The slot i of the polygon is the vertex of the
+// i-th border corner, and owns the polygon edge going to the next slot: its
+// owner is the corner of the mesh or of the patch on the other side.
+void ParallelHoleFilling::fillHole(
+	Hole&                          h,
+	std::unordered_set<long long>& chords,
+	std::vector<int>&              near) const
+{
+	const int n = int(h.corners.size());
+	std::vector<int>     vert(n), prev(n), next(n), owner(n), stamp(n, 0);
+	std::vector<Point3m> edgeNormal(n);
+	for (int i = 0; i < n; ++i) {
+		const CFaceO& f = m.face[h.corners[i] / 3];
+		vert[i]         = int(tri::Index(m, f.cV(h.corners[i] % 3)));
+		prev[i]         = (i + n - 1) % n;
+		next[i]         = (i + 1) % n;
+		owner[i]        = h.corners[i];
+		edgeNormal[i]   = normalOf(f.cP(0), f.cP(1), f.cP(2));
+	}
+
+	// the ear of the slot q is the face (r, q, p), oriented as the mesh
+	auto makeEar = [&](int q) {
+		const int      p = prev[q];
+		const int      r = next[q];
+		const Point3m& P = m.vert[vert[p]].cP();
+		const Point3m& Q = m.vert[vert[q]].cP();
+		const Point3m& R = m.vert[vert[r]].cP();
+		const Point3m  nrm = normalOf(R, Q, P);
+
+		Scalarm angle = Angle(P - Q, R - Q);
+		if (nrm * m.vert[vert[q]].cN() < 0)
+			angle = Scalarm(2 * M_PI) - angle;
+		const Scalarm dihedral =
+			std::max(Angle(nrm, edgeNormal[p]), Angle(nrm, edgeNormal[q]));
+
+		Ear e;
+		e.slot    = q;
+		e.stamp   = stamp[q];
+		e.concave = angle > Scalarm(M_PI);
+		e.score   = Quality(P, Q, R) - (dihedral / Scalarm(M_PI)) * DIHEDRAL_WEIGHT;
+		return e;
+	};
+
+	std::priority_queue<Ear> heap;
+	for (int i = 0; i < n; ++i)
+		heap.push(makeEar(i));
+
+	int cnt = n;
+	while (cnt > 2 && !heap.empty()) {
+		const Ear e = heap.top();
+		heap.pop();
+		const int q = e.slot;
+		if (e.stamp != stamp[q])
+			continue;
+		const int p = prev[q];
+		const int r = next[q];
+		const int tv[3] = {vert[r], vert[q], vert[p]};
+
+		// the new edge must not exist yet, unless it closes the hole
+		if (cnt > 3 &&
+			(tv[0] == tv[2] || chords.count(edgeKey(tv[0], tv[2])) > 0 || meshEdge(tv[2], tv[0])))
+			continue;
+		if (par.selfIntersection && intersects(tv, h, near))
+			continue;
+
+		const int t = int(h.faces.size());
+		h.faces.push_back(vcg::Point3i(tv[0], tv[1], tv[2]));
+		h.links.push_back(vcg::Point2i(patchCorner(t, 0), owner[q]));
+		h.links.push_back(vcg::Point2i(patchCorner(t, 1), owner[p]));
+		if (cnt == 3) {
+			h.links.push_back(vcg::Point2i(patchCorner(t, 2), owner[r]));
+		}
+		else {
+			owner[p]      = patchCorner(t, 2);
+			edgeNormal[p] = normalOf(m.vert[tv[0]].cP(), m.vert[tv[1]].cP(), m.vert[tv[2]].cP());
+			chords.insert(edgeKey(tv[0], tv[2]));
+		}
+
+		next[p] = r;
+		prev[r] = p;
+		++stamp[q];
+		++stamp[p];
+		++stamp[r];
+		--cnt;
+		if (cnt > 2) {
+			heap.push(makeEar(p));
+			heap.push(makeEar(r));
+		}
+	}
+}
+
+bool ParallelHoleFilling::intersects(const int tv[3], const Hole& h, std::vector<int>& near) const
+{
+	Point3m tp[3];
+	Box3m   box;
+	for (int i = 0; i < 3; ++i) {
+		tp[i] = m.vert[tv[i]].cP();
+		box.Add(tp[i]);
+	}
+
+	near.clear();
+	bvh.regionQuery(
+		[&](const Box3m& b) {
+			for (int i = 0; i < 3; ++i) {
+				if (b.min[i] > box.max[i] || b.max[i] < box.min[i])
+					return meshlab::FaceBVH::OUTSIDE;
+			}
+			return meshlab::FaceBVH::STRADDLING;
+		},
+		near,
+		near);
+
+	Point3m fp[3];
+	int     fv[3];
+	for (int f : near) {
+		const CFaceO& fc = m.face[f];
+		for (int i = 0; i < 3; ++i) {
+			fp[i] = fc.cP(i);
+			fv[i] = int(tri::Index(m, fc.cV(i)));
+		}
+		if (facesIntersect(tp, tv, fp, fv))
+			return true;
+	}
+	for (const vcg::Point3i& pf : h.faces) {
+		for (int i = 0; i < 3; ++i) {
+			fp[i] = m.vert[pf[i]].cP();
+			fv[i] = pf[i];
+		}
+		if (facesIntersect(tp, tv, fp, fv))
+			return true;
+	}
+	return false;
+}
+
+void ParallelHoleFilling::merge()
+{
+	int faceNum = 0;
+	for (Hole& h : holes) {
+		h.faceBase = faceNum;
+		faceNum += int(h.faces.size());
+	}
+	if (faceNum == 0)
+		return;
+
+	const int fn0 = int(m.face.size());
+	tri::Allocator<CMeshO>::AddFaces(m, faceNum);
+
+	// every border corner of the mesh belongs to a single hole, but a face of
+	// the mesh can have border edges on different holes: its flags are shared
+	// by them and are updated after the parallel loop, that only writes its
+	// adjacency (one field per edge) and the flags of the new faces
+	const int holeNum = int(holes.size());
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int i = 0; i < holeNum; ++i) {
+		const Hole& h = holes[i];
+		const int   base = fn0 + h.faceBase;
+		auto corner = [&](int c, CFaceO*& f, int& e) {
+			if (c >= 0) {
+				f = &m.face[c / 3];
+				e = c % 3;
+			}
+			else {
+				f = &m.face[base + (-c - 1) / 3];
+				e = (-c - 1) % 3;
+			}
+		};
+
+		for (size_t t = 0; t < h.faces.size(); ++t) {
+			CFaceO& nf = m.face[base + t];
+			for (int j = 0; j < 3; ++j) {
+				nf.V(j)   = &m.vert[h.faces[t][j]];
+				nf.FFp(j) = &nf;
+				nf.FFi(j) = j;
+				nf.SetB(j);
+			}
+		}
+		for (const vcg::Point2i& l : h.links) {
+			CFaceO *fa, *fb;
+			int     ea, eb;
+			corner(l[0], fa, ea);
+			corner(l[1], fb, eb);
+			fa->FFp(ea) = fb;
+			fa->FFi(ea) = eb;
+			fb->FFp(eb) = fa;
+			fb->FFi(eb) = ea;
+			if (l[0] < 0)
+				fa->ClearB(ea);
+			if (l[1] < 0)
+				fb->ClearB(eb);
+		}
+	}
+
+	for (const Hole& h : holes) {
+		for (const vcg::Point2i& l : h.links) {
+			for (int k = 0; k < 2; ++k)
+				if (l[k] >= 0)
+					m.face[l[k] / 3].ClearB(l[k] % 3);
+		}
+	}
+}
+
+int ParallelHoleFilling::fill(CMeshO& m, const Params& params, vcg::CallBackPos* cb)
+{
+	ParallelHoleFilling hf(m, params);
+	hf.findHoles();
+
+	const int holeNum = int(hf.holes.size());
+	for (int b = 0; b < holeNum; b += HOLE_BATCH) {
+		if (cb)
+			cb((100 * b) / holeNum, "Closing Holes");
+		const int e = std::min(holeNum, b + HOLE_BATCH);
+		#pragma omp parallel
+		{
+			std::vector<int>              near;
+			std::unordered_set<long long> chords;
+			#pragma omp for schedule(dynamic, 1)
+			for (int i = b; i < e; ++i) {
+				if (!hf.holes[i].shared) {
+					chords.clear();
+					hf.fillHole(hf.holes[i], chords, near);
+				}
+			}
+		}
+	}
+
+	// the new edges of the holes with common vertices are seen by all of them
+	std::vector<int>              near;
+	std::unordered_set<long long> chords;
+	for (Hole& h : hf.holes) {
+		if (h.shared)
+			hf.fillHole(h, chords, near);
+	}
+
+	hf.merge();
+	return holeNum;
+}
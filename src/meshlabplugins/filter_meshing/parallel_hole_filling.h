@@ -0,0 +1,88 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_MESHING_PARALLEL_HOLE_FILLING_H
+#define FILTER_MESHING_PARALLEL_HOLE_FILLING_H
+
+#include <unordered_set>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+#include <common/utilities/face_bvh.h>
+
+/*
+Hole filling by ear cutting (as vcg::tri::Hole::EarCuttingFill with the
+MinimumWeightEar, or EarCuttingIntersectionFill with the SelfIntersectionEar)
+with the holes filled concurrently.
+
+All the border loops are found at once. Every hole is then triangulated in
+its own patch, made of vertex indices, without touching the mesh: the patches
+are finally appended with a single allocation, and their FF adjacency (with
+the mesh and inside the patch) is written directly. The holes sharing a vertex
+with other holes could add the same edge, so they are filled serially at the
+end.
+
+The self intersection test of an ear is done against the faces of the whole
+mesh found by a FaceBVH (built once and shared by all the threads) and against
+the faces of the patch of the same hole.
+
+The mesh must have FF adjacency and no non manifold edges.
+*/
+class ParallelHoleFilling
+{
+public:
+	struct Params
+	{
+		int  maxHoleSize      = 30; // holes with at least this number of edges are left open
+		bool selectedOnly     = false;
+		bool selfIntersection = true;
+	};
+
+	// closes the holes of m and returns their number; the new faces are
+	// appended at the end of the face vector
+	static int fill(CMeshO& m, const Params& params, vcg::CallBackPos* cb = nullptr);
+
+private:
+	struct Hole;
+
+	ParallelHoleFilling(CMeshO& m, const Params& params);
+
+	void findHoles();
+	void fillHole(Hole& h, std::unordered_set<long long>& chords, std::vector<int>& near) const;
+	void merge();
+
+	int  nextBorder(int c) const;
+	bool meshEdge(int v, int w) const;
+	bool intersects(const int tv[3], const Hole& h, std::vector<int>& near) const;
+
+	CMeshO&          m;
+	Params           par;
+	meshlab::FaceBVH bvh;
+
+	std::vector<Hole> holes;
+	std::vector<int>  vertBorder;  // vertex -> a border corner starting from it, -1 if none
+	std::vector<int>  otherBorder; // border corner -> another one starting from the same vertex
+};
+
+#endif // FILTER_MESHING_PARALLEL_HOLE_FILLING_H
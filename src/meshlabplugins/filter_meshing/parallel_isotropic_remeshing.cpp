@@ -0,0 +1,1005 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "parallel_isotropic_remeshing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <vcg/complex/allocate.h>
+#include <vcg/complex/algorithms/update/selection.h>
+
+using namespace vcg;
+
+namespace {
+
+// side of the partitions, in target edge lengths
+const Scalarm PARTITION_SIDE = 64;
+// partitions per axis, at most
+const int MAX_PARTITION_DIM = 1024;
+// rings larger than this are not handled
+const size_t MAX_VALENCE = 256;
+
+inline int nextOf(int h)
+{
+	return h - h % 3 + (h + 1) % 3;
+}
+
+inline int prevOf(int h)
+{
+	return h - h % 3 + (h + 2) % 3;
+}
+
+inline int sq(int x)
+{
+	return x * x;
+}
+
+// copies the per vertex attributes of type T of the vertices src[i] of
+// from to the vertices i of to (that must already have the attributes)
+template <class T>
+void copyPerVertexAttributes(CMeshO& from, CMeshO& to, const std::vector<int>& src)
+{
+	std::vector<std::string> names;
+	tri::Allocator<CMeshO>::GetAllPerVertexAttribute<T>(from, names);
+	for (const std::string& name : names) {
+		auto hf = tri::Allocator<CMeshO>::FindPerVertexAttribute<T>(from, name);
+		auto ht = tri::Allocator<CMeshO>::FindPerVertexAttribute<T>(to, name);
+		for (size_t i = 0; i < src.size(); ++i)
+			if (src[i] >= 0)
+				ht[i] = hf[src[i]];
+	}
+}
+
+// same of copyPerVertexAttributes, for the per face attributes
+template <class T>
+void copyPerFaceAttributes(CMeshO& from, CMeshO& to, const std::vector<int>& src)
+{
+	std::vector<std::string> names;
+	tri::Allocator<CMeshO>::GetAllPerFaceAttribute<T>(from, names);
+	for (const std::string& name : names) {
+		auto hf = tri::Allocator<CMeshO>::FindPerFaceAttribute<T>(from, name);
+		auto ht = tri::Allocator<CMeshO>::FindPerFaceAttribute<T>(to, name);
+		for (size_t i = 0; i < src.size(); ++i)
+			if (src[i] >= 0)
+				ht[i] = hf[src[i]];
+	}
+}
+
+} // namespace
+
+struct ParallelIsotropicRemeshing::Ring
+{
+	std::vector<int> out;       // outgoing half edges, one for each face
+	std::vector<int> vert;      // adjacent vertices
+	int              borderIn;  // incoming border half edge, -1 if inner vertex
+};
+
+ParallelIsotropicRemeshing::ParallelIsotropicRemeshing(const CMeshO& m, const Params& params) :
+		par(params)
+{
+	minLen = par.targetLen * 4 / 5;
+	maxLen = par.targetLen * 4 / 3;
+
+	const int vn = int(m.vert.size());
+	pos.resize(vn);
+	vFlag.assign(vn, 0);
+	vOut.assign(vn, -1);
+	vSrc.resize(vn);
+	vHint.assign(vn, -1);
+	vPart.assign(vn, 0);
+	for (int i = 0; i < vn; ++i) {
+		pos[i]  = m.vert[i].cP();
+		vSrc[i] = i;
+		if (m.vert[i].IsD())
+			vFlag[i] = DELETED;
+	}
+	for (size_t i = 0; i < m.face.size(); ++i) {
+		const CFaceO& f = m.face[i];
+		if (f.IsD())
+			continue;
+		for (int k = 0; k < 3; ++k)
+			fv.push_back(int(tri::Index(m, f.cV(k))));
+		fSrc.push_back(int(i));
+		fSel.push_back(f.IsS() ? 1 : 0);
+	}
+	const int fn = int(fSrc.size());
+	const int hn = 3 * fn;
+
+	// the corners of each vertex
+	std::vector<int> cornerBegin(vn + 1, 0);
+	for (int h = 0; h < hn; ++h)
+		++cornerBegin[fv[h] + 1];
+	for (int i = 0; i < vn; ++i)
+		cornerBegin[i + 1] += cornerBegin[i];
+	std::vector<int> corner(hn);
+	std::vector<int> fill(cornerBegin.begin(), cornerBegin.end() - 1);
+	for (int h = 0; h < hn; ++h)
+		corner[fill[fv[h]]++] = h;
+	for (int i = 0; i < vn; ++i)
+		if (cornerBegin[i] < cornerBegin[i + 1])
+			vOut[i] = corner[cornerBegin[i]];
+
+	// an edge is manifold if it has exactly one half edge for each direction
+	twin.assign(hn, -1);
+	hFeature.assign(hn, 0);
+	#pragma omp parallel for schedule(static)
+	for (int h = 0; h < hn; ++h) {
+		const int a = fv[h];
+		const int b = fv[nextOf(h)];
+		int       opposite = -1, oppositeNum = 0, sameNum = 0;
+		for (int j = cornerBegin[b]; j < cornerBegin[b + 1]; ++j)
+			if (fv[nextOf(corner[j])] == a) {
+				opposite = corner[j];
+				++oppositeNum;
+			}
+		for (int j = cornerBegin[a]; j < cornerBegin[a + 1]; ++j)
+			if (fv[nextOf(corner[j])] == b)
+				++sameNum;
+		if (oppositeNum == 1 && sameNum == 1)
+			twin[h] = opposite;
+		else if (oppositeNum + sameNum > 1)
+			hFeature[h] = NON_MANIFOLD_EDGE;
+	}
+
+	// the crease edges of the input
+	const Scalarm cosCrease = std::cos(par.creaseAngle);
+	#pragma omp parallel for schedule(static)
+	for (int h = 0; h < hn; ++h) {
+		if (twin[h] < 0)
+			continue;
+		Point3m n0 = faceNormal(h / 3);
+		Point3m n1 = faceNormal(twin[h] / 3);
+		if (n0.Norm() > 0 && n1.Norm() > 0 && n0.Normalize() * n1.Normalize() < cosCrease)
+			hFeature[h] = CREASE;
+	}
+
+	if (par.projectFlag || par.surfDistCheck)
+		bvh.build(m);
+}
+
+/*
+ * Feature vertices lie on crease or border edges; corners are the feature
+ * vertices where the feature lines end, meet or bend more than the crease
+ * angle. Non manifold vertices, and the vertices of the faces not selected
+ * when remeshing only the selection, are locked.
+ */
+void ParallelIsotropicRemeshing::classifyVertices()
+{
+	const int        vn = int(pos.size());
+	std::vector<int> faceNum(vn, 0);
+	for (size_t h = 0; h < fv.size(); ++h)
+		if (fv[h] >= 0)
+			++faceNum[fv[h]];
+	const Scalarm cosCrease = std::cos(par.creaseAngle);
+
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < vn; ++v) {
+		if (vFlag[v] & DELETED)
+			continue;
+		thread_local Ring r;
+		if (!ring(v, r) || int(r.out.size()) != faceNum[v]) {
+			vFlag[v] = FEATURE | CORNER | LOCKED | NON_MANIFOLD;
+			continue;
+		}
+		unsigned char flags = 0;
+		int           featureNum = 0;
+		Point3m       dir[2];
+		for (size_t i = 0; i < r.out.size(); ++i) {
+			const int h = r.out[i];
+			if (twin[h] < 0 || hFeature[h] != 0) {
+				if (featureNum < 2)
+					dir[featureNum] = pos[r.vert[i]] - pos[v];
+				++featureNum;
+			}
+			if (par.selectedOnly && !fSel[h / 3])
+				flags |= LOCKED;
+		}
+		if (r.borderIn >= 0) {
+			if (featureNum < 2)
+				dir[featureNum] = pos[fv[r.borderIn]] - pos[v];
+			++featureNum;
+		}
+		if (featureNum > 0)
+			flags |= FEATURE;
+		if (featureNum == 1 || featureNum > 2)
+			flags |= CORNER;
+		else if (featureNum == 2 && dir[0].Normalize() * dir[1].Normalize() > -cosCrease)
+			flags |= CORNER;
+		vFlag[v] = flags;
+	}
+}
+
+/*
+ * The vertices are assigned to cubic partitions, numbered in order of their
+ * first vertex; the partitions are sorted by round, i.e. by their coordinates
+ * modulo 3.
+ */
+void ParallelIsotropicRemeshing::computePartitions()
+{
+	const int vn = int(pos.size());
+	Box3m     box;
+	for (int v = 0; v < vn; ++v)
+		if (!(vFlag[v] & DELETED))
+			box.Add(pos[v]);
+	Scalarm side = par.targetLen * PARTITION_SIDE;
+	if (!box.IsNull()) {
+		const Point3m dim = box.Dim();
+		side = std::max(side, std::max(dim[0], std::max(dim[1], dim[2])) / MAX_PARTITION_DIM);
+	}
+	if (!(side > 0))
+		side = 1;
+
+	std::unordered_map<long long, int> partIndex;
+	partCoord.clear();
+	for (int v = 0; v < vn; ++v) {
+		if (vFlag[v] & DELETED) {
+			vPart[v] = 0;
+			continue;
+		}
+		Point3i c;
+		for (int i = 0; i < 3; ++i)
+			c[i] = std::min(MAX_PARTITION_DIM, int((pos[v][i] - box.min[i]) / side));
+		const long long key = ((long long) c[0] * (MAX_PARTITION_DIM + 1) + c[1]) *
+		                          (MAX_PARTITION_DIM + 1) + c[2];
+		auto it = partIndex.find(key);
+		if (it == partIndex.end()) {
+			it = partIndex.insert(std::make_pair(key, int(partCoord.size()))).first;
+			partCoord.push_back(c);
+		}
+		vPart[v] = it->second;
+	}
+	if (partCoord.empty())
+		partCoord.push_back(Point3i(0, 0, 0));
+
+	const int partNum = int(partCoord.size());
+	roundBegin.assign(28, 0);
+	std::vector<int> round(partNum);
+	for (int p = 0; p < partNum; ++p) {
+		const Point3i& c = partCoord[p];
+		round[p] = (c[0] % 3) * 9 + (c[1] % 3) * 3 + c[2] % 3;
+		++roundBegin[round[p] + 1];
+	}
+	for (int i = 0; i < 27; ++i)
+		roundBegin[i + 1] += roundBegin[i];
+	roundPart.resize(partNum);
+	std::vector<int> fill(roundBegin.begin(), roundBegin.end() - 1);
+	for (int p = 0; p < partNum; ++p)
+		roundPart[fill[round[p]]++] = p;
+	stats.partitionNum = partNum;
+}
+
+/*
+ * Runs an operation on the edges selected by candidate (an edge is given by
+ * any of its half edges), and returns the number of operations done. Each
+ * edge is processed by the partition of its first vertex; with reserve, edge
+ * j gets the vertex slotVertBase + j and the faces slotFaceBase + 2j, 2j + 1.
+ */
+template <class Candidate, class Operation>
+int ParallelIsotropicRemeshing::runPass(Candidate candidate, Operation operation, bool reserve)
+{
+	const int                  hn = int(fv.size());
+	std::vector<unsigned char> selected(hn, 0);
+	#pragma omp parallel for schedule(static)
+	for (int h = 0; h < hn; ++h) {
+		if (fv[h] < 0 || (hFeature[h] & NON_MANIFOLD_EDGE))
+			continue;
+		const int a = fv[h], b = fv[nextOf(h)];
+		if ((twin[h] < 0 || a < b) && editable(h) && candidate(h))
+			selected[h] = 1;
+	}
+
+	const int        partNum = int(partCoord.size());
+	std::vector<int> begin(partNum + 1, 0);
+	for (int h = 0; h < hn; ++h)
+		if (selected[h])
+			++begin[vPart[fv[h]] + 1];
+	for (int p = 0; p < partNum; ++p)
+		begin[p + 1] += begin[p];
+	const int        edgeNum = begin[partNum];
+	std::vector<int> edgeA(edgeNum), edgeB(edgeNum);
+	std::vector<int> fill(begin.begin(), begin.end() - 1);
+	for (int h = 0; h < hn; ++h)
+		if (selected[h]) {
+			const int j = fill[vPart[fv[h]]]++;
+			edgeA[j]    = fv[h];
+			edgeB[j]    = fv[nextOf(h)];
+		}
+
+	if (reserve) {
+		slotVertBase = int(pos.size());
+		slotFaceBase = int(fv.size() / 3);
+		const size_t vn = pos.size() + edgeNum;
+		const size_t fn = fv.size() / 3 + 2 * size_t(edgeNum);
+		pos.resize(vn, Point3m(0, 0, 0));
+		vFlag.resize(vn, DELETED);
+		vOut.resize(vn, -1);
+		vSrc.resize(vn, -1);
+		vHint.resize(vn, -1);
+		vPart.resize(vn, 0);
+		fv.resize(3 * fn, -1);
+		twin.resize(3 * fn, -1);
+		hFeature.resize(3 * fn, 0);
+		fSrc.resize(fn, -1);
+		fSel.resize(fn, 0);
+	}
+
+	std::vector<int>              done(partNum, 0);
+	std::vector<std::vector<int>> deferred(partNum);
+	for (int r = 0; r < 27; ++r) {
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = roundBegin[r]; i < roundBegin[r + 1]; ++i) {
+			const int p = roundPart[i];
+			for (int j = begin[p]; j < begin[p + 1]; ++j) {
+				const OpResult res = operation(edgeA[j], edgeB[j], j, p);
+				if (res == DONE)
+					++done[p];
+				else if (res == DEFERRED)
+					deferred[p].push_back(j);
+			}
+		}
+	}
+
+	// the operations across the partitions
+	int doneNum = 0;
+	for (int p = 0; p < partNum; ++p) {
+		doneNum += done[p];
+		for (int j : deferred[p])
+			if (operation(edgeA[j], edgeB[j], j, -1) == DONE)
+				++doneNum;
+		stats.deferredNum += int(deferred[p].size());
+	}
+	return doneNum;
+}
+
+/*
+ * The vertices and faces of the ring of v; false if v has no faces, or if its
+ * faces do not form a single fan.
+ */
+bool ParallelIsotropicRemeshing::ring(int v, Ring& r) const
+{
+	r.out.clear();
+	r.vert.clear();
+	r.borderIn = -1;
+	const int h0 = vOut[v];
+	if (h0 < 0)
+		return false;
+	int h = h0;
+	do {
+		r.out.push_back(h);
+		r.vert.push_back(fv[nextOf(h)]);
+		const int p = prevOf(h);
+		if (twin[p] < 0) {
+			r.borderIn = p;
+			break;
+		}
+		h = twin[p];
+		if (r.out.size() > MAX_VALENCE)
+			return false;
+	} while (h != h0);
+
+	if (r.borderIn >= 0) {
+		r.vert.push_back(fv[r.borderIn]);
+		for (h = h0; twin[h] >= 0;) {
+			h = nextOf(twin[h]);
+			r.out.push_back(h);
+			r.vert.push_back(fv[nextOf(h)]);
+			if (r.out.size() > MAX_VALENCE)
+				return false;
+		}
+	}
+	return true;
+}
+
+// true if the ring can be read and written from the partition part (-1 for
+// the serial operations)
+bool ParallelIsotropicRemeshing::reachable(int part, const Ring& r) const
+{
+	if (part < 0)
+		return true;
+	const Point3i& c = partCoord[part];
+	for (int v : r.vert) {
+		const Point3i& d = partCoord[vPart[v]];
+		if (std::abs(d[0] - c[0]) > 1 || std::abs(d[1] - c[1]) > 1 || std::abs(d[2] - c[2]) > 1)
+			return false;
+	}
+	return true;
+}
+
+// the half edge between a and b, in any direction
+int ParallelIsotropicRemeshing::findHalfEdge(const Ring& ra, int b) const
+{
+	for (size_t i = 0; i < ra.out.size(); ++i)
+		if (ra.vert[i] == b)
+			return ra.out[i];
+	if (ra.borderIn >= 0 && fv[ra.borderIn] == b)
+		return ra.borderIn;
+	return -1;
+}
+
+bool ParallelIsotropicRemeshing::editable(int h) const
+{
+	if (!par.selectedOnly)
+		return true;
+	return fSel[h / 3] && (twin[h] < 0 || fSel[twin[h] / 3]);
+}
+
+void ParallelIsotropicRemeshing::linkTwin(int h, int t, unsigned char feature)
+{
+	twin[h]     = t;
+	hFeature[h] = feature;
+	if (t >= 0) {
+		twin[t]     = h;
+		hFeature[t] = feature;
+	}
+}
+
+Point3m ParallelIsotropicRemeshing::faceNormal(int f) const
+{
+	const Point3m& p0 = pos[fv[3 * f]];
+	return (pos[fv[3 * f + 1]] - p0) ^ (pos[fv[3 * f + 2]] - p0);
+}
+
+// normal of the face f with the vertex v moved in p
+Point3m ParallelIsotropicRemeshing::movedNormal(int f, int v, const Point3m& p) const
+{
+	Point3m q[3];
+	for (int k = 0; k < 3; ++k)
+		q[k] = fv[3 * f + k] == v ? p : pos[fv[3 * f + k]];
+	return (q[1] - q[0]) ^ (q[2] - q[0]);
+}
+
+bool ParallelIsotropicRemeshing::farFromSurface(const Point3m& p) const
+{
+	if (bvh.isEmpty())
+		return false;
+	meshlab::FaceBVH::PointHit hit;
+	return !bvh.closestPoint(p, par.maxSurfDist, hit);
+}
+
+/*
+ * Splits the edge (a, b) at its midpoint: the faces (u, w, c) and (w, u, d)
+ * become (u, m, c), (m, w, c) and (m, u, d), (w, m, d).
+ */
+ParallelIsotropicRemeshing::OpResult
+ParallelIsotropicRemeshing::split(int a, int b, int slot, int part)
+{
+	thread_local Ring ra, rb;
+	if ((vFlag[a] & DELETED) || (vFlag[b] & DELETED) || !ring(a, ra))
+		return SKIPPED;
+	if (!reachable(part, ra))
+		return DEFERRED;
+	const int h = findHalfEdge(ra, b);
+	if (h < 0 || !ring(b, rb))
+		return SKIPPED;
+	if (!reachable(part, rb))
+		return DEFERRED;
+
+	const int           f       = h / 3;
+	const int           hn      = nextOf(h);
+	const int           t       = twin[h];
+	const int           u       = fv[h];
+	const int           w       = fv[hn];
+	const int           c       = fv[prevOf(h)];
+	const int           m       = slotVertBase + slot;
+	const int           f2      = slotFaceBase + 2 * slot;
+	const int           g2      = f2 + 1;
+	const unsigned char feature = hFeature[h];
+
+	pos[m]   = (pos[u] + pos[w]) / 2;
+	vFlag[m] = (t < 0 || feature != 0) ? FEATURE : 0;
+	vSrc[m]  = vSrc[u];
+	vHint[m] = vHint[u];
+	vPart[m] = part >= 0 ? part : vPart[a];
+
+	const int           hnTwin    = twin[hn];
+	const unsigned char hnFeature = hFeature[hn];
+	fv[hn]         = m;
+	fv[3 * f2]     = m;
+	fv[3 * f2 + 1] = w;
+	fv[3 * f2 + 2] = c;
+	fSrc[f2]       = fSrc[f];
+	fSel[f2]       = fSel[f];
+	linkTwin(hn, 3 * f2 + 2, 0);
+	linkTwin(3 * f2 + 1, hnTwin, hnFeature);
+
+	if (t >= 0) {
+		const int           g         = t / 3;
+		const int           tp        = prevOf(t);
+		const int           d         = fv[tp];
+		const int           tpTwin    = twin[tp];
+		const unsigned char tpFeature = hFeature[tp];
+		fv[t]          = m;
+		fv[3 * g2]     = w;
+		fv[3 * g2 + 1] = m;
+		fv[3 * g2 + 2] = d;
+		fSrc[g2]       = fSrc[g];
+		fSel[g2]       = fSel[g];
+		linkTwin(tp, 3 * g2 + 1, 0);
+		linkTwin(3 * g2 + 2, tpTwin, tpFeature);
+		linkTwin(h, t, feature);
+		linkTwin(3 * f2, 3 * g2, feature);
+	}
+	else {
+		linkTwin(h, -1, feature);
+		linkTwin(3 * f2, -1, feature);
+	}
+	vOut[w] = 3 * f2 + 1;
+	vOut[m] = 3 * f2;
+	return DONE;
+}
+
+/*
+ * Collapses the edge (a, b): a vertex off the features is never merged with
+ * a feature line, and a feature vertex only moves along its line; corners and
+ * locked vertices do not move.
+ */
+ParallelIsotropicRemeshing::OpResult ParallelIsotropicRemeshing::collapse(int a, int b, int part)
+{
+	thread_local Ring ra, rb, rc;
+	if ((vFlag[a] & DELETED) || (vFlag[b] & DELETED) || !ring(a, ra))
+		return SKIPPED;
+	if (!reachable(part, ra))
+		return DEFERRED;
+	const int h = findHalfEdge(ra, b);
+	if (h < 0 || !ring(b, rb))
+		return SKIPPED;
+	if (!reachable(part, rb))
+		return DEFERRED;
+	if (((vFlag[a] | vFlag[b]) & NON_MANIFOLD) || (hFeature[h] & NON_MANIFOLD_EDGE))
+		return SKIPPED;
+	if (SquaredDistance(pos[a], pos[b]) >= minLen * minLen)
+		return SKIPPED;
+
+	const int  t           = twin[h];
+	const bool featureEdge = t < 0 || hFeature[h] != 0;
+	auto       removable   = [&](int v) {
+		return !(vFlag[v] & (CORNER | LOCKED)) && (featureEdge || !(vFlag[v] & FEATURE));
+	};
+	const bool removeA = removable(a);
+	const bool removeB = removable(b);
+	if (!removeA && !removeB)
+		return SKIPPED;
+	const int     r  = removeA ? a : b;
+	const int     k  = removeA ? b : a;
+	const Point3m p  = (removeA && removeB) ? (pos[a] + pos[b]) / 2 : pos[k];
+	const Ring&   rr = removeA ? ra : rb;
+
+	// an inner edge between two border vertices would pinch the surface
+	if (t >= 0 && ra.borderIn >= 0 && rb.borderIn >= 0)
+		return SKIPPED;
+	// link condition: the only common neighbours are the opposite vertices
+	const int c = fv[prevOf(h)];
+	const int d = t >= 0 ? fv[prevOf(t)] : -1;
+	int       commonNum = 0;
+	for (int x : ra.vert)
+		if (std::find(rb.vert.begin(), rb.vert.end(), x) != rb.vert.end()) {
+			if (x != c && x != d)
+				return SKIPPED;
+			++commonNum;
+		}
+	if (commonNum != (t >= 0 ? 2 : 1))
+		return SKIPPED;
+	for (int x : {c, d}) {
+		if (x < 0)
+			continue;
+		if (!ring(x, rc) || rc.vert.size() <= (rc.borderIn >= 0 ? 2u : 3u))
+			return SKIPPED;
+	}
+
+	// no long edge and no flipped face
+	const int f = h / 3;
+	const int g = t >= 0 ? t / 3 : -1;
+	for (const Ring* q : {&ra, &rb}) {
+		for (int x : q->vert)
+			if (x != a && x != b && SquaredDistance(p, pos[x]) >= maxLen * maxLen)
+				return SKIPPED;
+		const int v = q == &ra ? a : b;
+		for (int o : q->out) {
+			const int e = o / 3;
+			if (e == f || e == g)
+				continue;
+			if (movedNormal(e, v, p) * faceNormal(e) <= 0)
+				return SKIPPED;
+		}
+	}
+	if (par.surfDistCheck && farFromSurface(p))
+		return SKIPPED;
+
+	// the faces f and g are removed, and their other edges glued in pairs
+	const int outer[4] = {
+		twin[nextOf(h)], twin[prevOf(h)], t >= 0 ? twin[nextOf(t)] : -1, t >= 0 ? twin[prevOf(t)] : -1};
+	for (int e : {h, t}) {
+		if (e < 0)
+			continue;
+		const int           x       = twin[nextOf(e)];
+		const int           y       = twin[prevOf(e)];
+		const unsigned char feature = hFeature[nextOf(e)] | hFeature[prevOf(e)];
+		if (x >= 0)
+			linkTwin(x, y, feature);
+		else if (y >= 0)
+			linkTwin(y, -1, feature);
+	}
+	for (int o : rr.out)
+		if (o / 3 != f && o / 3 != g)
+			fv[o] = k;
+	for (int e : {f, g}) {
+		if (e < 0)
+			continue;
+		for (int i = 0; i < 3; ++i) {
+			fv[3 * e + i]   = -1;
+			twin[3 * e + i] = -1;
+		}
+	}
+	pos[k]   = p;
+	vFlag[r] = DELETED;
+	vOut[r]  = -1;
+
+	for (int v : {k, c, d}) {
+		if (v < 0 || (vOut[v] >= 0 && fv[vOut[v]] == v))
+			continue;
+		for (int x : outer) {
+			if (x < 0)
+				continue;
+			if (fv[x] == v)
+				vOut[v] = x;
+			else if (fv[nextOf(x)] == v)
+				vOut[v] = nextOf(x);
+			else
+				continue;
+			break;
+		}
+	}
+	return DONE;
+}
+
+/*
+ * Flips the inner edge (u, w) of the faces (u, w, c) and (w, u, d), if it
+ * brings the valences of the four vertices nearer to 6 (4 on the border).
+ */
+ParallelIsotropicRemeshing::OpResult ParallelIsotropicRemeshing::flip(int a, int b, int part)
+{
+	thread_local Ring ra, rb, rc, rd;
+	if ((vFlag[a] & DELETED) || (vFlag[b] & DELETED) || !ring(a, ra))
+		return SKIPPED;
+	if (!reachable(part, ra))
+		return DEFERRED;
+	const int h = findHalfEdge(ra, b);
+	if (h < 0 || !ring(b, rb))
+		return SKIPPED;
+	if (!reachable(part, rb))
+		return DEFERRED;
+
+	const int t = twin[h];
+	if (t < 0 || hFeature[h] != 0)
+		return SKIPPED;
+	const int f = h / 3;
+	const int g = t / 3;
+	const int u = fv[h];
+	const int w = fv[nextOf(h)];
+	const int c = fv[prevOf(h)];
+	const int d = fv[prevOf(t)];
+	if (c == d || ((vFlag[a] | vFlag[b] | vFlag[c] | vFlag[d]) & NON_MANIFOLD))
+		return SKIPPED;
+	if (!ring(c, rc) || !ring(d, rd))
+		return SKIPPED;
+	if (std::find(rc.vert.begin(), rc.vert.end(), d) != rc.vert.end())
+		return SKIPPED;
+
+	const Ring& ru = u == a ? ra : rb;
+	const Ring& rw = u == a ? rb : ra;
+	auto deviation = [](const Ring& r, int delta) {
+		return sq(int(r.vert.size()) + delta - (r.borderIn >= 0 ? 4 : 6));
+	};
+	const int before = deviation(ru, 0) + deviation(rw, 0) + deviation(rc, 0) + deviation(rd, 0);
+	const int after  = deviation(ru, -1) + deviation(rw, -1) + deviation(rc, 1) + deviation(rd, 1);
+	if (after >= before)
+		return SKIPPED;
+
+	// the new faces must keep the orientation and not fold more than the old ones
+	Point3m n0 = faceNormal(f);
+	Point3m n1 = faceNormal(g);
+	Point3m m0 = (pos[u] - pos[c]) ^ (pos[d] - pos[c]);
+	Point3m m1 = (pos[w] - pos[d]) ^ (pos[c] - pos[d]);
+	const Point3m avg = n0 + n1;
+	if (m0 * avg <= 0 || m1 * avg <= 0 || n0.Norm() == 0 || n1.Norm() == 0)
+		return SKIPPED;
+	const Scalarm newCos = m0.Normalize() * m1.Normalize();
+	if (newCos < n0.Normalize() * n1.Normalize() && newCos < std::cos(par.creaseAngle))
+		return SKIPPED;
+	if (par.surfDistCheck && farFromSurface((pos[c] + pos[d]) / 2))
+		return SKIPPED;
+
+	// (c, u, d) and (d, w, c)
+	const int           hnTwin    = twin[nextOf(h)];
+	const int           hpTwin    = twin[prevOf(h)];
+	const int           tnTwin    = twin[nextOf(t)];
+	const int           tpTwin    = twin[prevOf(t)];
+	const unsigned char hnFeature = hFeature[nextOf(h)];
+	const unsigned char hpFeature = hFeature[prevOf(h)];
+	const unsigned char tnFeature = hFeature[nextOf(t)];
+	const unsigned char tpFeature = hFeature[prevOf(t)];
+	fv[3 * f]     = c;
+	fv[3 * f + 1] = u;
+	fv[3 * f + 2] = d;
+	fv[3 * g]     = d;
+	fv[3 * g + 1] = w;
+	fv[3 * g + 2] = c;
+	linkTwin(3 * f, hpTwin, hpFeature);
+	linkTwin(3 * f + 1, tnTwin, tnFeature);
+	linkTwin(3 * f + 2, 3 * g + 2, 0);
+	linkTwin(3 * g, tpTwin, tpFeature);
+	linkTwin(3 * g + 1, hnTwin, hnFeature);
+	vOut[c] = 3 * f;
+	vOut[u] = 3 * f + 1;
+	vOut[d] = 3 * g;
+	vOut[w] = 3 * g + 1;
+	return DONE;
+}
+
+/*
+ * Tangential relaxation: every free vertex moves towards the centroid of its
+ * ring, in the tangent plane. All the vertices move at once, so the result
+ * does not depend on the order.
+ */
+void ParallelIsotropicRemeshing::smooth()
+{
+	const int            vn = int(pos.size());
+	std::vector<Point3m> moved(pos);
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < vn; ++v) {
+		if (vFlag[v] & (DELETED | FEATURE | CORNER | LOCKED))
+			continue;
+		thread_local Ring r;
+		if (!ring(v, r) || r.vert.empty())
+			continue;
+		Point3m q(0, 0, 0);
+		for (int x : r.vert)
+			q += pos[x];
+		q /= Scalarm(r.vert.size());
+		Point3m n(0, 0, 0);
+		for (int o : r.out)
+			n += faceNormal(o / 3);
+		if (!(n.Norm() > 0))
+			continue;
+		n.Normalize();
+		Point3m delta = q - pos[v];
+		delta -= n * (delta * n);
+		const Point3m p = pos[v] + delta;
+
+		bool ok = true;
+		for (int o : r.out)
+			if (movedNormal(o / 3, v, p) * faceNormal(o / 3) <= 0) {
+				ok = false;
+				break;
+			}
+		if (ok && par.surfDistCheck && farFromSurface(p))
+			ok = false;
+		if (ok)
+			moved[v] = p;
+	}
+	pos.swap(moved);
+}
+
+// moves the vertices on the closest point of the input surface
+void ParallelIsotropicRemeshing::project()
+{
+	if (bvh.isEmpty())
+		return;
+	const int     vn      = int(pos.size());
+	const Scalarm maxDist = bvh.boundingBox().Diag();
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < vn; ++v) {
+		if (vFlag[v] & (DELETED | CORNER | LOCKED))
+			continue;
+		meshlab::FaceBVH::PointHit hit;
+		hit.tri = vHint[v];
+		if (bvh.closestPoint(pos[v], maxDist, hit)) {
+			pos[v]   = hit.point;
+			vHint[v] = hit.tri;
+		}
+	}
+}
+
+// removes the deleted vertices and faces, and the unused reserved slots
+void ParallelIsotropicRemeshing::compact()
+{
+	const int        vn = int(pos.size());
+	const int        fn = int(fv.size() / 3);
+	std::vector<int> vMap(vn, -1), fMap(fn, -1);
+	int              nv = 0, nf = 0;
+	for (int v = 0; v < vn; ++v)
+		if (!(vFlag[v] & DELETED))
+			vMap[v] = nv++;
+	for (int f = 0; f < fn; ++f)
+		if (fv[3 * f] >= 0)
+			fMap[f] = nf++;
+	auto hMap = [&fMap](int h) { return h < 0 ? -1 : 3 * fMap[h / 3] + h % 3; };
+
+	std::vector<Point3m>       nPos(nv);
+	std::vector<unsigned char> nFlag(nv);
+	std::vector<int>           nOut(nv), nSrc(nv), nHint(nv), nPart(nv);
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < vn; ++v) {
+		const int i = vMap[v];
+		if (i < 0)
+			continue;
+		nPos[i]  = pos[v];
+		nFlag[i] = vFlag[v];
+		nOut[i]  = hMap(vOut[v]);
+		nSrc[i]  = vSrc[v];
+		nHint[i] = vHint[v];
+		nPart[i] = vPart[v];
+	}
+	std::vector<int>           nFv(3 * size_t(nf)), nTwin(3 * size_t(nf));
+	std::vector<unsigned char> nFeature(3 * size_t(nf)), nSel(nf);
+	std::vector<int>           nFSrc(nf);
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn; ++f) {
+		const int i = fMap[f];
+		if (i < 0)
+			continue;
+		for (int k = 0; k < 3; ++k) {
+			nFv[3 * i + k]      = vMap[fv[3 * f + k]];
+			nTwin[3 * i + k]    = hMap(twin[3 * f + k]);
+			nFeature[3 * i + k] = hFeature[3 * f + k];
+		}
+		nFSrc[i] = fSrc[f];
+		nSel[i]  = fSel[f];
+	}
+	pos.swap(nPos);
+	vFlag.swap(nFlag);
+	vOut.swap(nOut);
+	vSrc.swap(nSrc);
+	vHint.swap(nHint);
+	vPart.swap(nPart);
+	fv.swap(nFv);
+	twin.swap(nTwin);
+	hFeature.swap(nFeature);
+	fSrc.swap(nFSrc);
+	fSel.swap(nSel);
+}
+
+/*
+ * Replaces the elements of m with the remeshed ones, that take the attributes
+ * of their source elements (if the input has not been released). The new
+ * elements are built in a separate mesh that is then moved into m: the
+ * vectors of m are not grown with the input still in them, and there are no
+ * deleted elements to compact. The mesh level data (transformation, textures,
+ * shot and per mesh attributes) is kept.
+ */
+void ParallelIsotropicRemeshing::writeBack(CMeshO& m, bool released) const
+{
+	std::vector<int> vMap(pos.size(), -1);
+	int              vn = 0;
+	for (size_t v = 0; v < pos.size(); ++v)
+		if (!(vFlag[v] & DELETED))
+			vMap[v] = vn++;
+	std::vector<int> faces;
+	for (size_t f = 0; 3 * f < fv.size(); ++f)
+		if (fv[3 * f] >= 0)
+			faces.push_back(int(f));
+
+	// source element of each output element, -1 for the new ones
+	std::vector<int> outVSrc(vn, -1);
+	std::vector<int> outFSrc(faces.size(), -1);
+
+	CMeshO out;
+	out.enableComponentsFromOtherMesh(m);
+	tri::Allocator<CMeshO>::AddVertices(out, vn);
+	for (size_t v = 0; v < pos.size(); ++v) {
+		if (vMap[v] < 0)
+			continue;
+		CVertexO& nv = out.vert[vMap[v]];
+		if (!released && vSrc[v] >= 0) {
+			nv.ImportData(m.vert[vSrc[v]]);
+			outVSrc[vMap[v]] = vSrc[v];
+		}
+		nv.P() = pos[v];
+	}
+	tri::Allocator<CMeshO>::AddFaces(out, faces.size());
+	for (size_t i = 0; i < faces.size(); ++i) {
+		const int f  = faces[i];
+		CFaceO&   nf = out.face[i];
+		if (!released && fSrc[f] >= 0) {
+			nf.ImportData(m.face[fSrc[f]]);
+			outFSrc[i] = fSrc[f];
+		}
+		for (int k = 0; k < 3; ++k)
+			nf.V(k) = &out.vert[vMap[fv[3 * f + k]]];
+	}
+	if (!released) {
+		copyPerVertexAttributes<Scalarm>(m, out, outVSrc);
+		copyPerVertexAttributes<Point3m>(m, out, outVSrc);
+		copyPerFaceAttributes<Scalarm>(m, out, outFSrc);
+		copyPerFaceAttributes<Point3m>(m, out, outFSrc);
+	}
+	// the selection flags are inherited by ImportData
+	out.svn = tri::UpdateSelection<CMeshO>::VertexCount(out);
+	out.sfn = tri::UpdateSelection<CMeshO>::FaceCount(out);
+
+	out.Tr         = m.Tr;
+	out.textures   = m.textures;
+	out.normalmaps = m.normalmaps;
+	out.shot       = m.shot;
+	std::swap(out.mesh_attr, m.mesh_attr);
+	m = std::move(out);
+}
+
+ParallelIsotropicRemeshing::Stats
+ParallelIsotropicRemeshing::remesh(CMeshO& m, const Params& params, vcg::CallBackPos* cb)
+{
+	ParallelIsotropicRemeshing r(m, params);
+	if (params.releaseInput) {
+		for (CVertexO& v : m.vert)
+			if (!v.IsD())
+				tri::Allocator<CMeshO>::DeleteVertex(m, v);
+		for (CFaceO& f : m.face)
+			if (!f.IsD())
+				tri::Allocator<CMeshO>::DeleteFace(m, f);
+		tri::Allocator<CMeshO>::CompactEveryVector(m);
+		m.vert.shrink_to_fit();
+		m.face.shrink_to_fit();
+	}
+
+	for (int i = 0; i < params.iter; ++i) {
+		if (cb)
+			cb((100 * i) / params.iter, "Isotropic remeshing");
+		r.classifyVertices();
+		r.computePartitions();
+		if (params.splitFlag)
+			r.stats.splitNum += r.runPass(
+				[&r](int h) {
+					const int a = r.fv[h], b = r.fv[nextOf(h)];
+					return SquaredDistance(r.pos[a], r.pos[b]) > r.maxLen * r.maxLen;
+				},
+				[&r](int a, int b, int slot, int part) { return r.split(a, b, slot, part); },
+				true);
+		if (params.collapseFlag)
+			r.stats.collapseNum += r.runPass(
+				[&r](int h) {
+					const int a = r.fv[h], b = r.fv[nextOf(h)];
+					return SquaredDistance(r.pos[a], r.pos[b]) < r.minLen * r.minLen;
+				},
+				[&r](int a, int b, int, int part) { return r.collapse(a, b, part); },
+				false);
+		if (params.swapFlag)
+			r.stats.flipNum += r.runPass(
+				[&r](int h) { return r.twin[h] >= 0 && r.hFeature[h] == 0; },
+				[&r](int a, int b, int, int part) { return r.flip(a, b, part); },
+				false);
+		r.compact();
+		if (params.smoothFlag) {
+			r.classifyVertices();
+			r.smooth();
+		}
+		if (params.projectFlag)
+			r.project();
+	}
+	r.writeBack(m, params.releaseInput);
+	return r.stats;
+}
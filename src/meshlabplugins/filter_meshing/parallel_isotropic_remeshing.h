@@ -0,0 +1,153 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_MESHING_PARALLEL_ISOTROPIC_REMESHING_H
+#define FILTER_MESHING_PARALLEL_ISOTROPIC_REMESHING_H
+
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+#include <common/utilities/face_bvh.h>
+
+/*
+Isotropic explicit remeshing (as vcg::tri::IsotropicRemeshing: split of the long
+edges, collapse of the short ones, edge flips towards valence 6, tangential
+smoothing and reprojection) with every pass run in parallel.
+
+The mesh is copied in an indexed half edge structure. Before each topological
+pass the space is split in cubic partitions, and every edge belongs to the
+partition of its first vertex. The partitions are processed in 27 rounds, one
+for each residue of their coordinates modulo 3, so that two partitions processed
+together are never adjacent: an operation is done in parallel only if all the
+vertices it reads or writes belong to its partition or to the adjacent ones,
+otherwise it is deferred and done serially at the end of the pass. The new
+elements of a split get indices reserved in advance for its edge, so the result
+does not depend on the number of threads.
+
+The reprojection and the surface distance check query a FaceBVH of the input
+mesh from all the threads; no copy of the input mesh (nor of its grid) is made.
+*/
+class ParallelIsotropicRemeshing
+{
+public:
+	struct Params
+	{
+		Scalarm targetLen     = 1;
+		Scalarm creaseAngle   = Scalarm(M_PI / 6); // radians
+		Scalarm maxSurfDist   = 0;
+		int     iter          = 3;
+		bool    selectedOnly  = false;
+		bool    splitFlag     = true;
+		bool    collapseFlag  = true;
+		bool    swapFlag      = true;
+		bool    smoothFlag    = true;
+		bool    projectFlag   = true;
+		bool    surfDistCheck = false;
+		// the input mesh is emptied as soon as it has been copied: lowers the
+		// memory peak, but its per vertex and per face attributes are lost
+		bool    releaseInput  = false;
+	};
+
+	struct Stats
+	{
+		int partitionNum = 0; // partitions of the last pass
+		int splitNum     = 0;
+		int collapseNum  = 0;
+		int flipNum      = 0;
+		int deferredNum  = 0; // operations done serially at the end of a pass
+	};
+
+	// remeshes m in place; the new elements take the attributes of the
+	// elements they come from
+	static Stats remesh(CMeshO& m, const Params& params, vcg::CallBackPos* cb = nullptr);
+
+private:
+	enum VertexFlag : unsigned char {
+		DELETED      = 1,
+		FEATURE      = 2, // on a crease or border edge
+		CORNER       = 4,
+		LOCKED       = 8,
+		NON_MANIFOLD = 16
+	};
+	enum EdgeFlag : unsigned char { CREASE = 1, NON_MANIFOLD_EDGE = 2 };
+	enum OpResult { SKIPPED, DONE, DEFERRED };
+
+	struct Ring;
+
+	ParallelIsotropicRemeshing(const CMeshO& m, const Params& params);
+
+	void classifyVertices();
+	void computePartitions();
+	template <class Candidate, class Operation>
+	int runPass(Candidate candidate, Operation operation, bool reserve);
+	OpResult split(int a, int b, int slot, int part);
+	OpResult collapse(int a, int b, int part);
+	OpResult flip(int a, int b, int part);
+	void smooth();
+	void project();
+	void compact();
+	void writeBack(CMeshO& m, bool released) const;
+
+	bool    ring(int v, Ring& r) const;
+	bool    reachable(int part, const Ring& r) const;
+	int     findHalfEdge(const Ring& ra, int b) const;
+	bool    editable(int h) const;
+	void    linkTwin(int h, int t, unsigned char feature);
+	Point3m faceNormal(int f) const;
+	Point3m movedNormal(int f, int v, const Point3m& p) const;
+	bool    farFromSurface(const Point3m& p) const;
+
+	Params  par;
+	Scalarm minLen;
+	Scalarm maxLen;
+	Stats   stats;
+
+	meshlab::FaceBVH bvh; // the input surface
+
+	// vertices
+	std::vector<Point3m>       pos;
+	std::vector<unsigned char> vFlag;
+	std::vector<int>           vOut;  // an outgoing half edge
+	std::vector<int>           vSrc;  // input vertex whose attributes are inherited
+	std::vector<int>           vHint; // BVH triangle of the last projection
+	std::vector<int>           vPart;
+
+	// faces: the half edge 3*f+k goes from fv[3*f+k] to fv[3*f+(k+1)%3]
+	std::vector<int>           fv; // -1 for the deleted faces
+	std::vector<int>           twin;
+	std::vector<unsigned char> hFeature; // EdgeFlag, on both half edges
+	std::vector<int>           fSrc;
+	std::vector<unsigned char> fSel;
+
+	// partitions
+	std::vector<vcg::Point3i> partCoord;
+	std::vector<int>          roundBegin; // partitions sorted by round
+	std::vector<int>          roundPart;
+
+	// first vertex and face reserved for the splits of the current pass
+	int slotVertBase = 0;
+	int slotFaceBase = 0;
+};
+
+#endif // FILTER_MESHING_PARALLEL_ISOTROPIC_REMESHING_H
@@ -0,0 +1,295 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "parallel_subdivision.h"
+
+#include <vcg/complex/allocate.h>
+
+using namespace vcg;
+
+namespace {
+
+// Sub faces of a triangle, as in vcg::tri::RefineE. The labels 0..2 are the
+// vertices of the triangle, 3..5 the new vertices on its edges 0..2; the
+// pattern is indexed by the split edges (1: edge 0, 2: edge 1, 4: edge 2).
+// When three sub faces are made, the quad left by the corner is split along
+// its shorter diagonal: if swap[0] is shorter than swap[1] the last two sub
+// faces are swapped.
+struct SplitPattern
+{
+	int triNum;
+	int tv[4][3];
+	int swap[2][2];
+};
+
+const SplitPattern SPLIT[8] = {
+	{1, {{0, 1, 2}, {0, 0, 0}, {0, 0, 0}, {0, 0, 0}}, {{0, 0}, {0, 0}}},
+	{2, {{0, 3, 2}, {3, 1, 2}, {0, 0, 0}, {0, 0, 0}}, {{0, 0}, {0, 0}}},
+	{2, {{0, 1, 4}, {0, 4, 2}, {0, 0, 0}, {0, 0, 0}}, {{0, 0}, {0, 0}}},
+	{3, {{3, 1, 4}, {0, 3, 2}, {4, 2, 3}, {0, 0, 0}}, {{0, 4}, {3, 2}}},
+	{2, {{0, 1, 5}, {5, 1, 2}, {0, 0, 0}, {0, 0, 0}}, {{0, 0}, {0, 0}}},
+	{3, {{0, 3, 5}, {3, 1, 5}, {2, 5, 1}, {0, 0, 0}}, {{3, 2}, {5, 1}}},
+	{3, {{2, 5, 4}, {0, 1, 5}, {4, 5, 1}, {0, 0, 0}}, {{0, 4}, {1, 5}}},
+	{4, {{3, 4, 5}, {0, 3, 5}, {3, 1, 4}, {5, 4, 2}}, {{0, 0}, {0, 0}}},
+};
+
+// edge of the triangle a sub face edge lies on, -1 if it is inside the triangle
+inline int originalEdge(int a, int b, int ind)
+{
+	for (int k = 0; k < 3; ++k) {
+		const int k1 = (k + 1) % 3;
+		const int mk = (ind & (1 << k)) ? 3 + k : -1;
+		const bool aOn = a == k || a == k1 || a == mk;
+		const bool bOn = b == k || b == k1 || b == mk;
+		if (aOn && bOn)
+			return k;
+	}
+	return -1;
+}
+
+} // namespace
+
+ParallelSubdivision::ParallelSubdivision(CMeshO& m, bool selected) :
+		m(m), selected(selected)
+{
+	vn0 = int(m.vert.size());
+	fn0 = int(m.face.size());
+
+	ffp.resize(3 * size_t(fn0));
+	ffi.resize(3 * size_t(fn0));
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		const CFaceO& fc = m.face[f];
+		for (int k = 0; k < 3; ++k) {
+			const CFaceO* g = fc.cFFp(k);
+			const bool border = g == nullptr || g == &fc;
+			ffp[3 * f + k] = border ? f : int(tri::Index(m, g));
+			ffi[3 * f + k] = border ? char(k) : char(fc.cFFi(k));
+		}
+	}
+}
+
+// The edge of two refinable faces belongs to the first one, as in the face
+// scan of vcg; the new vertices are numbered in the same order.
+int ParallelSubdivision::markEdges(Scalarm threshold)
+{
+	const Scalarm sqThr = threshold * threshold;
+	edgeVert.assign(3 * size_t(fn0), -1);
+	std::vector<int> vertBase(fn0 + 1, 0);
+
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		if (!refinable(f))
+			continue;
+		const CFaceO& fc = m.face[f];
+		int n = 0;
+		for (int k = 0; k < 3; ++k) {
+			const int g = ffp[3 * f + k];
+			if (g < f && refinable(g))
+				continue;
+			// the predicate of vcg::tri::Refine
+			if (SquaredDistance(fc.cP(k), fc.cP((k + 1) % 3)) > sqThr) {
+				edgeVert[3 * f + k] = n;
+				++n;
+			}
+		}
+		vertBase[f + 1] = n;
+	}
+	for (int f = 0; f < fn0; ++f)
+		vertBase[f + 1] += vertBase[f];
+
+	const int newVertNum = vertBase[fn0];
+	vertCorner.resize(newVertNum);
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		for (int k = 0; k < 3; ++k) {
+			int& ev = edgeVert[3 * f + k];
+			if (ev >= 0) {
+				vertCorner[vertBase[f] + ev] = 3 * f + k;
+				ev += vn0 + vertBase[f];
+			}
+		}
+	}
+
+	// the other face of a split edge gets its vertex too, refinable or not;
+	// it only reads the corners written by the owners above
+	faceBase.assign(fn0 + 1, 0);
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		int n = 0;
+		for (int k = 0; k < 3; ++k) {
+			const int c = 3 * f + k;
+			const int g = ffp[c];
+			if (g != f && edgeVert[c] < 0 && (g < f ? refinable(g) : !refinable(f)))
+				edgeVert[c] = edgeVert[3 * g + ffi[c]];
+			if (edgeVert[c] >= 0)
+				++n;
+		}
+		faceBase[f + 1] = n;
+	}
+	for (int f = 0; f < fn0; ++f)
+		faceBase[f + 1] += faceBase[f];
+
+	return newVertNum;
+}
+
+// first corner, in face order, of every vertex of the refinable faces: the
+// even vertices are computed starting from it, as in vcg
+void ParallelSubdivision::findEvenCorners()
+{
+	evenCorner.assign(vn0, -1);
+	for (int f = 0; f < fn0; ++f) {
+		if (!refinable(f))
+			continue;
+		for (int k = 0; k < 3; ++k) {
+			int& c = evenCorner[tri::Index(m, m.face[f].cV(k))];
+			if (c < 0)
+				c = 3 * f + k;
+		}
+	}
+}
+
+void ParallelSubdivision::allocate()
+{
+	tri::Allocator<CMeshO>::AddVertices(m, vertCorner.size());
+	tri::Allocator<CMeshO>::AddFaces(m, faceBase[fn0]);
+}
+
+void ParallelSubdivision::splitFaces()
+{
+	const bool wedgeTex = tri::HasPerWedgeTexCoord(m);
+	coverFace.resize(6 * size_t(fn0));
+	coverEdge.resize(6 * size_t(fn0));
+
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		CFaceO& fc = m.face[f];
+		CVertexO* vv[6];
+		TexCoordType wt[6];
+		int ind = 0;
+		for (int k = 0; k < 3; ++k) {
+			const int ev = edgeVert[3 * f + k];
+			vv[k] = fc.V(k);
+			vv[3 + k] = ev >= 0 ? &m.vert[ev] : nullptr;
+			if (ev >= 0)
+				ind |= 1 << k;
+			if (wedgeTex) {
+				wt[k] = fc.WT(k);
+				if (ev >= 0)
+					wt[3 + k] = wedgeMid[3 * f + k];
+			}
+		}
+
+		// labels and indices of the sub faces, the first one replaces f
+		const SplitPattern& sp = SPLIT[ind];
+		const int triNum = sp.triNum;
+		int tv[4][3];
+		int sub[4];
+		for (int i = 0; i < triNum; ++i) {
+			for (int j = 0; j < 3; ++j)
+				tv[i][j] = sp.tv[i][j];
+			sub[i] = i == 0 ? f : fn0 + faceBase[f] + i - 1;
+		}
+		if (triNum == 3 &&
+				SquaredDistance(vv[sp.swap[0][0]]->cP(), vv[sp.swap[0][1]]->cP()) <
+				SquaredDistance(vv[sp.swap[1][0]]->cP(), vv[sp.swap[1][1]]->cP())) {
+			tv[2][1] = tv[1][0];
+			tv[1][1] = tv[2][0];
+		}
+
+		const int orgFlags = fc.Flags();
+		for (int i = 1; i < triNum; ++i) {
+			CFaceO& nf = m.face[sub[i]];
+			if (selected || fc.IsS())
+				nf.SetS();
+			nf.ImportData(fc);
+		}
+
+		for (int i = 0; i < triNum; ++i) {
+			CFaceO& nf = m.face[sub[i]];
+			for (int j = 0; j < 3; ++j) {
+				const int a = tv[i][j];
+				const int b = tv[i][(j + 1) % 3];
+				nf.V(j) = vv[a];
+				if (wedgeTex)
+					nf.WT(j) = wt[a];
+
+				const int k = originalEdge(a, b, ind);
+				if (k < 0) {
+					nf.ClearB(j);
+					// the twin edge is in another sub face of the same triangle
+					for (int i2 = 0; i2 < triNum; ++i2) {
+						for (int j2 = 0; j2 < 3; ++j2) {
+							if (tv[i2][j2] == b && tv[i2][(j2 + 1) % 3] == a) {
+								nf.FFp(j) = &m.face[sub[i2]];
+								nf.FFi(j) = j2;
+							}
+						}
+					}
+					continue;
+				}
+				if (orgFlags & (CFaceO::BORDER0 << k))
+					nf.SetB(j);
+				else
+					nf.ClearB(j);
+
+				const size_t c = 2 * (3 * size_t(f) + k);
+				const bool full = (ind & (1 << k)) == 0;
+				if (full || a == k || b == k) {
+					coverFace[c] = sub[i];
+					coverEdge[c] = char(j);
+				}
+				if (full || a == (k + 1) % 3 || b == (k + 1) % 3) {
+					coverFace[c + 1] = sub[i];
+					coverEdge[c + 1] = char(j);
+				}
+			}
+		}
+	}
+
+	// the edges on the sides of the triangles: the half h of an edge is the
+	// half 1-h of its twin, that runs the other way
+	#pragma omp parallel for schedule(static)
+	for (int f = 0; f < fn0; ++f) {
+		for (int k = 0; k < 3; ++k) {
+			const int c = 3 * f + k;
+			const int g = ffp[c];
+			for (int h = 0; h < 2; ++h) {
+				CFaceO& nf = m.face[coverFace[2 * c + h]];
+				const int j = coverEdge[2 * c + h];
+				if (g == f) {
+					nf.FFp(j) = &nf;
+					nf.FFi(j) = j;
+				}
+				else {
+					const int gc = 2 * (3 * g + ffi[c]) + 1 - h;
+					nf.FFp(j) = &m.face[coverFace[gc]];
+					nf.FFi(j) = coverEdge[gc];
+				}
+			}
+		}
+	}
+	coverFace.clear();
+	coverEdge.clear();
+}
@@ -0,0 +1,228 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_MESHING_PARALLEL_SUBDIVISION_H
+#define FILTER_MESHING_PARALLEL_SUBDIVISION_H
+
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/*
+Edge split refinement with the same interface and results of vcg::tri::Refine
+and vcg::tri::RefineOddEven, i.e. the same new vertex functors (midpoint,
+butterfly, Loop and LS3 odd/even points) are used, but evaluated in parallel.
+
+A table of the edges to split is built first (every edge belongs to the first
+of its faces that can be refined, and is split if longer than the threshold),
+so that the number of new vertices and faces is known and they are allocated
+at once, in the same order of vcg. Then the odd vertices are computed in
+parallel over the split edges, the even ones in parallel over the vertices,
+and every face writes its sub faces and their FF adjacency directly, without
+rebuilding the topology of the whole mesh.
+
+The mesh must be compact, with FF adjacency and no non manifold edges.
+*/
+class ParallelSubdivision
+{
+public:
+	// as vcg::tri::Refine: splits the edges longer than threshold, placing the
+	// new vertices with mid
+	template <class MidPoint>
+	static bool refine(
+		CMeshO&           m,
+		MidPoint          mid,
+		Scalarm           threshold,
+		bool              selected = false,
+		vcg::CallBackPos* cb       = nullptr);
+
+	// as vcg::tri::RefineOddEven: the odd vertices are placed with odd, and
+	// the vertices of the refined faces are moved with even
+	template <class OddPoint, class EvenPoint>
+	static bool refineOddEven(
+		CMeshO&           m,
+		OddPoint          odd,
+		EvenPoint         even,
+		Scalarm           threshold,
+		bool              selected = false,
+		vcg::CallBackPos* cb       = nullptr);
+
+private:
+	typedef CMeshO::FaceType::TexCoordType TexCoordType;
+
+	ParallelSubdivision(CMeshO& m, bool selected);
+
+	int  markEdges(Scalarm threshold);
+	void findEvenCorners();
+	void allocate();
+	void splitFaces();
+
+	template <class MidPoint>
+	bool split(MidPoint& mid, Scalarm threshold, vcg::CallBackPos* cb);
+
+	template <class T>
+	static CMeshO::PerVertexAttributeHandle<T>
+	addValence(CMeshO& m, CMeshO::PerVertexAttributeHandle<T>*)
+	{
+		return vcg::tri::Allocator<CMeshO>::template AddPerVertexAttribute<T>(m);
+	}
+
+	bool refinable(int f) const { return !selected || m.face[f].IsS(); }
+
+	CMeshO& m;
+	bool    selected;
+	int     vn0; // vertices and faces before the refinement
+	int     fn0;
+
+	// FF adjacency before the refinement, f itself on the border
+	std::vector<int>  ffp;
+	std::vector<char> ffi;
+
+	std::vector<int> edgeVert;    // corner 3*f+k -> new vertex on the edge k of f, -1 if not split
+	std::vector<int> vertCorner;  // new vertex - vn0 -> corner of the face its edge belongs to
+	std::vector<int> faceBase;    // f -> its first new face - fn0
+	std::vector<int> evenCorner;  // vertex -> first corner of a refined face on it, -1 if none
+
+	std::vector<TexCoordType> wedgeMid; // interpolated wedge texcoords of the split edges
+
+	// (corner 3*f+k)*2+h -> sub face (and its edge) covering the half h of the
+	// edge k of f; the half 0 is the one starting from V(k)
+	std::vector<int>  coverFace;
+	std::vector<char> coverEdge;
+};
+
+template <class MidPoint>
+bool ParallelSubdivision::split(MidPoint& mid, Scalarm threshold, vcg::CallBackPos* cb)
+{
+	const int newVertNum = markEdges(threshold);
+	if (newVertNum == 0)
+		return false;
+	if (cb)
+		cb(20, "Refining...");
+
+	allocate();
+
+	#pragma omp parallel
+	{
+		MidPoint localMid = mid;
+		#pragma omp for schedule(static)
+		for (int i = 0; i < newVertNum; ++i) {
+			const int c = vertCorner[i];
+			localMid(m.vert[vn0 + i], vcg::face::Pos<CFaceO>(&m.face[c / 3], c % 3));
+		}
+
+		if (vcg::tri::HasPerWedgeTexCoord(m)) {
+			#pragma omp single
+			wedgeMid.resize(3 * size_t(fn0));
+
+			#pragma omp for schedule(static)
+			for (int c = 0; c < 3 * fn0; ++c) {
+				if (edgeVert[c] >= 0) {
+					const CFaceO& f = m.face[c / 3];
+					wedgeMid[c] = localMid.WedgeInterp(f.cWT(c % 3), f.cWT((c + 1) % 3));
+				}
+			}
+		}
+	}
+	if (cb)
+		cb(60, "Refining...");
+
+	splitFaces();
+	wedgeMid.clear();
+	return true;
+}
+
+template <class MidPoint>
+bool ParallelSubdivision::refine(
+	CMeshO&           m,
+	MidPoint          mid,
+	Scalarm           threshold,
+	bool              selected,
+	vcg::CallBackPos* cb)
+{
+	ParallelSubdivision s(m, selected);
+	return s.split(mid, threshold, cb);
+}
+
+template <class OddPoint, class EvenPoint>
+bool ParallelSubdivision::refineOddEven(
+	CMeshO&           m,
+	OddPoint          odd,
+	EvenPoint         even,
+	Scalarm           threshold,
+	bool              selected,
+	vcg::CallBackPos* cb)
+{
+	ParallelSubdivision s(m, selected);
+	s.findEvenCorners();
+
+	auto valence = addValence(m, odd.valence);
+	odd.valence  = &valence;
+	even.valence = &valence;
+
+	// as vcg, the valence is the number of incident faces when VF is available
+	const bool vf = vcg::tri::HasVFAdjacency(m);
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < s.vn0; ++v) {
+		const int c = s.evenCorner[v];
+		if (c < 0)
+			continue;
+		if (vf) {
+			int n = 0;
+			for (vcg::face::VFIterator<CFaceO> vfi(&m.vert[v]); !vfi.End(); ++vfi)
+				++n;
+			valence[v] = n;
+		}
+		else {
+			vcg::face::Pos<CFaceO> p(&m.face[c / 3], c % 3);
+			valence[v] = p.NumberOfIncidentVertices();
+		}
+	}
+
+	// the even vertices are computed on the mesh before the refinement, and
+	// applied after the odd ones
+	std::vector<CVertexO> newEven(s.vn0);
+	#pragma omp parallel
+	{
+		EvenPoint localEven = even;
+		#pragma omp for schedule(static)
+		for (int v = 0; v < s.vn0; ++v) {
+			const int c = s.evenCorner[v];
+			if (c >= 0)
+				localEven(newEven[v], vcg::face::Pos<CFaceO>(&m.face[c / 3], c % 3));
+		}
+	}
+
+	const bool refined = s.split(odd, threshold, cb);
+
+	#pragma omp parallel for schedule(static)
+	for (int v = 0; v < s.vn0; ++v) {
+		if (s.evenCorner[v] >= 0)
+			m.vert[v].ImportData(newEven[v]);
+	}
+	vcg::tri::Allocator<CMeshO>::DeletePerVertexAttribute(m, valence);
+	return refined;
+}
+
+#endif // FILTER_MESHING_PARALLEL_SUBDIVISION_H
@@ -0,0 +1,639 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "streaming_clustering.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+
+#include <QFile>
+
+#include <common/mlexception.h>
+#include <vcg/complex/allocate.h>
+#include <vcg/math/quadric.h>
+#include <vcg/space/plane3.h>
+
+using namespace vcg;
+
+namespace {
+
+// lanes a chunk of faces is split into, and shards the cells are split into;
+// fixed, so that the sums of the cells and the orientation of the output
+// triangles (the first one seen, in lane order) do not depend on the number of
+// threads
+const int LANE_NUM = 16;
+// cell coordinates beyond this are rejected, to keep them in an int
+const double MAX_CELL_COORD = 1e9;
+// size of the header and of a triangle of a binary STL
+const long long STL_HEADER = 84;
+const long long STL_RECORD = 50;
+
+enum PlyType { INT8, UINT8, INT16, UINT16, INT32, UINT32, FLOAT32, FLOAT64, NO_TYPE };
+
+const int PLY_TYPE_SIZE[] = {1, 1, 2, 2, 4, 4, 4, 8};
+
+PlyType plyType(const std::string& name)
+{
+	if (name == "char" || name == "int8")
+		return INT8;
+	if (name == "uchar" || name == "uint8")
+		return UINT8;
+	if (name == "short" || name == "int16")
+		return INT16;
+	if (name == "ushort" || name == "uint16")
+		return UINT16;
+	if (name == "int" || name == "int32")
+		return INT32;
+	if (name == "uint" || name == "uint32")
+		return UINT32;
+	if (name == "float" || name == "float32")
+		return FLOAT32;
+	if (name == "double" || name == "float64")
+		return FLOAT64;
+	throw MLException("Unknown PLY property type: " + QString::fromStdString(name));
+}
+
+template <class T>
+inline T load(const char* p, bool swapBytes)
+{
+	char b[sizeof(T)];
+	if (swapBytes)
+		std::reverse_copy(p, p + sizeof(T), b);
+	else
+		std::memcpy(b, p, sizeof(T));
+	T v;
+	std::memcpy(&v, b, sizeof(T));
+	return v;
+}
+
+double loadScalar(const char* p, int type, bool swapBytes)
+{
+	switch (type) {
+	case INT8: return load<int8_t>(p, swapBytes);
+	case UINT8: return load<uint8_t>(p, swapBytes);
+	case INT16: return load<int16_t>(p, swapBytes);
+	case UINT16: return load<uint16_t>(p, swapBytes);
+	case INT32: return load<int32_t>(p, swapBytes);
+	case UINT32: return load<uint32_t>(p, swapBytes);
+	case FLOAT32: return load<float>(p, swapBytes);
+	default: return load<double>(p, swapBytes);
+	}
+}
+
+struct CellHash
+{
+	size_t operator()(const Point3i& c) const
+	{
+		return size_t(c[0]) * 73856093u ^ size_t(c[1]) * 19349663u ^ size_t(c[2]) * 83492791u;
+	}
+};
+
+// the shard of a cell, from the top bits of its (fibonacci) mixed hash: they
+// do not depend only on the low bits used by the buckets of the hash maps
+inline int shardOf(const Point3i& c)
+{
+	const uint64_t h = uint64_t(CellHash()(c)) * 0x9E3779B97F4A7C15ull;
+	return int(h >> 60) % LANE_NUM;
+}
+
+// the cells of a triangle, sorted: the orientation of the triangle is kept
+// apart, so that the two sides of a thin part give a single face as in vcg
+struct TriKey
+{
+	Point3i v[3];
+
+	bool operator==(const TriKey& t) const
+	{
+		return v[0] == t.v[0] && v[1] == t.v[1] && v[2] == t.v[2];
+	}
+	bool operator<(const TriKey& t) const
+	{
+		if (!(v[0] == t.v[0]))
+			return v[0] < t.v[0];
+		if (!(v[1] == t.v[1]))
+			return v[1] < t.v[1];
+		return v[2] < t.v[2];
+	}
+};
+
+struct TriHash
+{
+	size_t operator()(const TriKey& t) const
+	{
+		CellHash h;
+		return h(t.v[0]) ^ (h(t.v[1]) * 31u) ^ (h(t.v[2]) * 961u);
+	}
+};
+
+inline bool isFinite(const Point3d& p)
+{
+	return std::fabs(p[0]) < HUGE_VAL && std::fabs(p[1]) < HUGE_VAL && std::fabs(p[2]) < HUGE_VAL;
+}
+
+} // namespace
+
+struct StreamingClustering::Property
+{
+	std::string name;
+	int         type;
+	int         countType; // NO_TYPE if it is not a list
+};
+
+struct StreamingClustering::Cell
+{
+	Point3d               sum;
+	long long             n;
+	math::Quadric<double> q;
+
+	Cell() : sum(0, 0, 0), n(0) { q.SetZero(); }
+};
+
+// the cells having hash % LANE_NUM == shard, and the triangles whose first
+// cell is in the shard
+struct StreamingClustering::Shard
+{
+	std::unordered_map<Point3i, Cell, CellHash> cells;
+	std::unordered_map<TriKey, bool, TriHash>   tris; // cells -> flipped
+};
+
+// the cells and triangles of the current chunk seen by a lane, by shard
+struct StreamingClustering::Lane
+{
+	std::vector<Shard> shards;
+	long long          triNum = 0;
+	bool               badIndex = false;
+
+	Lane() : shards(LANE_NUM) {}
+};
+
+
+StreamingClustering::StreamingClustering(const char* data, long long size, const Params& params) :
+		data(data),
+		size(size),
+		par(params),
+		cellSize(params.cellSize),
+		ply(false),
+		swapBytes(false),
+		vertNum(0),
+		vertStart(0),
+		vertStride(0),
+		faceNum(0),
+		faceStart(0),
+		indexProp(-1)
+{
+	for (int k = 0; k < 3; ++k) {
+		coordOffset[k] = 0;
+		coordType[k] = FLOAT32;
+	}
+}
+
+void StreamingClustering::parseHeader()
+{
+	if (size >= 4 && std::strncmp(data, "ply", 3) == 0 && (data[3] == '\n' || data[3] == '\r')) {
+		ply = true;
+		parsePlyHeader();
+		return;
+	}
+
+	// binary STL: an 80 bytes header, the number of triangles and 50 bytes each
+	if (size < STL_HEADER)
+		throw MLException("The file is neither a PLY nor a binary STL");
+	faceNum = load<uint32_t>(data + 80, false);
+	faceStart = STL_HEADER;
+	if (STL_HEADER + faceNum * STL_RECORD != size)
+		throw MLException("The file is neither a PLY nor a binary STL (ASCII STL files cannot be streamed)");
+}
+
+void StreamingClustering::parsePlyHeader()
+{
+	const char* end = nullptr;
+	const char* tag = "end_header";
+	for (const char* p = data; p + 10 <= data + size; ++p) {
+		if (std::strncmp(p, tag, 10) == 0) {
+			end = p + 10;
+			break;
+		}
+	}
+	if (end == nullptr)
+		throw MLException("Missing end of the PLY header");
+	while (end < data + size && *end != '\n')
+		++end;
+	long long pos = end + 1 - data;
+
+	struct Element
+	{
+		std::string           name;
+		long long             count;
+		std::vector<Property> props;
+	};
+	std::vector<Element> elements;
+
+	std::istringstream header(std::string(data, end));
+	std::string line;
+	while (std::getline(header, line)) {
+		std::istringstream ls(line);
+		std::string key;
+		ls >> key;
+		if (key == "format") {
+			std::string format;
+			ls >> format;
+			if (format == "binary_big_endian")
+				swapBytes = true;
+			else if (format != "binary_little_endian")
+				throw MLException("Only binary PLY files can be streamed");
+		}
+		else if (key == "element") {
+			Element e;
+			ls >> e.name >> e.count;
+			elements.push_back(e);
+		}
+		else if (key == "property" && !elements.empty()) {
+			Property p;
+			std::string type;
+			ls >> type;
+			if (type == "list") {
+				std::string countType;
+				ls >> countType >> type;
+				p.countType = plyType(countType);
+			}
+			else {
+				p.countType = NO_TYPE;
+			}
+			p.type = plyType(type);
+			ls >> p.name;
+			elements.back().props.push_back(p);
+		}
+	}
+
+	// the elements before the faces must have a fixed size, to find where
+	// the vertices and the faces start
+	bool vertFound = false;
+	for (const Element& e : elements) {
+		if (e.name == "face") {
+			faceNum = e.count;
+			faceStart = pos;
+			faceProps = e.props;
+			for (size_t i = 0; i < faceProps.size(); ++i) {
+				const std::string& name = faceProps[i].name;
+				if (faceProps[i].countType != NO_TYPE && (name == "vertex_indices" || name == "vertex_index"))
+					indexProp = int(i);
+			}
+			break;
+		}
+
+		int stride = 0;
+		for (const Property& p : e.props) {
+			if (p.countType != NO_TYPE)
+				throw MLException("PLY element '" + QString::fromStdString(e.name) + "' with list properties before the faces");
+			stride += PLY_TYPE_SIZE[p.type];
+		}
+		if (e.name == "vertex") {
+			vertFound = true;
+			vertNum = e.count;
+			vertStart = pos;
+			vertStride = stride;
+			const char* coords[3] = {"x", "y", "z"};
+			for (int k = 0; k < 3; ++k) {
+				int offset = 0;
+				coordOffset[k] = -1;
+				for (const Property& p : e.props) {
+					if (p.name == coords[k]) {
+						coordOffset[k] = offset;
+						coordType[k] = p.type;
+					}
+					offset += PLY_TYPE_SIZE[p.type];
+				}
+				if (coordOffset[k] < 0)
+					throw MLException("PLY vertices without coordinates");
+			}
+		}
+		pos += e.count * stride;
+	}
+	if (!vertFound || indexProp < 0)
+		throw MLException("The PLY file has no vertices or no faces");
+	if (vertStart + vertNum * vertStride > size)
+		throw MLException("Truncated PLY file");
+}
+
+Point3d StreamingClustering::vertex(long long i) const
+{
+	if (!ply) {
+		const char* p = data + faceStart + (i / 3) * STL_RECORD + 12 + (i % 3) * 12;
+		return Point3d(load<float>(p, false), load<float>(p + 4, false), load<float>(p + 8, false));
+	}
+	const char* p = data + vertStart + i * vertStride;
+	return Point3d(
+		loadScalar(p + coordOffset[0], coordType[0], swapBytes),
+		loadScalar(p + coordOffset[1], coordType[1], swapBytes),
+		loadScalar(p + coordOffset[2], coordType[2], swapBytes));
+}
+
+// when the cell size is not given, the bbox is found reading the vertices of a
+// PLY (or the triangles of a STL) once
+void StreamingClustering::findCellSize()
+{
+	if (cellSize > 0)
+		return;
+
+	const long long n = ply ? vertNum : 3 * faceNum;
+	std::vector<Box3d> boxes(LANE_NUM);
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int l = 0; l < LANE_NUM; ++l) {
+		for (long long i = n * l / LANE_NUM; i < n * (l + 1) / LANE_NUM; ++i) {
+			const Point3d p = vertex(i);
+			if (isFinite(p))
+				boxes[l].Add(p);
+		}
+	}
+	Box3d box;
+	for (const Box3d& b : boxes)
+		box.Add(b);
+	if (box.IsNull() || box.Diag() == 0)
+		throw MLException("Empty mesh");
+	cellSize = box.Diag() * 0.01;
+}
+
+// offsets of the PLY faces first..last-1 starting at pos, followed by the
+// offset of the next chunk
+void StreamingClustering::scanFaces(long long first, long long last, long long pos, std::vector<long long>& offsets) const
+{
+	offsets.resize(last - first + 1);
+	for (long long f = first; f < last; ++f) {
+		offsets[f - first] = pos;
+		for (const Property& p : faceProps) {
+			if (p.countType == NO_TYPE) {
+				pos += PLY_TYPE_SIZE[p.type];
+				continue;
+			}
+			if (pos + PLY_TYPE_SIZE[p.countType] > size)
+				throw MLException("Truncated PLY file");
+			const long long n = (long long) loadScalar(data + pos, p.countType, swapBytes);
+			pos += PLY_TYPE_SIZE[p.countType] + n * PLY_TYPE_SIZE[p.type];
+		}
+		if (pos > size)
+			throw MLException("Truncated PLY file");
+	}
+	offsets[last - first] = pos;
+}
+
+void StreamingClustering::accumulate(Lane& l, long long first, long long last, const long long* offsets) const
+{
+	Point3d p[3];
+	if (!ply) {
+		for (long long f = first; f < last; ++f) {
+			for (int k = 0; k < 3; ++k)
+				p[k] = vertex(3 * f + k);
+			addTriangle(l, p);
+		}
+		return;
+	}
+
+	for (long long f = first; f < last; ++f) {
+		const char* pos = data + offsets[f - first];
+		for (int i = 0; i < indexProp; ++i)
+			pos += faceProps[i].countType == NO_TYPE ?
+				PLY_TYPE_SIZE[faceProps[i].type] :
+				PLY_TYPE_SIZE[faceProps[i].countType] +
+					(long long) loadScalar(pos, faceProps[i].countType, swapBytes) * PLY_TYPE_SIZE[faceProps[i].type];
+
+		const Property& ip = faceProps[indexProp];
+		const int n = int(loadScalar(pos, ip.countType, swapBytes));
+		pos += PLY_TYPE_SIZE[ip.countType];
+
+		// polygons are split in a fan
+		for (int j = 0; j < n; ++j) {
+			const long long v = (long long) loadScalar(pos + j * PLY_TYPE_SIZE[ip.type], ip.type, swapBytes);
+			if (v < 0 || v >= vertNum) {
+				l.badIndex = true;
+				break;
+			}
+			p[std::min(j, 2)] = vertex(v);
+			if (j >= 2) {
+				addTriangle(l, p);
+				p[1] = p[2];
+			}
+		}
+	}
+}
+
+void StreamingClustering::addTriangle(Lane& l, const Point3d p[3]) const
+{
+	if (!isFinite(p[0]) || !isFinite(p[1]) || !isFinite(p[2]))
+		return;
+	++l.triNum;
+
+	TriKey t;
+	for (int k = 0; k < 3; ++k) {
+		for (int i = 0; i < 3; ++i) {
+			const double c = std::floor(p[k][i] / cellSize);
+			if (std::fabs(c) > MAX_CELL_COORD) {
+				l.badIndex = true;
+				return;
+			}
+			t.v[k][i] = int(c);
+		}
+	}
+
+	// every corner adds its position, and the plane of the triangle
+	// weighted by its area, to its cell
+	math::Quadric<double> q;
+	const Point3d n = (p[1] - p[0]) ^ (p[2] - p[0]);
+	const double area = n.Norm() / 2;
+	if (par.representative == QUADRIC && area > 0) {
+		Plane3d plane;
+		plane.SetDirection(n);
+		plane.SetOffset(plane.Direction() * p[0]);
+		q.ByPlane(plane);
+		q *= area;
+	}
+	for (int k = 0; k < 3; ++k) {
+		Cell& c = l.shards[shardOf(t.v[k])].cells[t.v[k]];
+		c.sum += p[k];
+		++c.n;
+		if (par.representative == QUADRIC && area > 0)
+			c.q += q;
+	}
+
+	if (t.v[0] == t.v[1] || t.v[1] == t.v[2] || t.v[2] == t.v[0])
+		return;
+	// each swap of the sort flips the orientation
+	bool flipped = false;
+	for (int i = 0; i < 2; ++i) {
+		for (int j = 0; j < 2 - i; ++j) {
+			if (t.v[j + 1] < t.v[j]) {
+				std::swap(t.v[j], t.v[j + 1]);
+				flipped = !flipped;
+			}
+		}
+	}
+	l.shards[shardOf(t.v[0])].tris.insert(std::make_pair(t, flipped));
+}
+
+// the cells and triangles of the chunk are moved from the lanes to the grid,
+// in lane order; the shards are disjoint, so they are merged in parallel, and
+// the lanes keep only the cells of a single chunk
+void StreamingClustering::merge(std::vector<Lane>& lanes, std::vector<Shard>& grid) const
+{
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int s = 0; s < LANE_NUM; ++s) {
+		Shard& g = grid[s];
+		for (Lane& l : lanes) {
+			Shard& ls = l.shards[s];
+			for (const auto& c : ls.cells) {
+				Cell& gc = g.cells[c.first];
+				gc.sum += c.second.sum;
+				gc.n += c.second.n;
+				gc.q += c.second.q;
+			}
+			ls.cells.clear();
+			for (const auto& t : ls.tris)
+				g.tris.insert(t);
+			ls.tris.clear();
+		}
+	}
+}
+
+void StreamingClustering::extractMesh(std::vector<Shard>& grid, CMeshO& m) const
+{
+	// sorted, so that the result does not depend on the number of threads
+	std::vector<std::pair<Point3i, Cell>> cells;
+	std::vector<std::pair<TriKey, bool>> tris;
+	for (Shard& g : grid) {
+		cells.insert(cells.end(), g.cells.begin(), g.cells.end());
+		g.cells = std::unordered_map<Point3i, Cell, CellHash>();
+		tris.insert(tris.end(), g.tris.begin(), g.tris.end());
+		g.tris = std::unordered_map<TriKey, bool, TriHash>();
+	}
+	std::sort(cells.begin(), cells.end(),
+		[](const std::pair<Point3i, Cell>& a, const std::pair<Point3i, Cell>& b) {
+			return a.first < b.first;
+		});
+	std::sort(tris.begin(), tris.end(),
+		[](const std::pair<TriKey, bool>& a, const std::pair<TriKey, bool>& b) {
+			return a.first < b.first;
+		});
+
+	m.Clear();
+	tri::Allocator<CMeshO>::AddVertices(m, cells.size());
+	tri::Allocator<CMeshO>::AddFaces(m, tris.size());
+
+	const int cellNum = int(cells.size());
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < cellNum; ++i) {
+		Cell& c = cells[i].second;
+		Point3d p = c.sum / double(c.n);
+		if (par.representative == QUADRIC) {
+			// the minimum is kept only if it is in the cell, otherwise the
+			// quadric is nearly singular (a flat or creased cell)
+			Point3d x;
+			if (c.q.Minimum(x)) {
+				bool inside = true;
+				for (int k = 0; k < 3; ++k) {
+					const double lo = cells[i].first[k] * cellSize;
+					inside = inside && x[k] >= lo && x[k] <= lo + cellSize;
+				}
+				if (inside)
+					p = x;
+			}
+		}
+		m.vert[i].P() = Point3m::Construct(p);
+	}
+
+	const int triNum = int(tris.size());
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < triNum; ++i) {
+		const TriKey& t = tris[i].first;
+		int v[3];
+		for (int k = 0; k < 3; ++k) {
+			const auto it = std::lower_bound(cells.begin(), cells.end(), t.v[k],
+				[](const std::pair<Point3i, Cell>& c, const Point3i& key) {
+					return c.first < key;
+				});
+			v[k] = int(it - cells.begin());
+		}
+		if (tris[i].second)
+			std::swap(v[1], v[2]);
+		for (int k = 0; k < 3; ++k)
+			m.face[i].V(k) = &m.vert[v[k]];
+	}
+}
+
+long long StreamingClustering::extract(
+	const QString&    fileName,
+	CMeshO&           m,
+	const Params&     params,
+	vcg::CallBackPos* cb)
+{
+	QFile file(fileName);
+	if (!file.open(QIODevice::ReadOnly))
+		throw MLException("Cannot open " + fileName);
+	const long long size = file.size();
+	const uchar* map = file.map(0, size);
+	if (map == nullptr)
+		throw MLException("Cannot map " + fileName + " in memory");
+
+	StreamingClustering s(reinterpret_cast<const char*>(map), size, params);
+	s.parseHeader();
+	if (cb)
+		cb(0, "Streaming clustering: finding the cell size");
+	s.findCellSize();
+
+	std::vector<Lane> lanes(LANE_NUM);
+	std::vector<Shard> grid(LANE_NUM);
+	std::vector<long long> offsets(1, s.faceStart);
+	const long long chunkSize = std::max(params.chunkSize, 1);
+	for (long long first = 0; first < s.faceNum; first += chunkSize) {
+		const long long last = std::min(first + chunkSize, s.faceNum);
+		if (s.ply)
+			s.scanFaces(first, last, offsets.back(), offsets);
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int l = 0; l < LANE_NUM; ++l) {
+			const long long f0 = first + (last - first) * l / LANE_NUM;
+			const long long f1 = first + (last - first) * (l + 1) / LANE_NUM;
+			s.accumulate(lanes[l], f0, f1, s.ply ? &offsets[f0 - first] : nullptr);
+		}
+		s.merge(lanes, grid);
+
+		if (cb)
+			cb(int(90 * last / s.faceNum), "Streaming clustering");
+	}
+
+	long long triNum = 0;
+	for (const Lane& l : lanes) {
+		if (l.badIndex)
+			throw MLException("Invalid vertex index, or cell size too small for the extent of the mesh");
+		triNum += l.triNum;
+	}
+	if (cb)
+		cb(90, "Streaming clustering: building the mesh");
+	s.extractMesh(grid, m);
+	file.unmap(const_cast<uchar*>(map));
+	return triNum;
+}
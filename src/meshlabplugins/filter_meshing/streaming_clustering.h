@@ -0,0 +1,111 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_MESHING_STREAMING_CLUSTERING_H
+#define FILTER_MESHING_STREAMING_CLUSTERING_H
+
+#include <vector>
+
+#include <QString>
+
+#include <common/ml_document/cmesh.h>
+
+/*
+Vertex clustering decimation (as vcg::tri::Clustering) of a binary PLY or STL
+file, done while reading it, without loading the input mesh.
+
+The file is memory mapped and its faces are read in chunks: every chunk is
+split among a fixed number of lanes, processed in parallel, and each lane adds
+the corners of its triangles to its own hash grid of the cells occupied in the
+chunk, together with the triangles whose corners fall in three different
+cells. After each chunk the lanes are merged in order into a global grid,
+split by cell hash in shards that are merged in parallel: the result does not
+depend on the number of threads, and every cell is kept only once. At the end
+every occupied cell becomes a vertex placed on the average of its corners or
+on the minimum of the quadric of the planes of its triangles (on the average,
+if the minimum falls out of the cell).
+
+Only the grid and the output triangles are kept in memory. The PLY faces refer
+to the vertices by index, so their positions are read from the mapped file
+when needed: the paging is cheap when the faces are ordered (as the ones saved
+by a scanner pipeline), and slow when they jump all over the vertex element.
+*/
+class StreamingClustering
+{
+public:
+	enum Representative { AVERAGE = 0, QUADRIC = 1 };
+
+	struct Params
+	{
+		Scalarm        cellSize       = 0; // if zero 1% of the bbox diagonal, found with an additional pass
+		Representative representative = QUADRIC;
+		int            chunkSize      = 1 << 20; // faces read between two calls of the callback
+	};
+
+	// clusters the triangles of the file into m, and returns their number;
+	// throws MLException if the file cannot be read
+	static long long extract(
+		const QString&    fileName,
+		CMeshO&           m,
+		const Params&     params,
+		vcg::CallBackPos* cb = nullptr);
+
+private:
+	struct Property;
+	struct Cell;
+	struct Shard;
+	struct Lane;
+
+	StreamingClustering(const char* data, long long size, const Params& params);
+
+	void parseHeader();
+	void parsePlyHeader();
+	void findCellSize();
+	void scanFaces(long long first, long long last, long long pos, std::vector<long long>& offsets) const;
+	void accumulate(Lane& l, long long first, long long last, const long long* offsets) const;
+	void addTriangle(Lane& l, const vcg::Point3d p[3]) const;
+	vcg::Point3d vertex(long long i) const;
+	void merge(std::vector<Lane>& lanes, std::vector<Shard>& grid) const;
+	void extractMesh(std::vector<Shard>& grid, CMeshO& m) const;
+
+	const char* data;
+	long long   size;
+	Params      par;
+	double      cellSize;
+	bool        ply;
+	bool        swapBytes; // big endian PLY
+
+	long long vertNum;
+	long long vertStart;
+	int       vertStride;
+	int       coordOffset[3];
+	int       coordType[3];
+
+	long long             faceNum;
+	long long             faceStart;
+	std::vector<Property> faceProps;
+	int                   indexProp;
+};
+
+#endif // FILTER_MESHING_STREAMING_CLUSTERING_H
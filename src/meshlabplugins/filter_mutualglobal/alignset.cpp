@@ -21,6 +21,7 @@
 #include <wrap/io_trimesh/import_ply.h>
 
 #include "shutils.h"
+#include "../filter_mutualinfo/cpu_renderer.h"
 
 #define GL_STRINGFY(X) #X
 
@@ -30,6 +31,7 @@ AlignSet::AlignSet()
 	: mode(COMBINE)
 	, target(NULL)
 	, render(NULL)
+	, cpuRendering(false)
 	, vbo(0)
 	, nbo(0)
 	, cbo(0)
@@ -943,12 +945,6 @@ void AlignSet::resize(int max_side) {
 }
 
 void AlignSet::renderScene(vcg::Shot<Scalarm> &view, int component, bool save) {
-  QSize fbosize(wt,ht);
-  QGLFramebufferObjectFormat frmt;
-  frmt.setInternalTextureFormat(GL_RGBA);
-  frmt.setAttachment(QGLFramebufferObject::Depth);
-  QGLFramebufferObject fbo(fbosize,frmt);
-
   Scalarm _near, _far;
   _near=0.1;
   _far=10000;
@@ -958,6 +954,21 @@ void AlignSet::renderScene(vcg::Shot<Scalarm> &view, int component, bool save) {
   if(_near <= 0) _near = 0.1;
   if(_far < _near) _far = 1000;
 
+  //the projective modes need the shadow maps, they are always rendered with GL
+  if (cpuRendering && CPURenderer::supportsMode(mode)) {
+    if (!render) render = new unsigned char[wt*ht];
+    Matrix44m id;
+    id.SetIdentity();
+    CPURenderer::render(*mesh, id, view, 0.5*_near, 2*_far, mode, component, true, wt, ht, render);
+    return;
+  }
+
+  QSize fbosize(wt,ht);
+  QGLFramebufferObjectFormat frmt;
+  frmt.setInternalTextureFormat(GL_RGBA);
+  frmt.setAttachment(QGLFramebufferObject::Depth);
+  QGLFramebufferObject fbo(fbosize,frmt);
+
 
 //GLenum err = glGetError();
 
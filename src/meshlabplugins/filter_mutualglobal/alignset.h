@@ -70,6 +70,7 @@ class AlignSet {
   GLint programs[RENDERING_MODE_LAST];
 
   unsigned char *target, *render; //buffers for rendered images 
+  bool cpuRendering; //if true the modes up to SPECAMB are rendered on the CPU, without GL
 
   AlignSet();
   ~AlignSet();
@@ -158,6 +158,9 @@ RichParameterList FilterMutualGlobal::initParameterList(const QAction *action, c
 			parlst.addParam(RichBool("Pre-alignment",false,"Pre-alignment step","Pre-alignment step"));
 			parlst.addParam(RichBool("Estimate Focal",true,"Estimate focal length","Estimate focal length"));
 			parlst.addParam(RichBool("Fine",true,"Fine Alignment","Fine alignment"));
+			parlst.addParam(RichBool("CPU Rendering",false,"Pre-alignment on the CPU",
+				"Render the model on the CPU during the pre-alignment step, and align the images in parallel. "
+				"Always done when an OpenGL context is not available"));
 
 		  /*parlst.addParam(RichBool ("UpdateNormals",
 											true,
@@ -187,8 +190,9 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 		unsigned int& /*postConditionMask*/,
 		vcg::CallBackPos *cb)
 {
-	if (glContext == nullptr){
-		throw MLException("Fatal error: glContext not initialized");
+	bool useGL = glContext != nullptr && glContext->isValid();
+	if (!useGL && par.getInt("Max number of refinement steps") != 0){
+		throw MLException("The global refinement needs an OpenGL context: set the max number of refinement steps to 0 to run only the pre-alignment");
 	}
 	QElapsedTimer filterTime;
 	filterTime.start();
@@ -220,12 +224,14 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 
 			}
 
-			this->glContext->makeCurrent();
+			if (useGL) {
+				this->glContext->makeCurrent();
 
-			this->initGL();
+				this->initGL();
+			}
 
 			if (par.getBool("Pre-alignment")) {
-				preAlignment(md, par, cb);
+				preAlignment(md, par, cb, par.getBool("CPU Rendering") || !useGL);
 			}
 
 			if (par.getInt("Max number of refinement steps")!=0) {
@@ -244,7 +250,8 @@ std::map<std::string, QVariant> FilterMutualGlobal::applyFilter(
 				}
 			}
 
-			this->glContext->doneCurrent();
+			if (useGL)
+				this->glContext->doneCurrent();
 			log("Done!");
 			break;
 
@@ -357,7 +364,27 @@ QString FilterMutualGlobal::filterScriptFunctionName( ActionIDType filterID )
 	return QString();
 }
 
-bool FilterMutualGlobal::preAlignment(MeshDocument &md, const RichParameterList & par, vcg::CallBackPos *cb)
+// Aligns the image of a raster with the classic MI, starting from the shot of the raster.
+// The returned shot refers to the viewport of the resized image.
+static Shotm alignRaster(AlignSet &align, Solver &solver, MutualInfo &mutual, RasterModel &rm)
+{
+	align.image=&rm.currentPlane->image;
+	align.shot=rm.shot;
+
+	align.resize(800);
+
+	align.shot.Intrinsics.ViewportPx[0]=int((double)align.shot.Intrinsics.ViewportPx[1]*align.image->width()/align.image->height());
+	align.shot.Intrinsics.CenterPx[0]=(int)(align.shot.Intrinsics.ViewportPx[0]/2);
+
+	if (solver.fine_alignment)
+		solver.optimize(&align, &mutual, align.shot);
+	else
+		solver.iterative(&align, &mutual, align.shot);
+
+	return align.shot;
+}
+
+bool FilterMutualGlobal::preAlignment(MeshDocument &md, const RichParameterList & par, vcg::CallBackPos *cb, bool cpuRendering)
 {
 	Solver solver;
 	MutualInfo mutual;
@@ -399,79 +426,99 @@ bool FilterMutualGlobal::preAlignment(MeshDocument &md, const RichParameterList
 			break;
 		}
 
-		vcg::Point3f *vertices = new vcg::Point3f[alignset.mesh->vn];
-		vcg::Point3f *normals = new vcg::Point3f[alignset.mesh->vn];
-		vcg::Color4b *colors = new vcg::Color4b[alignset.mesh->vn];
-		unsigned int *indices = new unsigned int[alignset.mesh->fn*3];
-
-		for(int i = 0; i < alignset.mesh->vn; i++) {
-			vertices[i] = alignset.mesh->vert[i].P();
-			normals[i] = alignset.mesh->vert[i].N();
-			colors[i] = alignset.mesh->vert[i].C();
-		}
-
-		for(int i = 0; i < alignset.mesh->fn; i++)
-			for(int k = 0; k < 3; k++)
-				indices[k+i*3] = alignset.mesh->face[i].V(k) - &*alignset.mesh->vert.begin();
-
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.vbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
-						vertices, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.nbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
-						normals, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.cbo);
-		glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Color4b),
-						colors, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
-
-		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.ibo);
-		glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.mesh->fn*3*sizeof(unsigned int),
-						indices, GL_STATIC_DRAW_ARB);
-		glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+		if (!cpuRendering) {
+			vcg::Point3f *vertices = new vcg::Point3f[alignset.mesh->vn];
+			vcg::Point3f *normals = new vcg::Point3f[alignset.mesh->vn];
+			vcg::Color4b *colors = new vcg::Color4b[alignset.mesh->vn];
+			unsigned int *indices = new unsigned int[alignset.mesh->fn*3];
 
+			for(int i = 0; i < alignset.mesh->vn; i++) {
+				vertices[i] = alignset.mesh->vert[i].P();
+				normals[i] = alignset.mesh->vert[i].N();
+				colors[i] = alignset.mesh->vert[i].C();
+			}
 
-		// it is safe to delete after copying data to VBO
-		delete []vertices;
-		delete []normals;
-		delete []colors;
-		delete []indices;
+			for(int i = 0; i < alignset.mesh->fn; i++)
+				for(int k = 0; k < 3; k++)
+					indices[k+i*3] = alignset.mesh->face[i].V(k) - &*alignset.mesh->vert.begin();
+
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.vbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
+							vertices, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.nbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Point3f),
+							normals, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, alignset.cbo);
+			glBufferDataARB(GL_ARRAY_BUFFER_ARB, alignset.mesh->vn*sizeof(vcg::Color4b),
+							colors, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ARRAY_BUFFER_ARB, 0);
+
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.ibo);
+			glBufferDataARB(GL_ELEMENT_ARRAY_BUFFER_ARB, alignset.mesh->fn*3*sizeof(unsigned int),
+							indices, GL_STATIC_DRAW_ARB);
+			glBindBufferARB(GL_ELEMENT_ARRAY_BUFFER_ARB, 0);
+
+
+			// it is safe to delete after copying data to VBO
+			delete []vertices;
+			delete []normals;
+			delete []colors;
+			delete []indices;
+		}
 
+		std::vector<RasterModel*> rasters;
+		std::vector<unsigned int> rasterIndices;
 		unsigned int r = 0;
 		for (RasterModel& rm : md.rasterIterator()) {
 			if(rm.isVisible()) {
-				alignset.image=&rm.currentPlane->image;
-				alignset.shot=rm.shot;
-
-				alignset.resize(800);
-
-				alignset.shot.Intrinsics.ViewportPx[0]=int((double)alignset.shot.Intrinsics.ViewportPx[1]*alignset.image->width()/alignset.image->height());
-				alignset.shot.Intrinsics.CenterPx[0]=(int)(alignset.shot.Intrinsics.ViewportPx[0]/2);
-
-				if (solver.fine_alignment)
-					solver.optimize(&alignset, &mutual, alignset.shot);
-				else {
-					solver.iterative(&alignset, &mutual, alignset.shot);
-					log("Vado di rough",r);
-				}
-
-				rm.shot=alignset.shot;
-				float ratio= (float) rm.currentPlane->image.height()/(float)alignset.shot.Intrinsics.ViewportPx[1];
-				rm.shot.Intrinsics.ViewportPx[0]=rm.currentPlane->image.width();
-				rm.shot.Intrinsics.ViewportPx[1]=rm.currentPlane->image.height();
-				rm.shot.Intrinsics.PixelSizeMm[1]/=ratio;
-				rm.shot.Intrinsics.PixelSizeMm[0]/=ratio;
-				rm.shot.Intrinsics.CenterPx[0]=(int)((float)rm.shot.Intrinsics.ViewportPx[0]/2.0);
-				rm.shot.Intrinsics.CenterPx[1]=(int)((float)rm.shot.Intrinsics.ViewportPx[1]/2.0);
-
-				log("Image %d completed",r);
-
+				rasters.push_back(&rm);
+				rasterIndices.push_back(r);
 			}
 			else{
 				log("Image %d skipped",r);
 			}
 			++r;
 		}
+
+		std::vector<Shotm> shots(rasters.size());
+		if (cpuRendering) {
+			// the images are aligned independently: each thread renders on the CPU
+			// with its own buffers, solver and histograms
+			#pragma omp parallel for schedule(dynamic, 1)
+			for (int i = 0; i < (int) rasters.size(); i++) {
+				AlignSet align;
+				align.cpuRendering = true;
+				align.mesh = alignset.mesh;
+				align.mode = alignset.mode;
+				align.box = alignset.box;
+				Solver rasterSolver;
+				rasterSolver.optimize_focal = solver.optimize_focal;
+				rasterSolver.fine_alignment = solver.fine_alignment;
+				MutualInfo rasterMutual;
+				shots[i] = alignRaster(align, rasterSolver, rasterMutual, *rasters[i]);
+			}
+		}
+		else {
+			for (unsigned int i = 0; i < rasters.size(); i++) {
+				shots[i] = alignRaster(alignset, solver, mutual, *rasters[i]);
+				if (cb != nullptr)
+					cb((i+1)*100/rasters.size(), "Pre-alignment");
+			}
+		}
+
+		for (unsigned int i = 0; i < rasters.size(); i++) {
+			RasterModel& rm = *rasters[i];
+			rm.shot=shots[i];
+			float ratio= (float) rm.currentPlane->image.height()/(float)shots[i].Intrinsics.ViewportPx[1];
+			rm.shot.Intrinsics.ViewportPx[0]=rm.currentPlane->image.width();
+			rm.shot.Intrinsics.ViewportPx[1]=rm.currentPlane->image.height();
+			rm.shot.Intrinsics.PixelSizeMm[1]/=ratio;
+			rm.shot.Intrinsics.PixelSizeMm[0]/=ratio;
+			rm.shot.Intrinsics.CenterPx[0]=(int)((float)rm.shot.Intrinsics.ViewportPx[0]/2.0);
+			rm.shot.Intrinsics.CenterPx[1]=(int)((float)rm.shot.Intrinsics.ViewportPx[1]/2.0);
+
+			log("Image %d completed",rasterIndices[i]);
+		}
 	}
 
 	return true;
@@ -67,7 +67,7 @@ public:
 	FilterClass getClass(const QAction* a) const;
 	bool requiresGLContext(const QAction* action) const;
 	QString filterScriptFunctionName(ActionIDType filterID);
-	bool preAlignment(MeshDocument &md, const RichParameterList& par, vcg::CallBackPos *cb);
+	bool preAlignment(MeshDocument &md, const RichParameterList& par, vcg::CallBackPos *cb, bool cpuRendering);
 	std::vector<SubGraph> buildGraph(MeshDocument &md, bool globalign=true);
 	std::vector<AlignPair> CalcPairs(MeshDocument &md, bool globalign=true);
 	std::vector<SubGraph> CreateGraphs(MeshDocument &md, std::vector<AlignPair> arcs);
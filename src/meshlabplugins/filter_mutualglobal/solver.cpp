@@ -38,8 +38,6 @@ double Solver::operator()(int ndim, double *x) {
     //cout << p[i] << "\t";
   }
   //cout << endl;
-  static int iter = 0;
-  iter++;
 /*  double orig = p.scale[6];
   //p.scale[6] *= pow(iter/(double)maxiter, 4);
   double v = 4*(iter/(double)maxiter) - 2;
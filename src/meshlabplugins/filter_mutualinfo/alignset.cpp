@@ -21,11 +21,12 @@
 #include <wrap/io_trimesh/import_ply.h>
 
 #include "shutils.h"
+#include "cpu_renderer.h"
 
 using namespace std;
 
 AlignSet::AlignSet(): mode(COMBINE),
-    target(NULL), render(NULL),error(0)
+    target(NULL), render(NULL), cpuRendering(false), error(0)
 {
         _cont = NULL;
         box.SetNull();
@@ -161,12 +162,6 @@ void AlignSet::resize(int max_side) {
 
 void AlignSet::renderScene(vcg::Shot<MESHLAB_SCALAR> &view, int component) 
 {
-    QSize fbosize(wt,ht);
-    QGLFramebufferObjectFormat frmt;
-    frmt.setInternalTextureFormat(GL_RGBA);
-    frmt.setAttachment(QGLFramebufferObject::Depth);
-    QGLFramebufferObject fbo(fbosize,frmt);
-
     MESHLAB_SCALAR _near, _far;
     _near=0.1;
     _far=10000;
@@ -176,6 +171,19 @@ void AlignSet::renderScene(vcg::Shot<MESHLAB_SCALAR> &view, int component)
     if(_near <= 0) _near = 0.1;
     if(_far < _near) _far = 1000;
 
+    if (cpuRendering)
+    {
+        if (!render) render = new unsigned char[wt*ht];
+        CPURenderer::render(*mesh, mesh->Tr, view, 0.5*_near, 2*_far, mode, component, false, wt, ht, render);
+        return;
+    }
+
+    QSize fbosize(wt,ht);
+    QGLFramebufferObjectFormat frmt;
+    frmt.setInternalTextureFormat(GL_RGBA);
+    frmt.setAttachment(QGLFramebufferObject::Depth);
+    QGLFramebufferObject fbo(fbosize,frmt);
+
 
     //GLenum err = glGetError();
 
@@ -44,6 +44,7 @@ class AlignSet {
   RenderingMode mode;
 
   unsigned char *target, *render; //buffers for rendered images 
+  bool cpuRendering; //if true the renderings are done on the CPU, without GL
   double error; //alignment error in px
 
   AlignSet();
@@ -0,0 +1,274 @@
+/****************************************************************************
+* MeshLab                                                           o o     *
+* A versatile mesh processing toolbox                             o     o   *
+*                                                                _   O  _   *
+* Copyright(C) 2005                                                \/)\/    *
+* Visual Computing Lab                                            /\/|      *
+* ISTI - Italian National Research Council                           |      *
+*                                                                    \      *
+* All rights reserved.                                                      *
+*                                                                           *
+* This program is free software; you can redistribute it and/or modify      *
+* it under the terms of the GNU General Public License as published by      *
+* the Free Software Foundation; either version 2 of the License, or         *
+* (at your option) any later version.                                       *
+*                                                                           *
+* This program is distributed in the hope that it will be useful,           *
+* but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+* GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+* for more details.                                                         *
+*                                                                           *
+****************************************************************************/
+
+#ifndef _CPU_RENDERER_H
+#define _CPU_RENDERER_H
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/*
+CPU replacement of the shaded renderings that AlignSet::renderScene does with
+OpenGL for the mutual information registration (filter_mutualinfo and
+filter_mutualglobal).
+
+The mesh, transformed by tr, is rendered from the given shot into a wt x ht
+single channel buffer, that receives the requested component (0 = R, 1 = G,
+2 = B, 3 = A) of the same shading computed by the AlignSet shaders:
+- COLOR:      vertex color
+- SILHOUETTE: white
+- NORMALMAP:  eye space normal, mapped to [0, 1]
+- SPECULAR:   eye space reflection of the view direction, mapped to [0, 1]
+- COMBINE and SPECAMB: vertex color blended with the NORMALMAP and SPECULAR
+  color, weighted by the square of the red channel.
+Background pixels are 0. As for a glReadPixels readback, rows are bottom-up.
+
+Attributes are interpolated perspective-correctly and sampled at pixel centers.
+Faces with a vertex closer than camNear are skipped instead of being clipped,
+and fragments beyond camFar are discarded. Point clouds are rendered as one
+pixel per point.
+
+The image is split in horizontal bands, rasterized in parallel: each band
+owns its pixels, so the result does not depend on the number of threads. When
+called inside a parallel region (e.g. one raster per thread) the loops run
+serially in the calling thread.
+*/
+class CPURenderer
+{
+public:
+	// same values of AlignSet::RenderingMode
+	enum Mode {COMBINE = 0, NORMALMAP = 1, COLOR = 2, SPECULAR = 3, SILHOUETTE = 4, SPECAMB = 5};
+
+	static bool supportsMode(int mode)
+	{
+		return mode >= COMBINE && mode <= SPECAMB;
+	}
+
+	static void render(
+			const CMeshO& m,
+			const Matrix44m& tr,
+			const Shotm& shot,
+			Scalarm camNear,
+			Scalarm camFar,
+			int mode,
+			int component,
+			bool cullBackFaces,
+			int wt,
+			int ht,
+			unsigned char* out)
+	{
+		std::fill(out, out + wt * ht, 0);
+		std::vector<float> depth(wt * ht, std::numeric_limits<float>::max());
+
+		const bool useColor   = (mode != NORMALMAP && mode != SPECULAR && mode != SILHOUETTE);
+		const bool reflection = (mode == SPECULAR || mode == SPECAMB);
+		const double sx = double(wt) / shot.Intrinsics.ViewportPx[0];
+		const double sy = double(ht) / shot.Intrinsics.ViewportPx[1];
+		const Matrix44m& rot = shot.Extrinsics.Rot();
+
+		// transform all the vertices: screen x, y, camera depth and the interpolated attributes
+		const int vn = (int) m.vert.size();
+		std::vector<Vertex> sv(vn);
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < vn; ++i)
+		{
+			const CVertexO& v = m.vert[i];
+			if (v.IsD())
+				continue;
+			Point3m wp = tr * v.cP();
+			Point2m pp = shot.Project(wp);
+			Vertex& o = sv[i];
+			o.x = pp[0] * sx;
+			o.y = pp[1] * sy;
+			o.z = shot.Depth(wp);
+
+			Color4b c = useColor ? v.cC() : Color4b(Color4b::White);
+			for (int k = 0; k < 4; ++k)
+				o.attr[k] = c[k] / 255.0f;
+
+			// eye space normal; the mesh transform is applied as in the modelview matrix
+			Point3m n = rot * ((tr * (v.cP() + v.cN())) - wp);
+			if (reflection)
+			{
+				Point3m e = rot * (wp - shot.GetViewPoint());
+				n.Normalize();
+				n = e - n * (2 * (n * e));
+			}
+			for (int k = 0; k < 3; ++k)
+				o.attr[4 + k] = float(n[k]);
+		}
+
+		if (m.fn == 0) // point cloud: one pixel per point, as GL_POINTS
+		{
+			for (int i = 0; i < vn; ++i)
+			{
+				const Vertex& v = sv[i];
+				if (m.vert[i].IsD() || v.z < camNear || v.z > camFar)
+					continue;
+				int x = int(std::floor(v.x)), y = int(std::floor(v.y));
+				if (x < 0 || y < 0 || x >= wt || y >= ht || !(v.z < depth[y * wt + x]))
+					continue;
+				depth[y * wt + x] = float(v.z);
+				out[y * wt + x] = shade(v.attr, mode, component);
+			}
+			return;
+		}
+
+		// bin the faces in horizontal bands
+		const int bandHeight = 32;
+		const int bandNum    = (ht + bandHeight - 1) / bandHeight;
+		std::vector<std::vector<int> > bands(bandNum);
+		for (int fi = 0; fi < (int) m.face.size(); ++fi)
+		{
+			const CFaceO& f = m.face[fi];
+			if (f.IsD())
+				continue;
+			const Vertex& a = sv[vcg::tri::Index(m, f.cV(0))];
+			const Vertex& b = sv[vcg::tri::Index(m, f.cV(1))];
+			const Vertex& c = sv[vcg::tri::Index(m, f.cV(2))];
+			if (a.z < camNear || b.z < camNear || c.z < camNear)
+				continue;
+			if (cullBackFaces && edge(a, b, c.x, c.y) <= 0)
+				continue;
+			double ymin = std::min(a.y, std::min(b.y, c.y));
+			double ymax = std::max(a.y, std::max(b.y, c.y));
+			double xmin = std::min(a.x, std::min(b.x, c.x));
+			double xmax = std::max(a.x, std::max(b.x, c.x));
+			if (xmax < 0 || ymax < 0 || xmin >= wt || ymin >= ht)
+				continue;
+			int b0 = int(std::max<double>(ymin, 0)) / bandHeight;
+			int b1 = int(std::min<double>(ymax, ht - 1)) / bandHeight;
+			for (int bi = b0; bi <= b1; ++bi)
+				bands[bi].push_back(fi);
+		}
+
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int bi = 0; bi < bandNum; ++bi)
+		{
+			const int y0 = bi * bandHeight;
+			const int y1 = std::min(ht, y0 + bandHeight);
+			for (int fi : bands[bi])
+			{
+				const CFaceO& f = m.face[fi];
+				rasterizeTriangle(
+					sv[vcg::tri::Index(m, f.cV(0))],
+					sv[vcg::tri::Index(m, f.cV(1))],
+					sv[vcg::tri::Index(m, f.cV(2))],
+					y0, y1, wt, camFar, mode, component, depth.data(), out);
+			}
+		}
+	}
+
+private:
+	struct Vertex
+	{
+		double x, y, z;
+		float  attr[7]; // rgba color, eye space normal (or reflection vector)
+	};
+
+	// shading of the AlignSet fragment shaders, quantized as in a GL_UNSIGNED_BYTE readback
+	static unsigned char shade(const float* attr, int mode, int component)
+	{
+		float c = attr[component];
+		float g = 1.0f;
+		if (mode != COLOR && mode != SILHOUETTE)
+		{
+			if (component < 3)
+			{
+				float len = std::sqrt(attr[4] * attr[4] + attr[5] * attr[5] + attr[6] * attr[6]);
+				g = (len > 0 ? attr[4 + component] / len : 0) * 0.5f + 0.5f;
+			}
+			if (mode == COMBINE || mode == SPECAMB)
+			{
+				float t = attr[0] * attr[0];
+				c = (1 - t) * c + t * g;
+			}
+			else
+				c = g;
+		}
+		return (unsigned char) std::lround(std::min(std::max(c, 0.0f), 1.0f) * 255);
+	}
+
+	// rasterizes the triangle on the rows [y0, y1), sampling at pixel centers
+	static void rasterizeTriangle(
+			const Vertex& a,
+			const Vertex& b,
+			const Vertex& c,
+			int y0,
+			int y1,
+			int wt,
+			Scalarm camFar,
+			int mode,
+			int component,
+			float* depth,
+			unsigned char* out)
+	{
+		const double area = edge(a, b, c.x, c.y);
+		if (area == 0)
+			return;
+
+		// clamp before the conversion to int, projections of points close to the camera plane can be huge
+		int xmin = int(std::max<double>(0, std::floor(std::min(a.x, std::min(b.x, c.x)))));
+		int xmax = int(std::min<double>(wt - 1, std::ceil(std::max(a.x, std::max(b.x, c.x)))));
+		int ymin = int(std::max<double>(y0, std::floor(std::min(a.y, std::min(b.y, c.y)))));
+		int ymax = int(std::min<double>(y1 - 1, std::ceil(std::max(a.y, std::max(b.y, c.y)))));
+
+		const double iza = 1.0 / a.z, izb = 1.0 / b.z, izc = 1.0 / c.z;
+		float attr[7];
+		for (int y = ymin; y <= ymax; ++y)
+		{
+			const double py = y + 0.5;
+			for (int x = xmin; x <= xmax; ++x)
+			{
+				const double px = x + 0.5;
+				double wa = edge(b, c, px, py) / area;
+				double wb = edge(c, a, px, py) / area;
+				double wc = 1.0 - wa - wb;
+				if (wa < 0 || wb < 0 || wc < 0)
+					continue;
+				double z = 1.0 / (wa * iza + wb * izb + wc * izc);
+				float& d = depth[y * wt + x];
+				if (z > camFar || !(z < d))
+					continue;
+				d = float(z);
+				wa *= iza * z;
+				wb *= izb * z;
+				wc *= izc * z;
+				for (int k = 0; k < 7; ++k)
+					attr[k] = float(wa * a.attr[k] + wb * b.attr[k] + wc * c.attr[k]);
+				out[y * wt + x] = shade(attr, mode, component);
+			}
+		}
+	}
+
+	static double edge(const Vertex& p, const Vertex& q, double x, double y)
+	{
+		return (q.x - p.x) * (y - p.y) - (q.y - p.y) * (x - p.x);
+	}
+};
+
+#endif
@@ -67,7 +67,7 @@ QString FilterMutualInfoPlugin::filterInfo(ActionIDType filterId) const
 {
 	switch(filterId) {
 	case FP_IMAGE_MUTUALINFO:
-		return "Register an image on a 3D model using Mutual Information. This filter is an implementation of Corsini et al. 'Image-to-geometry registration: a mutual information method exploiting illumination-related geometric properties', 2009, <a href=\"http://vcg.isti.cnr.it/Publications/2009/CDPS09/\" target=\"_blank\">Get link</a>";
+		return "Register an image on a 3D model using Mutual Information. This filter is an implementation of Corsini et al. 'Image-to-geometry registration: a mutual information method exploiting illumination-related geometric properties', 2009, <a href=\"http://vcg.isti.cnr.it/Publications/2009/CDPS09/\" target=\"_blank\">Get link</a>. When an OpenGL context is not available (e.g. on headless machines) the renderings of the model are computed on the CPU.";
 	default :
 		assert(0);
 		return "Unknown Filter";
@@ -121,6 +121,7 @@ RichParameterList FilterMutualInfoPlugin::initParameterList(const QAction *actio
 		parlst.addParam(RichFloat("Tolerance", 0.1, "Tolerance", "Threshold to stop convergence"));
 		parlst.addParam(RichFloat("ExpectedVariance", 2.0, "Expected Variance", "Expected Variance"));
 		parlst.addParam(RichInt("BackgroundWeight", 2, "Background Weight", "Weight of background pixels (1, as all the other pixels; 2, one half of the other pixels etc etc)"));
+		parlst.addParam(RichBool("CPU Rendering", false, "Render on the CPU", "Render the model on the CPU instead of using OpenGL. Always done when an OpenGL context is not available"));
 		break;
 	default :
 		assert(0);
@@ -135,9 +136,6 @@ std::map<std::string, QVariant> FilterMutualInfoPlugin::applyFilter(
 		unsigned int& /*postConditionMask*/,
 		vcg::CallBackPos* )
 {
-	if (glContext == nullptr){
-		throw MLException("Fatal error: glContext not initialized");
-	}
 	switch(ID(action))	 {
 	case FP_IMAGE_MUTUALINFO :
 		imageMutualInfoAlign(
@@ -145,7 +143,8 @@ std::map<std::string, QVariant> FilterMutualInfoPlugin::applyFilter(
 					par.getEnum("Rendering Mode"), par.getBool("Estimate Focal"),
 					par.getBool("Fine"), par.getFloat("ExpectedVariance"),
 					par.getFloat("Tolerance"), par.getInt("NumOfIterations"),
-					par.getInt("BackgroundWeight"), par.getShotf("Shot"));
+					par.getInt("BackgroundWeight"), par.getShotf("Shot"),
+					par.getBool("CPU Rendering") || glContext == nullptr || !glContext->isValid());
 		break;
 	default :
 		wrongActionCalled(action);
@@ -167,7 +166,8 @@ void FilterMutualInfoPlugin::imageMutualInfoAlign(
 		Scalarm tolerance,
 		int numIterations,
 		int backGroundWeight,
-		Shotm shot)
+		Shotm shot,
+		bool cpuRendering)
 {
 	Solver solver;
 	MutualInfo mutual;
@@ -224,15 +224,22 @@ void FilterMutualInfoPlugin::imageMutualInfoAlign(
 	align.shot.Intrinsics.ViewportPx[0]=int((double)align.shot.Intrinsics.ViewportPx[1]*align.image->width()/align.image->height());
 	align.shot.Intrinsics.CenterPx[0]=(int)(align.shot.Intrinsics.ViewportPx[0]/2);
 
-	///// Initialize GLContext
+	align.cpuRendering = cpuRendering;
+	if (cpuRendering) {
+		log("Rendering on the CPU");
+		align.resize(800);
+	}
+	else {
+		///// Initialize GLContext
 
-	log( "Initialize GL");
-	align.setGLContext(glContext);
-	glContext->makeCurrent();
-	if (initGLMutualInfo() == false)
-		throw MLException("Error while initializing GL.");
+		log( "Initialize GL");
+		align.setGLContext(glContext);
+		glContext->makeCurrent();
+		if (initGLMutualInfo() == false)
+			throw MLException("Error while initializing GL.");
 
-	log( "Done");
+		log( "Done");
+	}
 
 	///// Mutual info calculation: every 30 iterations, the mail glarea is updated
 	int rounds=(int)(solver.maxiter/30);
@@ -263,7 +270,8 @@ void FilterMutualInfoPlugin::imageMutualInfoAlign(
 
 		md.documentUpdated();
 	}
-	this->glContext->doneCurrent();
+	if (!cpuRendering)
+		this->glContext->doneCurrent();
 }
 
 bool FilterMutualInfoPlugin::initGLMutualInfo()
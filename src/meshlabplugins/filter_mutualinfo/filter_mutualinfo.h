@@ -70,7 +70,8 @@ private:
 			Scalarm tolerance,
 			int numIterations,
 			int backGroundWeight,
-			Shotm shot);
+			Shotm shot,
+			bool cpuRendering);
 
 	bool initGLMutualInfo();
 };
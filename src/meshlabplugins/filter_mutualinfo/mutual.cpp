@@ -28,7 +28,7 @@ void MutualInfo::setBins(unsigned int _nbins) {
   if(histo2D) delete []histo2D;
   if(histoA) delete []histoA;
   if(histoB) delete []histoB;
-  histo2D = new unsigned int[nbins*nbins];
+  histo2D = new unsigned int[4*nbins*nbins]; //room for the partial histograms
   histoA = new unsigned int[nbins];
   histoB = new unsigned int[nbins];
 }
@@ -91,7 +91,8 @@ void MutualInfo::histogram(int width, int height,
                            int starty, int endy) {
   if(endx == 0) endx = width;
   if(endy == 0) endy = height;
-  memset(histo2D, 0, nbins*nbins*sizeof(int));
+  unsigned int size = nbins*nbins;
+  memset(histo2D, 0, 4*size*sizeof(int));
   int side = 256/nbins;
   assert(!(side & (side-1)));
 
@@ -103,14 +104,27 @@ void MutualInfo::histogram(int width, int height,
   int s = 0; 
   while ( bins>>=1) { ++s; }
 
+  //consecutive pixels go in 4 interleaved partial histograms, so that runs of
+  //equal values (e.g. the background) do not stall on the same counter
+  unsigned int *h0 = histo2D, *h1 = h0 + size, *h2 = h1 + size, *h3 = h2 + size;
   for(int y = starty; y < endy; y++) {
-    int offset = width*y + startx;
-    for(int x = startx; x < endx; x++, offset++) {
-      unsigned char a = target[offset]>>k; //instead of /side;
-      unsigned char b = render[offset]>>k; //instead of /side;
-      histo2D[a + (b<<s)] += 2;//bweight; //instead of nbins*s
+    const unsigned char *t = target + width*y;
+    const unsigned char *r = render + width*y;
+    int x = startx;
+    for(; x + 3 < endx; x += 4) {
+      h0[(t[x  ]>>k) + ((r[x  ]>>k)<<s)] += 2;
+      h1[(t[x+1]>>k) + ((r[x+1]>>k)<<s)] += 2;
+      h2[(t[x+2]>>k) + ((r[x+2]>>k)<<s)] += 2;
+      h3[(t[x+3]>>k) + ((r[x+3]>>k)<<s)] += 2;
+    }
+    for(; x < endx; x++) {
+      unsigned char a = t[x]>>k; //instead of /side;
+      unsigned char b = r[x]>>k; //instead of /side;
+      h0[a + (b<<s)] += 2;//bweight; //instead of nbins*s
     }
   }
+  for(unsigned int i = 0; i < size; i++)
+    histo2D[i] = h0[i] + h1[i] + h2[i] + h3[i];
   //weight of background is divided.
   //background is when b = 0 -> first row of histo2D
   if(bweight != 0) {
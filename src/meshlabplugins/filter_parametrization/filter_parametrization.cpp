@@ -27,8 +27,10 @@
 
 #include <igl/boundary_loop.h>
 #include <igl/harmonic.h>
-#include <igl/lscm.h>
 #include <igl/map_vertices_to_circle.h>
+#include <igl/massmatrix.h>
+#include <igl/repdiag.h>
+#include <igl/vector_area_matrix.h>
 
 FilterParametrizationPlugin::FilterParametrizationPlugin()
 {
@@ -167,7 +169,21 @@ std::map<std::string, QVariant> FilterParametrizationPlugin::applyFilter(
 			throw MLException(
 				"Harmonic Parametrization can be applied only on meshes that have a boundary.");
 		igl::map_vertices_to_circle(verts, bnd, bnd_uv);
-		igl::harmonic(verts,faces,bnd,bnd_uv,1,V_uv);
+
+		// the factorization only depends on the mesh, on k and on the boundary:
+		// it is reused when the filter is applied again on the same mesh
+		meshlab::LaplacianCache::Timings timings;
+		V_uv = meshlab::LaplacianCache::instance().solve(
+			md.mm(), verts, faces, "harmonic" + std::to_string(f),
+			[&](const Eigen::SparseMatrix<double>& L) {
+				Eigen::SparseMatrix<double> M, Q;
+				if (f > 1)
+					igl::massmatrix(verts, faces, igl::MASSMATRIX_TYPE_DEFAULT, M);
+				igl::harmonic(L, M, f, Q);
+				return Q;
+			},
+			bnd, bnd_uv, timings);
+		logTimings(timings);
 
 		unsigned int i = 0;
 		for (auto& v : md.mm()->cm.vert){
@@ -198,8 +214,33 @@ std::map<std::string, QVariant> FilterParametrizationPlugin::applyFilter(
 		Eigen::MatrixXd bc(2,2);
 		bc<<0,0,1,0;
 
-		// LSCM parametrization
-		igl::lscm(verts,faces,boundaryPoints,bc,V_uv);
+		if (faces.maxCoeff() + 1 != verts.rows())
+			throw MLException(
+				"Least Squares Conformal Maps Parametrization cannot be applied on meshes with "
+				"unreferenced vertices.");
+
+		// LSCM parametrization, as igl::lscm: u and v are stacked in a single vector
+		const Eigen::Index n = verts.rows();
+		Eigen::VectorXi b_flat(4);
+		b_flat << boundaryPoints(0), boundaryPoints(1), boundaryPoints(0) + n, boundaryPoints(1) + n;
+		Eigen::MatrixXd bc_flat(4, 1);
+		bc_flat << bc(0, 0), bc(1, 0), bc(0, 1), bc(1, 1);
+
+		meshlab::LaplacianCache::Timings timings;
+		Eigen::MatrixXd W_flat = meshlab::LaplacianCache::instance().solve(
+			md.mm(), verts, faces, "lscm",
+			[&](const Eigen::SparseMatrix<double>& L) {
+				Eigen::SparseMatrix<double> A, L_flat;
+				igl::vector_area_matrix(faces, A);
+				igl::repdiag(L, 2, L_flat);
+				return Eigen::SparseMatrix<double>(-L_flat + 2. * A);
+			},
+			b_flat, bc_flat, timings);
+		logTimings(timings);
+
+		V_uv.resize(n, 2);
+		V_uv.col(1) = W_flat.block(0, 0, n, 1);
+		V_uv.col(0) = W_flat.block(n, 0, n, 1);
 
 		unsigned int i = 0;
 		for (auto& v : md.mm()->cm.vert){
@@ -216,4 +257,14 @@ std::map<std::string, QVariant> FilterParametrizationPlugin::applyFilter(
 	return std::map<std::string, QVariant>();
 }
 
+void FilterParametrizationPlugin::logTimings(const meshlab::LaplacianCache::Timings& timings) const
+{
+	log("Assembly %.3f s%s, factorization %.3f s%s, solve %.3f s",
+		timings.assembly,
+		timings.cachedLaplacian ? " (cached Laplacian)" : "",
+		timings.factorization,
+		timings.cachedFactorization ? " (cached)" : "",
+		timings.solve);
+}
+
 MESHLAB_PLUGIN_NAME_EXPORTER(FilterSamplePlugin)
@@ -25,6 +25,7 @@
 #define MESHLAB_FILTER_PARAMETRIZATION_PLUGIN_H
 
 #include <common/plugins/interfaces/filter_plugin.h>
+#include <common/utilities/laplacian_cache.h>
 
 class FilterParametrizationPlugin : public QObject, public FilterPlugin
 {
@@ -61,6 +62,7 @@ public:
 			vcg::CallBackPos * cb);
 
 private:
+	void logTimings(const meshlab::LaplacianCache::Timings& timings) const;
 };
 
 #endif //MESHLAB_FILTER_PARAMETRIZATION_PLUGIN_H
@@ -29,8 +29,13 @@ $Log: samplefilter.cpp,v $
 #include <stdlib.h>
 #include <time.h>
 #include <limits>
+#include <memory>
 
 #include "filter_sampling.h"
+#include "parallel_sampling.h"
+#include "sparse_resampler.h"
+
+#include <common/utilities/texture_raster.h>
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/point_sampling.h>
@@ -96,16 +101,70 @@ public:
     if (qualitySampling)
       m->vert.back().Q() = f.cV(0)->Q()*p[0] + f.cV(1)->Q()*p[1] + f.cV(2)->Q()*p[2];
   }
-  void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const Point2i &tp, float edgeDist)
+
+  // Bulk versions of AddVert and AddFace used with the parallel samplers:
+  // the vertices are allocated once and filled in parallel, in the given order.
+  void AddVerts(const std::vector<CMeshO::VertexType *> &verts)
   {
-    if (edgeDist != .0) return;
+    size_t base = m->vert.size();
+    tri::Allocator<CMeshO>::AddVertices(*m, verts.size());
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < int(verts.size()); ++i)
+      m->vert[base+i].ImportData(*verts[i]);
+  }
 
-    tri::Allocator<CMeshO>::AddVertices(*m,1);
+  void AddFaces(const CMeshO &src, const std::vector<tri::ParallelSampling<CMeshO>::FaceSample> &samples)
+  {
+    size_t base = m->vert.size();
+    tri::Allocator<CMeshO>::AddVertices(*m, samples.size());
+    #pragma omp parallel for schedule(static)
+    for (int i = 0; i < int(samples.size()); ++i)
+    {
+      const CMeshO::FaceType &f = src.face[samples[i].face];
+      const CMeshO::CoordType &p = samples[i].bary;
+      CMeshO::VertexType &v = m->vert[base+i];
+      v.P() = f.cP(0)*p[0] + f.cP(1)*p[1] + f.cP(2)*p[2];
+      if(perFaceNormal) v.N() = f.cN();
+         else v.N() = f.cV(0)->cN()*p[0] + f.cV(1)->cN()*p[1] + f.cV(2)->cN()*p[2];
+      if (qualitySampling)
+        v.Q() = f.cV(0)->cQ()*p[0] + f.cV(1)->cQ()*p[1] + f.cV(2)->cQ()*p[2];
+    }
+  }
+
+  // Texel sampling with meshlab::TextureRaster: the samples are collected per
+  // tile, concurrently, and added to the mesh by AddTileSamples in tile order.
+  struct TexelSample
+  {
+    Point3m p;
+    Point3m n;
+    Color4b c;
+  };
+  struct Tile
+  {
+    std::vector<TexelSample> samples;
+  };
+  std::vector<std::vector<TexelSample> > tileSamples;
+
+  void BeginTiles(int tileNum)
+  {
+    tileSamples.clear();
+    tileSamples.resize(tileNum);
+  }
+
+  void EndTile(int tile, Tile &t)
+  {
+    tileSamples[tile].swap(t.samples);
+  }
 
-    if(uvSpaceFlag) m->vert.back().P() = Point3m(float(tp[0]),float(tp[1]),0);
-    else m->vert.back().P() = f.cP(0)*p[0] + f.cP(1)*p[1] +f.cP(2)*p[2];
+  void AddTextureSample(Tile &t, const CMeshO::FaceType &f, const CMeshO::CoordType &p, const Point2i &tp, float edgeDist)
+  {
+    if (edgeDist != .0) return;
+
+    TexelSample s;
+    if(uvSpaceFlag) s.p = Point3m(float(tp[0]),float(tp[1]),0);
+    else s.p = f.cP(0)*p[0] + f.cP(1)*p[1] +f.cP(2)*p[2];
 
-    m->vert.back().N() = f.cV(0)->N()*p[0] + f.cV(1)->N()*p[1] +f.cV(2)->N()*p[2];
+    s.n = f.cV(0)->cN()*p[0] + f.cV(1)->cN()*p[1] +f.cV(2)->cN()*p[2];
     if(tex)
     {
       QRgb val;
@@ -116,15 +175,154 @@ public:
       if (xpos < 0) xpos += tex->width();
       if (ypos < 0) ypos += tex->height();
 
-      val = tex->pixel(xpos,ypos);
-      m->vert.back().C()=Color4b(qRed(val),qGreen(val),qBlue(val),255);
+      val = static_cast<const QImage *>(tex)->pixel(xpos,ypos);
+      s.c = Color4b(qRed(val),qGreen(val),qBlue(val),255);
     }
+    t.samples.push_back(s);
+  }
 
+  void AddTileSamples()
+  {
+    std::vector<size_t> offset(tileSamples.size() + 1, 0);
+    for (size_t i = 0; i < tileSamples.size(); ++i)
+      offset[i+1] = offset[i] + tileSamples[i].size();
+    size_t base = m->vert.size();
+    tri::Allocator<CMeshO>::AddVertices(*m, offset.back());
+    #pragma omp parallel for schedule(dynamic, 16)
+    for (int i = 0; i < int(tileSamples.size()); ++i)
+      for (size_t k = 0; k < tileSamples[i].size(); ++k)
+      {
+        const TexelSample &s = tileSamples[i][k];
+        CMeshO::VertexType &v = m->vert[base + offset[i] + k];
+        v.P() = s.p;
+        v.N() = s.n;
+        if (tex) v.C() = s.c;
+      }
+    tileSamples.clear();
   }
 }; // end class BaseSampler
 
 
 
+/* The distance filters search the closest points on a mesh for samples taken on
+ * another one, both placed in the scene by their Tr matrix. Instead of applying
+ * the matrices to the meshes (and the inverse ones afterwards) the samples are
+ * moved into the local frame of the searched mesh, that is left untouched.
+ * Distances are preserved up to the constant factor scale only if its matrix is
+ * a similarity; for the other matrices the search is done on a temporary copy
+ * of the mesh in world coordinates.
+ */
+class SearchFrame
+{
+public:
+  SearchFrame(CMeshO &searched, const Matrix44m &sampledTr)
+  {
+    if (IsSimilarity(searched.Tr, scale))
+    {
+      m = &searched;
+      toWorld = searched.Tr;
+    }
+    else
+    {
+      worldCopy.reset(new CMeshO(searched));
+      tri::UpdatePosition<CMeshO>::Matrix(*worldCopy, searched.Tr, true);
+      worldCopy->Tr.SetIdentity();
+      m = worldCopy.get();
+      toWorld.SetIdentity();
+      scale = 1;
+    }
+    toSearch = Inverse(toWorld) * sampledTr;
+    fromSearch = Inverse(toSearch);
+  }
+
+  CMeshO &mesh() { return *m; }
+
+  Scalarm scale; // world distance = scale * distance in the search frame
+
+  // from the local frame of the sampled mesh to the search frame and back
+  Point3m pointToSearch(const Point3m &p) const { return toSearch * p; }
+  Point3m pointFromSearch(const Point3m &p) const { return fromSearch * p; }
+  Point3m normalToSearch(const Point3m &n) const { return TransformNormal(fromSearch, n); }
+  Point3m normalFromSearch(const Point3m &n) const { return TransformNormal(toSearch, n); }
+
+  // moves a mesh built in the search frame (e.g. the closest points) in world
+  // coordinates, scaling the distances stored in its quality
+  void toWorldFrame(CMeshO &pm) const
+  {
+    if (toWorld != Matrix44m::Identity())
+      tri::UpdatePosition<CMeshO>::Matrix(pm, toWorld, true);
+    if (scale != 1)
+      for (CMeshO::VertexIterator vi = pm.vert.begin(); vi != pm.vert.end(); ++vi)
+        (*vi).Q() *= scale;
+  }
+
+private:
+  // rotation, uniform scale and translation, without reflections
+  static bool IsSimilarity(const Matrix44m &M, Scalarm &s)
+  {
+    s = 1;
+    if (M.ElementAt(3,0) != 0 || M.ElementAt(3,1) != 0 || M.ElementAt(3,2) != 0 || M.ElementAt(3,3) != 1)
+      return false;
+    Scalarm g[3][3]; // columns dot products
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        g[i][j] = M.ElementAt(0,i)*M.ElementAt(0,j) + M.ElementAt(1,i)*M.ElementAt(1,j) + M.ElementAt(2,i)*M.ElementAt(2,j);
+    Scalarm s2 = (g[0][0] + g[1][1] + g[2][2]) / 3;
+    if (s2 <= 0)
+      return false;
+    const Scalarm eps = 1e-5;
+    for (int i = 0; i < 3; ++i)
+      for (int j = 0; j < 3; ++j)
+        if (std::abs(g[i][j] - (i == j ? s2 : 0)) > eps * s2)
+          return false;
+    Point3m c0(M.ElementAt(0,0), M.ElementAt(1,0), M.ElementAt(2,0));
+    Point3m c1(M.ElementAt(0,1), M.ElementAt(1,1), M.ElementAt(2,1));
+    Point3m c2(M.ElementAt(0,2), M.ElementAt(1,2), M.ElementAt(2,2));
+    if ((c0 ^ c1) * c2 < 0)
+      return false;
+    s = std::sqrt(s2);
+    return true;
+  }
+
+  // normals are transformed by the inverse transpose, inv is the inverse matrix
+  static Point3m TransformNormal(const Matrix44m &inv, const Point3m &n)
+  {
+    Point3m r(inv.ElementAt(0,0)*n[0] + inv.ElementAt(1,0)*n[1] + inv.ElementAt(2,0)*n[2],
+              inv.ElementAt(0,1)*n[0] + inv.ElementAt(1,1)*n[1] + inv.ElementAt(2,1)*n[2],
+              inv.ElementAt(0,2)*n[0] + inv.ElementAt(1,2)*n[1] + inv.ElementAt(2,2)*n[2]);
+    return r.Normalize();
+  }
+
+  CMeshO *m;
+  std::unique_ptr<CMeshO> worldCopy;
+  Matrix44m toWorld;
+  Matrix44m toSearch;
+  Matrix44m fromSearch;
+};
+
+// Forwards the samples taken on a mesh to a distance sampler (e.g. the
+// HausdorffSampler) that works in the search frame.
+template <class DistanceSampler>
+class FrameSampler
+{
+public:
+  FrameSampler(DistanceSampler &_ds, const SearchFrame &_frame) : ds(_ds), frame(_frame) {}
+
+  void AddVert(const CMeshO::VertexType &p)
+  {
+    ds.AddSample(frame.pointToSearch(p.cP()), frame.normalToSearch(p.cN()));
+  }
+
+  void AddFace(const CMeshO::FaceType &f, const CMeshO::CoordType &interp)
+  {
+    ds.AddSample(frame.pointToSearch(f.cP(0)*interp[0] + f.cP(1)*interp[1] + f.cP(2)*interp[2]), frame.normalToSearch(f.cN()));
+  }
+
+private:
+  DistanceSampler &ds;
+  const SearchFrame &frame;
+};
+
 /* This sampler is used to transfer the detail of a mesh onto another one.
  * It keep internally the spatial indexing structure used to find the closest point
  */
@@ -135,9 +333,10 @@ class LocalRedetailSampler
 
 public:
 
-  LocalRedetailSampler():m(0) {}
+  LocalRedetailSampler():m(0),frame(0) {}
 
   CMeshO *m;           /// the source mesh for which we search the closest points (e.g. the mesh from which we take colors etc).
+  const SearchFrame *frame; /// if set, the frame of the source mesh, otherwise the samples are in the same frame
   CallBackPos *cb;
   int sampleNum;  // the expected number of samples. Used only for the callback
   int sampleCnt;
@@ -185,19 +384,20 @@ public:
     // the results
     Point3m       closestPt,      normf, bestq, ip;
     CMeshO::ScalarType dist = dist_upper_bound;
-    const CMeshO::CoordType &startPt= p.cP();
+    const CMeshO::CoordType startPt = frame ? frame->pointToSearch(p.cP()) : p.cP();
+    const CMeshO::ScalarType scale = frame ? frame->scale : 1;
     // compute distance between startPt and the mesh S2
     if(useVertexSampling)
     {
       CMeshO::VertexType   *nearestV=0;
       nearestV =  tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*m,unifGridVert,startPt,dist_upper_bound,dist); //(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
       if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
-      if(storeDistanceAsQualityFlag)  p.Q() = dist;
+      if(storeDistanceAsQualityFlag)  p.Q() = dist * scale;
       if(dist == dist_upper_bound) return ;
 
-      if(coordFlag) p.P()=nearestV->P();
+      if(coordFlag) p.P() = frame ? frame->pointFromSearch(nearestV->P()) : nearestV->P();
       if(colorFlag) p.C() = nearestV->C();
-      if(normalFlag) p.N() = nearestV->N();
+      if(normalFlag) p.N() = frame ? frame->normalFromSearch(nearestV->N()) : nearestV->N();
       if(qualityFlag) p.Q()= nearestV->Q();
       if(selectionFlag) if(nearestV->IsS()) p.SetS();
     }
@@ -214,9 +414,13 @@ public:
       InterpolationParameters(*nearestF,(*nearestF).cN(),closestPt, interp);
       interp[2]=1.0-interp[1]-interp[0];
 
-      if(coordFlag) p.P()=closestPt;
+      if(coordFlag) p.P() = frame ? frame->pointFromSearch(closestPt) : closestPt;
       if(colorFlag) p.C().lerp(nearestF->V(0)->C(),nearestF->V(1)->C(),nearestF->V(2)->C(),interp);
-      if(normalFlag) p.N() = nearestF->V(0)->N()*interp[0] + nearestF->V(1)->N()*interp[1] + nearestF->V(2)->N()*interp[2];
+      if(normalFlag)
+      {
+        Point3m n = nearestF->V(0)->N()*interp[0] + nearestF->V(1)->N()*interp[1] + nearestF->V(2)->N()*interp[2];
+        p.N() = frame ? frame->normalFromSearch(n) : n;
+      }
       if(qualityFlag) p.Q()= nearestF->V(0)->Q()*interp[0] + nearestF->V(1)->Q()*interp[1] + nearestF->V(2)->Q()*interp[2];
 	  if (selectionFlag)
 	  {
@@ -559,6 +763,7 @@ RichParameterList FilterDocSampling::initParameterList(const QAction *action, co
     parlst.addParam(RichBool("EdgeSampling",  false,
                                  "Sample CreaseEdge Only",
                                  "Restrict the sampling process to the crease edges only. Useful to sample in a more accurate way the feature edges of a mechanical mesh."));
+    parlst.addParam(RichInt("RandomSeed", 0, "Random Seed", "The seed used to generate the samples. The same seed always gives the same samples, whatever the number of threads used. Not used when sampling crease edges."));
     break;
   case FP_STRATIFIED_SAMPLING :
     parlst.addParam(RichInt ("SampleNum",  std::max(100000,md.mm()->cm.vn),
@@ -622,6 +827,7 @@ RichParameterList FilterDocSampling::initParameterList(const QAction *action, co
     parlst.addParam(RichInt("BestSamplePool", 10, "Best Sample Pool Size", "Used only if the Best Sample Flag is true. It control the number of attempt that it makes to get the best sample. It is reasonable that it is smaller than the Montecarlo oversampling factor."));
     parlst.addParam(RichBool("ExactNumFlag", false, "Exact number of samples", "If requested it will try to do a dicotomic search for the best poisson disk radius that will generate the requested number of samples with a tolerance of the 0.5%. Obviously it takes much longer."));
     parlst.addParam(RichFloat("RadiusVariance", 1, "Radius Variance", "The radius of the disk is allowed to vary between r and r*var. If this parameter is 1 the sampling is the same of the Poisson Disk Sampling"));
+    parlst.addParam(RichInt("RandomSeed", 0, "Random Seed", "The seed used to generate the Montecarlo samples and the order in which they are pruned. The same seed always gives the same samples, whatever the number of threads used."));
     break;
 
   case FP_TEXEL_SAMPLING :
@@ -852,7 +1058,8 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		}
 		mps.uvSpaceFlag = par.getBool("TextureSpace");
 		vcg::tri::UpdateFlags<CMeshO>::FaceClearB(curMM->cm);
-		tri::SurfaceSampling<CMeshO,BaseSampler>::Texture(curMM->cm,mps,mps.texSamplingWidth,mps.texSamplingHeight);
+		meshlab::TextureRaster<CMeshO>::rasterize(curMM->cm,mps,mps.texSamplingWidth,mps.texSamplingHeight);
+		mps.AddTileSamples();
 		vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
 		mm->updateDataMask(MeshModel::MM_VERTNORMAL | MeshModel::MM_VERTCOLOR);
 		log("Texel Sampling created a new mesh of %i points", mm->cm.vn);
@@ -886,12 +1093,14 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		}
 		else
 		{
+			typedef tri::ParallelSampling<CMeshO> ParallelSampling;
+			unsigned int seed = par.getInt("RandomSeed");
 			if(par.getBool("Weighted"))
-				tri::SurfaceSampling<CMeshO,BaseSampler>::WeightedMontecarlo(curMM->cm,mps,par.getInt("SampleNum"),par.getFloat("RadiusVariance"));
+				mps.AddFaces(curMM->cm, ParallelSampling::WeightedMontecarlo(curMM->cm,par.getInt("SampleNum"),par.getFloat("RadiusVariance"),seed));
 			else if(par.getBool("ExactNum")) 
-				tri::SurfaceSampling<CMeshO,BaseSampler>::Montecarlo(curMM->cm,mps,par.getInt("SampleNum"));
+				mps.AddFaces(curMM->cm, ParallelSampling::Montecarlo(curMM->cm,par.getInt("SampleNum"),seed));
 			else 
-				tri::SurfaceSampling<CMeshO,BaseSampler>::MontecarloPoisson(curMM->cm,mps,par.getInt("SampleNum"));
+				mps.AddFaces(curMM->cm, ParallelSampling::MontecarloPoisson(curMM->cm,par.getInt("SampleNum"),seed));
 		}
 		
 		vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
@@ -1024,7 +1233,9 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		MeshModel *curMM= md.mm();
 		CMeshO::ScalarType radius = par.getAbsPerc("Radius");
 		int sampleNum = par.getInt("SampleNum");
-		tri::SurfaceSampling<CMeshO, BaseSampler>::PoissonDiskParam pp;
+		typedef tri::ParallelSampling<CMeshO> ParallelSampling;
+		ParallelSampling::PoissonDiskParam pp;
+		pp.seed = par.getInt("RandomSeed");
 		pp.radiusVariance = par.getFloat("RadiusVariance");
 		bool subsampleFlag = par.getBool("Subsample");
 		
@@ -1080,31 +1291,27 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 			BaseSampler sampler(presampledMesh);
 			sampler.qualitySampling=true;
 			if(pp.adaptiveRadiusFlag)
-				tri::SurfaceSampling<CMeshO,BaseSampler>::WeightedMontecarlo(curMM->cm, sampler, sampleNum*par.getInt("MontecarloRate"),pp.radiusVariance);
+				sampler.AddFaces(curMM->cm, ParallelSampling::WeightedMontecarlo(curMM->cm, sampleNum*par.getInt("MontecarloRate"),pp.radiusVariance,pp.seed));
 			else
-				tri::SurfaceSampling<CMeshO,BaseSampler>::Montecarlo(curMM->cm, sampler, sampleNum*par.getInt("MontecarloRate"));
+				sampler.AddFaces(curMM->cm, ParallelSampling::Montecarlo(curMM->cm, sampleNum*par.getInt("MontecarloRate"),pp.seed));
 			presampledMesh->bbox = curMM->cm.bbox; // we want the same bounding box
 			log("Generated %i Montecarlo Samples (%i msec)",presampledMesh->vn,tt.elapsed());
 		}
 		
 		BaseSampler mps(&(mm->cm));
 		if(par.getBool("RefineFlag"))
-		{
-			pp.preGenFlag=true;
 			pp.preGenMesh=&(md.getMesh(par.getMeshId("RefineMesh"))->cm);
-		}
 		pp.geodesicDistanceFlag=par.getBool("ApproximateGeodesicDistance");
 		pp.bestSampleChoiceFlag=par.getBool("BestSampleFlag");
 		pp.bestSamplePoolSize =par.getInt("BestSamplePool");
+		QElapsedTimer tt;tt.start();
 		if(par.getBool("ExactNumFlag"))
-			tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruningByNumber(mps, *presampledMesh, sampleNum, radius,pp,0.005);
+			mps.AddVerts(ParallelSampling::PoissonDiskPruningByNumber(*presampledMesh, sampleNum, radius,pp,0.005));
 		else
-			tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDiskPruning(mps, *presampledMesh, radius,pp);
+			mps.AddVerts(ParallelSampling::PoissonDiskPruning(*presampledMesh, radius,pp));
 		
-		//tri::SurfaceSampling<CMeshO,BaseSampler>::PoissonDisk(curMM->cm, mps, *presampledMesh, radius,pp);
 		vcg::tri::UpdateBounding<CMeshO>::Box(mm->cm);
-		Point3i &g=pp.pds.gridSize;
-		log("Grid size was %i %i %i (%i allocated on %i)",g[0],g[1],g[2], pp.pds.gridCellNum, g[0]*g[1]*g[2]);
+		log("Pruning used a hash of %i cells (built %i times), the last pass took %i rounds (%i msec)", pp.cellNum, pp.hashBuilds, pp.rounds, tt.elapsed());
 		log("Poisson Disk Sampling created a new mesh of %i points", mm->cm.vn);
 	} break;
 		
@@ -1133,20 +1340,20 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 			sampleFace=false;
 		}
 		
-		// the meshes have to be transformed
-		if (mm0->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm0->cm, mm0->cm.Tr, true);
-		if (mm1->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm1->cm, mm1->cm.Tr, true);
-		
 		mm0->updateDataMask(MeshModel::MM_VERTQUALITY);
 		mm1->updateDataMask(MeshModel::MM_VERTQUALITY);
 		mm1->updateDataMask(MeshModel::MM_FACEMARK);
-		tri::UpdateNormal<CMeshO>::PerFaceNormalized(mm1->cm);
+		
+		// the samples are moved in the frame of the searched mesh
+		SearchFrame frame(mm1->cm, mm0->cm.Tr);
+		const Scalarm s = frame.scale;
+		tri::UpdateNormal<CMeshO>::PerFaceNormalized(frame.mesh());
 		
 		MeshModel *samplePtMesh =0;
 		MeshModel *closestPtMesh =0;
-		vcg::tri::HausdorffSampler<CMeshO> hs(&(mm1->cm));
+		typedef vcg::tri::HausdorffSampler<CMeshO> HausdorffSampler;
+		HausdorffSampler hs(&(frame.mesh()));
+		FrameSampler<HausdorffSampler> fs(hs, frame);
 		if(saveSampleFlag)
 		{
 			closestPtMesh=md.addNewMesh("","Hausdorff Closest Points", false); // the new mesh is NOT the current one (byproduct of measurement)
@@ -1156,43 +1363,40 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 			hs.init(&(samplePtMesh->cm),&(closestPtMesh->cm));
 		}
 		
-		hs.dist_upper_bound = distUpperBound;
+		hs.dist_upper_bound = distUpperBound / s;
 		
 		qDebug("Sampled  mesh has %7i vert %7i face",mm0->cm.vn,mm0->cm.fn);
 		qDebug("Searched mesh has %7i vert %7i face",mm1->cm.vn,mm1->cm.fn);
 		qDebug("Max sampling distance %f on a bbox diag of %f",distUpperBound,mm1->cm.bbox.Diag());
 		
 		if(sampleVert)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::VertexUniform(mm0->cm,hs,par.getInt("SampleNum"));
+			tri::SurfaceSampling<CMeshO,FrameSampler<HausdorffSampler> >::VertexUniform(mm0->cm,fs,par.getInt("SampleNum"));
 		if(sampleEdge)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::EdgeUniform(mm0->cm,hs,par.getInt("SampleNum"),sampleFauxEdge);
+			tri::SurfaceSampling<CMeshO,FrameSampler<HausdorffSampler> >::EdgeUniform(mm0->cm,fs,par.getInt("SampleNum"),sampleFauxEdge);
 		if(sampleFace)
-			tri::SurfaceSampling<CMeshO,vcg::tri::HausdorffSampler<CMeshO> >::Montecarlo(mm0->cm,hs,par.getInt("SampleNum"));
-		
-		// the meshes have to return to their original position
-		if (mm0->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm0->cm, Inverse(mm0->cm.Tr), true);
-		if (mm1->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm1->cm, Inverse(mm1->cm.Tr), true);
+			tri::SurfaceSampling<CMeshO,FrameSampler<HausdorffSampler> >::Montecarlo(mm0->cm,fs,par.getInt("SampleNum"));
 		
+		// the distances measured in the search frame are scaled by s
 		log("Hausdorff Distance computed");
 		log("     Sampled %i pts (rng: 0) on %s searched closest on %s",hs.n_total_samples,qUtf8Printable(mm0->label()),qUtf8Printable(mm1->label()));
-		log("     min : %f   max %f   mean : %f   RMS : %f",hs.getMinDist(),hs.getMaxDist(),hs.getMeanDist(),hs.getRMSDist());
+		log("     min : %f   max %f   mean : %f   RMS : %f",s*hs.getMinDist(),s*hs.getMaxDist(),s*hs.getMeanDist(),s*hs.getRMSDist());
 		float d = mm0->cm.bbox.Diag();
 		log("Values w.r.t. BBox Diag (%f)",d);
-		log("     min : %f   max %f   mean : %f   RMS : %f\n",hs.getMinDist()/d,hs.getMaxDist()/d,hs.getMeanDist()/d,hs.getRMSDist()/d);
+		log("     min : %f   max %f   mean : %f   RMS : %f\n",s*hs.getMinDist()/d,s*hs.getMaxDist()/d,s*hs.getMeanDist()/d,s*hs.getRMSDist()/d);
 		
 		outputValues.clear();
 		outputValues["n_samples"] = hs.n_total_samples;
-		outputValues["min"] = hs.getMinDist();
-		outputValues["max"] = hs.getMaxDist();
-		outputValues["mean"] = hs.getMeanDist();
-		outputValues["RMS"] = hs.getRMSDist();
+		outputValues["min"] = s*hs.getMinDist();
+		outputValues["max"] = s*hs.getMaxDist();
+		outputValues["mean"] = s*hs.getMeanDist();
+		outputValues["RMS"] = s*hs.getRMSDist();
 		outputValues["diag_mesh_0"] = d;
 		outputValues["diag_mesh_1"] = mm1->cm.bbox.Diag();
 		
 		if(saveSampleFlag)
 		{
+			frame.toWorldFrame(samplePtMesh->cm);
+			frame.toWorldFrame(closestPtMesh->cm);
 			tri::UpdateBounding<CMeshO>::Box(samplePtMesh->cm);
 			tri::UpdateBounding<CMeshO>::Box(closestPtMesh->cm);
 			
@@ -1213,35 +1417,29 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 			throw MLException("Cannot compute, it is the same mesh");
 		}
 		
-		// the meshes have to return to their original position
-		if (mm0->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm0->cm, mm0->cm.Tr, true);
-		if (mm1->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm1->cm, mm1->cm.Tr, true);
-		
 		// add quality to vertex of measured mesh
 		mm0->updateDataMask(MeshModel::MM_VERTQUALITY);
+		mm1->updateDataMask(MeshModel::MM_FACEMARK);
+		
+		// the vertices are moved in the frame of the reference mesh
+		SearchFrame frame(mm1->cm, mm0->cm.Tr);
+		const Scalarm s = frame.scale;
 		// if reference has faces, recompute and normalize normals
-		if (mm1->cm.fn > 0)
+		if (frame.mesh().fn > 0)
 		{
-			tri::UpdateNormal<CMeshO>::PerFaceNormalized(mm1->cm);
-			tri::UpdateNormal<CMeshO>::PerVertexNormalized(mm1->cm);
+			tri::UpdateNormal<CMeshO>::PerFaceNormalized(frame.mesh());
+			tri::UpdateNormal<CMeshO>::PerVertexNormalized(frame.mesh());
 		}
-		mm1->updateDataMask(MeshModel::MM_FACEMARK);
 		
-		SimpleDistanceSampler ds(&(mm1->cm), useSigned, maxDistABS);
+		SimpleDistanceSampler ds(&(frame.mesh()), useSigned, maxDistABS / s);
 		
-		tri::SurfaceSampling<CMeshO, SimpleDistanceSampler>::AllVertex(mm0->cm, ds);
-		
-		// the meshes have to return to their original position
-		if (mm0->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm0->cm, Inverse(mm0->cm.Tr), true);
-		if (mm1->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(mm1->cm, Inverse(mm1->cm.Tr), true);
+		for (CMeshO::VertexIterator vi = mm0->cm.vert.begin(); vi != mm0->cm.vert.end(); ++vi)
+			if (!(*vi).IsD())
+				(*vi).Q() = s * ds.AddSample(frame.pointToSearch((*vi).cP()), frame.normalToSearch((*vi).cN()));
 		
 		log("Distance from Reference Mesh computed");
 		log("     Sampled %i vertices on %s searched closest on %s", mm0->cm.vn, qUtf8Printable(mm0->label()), qUtf8Printable(mm1->label()));
-		log("     min : %f   max %f   mean : %f   RMS : %f", ds.getMaxDist(), ds.getMaxDist(), ds.getMeanDist(), ds.getRMSDist());
+		log("     min : %f   max %f   mean : %f   RMS : %f", s*ds.getMinDist(), s*ds.getMaxDist(), s*ds.getMeanDist(), s*ds.getRMSDist());
 		
 	} break;
 		
@@ -1279,19 +1477,17 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 			tri::UpdateSelection<CMeshO>::VertexFromFaceLoose(trgMesh->cm);
 		}
 		
-		// the meshes have to be transformed
-		if (srcMesh->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(srcMesh->cm, srcMesh->cm.Tr, true);
-		if (trgMesh->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(trgMesh->cm, trgMesh->cm.Tr, true);
-		
 		srcMesh->updateDataMask(MeshModel::MM_FACEMARK);
-		tri::UpdateNormal<CMeshO>::PerFaceNormalized(srcMesh->cm);
+		
+		// the target vertices are moved in the frame of the source mesh
+		SearchFrame frame(srcMesh->cm, trgMesh->cm.Tr);
+		tri::UpdateNormal<CMeshO>::PerFaceNormalized(frame.mesh());
 		
 		LocalRedetailSampler rs;
-		rs.init(&(srcMesh->cm),cb,trgMesh->cm.vn);
+		rs.init(&(frame.mesh()),cb,trgMesh->cm.vn);
+		rs.frame = &frame;
 		
-		rs.dist_upper_bound = upperbound;
+		rs.dist_upper_bound = upperbound / frame.scale;
 		rs.colorFlag = colorT;
 		rs.coordFlag = geomT;
 		rs.normalFlag = normalT;
@@ -1310,12 +1506,6 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		
 		if(rs.coordFlag) tri::UpdateNormal<CMeshO>::PerFaceNormalized(trgMesh->cm);
 		
-		// the meshes have to return to their original position
-		if (srcMesh->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(srcMesh->cm, Inverse(srcMesh->cm.Tr), true);
-		if (trgMesh->cm.Tr != Matrix44m::Identity())
-			tri::UpdatePosition<CMeshO>::Matrix(trgMesh->cm, Inverse(trgMesh->cm.Tr), true);
-		
 	} break;
 		
 	case FP_UNIFORM_MESH_RESAMPLING :
@@ -1334,7 +1524,6 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		
 		MeshModel *baseMesh= md.mm();
 		MeshModel *offsetMesh = md.addNewMesh("", "Offset mesh", true); // the new mesh is the current one
-		baseMesh->updateDataMask(MeshModel::MM_FACEMARK);
 		
 		Point3i volumeDim;
 		Box3m volumeBox = baseMesh->cm.bbox;
@@ -1345,7 +1534,9 @@ std::map<std::string, QVariant> FilterDocSampling::applyFilter(
 		log("     VoxelSize is %f, offset is %f ", voxelSize,offsetThr);
 		log("     Mesh Box is %f %f %f",baseMesh->cm.bbox.DimX(),baseMesh->cm.bbox.DimY(),baseMesh->cm.bbox.DimZ() );
 		
-		tri::Resampler<CMeshO,CMeshO>::Resample(baseMesh->cm, offsetMesh->cm, volumeBox, volumeDim, voxelSize*3.5, offsetThr,discretizeFlag,multiSampleFlag,absDistFlag, cb);
+		SparseResampler::Stats stats;
+		SparseResampler::resample(baseMesh->cm, offsetMesh->cm, volumeBox, volumeDim, voxelSize*3.5, offsetThr,discretizeFlag,multiSampleFlag,absDistFlag, cb, &stats);
+		log("     Distance field computed in %lld of %lld blocks of %i^3 cells", stats.activeBlockNum, stats.blockNum, SparseResampler::BLOCK_SIZE);
 		tri::UpdateBounding<CMeshO>::Box(offsetMesh->cm);
 		if(mergeCloseVert)
 		{
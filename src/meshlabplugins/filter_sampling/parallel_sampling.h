@@ -0,0 +1,669 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef __PARALLELSAMPLING
+#define __PARALLELSAMPLING
+
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <random>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include <vcg/complex/complex.h>
+
+namespace vcg
+{
+namespace tri
+{
+
+/*
+ * Parallel versions of the Montecarlo samplings and of the Poisson disk
+ * pruning of SurfaceSampling.
+ *
+ * The random numbers come from independent streams derived from the seed and
+ * from the index of a fixed block of work (a block of samples or of faces),
+ * never from the thread that executes it: the result depends only on the seed,
+ * whatever the number of threads.
+ *
+ * The samplings return the samples as face + barycentric coordinates and the
+ * pruning returns the chosen vertices; they are added to the output mesh by
+ * the caller.
+ */
+template <class MeshType>
+class ParallelSampling
+{
+public:
+    typedef typename MeshType::ScalarType ScalarType;
+    typedef typename MeshType::CoordType CoordType;
+    typedef typename MeshType::FaceType FaceType;
+    typedef typename MeshType::VertexType VertexType;
+
+    struct FaceSample
+    {
+        int face;
+        CoordType bary;
+    };
+
+    struct PoissonDiskParam
+    {
+        unsigned int seed = 0;
+
+        // per-vertex radius in [r, r*radiusVariance], proportional to the
+        // quality of the candidates (inversely if invertQuality)
+        bool adaptiveRadiusFlag = false;
+        ScalarType radiusVariance = 1;
+        bool invertQuality = false;
+
+        bool geodesicDistanceFlag = false;
+
+        // among the next bestSamplePoolSize candidates of a cell choose the
+        // one nearest to the samples already taken, for a tighter packing
+        bool bestSampleChoiceFlag = false;
+        int bestSamplePoolSize = 10;
+
+        // vertices always kept, the pruning adds samples around them
+        MeshType *preGenMesh = nullptr;
+
+        // statistics of the last pruning
+        int sampleNum = 0;
+        int cellNum = 0;
+        int rounds = 0;
+        int hashBuilds = 0;
+    };
+
+    // sampleNum samples, on faces chosen with probability proportional to their area
+    static std::vector<FaceSample> Montecarlo(MeshType &m, int sampleNum, unsigned int seed)
+    {
+        std::vector<double> weight(m.face.size());
+        for (size_t i = 0; i < m.face.size(); ++i)
+            weight[i] = m.face[i].IsD() ? 0 : DoubleArea(m.face[i]) / 2;
+        return ExactNumber(m, weight, sampleNum, seed);
+    }
+
+    // about sampleNum samples, the number of samples of each face is Poisson
+    // distributed with mean proportional to its area
+    static std::vector<FaceSample> MontecarloPoisson(MeshType &m, int sampleNum, unsigned int seed)
+    {
+        std::vector<double> weight(m.face.size());
+        double total = 0;
+        for (size_t i = 0; i < m.face.size(); ++i) {
+            weight[i] = m.face[i].IsD() ? 0 : DoubleArea(m.face[i]) / 2;
+            total += weight[i];
+        }
+        const int fn = (int) m.face.size();
+        const double perUnit = total > 0 ? sampleNum / total : 0;
+        std::vector<int> count(fn);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < BlockNum(fn); ++b) {
+            Stream rng(seed, CountStream, b);
+            for (int i = b * BlockSize; i < std::min(fn, (b + 1) * BlockSize); ++i)
+                count[i] = rng.Poisson(weight[i] * perUnit);
+        }
+        return PerFace(m, count, seed);
+    }
+
+    // the density of the samples is proportional to 1/r^2, where r is the
+    // per-vertex radius of the Poisson disk pruning with the same variance:
+    // the number of samples of each face is its share of sampleNum, with the
+    // fractional parts carried over to the next faces
+    static std::vector<FaceSample> WeightedMontecarlo(MeshType &m, int sampleNum, ScalarType variance, unsigned int seed)
+    {
+        std::vector<ScalarType> r = RadiusFromQuality(m, 1, variance, false);
+        std::vector<double> weight(m.face.size());
+        double total = 0;
+        for (size_t i = 0; i < m.face.size(); ++i) {
+            const FaceType &f = m.face[i];
+            if (f.IsD()) {
+                weight[i] = 0;
+                continue;
+            }
+            double avg = (r[Index(m, f.cV(0))] + r[Index(m, f.cV(1))] + r[Index(m, f.cV(2))]) / 3.0;
+            weight[i] = DoubleArea(f) / 2 / (avg * avg);
+            total += weight[i];
+        }
+        const double perUnit = total > 0 ? sampleNum / total : 0;
+        std::vector<int> count(m.face.size());
+        double acc = 0;
+        long long taken = 0;
+        for (size_t i = 0; i < m.face.size(); ++i) {
+            acc += weight[i] * perUnit;
+            long long upTo = (long long) acc;
+            count[i] = int(upTo - taken);
+            taken = upTo;
+        }
+        return PerFace(m, count, seed);
+    }
+
+    /*
+     * Poisson disk pruning of the vertices of a mesh.
+     *
+     * The candidates are bucketed once in a spatial hash whose cells are
+     * larger than the largest radius, so a sample can only conflict with the
+     * samples of the 27 cells around it. The cells are split in 8 phase groups
+     * by the parity of their coordinates: two cells of the same group are
+     * at least one cell apart and are processed in parallel. In each round
+     * every cell, phase after phase, takes its next candidate that does not
+     * conflict with the samples already taken; the rounds go on until every
+     * cell has exhausted its candidates. The candidates of a cell are visited
+     * in an order given by a hash of the seed and of the vertex index.
+     *
+     * The hash only depends on the largest radius, so the same Pruner can be
+     * run for several radii, as the search by number does.
+     */
+    class Pruner
+    {
+    public:
+        Pruner(MeshType &m, ScalarType cellSize, const PoissonDiskParam &pp) : pp(pp), cellSize(cellSize)
+        {
+            if (pp.preGenMesh)
+                for (VertexType &v : pp.preGenMesh->vert)
+                    if (!v.IsD())
+                        vert.push_back(&v);
+            preGenNum = (int) vert.size();
+            for (VertexType &v : m.vert)
+                if (!v.IsD())
+                    vert.push_back(&v);
+            if (pp.adaptiveRadiusFlag) {
+                radius = RadiusFromQuality(m, 1, pp.radiusVariance, pp.invertQuality);
+                // the radius of the kept vertices is not used, they never conflict
+                radius.insert(radius.begin(), preGenNum, ScalarType(1));
+                size_t k = preGenNum;
+                for (size_t i = 0; i < m.vert.size(); ++i)
+                    if (!m.vert[i].IsD())
+                        radius[k++] = radius[preGenNum + i];
+                radius.resize(vert.size());
+            }
+            BuildHash();
+        }
+
+        ScalarType CellSize() const { return cellSize; }
+        int CellNum() const { return (int) cellKey.size(); }
+
+        // the largest radius that can be used with this hash
+        ScalarType MaxRadius() const
+        {
+            return pp.adaptiveRadiusFlag ? cellSize / std::max(ScalarType(1), pp.radiusVariance) : cellSize;
+        }
+
+        // the chosen vertices, the kept ones first; rounds is set to the
+        // number of rounds it took
+        std::vector<VertexType *> Prune(ScalarType diskRadius, int &rounds) const
+        {
+            assert(diskRadius <= MaxRadius() * (1 + 1e-5));
+            const int cn = CellNum();
+            std::vector<int> perm = order;
+            std::vector<int> next(cn), taken(cn);
+            std::vector<int> active[8];
+            for (int c = 0; c < cn; ++c) {
+                // the kept vertices are at the beginning of their cells
+                int k = cellBegin[c];
+                while (k < cellBegin[c + 1] && perm[k] < preGenNum)
+                    ++k;
+                taken[c] = next[c] = k;
+                if (k < cellBegin[c + 1])
+                    active[Phase(cellKey[c])].push_back(c);
+            }
+
+            rounds = 0;
+            bool any = true;
+            while (any) {
+                any = false;
+                for (int ph = 0; ph < 8; ++ph) {
+                    std::vector<int> &cells = active[ph];
+                    #pragma omp parallel for schedule(dynamic, 64)
+                    for (int i = 0; i < (int) cells.size(); ++i)
+                        TryCell(cells[i], diskRadius, perm, next, taken);
+                    cells.erase(std::remove_if(cells.begin(), cells.end(),
+                                               [&](int c) { return next[c] == cellBegin[c + 1]; }),
+                                cells.end());
+                    any = any || !cells.empty();
+                }
+                ++rounds;
+            }
+
+            std::vector<VertexType *> result;
+            for (int c = 0; c < cn; ++c)
+                for (int k = cellBegin[c]; k < taken[c]; ++k)
+                    if (perm[k] < preGenNum)
+                        result.push_back(vert[perm[k]]);
+            for (int c = 0; c < cn; ++c)
+                for (int k = cellBegin[c]; k < taken[c]; ++k)
+                    if (perm[k] >= preGenNum)
+                        result.push_back(vert[perm[k]]);
+            return result;
+        }
+
+    private:
+        void BuildHash()
+        {
+            Box3<ScalarType> box;
+            for (VertexType *v : vert)
+                box.Add(v->cP());
+            origin = box.min;
+            for (int i = 0; i < 3; ++i)
+                gridSize[i] = (long long) (box.Dim()[i] / cellSize) + 1;
+
+            const int n = (int) vert.size();
+            std::vector<Entry> entries(n);
+            #pragma omp parallel for schedule(static)
+            for (int i = 0; i < n; ++i) {
+                entries[i].cell = Key(vert[i]->cP());
+                // the kept vertices come first in their cells
+                entries[i].rank = i < preGenNum ? 0 : Hash(pp.seed, (uint64_t) i) | 1;
+                entries[i].index = i;
+            }
+            ParallelSort(entries);
+
+            order.resize(n);
+            cellKey.clear();
+            cellBegin.clear();
+            for (int i = 0; i < n; ++i) {
+                order[i] = entries[i].index;
+                if (i == 0 || entries[i].cell != entries[i - 1].cell) {
+                    cellKey.push_back(entries[i].cell);
+                    cellBegin.push_back(i);
+                }
+            }
+            cellBegin.push_back(n);
+        }
+
+        // tries the next candidates of a cell, taking at most one of them
+        void TryCell(int c, ScalarType diskRadius, std::vector<int> &perm, std::vector<int> &next, std::vector<int> &taken) const
+        {
+            int neighbours[27];
+            int nn = Neighbours(c, neighbours);
+            const int poolSize = pp.bestSampleChoiceFlag ? std::max(1, pp.bestSamplePoolSize) : 1;
+
+            // the candidates that conflict with a sample are dropped for good,
+            // the samples of a cell can only grow
+            std::vector<int> pool;
+            int best = -1;
+            ScalarType bestDist = std::numeric_limits<ScalarType>::max();
+            int k = next[c];
+            for (; k < cellBegin[c + 1] && (int) pool.size() < poolSize; ++k) {
+                int i = perm[k];
+                ScalarType r = pp.adaptiveRadiusFlag ? diskRadius * radius[i] : diskRadius;
+                ScalarType nearest = std::numeric_limits<ScalarType>::max();
+                bool conflict = false;
+                for (int j = 0; j < nn && !conflict; ++j) {
+                    int nc = neighbours[j];
+                    for (int h = cellBegin[nc]; h < taken[nc]; ++h) {
+                        ScalarType d = Distance(i, perm[h]);
+                        if (d < r) {
+                            conflict = true;
+                            break;
+                        }
+                        nearest = std::min(nearest, d);
+                    }
+                }
+                if (conflict)
+                    continue;
+                if (best == -1 || nearest < bestDist) {
+                    best = (int) pool.size();
+                    bestDist = nearest;
+                }
+                pool.push_back(i);
+            }
+
+            // the chosen candidate goes at the end of the samples of the cell,
+            // the other candidates of the pool just before the untried ones
+            if (best != -1)
+                perm[taken[c]++] = pool[best];
+            int back = k;
+            for (int p = (int) pool.size() - 1; p >= 0; --p)
+                if (p != best)
+                    perm[--back] = pool[p];
+            next[c] = back;
+        }
+
+        ScalarType Distance(int a, int b) const
+        {
+            const VertexType &va = *vert[a];
+            const VertexType &vb = *vert[b];
+            ScalarType d = vcg::Distance(va.cP(), vb.cP());
+            if (!pp.geodesicDistanceFlag || d == 0)
+                return d;
+            // length of the circular arc between the two points whose
+            // tangents turn by the angle between the normals, never shorter
+            // than the chord, so the hash is still valid
+            ScalarType theta = vcg::Angle(va.cN(), vb.cN());
+            if (theta < ScalarType(1e-4))
+                return d;
+            return d * (theta / 2) / std::sin(theta / 2);
+        }
+
+        int Neighbours(int c, int neighbours[27]) const
+        {
+            long long x, y, z;
+            Coords(cellKey[c], x, y, z);
+            int nn = 0;
+            for (long long i = x - 1; i <= x + 1; ++i)
+                for (long long j = y - 1; j <= y + 1; ++j)
+                    for (long long k = z - 1; k <= z + 1; ++k) {
+                        if (i < 0 || j < 0 || k < 0 || i >= gridSize[0] || j >= gridSize[1] || k >= gridSize[2])
+                            continue;
+                        long long key = (i * gridSize[1] + j) * gridSize[2] + k;
+                        auto it = std::lower_bound(cellKey.begin(), cellKey.end(), key);
+                        if (it != cellKey.end() && *it == key)
+                            neighbours[nn++] = int(it - cellKey.begin());
+                    }
+            return nn;
+        }
+
+        long long Key(const CoordType &p) const
+        {
+            long long c[3];
+            for (int i = 0; i < 3; ++i)
+                c[i] = std::min(gridSize[i] - 1, std::max(0LL, (long long) ((p[i] - origin[i]) / cellSize)));
+            return (c[0] * gridSize[1] + c[1]) * gridSize[2] + c[2];
+        }
+
+        void Coords(long long key, long long &x, long long &y, long long &z) const
+        {
+            z = key % gridSize[2];
+            y = (key / gridSize[2]) % gridSize[1];
+            x = key / (gridSize[2] * gridSize[1]);
+        }
+
+        int Phase(long long key) const
+        {
+            long long x, y, z;
+            Coords(key, x, y, z);
+            return int((x & 1) | ((y & 1) << 1) | ((z & 1) << 2));
+        }
+
+        struct Entry
+        {
+            long long cell;
+            uint64_t rank;
+            int index;
+
+            bool operator<(const Entry &o) const
+            {
+                if (cell != o.cell)
+                    return cell < o.cell;
+                if (rank != o.rank)
+                    return rank < o.rank;
+                return index < o.index;
+            }
+        };
+
+        const PoissonDiskParam &pp;
+        ScalarType cellSize;
+        CoordType origin;
+        long long gridSize[3];
+
+        std::vector<VertexType *> vert; // the kept vertices, then the candidates
+        int preGenNum;
+        std::vector<ScalarType> radius; // relative radius of each vertex, if adaptive
+
+        std::vector<int> order;           // vertices sorted by cell and rank
+        std::vector<long long> cellKey;   // sorted keys of the non empty cells
+        std::vector<int> cellBegin;       // range of each cell in order
+    };
+
+    static std::vector<VertexType *> PoissonDiskPruning(MeshType &m, ScalarType diskRadius, PoissonDiskParam &pp)
+    {
+        Pruner pruner(m, diskRadius * RadiusFactor(pp), pp);
+        std::vector<VertexType *> samples = pruner.Prune(diskRadius, pp.rounds);
+        pp.sampleNum = (int) samples.size();
+        pp.cellNum = pruner.CellNum();
+        pp.hashBuilds = 1;
+        return samples;
+    }
+
+    /*
+     * Bisection search of the radius that gives sampleNum samples, up to the
+     * given tolerance. diskRadius is the initial guess and is set to the
+     * radius found. The hash is built for the upper end of the search range
+     * and is rebuilt only when that must grow.
+     */
+    static std::vector<VertexType *> PoissonDiskPruningByNumber(
+            MeshType &m,
+            int sampleNum,
+            ScalarType &diskRadius,
+            PoissonDiskParam &pp,
+            ScalarType tolerance,
+            int maxIter = 20)
+    {
+        const int sampleNumMin = int(sampleNum * (1 - tolerance));
+        const int sampleNumMax = int(sampleNum * (1 + tolerance));
+        ScalarType minRad = diskRadius / 2;
+        ScalarType maxRad = diskRadius * 2;
+        pp.hashBuilds = 0;
+
+        std::unique_ptr<Pruner> pruner;
+        std::vector<VertexType *> samples;
+        for (;;) {
+            pruner.reset(new Pruner(m, maxRad * RadiusFactor(pp), pp));
+            ++pp.hashBuilds;
+            samples = pruner->Prune(maxRad, pp.rounds);
+            if ((int) samples.size() <= sampleNum || maxRad > m.bbox.Diag())
+                break;
+            minRad = maxRad;
+            maxRad *= 2;
+        }
+        // samples always holds the pruning with curRad
+        ScalarType curRad = maxRad;
+        if ((int) samples.size() < sampleNumMin) {
+            for (int iter = 0; iter < maxIter; ++iter) {
+                curRad = minRad;
+                samples = pruner->Prune(curRad, pp.rounds);
+                if ((int) samples.size() >= sampleNum)
+                    break;
+                maxRad = minRad;
+                minRad /= 2;
+            }
+        }
+        for (int iter = 0; iter < maxIter; ++iter) {
+            if ((int) samples.size() >= sampleNumMin && (int) samples.size() <= sampleNumMax)
+                break;
+            curRad = (minRad + maxRad) / 2;
+            samples = pruner->Prune(curRad, pp.rounds);
+            if ((int) samples.size() > sampleNum)
+                minRad = curRad;
+            else
+                maxRad = curRad;
+        }
+        diskRadius = curRad;
+        pp.sampleNum = (int) samples.size();
+        pp.cellNum = pruner->CellNum();
+        return samples;
+    }
+
+private:
+    static const int BlockSize = 4096;
+
+    // salts that separate the streams used for different purposes
+    enum StreamPurpose { CountStream = 1, FaceStream = 2, PointStream = 3 };
+
+    static int BlockNum(int n) { return (n + BlockSize - 1) / BlockSize; }
+
+    static uint64_t Hash(uint64_t seed, uint64_t i)
+    {
+        // splitmix64 finalizer
+        uint64_t x = seed * 0x9E3779B97F4A7C15ull + i + 0x632BE59BD9B4E019ull;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+        return x ^ (x >> 31);
+    }
+
+    // the random numbers of a block of work; the engine and the conversion
+    // to floating point are fully specified, so the streams are the same on
+    // every platform
+    class Stream
+    {
+    public:
+        Stream(unsigned int seed, int purpose, int block)
+            : gen(Hash(Hash(seed, (uint64_t) purpose), (uint64_t) block))
+        {
+        }
+
+        double Uniform() { return (gen() >> 11) * (1.0 / 9007199254740992.0); }
+
+        CoordType Barycentric()
+        {
+            double a = Uniform();
+            double b = Uniform();
+            if (a + b > 1) {
+                a = 1 - a;
+                b = 1 - b;
+            }
+            return CoordType(ScalarType(1 - a - b), ScalarType(a), ScalarType(b));
+        }
+
+        // Knuth's method, on chunks of the mean to avoid underflows
+        int Poisson(double lambda)
+        {
+            int k = 0;
+            while (lambda > 0) {
+                double l = std::min(lambda, 30.0);
+                lambda -= l;
+                double limit = std::exp(-l);
+                double p = Uniform();
+                while (p > limit) {
+                    ++k;
+                    p *= Uniform();
+                }
+            }
+            return k;
+        }
+
+    private:
+        std::mt19937_64 gen;
+    };
+
+    // the cell size for a given radius
+    static ScalarType RadiusFactor(const PoissonDiskParam &pp)
+    {
+        return pp.adaptiveRadiusFlag ? std::max(ScalarType(1), pp.radiusVariance) : ScalarType(1);
+    }
+
+    // per-vertex radius in [base, base*variance], linear in the quality
+    static std::vector<ScalarType> RadiusFromQuality(MeshType &m, ScalarType base, ScalarType variance, bool invert)
+    {
+        ScalarType minQ = std::numeric_limits<ScalarType>::max();
+        ScalarType maxQ = -std::numeric_limits<ScalarType>::max();
+        for (const VertexType &v : m.vert)
+            if (!v.IsD()) {
+                minQ = std::min(minQ, v.cQ());
+                maxQ = std::max(maxQ, v.cQ());
+            }
+        const ScalarType deltaQ = maxQ - minQ;
+        std::vector<ScalarType> r(m.vert.size(), base);
+        if (deltaQ <= 0)
+            return r;
+        for (size_t i = 0; i < m.vert.size(); ++i) {
+            ScalarType t = (m.vert[i].cQ() - minQ) / deltaQ;
+            if (invert)
+                t = 1 - t;
+            r[i] = base * (1 + (variance - 1) * t);
+        }
+        return r;
+    }
+
+    static std::vector<FaceSample> ExactNumber(MeshType &m, const std::vector<double> &weight, int sampleNum, unsigned int seed)
+    {
+        std::vector<double> cdf(weight.size());
+        double total = 0;
+        int last = -1; // last face with positive weight
+        for (size_t i = 0; i < weight.size(); ++i) {
+            total += weight[i];
+            cdf[i] = total;
+            if (weight[i] > 0)
+                last = (int) i;
+        }
+        std::vector<FaceSample> samples;
+        if (last == -1 || sampleNum <= 0)
+            return samples;
+        samples.resize(sampleNum);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < BlockNum(sampleNum); ++b) {
+            Stream rng(seed, PointStream, b);
+            for (int i = b * BlockSize; i < std::min(sampleNum, (b + 1) * BlockSize); ++i) {
+                double u = rng.Uniform() * total;
+                int f = int(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin());
+                samples[i].face = std::min(f, last);
+                samples[i].bary = rng.Barycentric();
+            }
+        }
+        return samples;
+    }
+
+    static std::vector<FaceSample> PerFace(MeshType &m, const std::vector<int> &count, unsigned int seed)
+    {
+        const int fn = (int) count.size();
+        std::vector<size_t> offset(fn + 1, 0);
+        for (int i = 0; i < fn; ++i)
+            offset[i + 1] = offset[i] + count[i];
+        std::vector<FaceSample> samples(offset[fn]);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < BlockNum(fn); ++b) {
+            Stream rng(seed, FaceStream, b);
+            for (int i = b * BlockSize; i < std::min(fn, (b + 1) * BlockSize); ++i)
+                for (size_t k = offset[i]; k < offset[i + 1]; ++k) {
+                    samples[k].face = i;
+                    samples[k].bary = rng.Barycentric();
+                }
+        }
+        return samples;
+    }
+
+    // sorts chunks in parallel, then merges them pairwise
+    template <class T>
+    static void ParallelSort(std::vector<T> &v)
+    {
+        const int n = (int) v.size();
+        int chunks = 1;
+#ifdef _OPENMP
+        while (chunks < omp_get_max_threads() && n / (chunks * 2) > 65536)
+            chunks *= 2;
+#endif
+        std::vector<int> bound(chunks + 1);
+        for (int c = 0; c <= chunks; ++c)
+            bound[c] = int((long long) n * c / chunks);
+        #pragma omp parallel for schedule(static, 1)
+        for (int c = 0; c < chunks; ++c)
+            std::sort(v.begin() + bound[c], v.begin() + bound[c + 1]);
+        for (int width = 1; width < chunks; width *= 2) {
+            #pragma omp parallel for schedule(static, 1)
+            for (int c = 0; c < chunks - width; c += 2 * width)
+                std::inplace_merge(v.begin() + bound[c],
+                                   v.begin() + bound[c + width],
+                                   v.begin() + bound[std::min(chunks, c + 2 * width)]);
+        }
+    }
+};
+
+} // namespace tri
+} // namespace vcg
+
+#endif // __PARALLELSAMPLING
@@ -0,0 +1,519 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "sparse_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include <common/utilities/face_bvh.h>
+#include <vcg/complex/algorithms/create/marching_cubes.h>
+#include <vcg/complex/algorithms/update/bounding.h>
+#include <vcg/complex/algorithms/update/normal.h>
+
+using namespace vcg;
+using meshlab::FaceBVH;
+
+namespace {
+
+typedef uint64_t EdgeKey;
+
+const EdgeKey NO_KEY = std::numeric_limits<EdgeKey>::max();
+const int     BLOCK  = SparseResampler::BLOCK_SIZE;
+// blocks processed between two calls of the progress callback
+const int BLOCK_BATCH = 256;
+
+// the points of the volume are (i, j, k), with 0 <= i <= dim[0] and so on, as in vcg::BasicGrid
+class VolumeGrid
+{
+public:
+	VolumeGrid(const Box3m& box, const Point3i& dim) : box(box), dim(dim)
+	{
+		for (int i = 0; i < 3; ++i) {
+			voxel[i]    = (box.max[i] - box.min[i]) / dim[i];
+			blockNum[i] = (dim[i] + BLOCK - 1) / BLOCK;
+		}
+	}
+
+	Point3m toWorld(const Point3m& ip) const
+	{
+		Point3m p;
+		for (int i = 0; i < 3; ++i)
+			p[i] = ip[i] * voxel[i] + box.min[i];
+		return p;
+	}
+
+	EdgeKey edgeKey(const Point3i& p, int axis) const
+	{
+		EdgeKey pi = EdgeKey(p[0]) + EdgeKey(dim[0] + 1) * (EdgeKey(p[1]) + EdgeKey(dim[1] + 1) * EdgeKey(p[2]));
+		return pi * 3 + axis;
+	}
+
+	// true if the edge from p along the axis lies on the boundary between two blocks
+	bool sharedEdge(const Point3i& p, int axis) const
+	{
+		for (int i = 0; i < 3; ++i)
+			if (i != axis && p[i] % BLOCK == 0 && p[i] > 0 && p[i] < dim[i])
+				return true;
+		return false;
+	}
+
+	Box3m   box;
+	Point3i dim;
+	Point3m voxel;
+	Point3i blockNum;
+};
+
+// the (signed) distance field of vcg::tri::Resampler, computed with a FaceBVH
+class DistanceField
+{
+public:
+	struct Value
+	{
+		bool    valid; // false if the mesh is farther than maxDist
+		Scalarm v;
+	};
+
+	DistanceField(
+		const CMeshO&     m,
+		const VolumeGrid& grid,
+		Scalarm           maxDist,
+		Scalarm           offset,
+		bool              discretize,
+		bool              multiSample,
+		bool              absDist) :
+			m(m),
+			grid(grid),
+			bvh(m),
+			maxDist(maxDist),
+			offset(offset),
+			discretize(discretize),
+			multiSample(multiSample),
+			absDist(absDist)
+	{
+	}
+
+	// the value of the field at a grid point, as the Walker::V of the Resampler
+	Value value(const Point3i& ip, FaceBVH::PointHit& hint) const
+	{
+		Point3m p(ip[0], ip[1], ip[2]);
+		Value   d = multiSample ? multiDistance(p, hint) : distance(p, hint);
+		if (d.valid) {
+			if (discretize)
+				d.v = d.v + offset < 0 ? -1 : 1;
+			else
+				d.v += offset;
+		}
+		return d;
+	}
+
+private:
+	Value distance(const Point3m& ip, FaceBVH::PointHit& hint) const
+	{
+		const Point3m testPt = grid.toWorld(ip);
+		if (!bvh.closestPoint(testPt, maxDist, hint))
+			return Value {false, 0};
+		Scalarm dist = hint.dist;
+		if (absDist)
+			return Value {true, dist};
+
+		const CFaceO& f = m.face[hint.face];
+		const Point3m pip(1 - hint.u - hint.v, hint.u, hint.v);
+		const Scalarm interpolationEpsilon = 0.00001f;
+		int           zeroCnt              = 0;
+		for (int i = 0; i < 3; ++i)
+			if (pip[i] < interpolationEpsilon)
+				++zeroCnt;
+
+		Point3m dir = testPt - hint.point;
+		dir.Normalize();
+		Scalarm signBest;
+		if (zeroCnt == 0) { // the closest point is inside the face
+			signBest = dir.dot(f.cN());
+		}
+		else { // on an edge or a vertex: use the interpolated vertex normals
+			Point3m n = f.cV(0)->cN() * pip[0] + f.cV(1)->cN() * pip[1] + f.cV(2)->cN() * pip[2];
+			signBest  = dir.dot(n);
+		}
+		if (signBest < 0)
+			dist = -dist;
+		return Value {true, dist};
+	}
+
+	Value multiDistance(const Point3m& ip, FaceBVH::PointHit& hint) const
+	{
+		const int     multiSampleNum        = 7;
+		const Point3m delta[multiSampleNum] = {
+			Point3m(0, 0, 0),
+			Point3m(0.2, -0.01, -0.02),
+			Point3m(-0.2, 0.01, 0.02),
+			Point3m(0.01, 0.2, 0.01),
+			Point3m(0.03, -0.2, -0.03),
+			Point3m(-0.02, -0.03, 0.2),
+			Point3m(-0.01, 0.01, -0.2)};
+
+		Scalarm distSum     = 0;
+		int     positiveCnt = 0;
+		for (int i = 0; i < multiSampleNum; ++i) {
+			Value d = distance(ip + delta[i], hint);
+			if (!d.valid)
+				return Value {false, 0};
+			distSum += std::fabs(d.v);
+			if (d.v > 0)
+				++positiveCnt;
+		}
+		if (positiveCnt <= multiSampleNum / 2)
+			distSum = -distSum;
+		return Value {true, distSum / multiSampleNum};
+	}
+
+	const CMeshO&     m;
+	const VolumeGrid& grid;
+	FaceBVH           bvh;
+	Scalarm           maxDist;
+	Scalarm           offset;
+	bool              discretize;
+	bool              multiSample;
+	bool              absDist;
+};
+
+// the part of the isosurface extracted from a block, in grid coords
+struct BlockMesh
+{
+	std::vector<Point3m> pos;
+	std::vector<EdgeKey> keys;  // per vertex, NO_KEY if not on an edge shared with other blocks
+	std::vector<int>     faces; // three vertex indices per face
+};
+
+// MarchingCubes walker over the field of a single block
+class BlockWalker
+{
+public:
+	typedef CMeshO::VertexPointer VertexPointer;
+
+	BlockWalker(const VolumeGrid& grid, const Point3i& block) : grid(grid)
+	{
+		for (int i = 0; i < 3; ++i) {
+			origin[i] = block[i] * BLOCK;
+			size[i]   = std::min(BLOCK, grid.dim[i] - origin[i]) + 1;
+		}
+		values.resize(size_t(size[0]) * size[1] * size[2]);
+		edgeVert.assign(values.size() * 3, -1);
+	}
+
+	void computeField(const DistanceField& field)
+	{
+		FaceBVH::PointHit hint;
+		Point3i           p;
+		for (p[2] = 0; p[2] < size[2]; ++p[2])
+			for (p[1] = 0; p[1] < size[1]; ++p[1])
+				for (p[0] = 0; p[0] < size[0]; ++p[0])
+					values[localIndex(p)] = field.value(origin + p, hint);
+	}
+
+	void extract(BlockMesh& res)
+	{
+		CMeshO m;
+		mesh = &m;
+		keys.clear();
+		tri::MarchingCubes<CMeshO, BlockWalker> mc(m, *this);
+		mc.Initialize();
+		// cells in the same order of the slices of the Resampler
+		Point3i c;
+		for (c[1] = 0; c[1] < size[1] - 1; ++c[1])
+			for (c[0] = 0; c[0] < size[0] - 1; ++c[0])
+				for (c[2] = 0; c[2] < size[2] - 1; ++c[2])
+					if (validCell(c)) {
+						addCrossedEdges(c);
+						mc.ProcessCell(origin + c, origin + c + Point3i(1, 1, 1));
+					}
+		mc.Finalize();
+		mesh = nullptr;
+
+		keys.resize(m.vert.size(), NO_KEY);
+		res.keys.swap(keys);
+		res.pos.resize(m.vert.size());
+		for (size_t i = 0; i < m.vert.size(); ++i)
+			res.pos[i] = m.vert[i].cP();
+		res.faces.clear();
+		res.faces.reserve(m.face.size() * 3);
+		for (const CFaceO& f : m.face)
+			if (!f.IsD())
+				for (int k = 0; k < 3; ++k)
+					res.faces.push_back(int(tri::Index(m, f.cV(k))));
+	}
+
+	// MarchingCubes walker interface, in global grid coords
+	Scalarm V(int i, int j, int k) const { return values[localIndex(Point3i(i, j, k) - origin)].v; }
+
+	void GetXIntercept(const Point3i& p1, const Point3i& p2, VertexPointer& v) { v = intercept(p1, p2); }
+	void GetYIntercept(const Point3i& p1, const Point3i& p2, VertexPointer& v) { v = intercept(p1, p2); }
+	void GetZIntercept(const Point3i& p1, const Point3i& p2, VertexPointer& v) { v = intercept(p1, p2); }
+
+	// only a lookup: MarchingCubes holds a pointer to the vertex it has just
+	// added in the middle of an ambiguous cell while it calls Exist on the
+	// edges of the cell, so no vertex can be added here
+	bool Exist(const Point3i& p0, const Point3i& p1, VertexPointer& v)
+	{
+		const int vi = edgeVert[edgeIndex(p0, p1)];
+		v = vi < 0 ? nullptr : &mesh->vert[vi];
+		return v != nullptr;
+	}
+
+private:
+	size_t localIndex(const Point3i& lp) const
+	{
+		return lp[0] + size_t(size[0]) * (lp[1] + size_t(size[1]) * lp[2]);
+	}
+
+	bool validCell(const Point3i& c) const
+	{
+		for (int k = 0; k < 8; ++k)
+			if (!values[localIndex(c + Point3i(k & 1, (k >> 1) & 1, (k >> 2) & 1))].valid)
+				return false;
+		return true;
+	}
+
+	size_t edgeIndex(const Point3i& p1, const Point3i& p2) const
+	{
+		const Point3i& p    = (p2[0] < p1[0] || p2[1] < p1[1] || p2[2] < p1[2]) ? p2 : p1;
+		const int      axis = p1[0] != p2[0] ? 0 : (p1[1] != p2[1] ? 1 : 2);
+		return localIndex(p - origin) * 3 + axis;
+	}
+
+	// creates the vertices of all the crossed edges of the cell c (in local
+	// coords) before the cell is processed, so that the vertex added in the
+	// middle of an ambiguous cell is the mean of all of them, whatever the
+	// cells already processed (and therefore the boundaries of the blocks)
+	void addCrossedEdges(const Point3i& c)
+	{
+		for (int axis = 0; axis < 3; ++axis) {
+			Point3i d(0, 0, 0);
+			d[axis] = 1;
+			const int a1 = (axis + 1) % 3, a2 = (axis + 2) % 3;
+			for (int k = 0; k < 4; ++k) {
+				Point3i p1 = origin + c;
+				p1[a1] += k & 1;
+				p1[a2] += k >> 1;
+				const Point3i p2 = p1 + d;
+				const Scalarm f1 = V(p1[0], p1[1], p1[2]);
+				const Scalarm f2 = V(p2[0], p2[1], p2[2]);
+				if ((f1 > 0) != (f2 > 0) || (f1 < 0) != (f2 < 0))
+					intercept(p1, p2);
+			}
+		}
+	}
+
+	VertexPointer intercept(Point3i p1, Point3i p2)
+	{
+		if (p2[0] < p1[0] || p2[1] < p1[1] || p2[2] < p1[2])
+			std::swap(p1, p2);
+		const int axis = p1[0] != p2[0] ? 0 : (p1[1] != p2[1] ? 1 : 2);
+		int&      vi   = edgeVert[edgeIndex(p1, p2)];
+		if (vi < 0) {
+			const Scalarm f1 = V(p1[0], p1[1], p1[2]);
+			const Scalarm f2 = V(p2[0], p2[1], p2[2]);
+			vi = int(mesh->vert.size());
+			tri::Allocator<CMeshO>::AddVertices(*mesh, 1);
+			// linear interpolation along the edge, as the Resampler
+			const Scalarm u = f1 / (f1 - f2);
+			Point3m       pos(p1[0], p1[1], p1[2]);
+			pos[axis]          = p1[axis] * (1 - u) + u * p2[axis];
+			mesh->vert[vi].P() = pos;
+			keys.resize(vi + 1, NO_KEY);
+			if (grid.sharedEdge(p1, axis))
+				keys[vi] = grid.edgeKey(p1, axis);
+		}
+		return &mesh->vert[vi];
+	}
+
+	const VolumeGrid&                 grid;
+	Point3i                           origin; // first point of the block
+	Point3i                           size;   // points per side
+	std::vector<DistanceField::Value> values;
+	std::vector<int>                  edgeVert; // per point and axis, vertex on the edge or -1
+	std::vector<EdgeKey>              keys;
+	CMeshO*                           mesh = nullptr;
+};
+
+// the blocks with at least a point within the given distance from a face
+std::vector<Point3i> activeBlocks(const CMeshO& m, const VolumeGrid& grid, Scalarm dist)
+{
+	const long long blockNum = (long long) grid.blockNum[0] * grid.blockNum[1] * grid.blockNum[2];
+	std::vector<char> active(blockNum, 0);
+	for (const CFaceO& f : m.face) {
+		if (f.IsD())
+			continue;
+		Box3m fb;
+		for (int k = 0; k < 3; ++k)
+			fb.Add(f.cP(k));
+		fb.Offset(dist);
+		// block b has the points [b*BLOCK, (b+1)*BLOCK] along each axis
+		Point3i b0, b1;
+		bool    empty = false;
+		for (int i = 0; i < 3; ++i) {
+			double lo = (fb.min[i] - grid.box.min[i]) / grid.voxel[i];
+			double hi = (fb.max[i] - grid.box.min[i]) / grid.voxel[i];
+			lo        = std::max(0.0, std::ceil(lo / BLOCK - 1));
+			hi        = std::min(double(grid.blockNum[i] - 1), std::floor(hi / BLOCK));
+			b0[i]     = int(lo);
+			b1[i]     = int(hi);
+			empty     = empty || lo > hi;
+		}
+		if (empty)
+			continue;
+		Point3i b;
+		for (b[2] = b0[2]; b[2] <= b1[2]; ++b[2])
+			for (b[1] = b0[1]; b[1] <= b1[1]; ++b[1])
+				for (b[0] = b0[0]; b[0] <= b1[0]; ++b[0])
+					active[b[0] + grid.blockNum[0] * (b[1] + (long long) grid.blockNum[1] * b[2])] = 1;
+	}
+
+	std::vector<Point3i> res;
+	Point3i              b;
+	for (b[2] = 0; b[2] < grid.blockNum[2]; ++b[2])
+		for (b[1] = 0; b[1] < grid.blockNum[1]; ++b[1])
+			for (b[0] = 0; b[0] < grid.blockNum[0]; ++b[0])
+				if (active[b[0] + grid.blockNum[0] * (b[1] + (long long) grid.blockNum[1] * b[2])])
+					res.push_back(b);
+	return res;
+}
+
+// builds the mesh from the parts extracted by the blocks, unifying the
+// vertices of the shared edges
+void mergeBlocks(const std::vector<BlockMesh>& blocks, const VolumeGrid& grid, CMeshO& m)
+{
+	std::vector<size_t> vertOffset(blocks.size() + 1, 0);
+	std::vector<size_t> faceOffset(blocks.size() + 1, 0);
+	for (size_t b = 0; b < blocks.size(); ++b) {
+		vertOffset[b + 1] = vertOffset[b] + blocks[b].pos.size();
+		faceOffset[b + 1] = faceOffset[b] + blocks[b].faces.size() / 3;
+	}
+	const size_t vertNum = vertOffset.back();
+
+	// each vertex of a shared edge is replaced by the first one with the same key
+	std::vector<std::pair<EdgeKey, size_t>> shared;
+	for (size_t b = 0; b < blocks.size(); ++b)
+		for (size_t i = 0; i < blocks[b].keys.size(); ++i)
+			if (blocks[b].keys[i] != NO_KEY)
+				shared.push_back(std::make_pair(blocks[b].keys[i], vertOffset[b] + i));
+	std::sort(shared.begin(), shared.end());
+	std::vector<size_t> rep(vertNum);
+	for (size_t i = 0; i < vertNum; ++i)
+		rep[i] = i;
+	for (size_t i = 1; i < shared.size(); ++i)
+		if (shared[i].first == shared[i - 1].first)
+			rep[shared[i].second] = rep[shared[i - 1].second];
+
+	// only the vertices used by the faces are kept
+	std::vector<char> used(vertNum, 0);
+	for (size_t b = 0; b < blocks.size(); ++b)
+		for (int v : blocks[b].faces)
+			used[rep[vertOffset[b] + v]] = 1;
+	std::vector<int> newIndex(vertNum, -1);
+	int              usedNum = 0;
+	for (size_t i = 0; i < vertNum; ++i)
+		if (used[i])
+			newIndex[i] = usedNum++;
+
+	tri::Allocator<CMeshO>::AddVertices(m, usedNum);
+	tri::Allocator<CMeshO>::AddFaces(m, faceOffset.back());
+	#pragma omp parallel for schedule(dynamic, 1)
+	for (int b = 0; b < int(blocks.size()); ++b) {
+		const BlockMesh& bm = blocks[b];
+		for (size_t i = 0; i < bm.pos.size(); ++i)
+			if (used[vertOffset[b] + i])
+				m.vert[newIndex[vertOffset[b] + i]].P() = grid.toWorld(bm.pos[i]);
+		for (size_t f = 0; f < bm.faces.size() / 3; ++f) {
+			CFaceO& nf = m.face[faceOffset[b] + f];
+			for (int k = 0; k < 3; ++k)
+				nf.V(k) = &m.vert[newIndex[rep[vertOffset[b] + bm.faces[3 * f + k]]]];
+		}
+	}
+}
+
+} // namespace
+
+/**
+ * @brief Builds in newMesh the isosurface at distance thr from oldMesh,
+ * sampling the distance field in the volumeDim cells of volumeBox. The
+ * parameters are the ones of vcg::tri::Resampler::Resample, and so is the
+ * result, but for the order of the elements and for the vertex added in
+ * the ambiguous cells, that is the mean of all the intersections on the
+ * cell edges.
+ *
+ * As the Resampler, it updates the face and vertex normals of oldMesh.
+ */
+void SparseResampler::resample(
+	CMeshO&           oldMesh,
+	CMeshO&           newMesh,
+	const Box3m&      volumeBox,
+	const Point3i&    volumeDim,
+	Scalarm           maxDist,
+	Scalarm           thr,
+	bool              discretizeFlag,
+	bool              multiSampleFlag,
+	bool              absDistFlag,
+	vcg::CallBackPos* cb,
+	Stats*            stats)
+{
+	tri::UpdateBounding<CMeshO>::Box(oldMesh);
+	// the sign of the distance needs normalized face normals and vertex normals
+	tri::UpdateNormal<CMeshO>::PerFaceNormalized(oldMesh);
+	tri::UpdateNormal<CMeshO>::PerVertexAngleWeighted(oldMesh);
+	newMesh.Clear();
+
+	const VolumeGrid    grid(volumeBox, volumeDim);
+	const Scalarm       searchDist = maxDist + std::fabs(thr);
+	const DistanceField field(oldMesh, grid, searchDist, -thr, discretizeFlag, multiSampleFlag, absDistFlag);
+
+	// multisampling looks for the mesh up to 0.2 voxels away from the grid points
+	const Scalarm              margin = searchDist + 0.25 * std::max(std::max(grid.voxel[0], grid.voxel[1]), grid.voxel[2]);
+	const std::vector<Point3i> active = activeBlocks(oldMesh, grid, margin);
+	if (stats != nullptr) {
+		stats->blockNum       = (long long) grid.blockNum[0] * grid.blockNum[1] * grid.blockNum[2];
+		stats->activeBlockNum = active.size();
+	}
+
+	std::vector<BlockMesh> blocks(active.size());
+	for (size_t begin = 0; begin < active.size(); begin += BLOCK_BATCH) {
+		if (cb != nullptr)
+			cb(int((90 * begin) / active.size()), "Marching ");
+		const int end = int(std::min(active.size(), begin + BLOCK_BATCH));
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int i = int(begin); i < end; ++i) {
+			BlockWalker walker(grid, active[i]);
+			walker.computeField(field);
+			walker.extract(blocks[i]);
+		}
+	}
+
+	if (cb != nullptr)
+		cb(90, "Merging blocks");
+	mergeBlocks(blocks, grid, newMesh);
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_SAMPLING_SPARSE_RESAMPLER_H
+#define FILTER_SAMPLING_SPARSE_RESAMPLER_H
+
+#include <common/ml_document/cmesh.h>
+
+/*
+Uniform mesh resampling, as vcg::tri::Resampler::Resample, on a sparse volume.
+
+The volume is split in blocks of BLOCK_SIZE^3 cells, and the distance field is
+computed only in the blocks that are within maxDist from a face of the mesh
+(the only ones where the field is defined, since the distance is searched up to
+maxDist): the memory depends on the area of the mesh, not on the volume of its
+bounding box. The blocks are processed in parallel: each one computes its field
+with a FaceBVH of the mesh and extracts its part of the isosurface with
+MarchingCubes. The vertices on the edges shared by more blocks are unified by
+the id of their grid edge, so the result is a single connected mesh as the one
+of the dense volume, independent of the number of threads.
+*/
+class SparseResampler
+{
+public:
+	static const int BLOCK_SIZE = 16;
+
+	struct Stats
+	{
+		long long blockNum       = 0; // blocks of the volume
+		long long activeBlockNum = 0; // blocks where the field has been computed
+	};
+
+	static void resample(
+		CMeshO&             oldMesh,
+		CMeshO&             newMesh,
+		const Box3m&        volumeBox,
+		const vcg::Point3i& volumeDim,
+		Scalarm             maxDist,
+		Scalarm             thr,
+		bool                discretizeFlag,
+		bool                multiSampleFlag,
+		bool                absDistFlag,
+		vcg::CallBackPos*   cb    = nullptr,
+		Stats*              stats = nullptr);
+};
+
+#endif // FILTER_SAMPLING_SPARSE_RESAMPLER_H
@@ -0,0 +1,113 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+/*
+Resamples a soup of small randomly oriented triangles: the sign of the field
+changes at almost every grid point, so there are many ambiguous cells, whose
+vertex is added by MarchingCubes while the vertices of the block grow. Meant to
+be run under AddressSanitizer, that reports any access through a vertex
+pointer invalidated by the growth; the output is also checked to reference
+only its own vertices.
+*/
+
+#include <cmath>
+#include <cstdio>
+#include <random>
+
+#include <vcg/complex/allocate.h>
+
+#include "../sparse_resampler.h"
+
+using namespace vcg;
+
+namespace {
+
+void randomSoup(CMeshO& m, int faceNum, unsigned int seed)
+{
+	std::mt19937                           gen(seed);
+	std::uniform_real_distribution<double> u(0, 1);
+	tri::Allocator<CMeshO>::AddVertices(m, 3 * faceNum);
+	tri::Allocator<CMeshO>::AddFaces(m, faceNum);
+	for (int i = 0; i < faceNum; ++i) {
+		const Point3m c(u(gen), u(gen), u(gen));
+		for (int k = 0; k < 3; ++k) {
+			m.vert[3 * i + k].P() = c + Point3m(u(gen), u(gen), u(gen)) * Scalarm(0.05);
+			m.face[i].V(k)        = &m.vert[3 * i + k];
+		}
+	}
+}
+
+bool check(const CMeshO& m, const Box3m& box, const char* name)
+{
+	for (const CVertexO& v : m.vert) {
+		for (int i = 0; i < 3; ++i) {
+			if (!std::isfinite(v.cP()[i])) {
+				std::printf("%s: non finite vertex\n", name);
+				return false;
+			}
+		}
+		if (!box.IsIn(v.cP())) {
+			std::printf("%s: vertex out of the volume\n", name);
+			return false;
+		}
+	}
+	for (const CFaceO& f : m.face) {
+		for (int k = 0; k < 3; ++k) {
+			const CVertexO* v = f.cV(k);
+			if (m.vert.empty() || v < &m.vert.front() || v > &m.vert.back()) {
+				std::printf("%s: face referencing a vertex of another mesh\n", name);
+				return false;
+			}
+		}
+	}
+	if (m.fn == 0) {
+		std::printf("%s: empty isosurface\n", name);
+		return false;
+	}
+	return true;
+}
+
+} // namespace
+
+int main()
+{
+	CMeshO soup;
+	randomSoup(soup, 2000, 1);
+	const Box3m   box(Point3m(-0.1, -0.1, -0.1), Point3m(1.15, 1.15, 1.15));
+	const Point3i dim(50, 50, 50);
+	Box3m         outBox = box;
+	outBox.Offset(box.Diag() * Scalarm(0.01));
+
+	bool ok = true;
+	for (int discretize = 0; discretize < 2; ++discretize) {
+		for (int multiSample = 0; multiSample < 2; ++multiSample) {
+			CMeshO out;
+			SparseResampler::resample(
+				soup, out, box, dim, Scalarm(0.1), Scalarm(0.01), discretize, multiSample, false);
+			char name[64];
+			std::snprintf(name, sizeof(name), "discretize %d multisample %d", discretize, multiSample);
+			ok = check(out, outBox, name) && ok;
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -1,5 +1,6 @@
 #include "filter_sdfgpu.h"
 #include <common/GLExtensionsManager.h>
+#include <common/utilities/face_bvh.h>
 
 #include <vcg/complex/complex.h>
 #include <vcg/complex/algorithms/intersection.h>
@@ -7,9 +8,12 @@
 #include <vcg/space/index/spatial_hashing.h>
 #include <wrap/qt/to_string.h>
 #include <vcg/math/gen_normal.h>
+#include <vcg/space/triangle3.h>
 #include <wrap/qt/checkGLError.h>
 #include <stdio.h>
 #include <assert.h>
+#include <algorithm>
+#include <limits>
 using namespace std;
 using namespace vcg;
 
@@ -159,9 +163,6 @@ std::map<std::string, QVariant> SdfGpuPlugin::applyFilter(
 		unsigned int& /*postConditionMask*/,
 		vcg::CallBackPos *cb)
 {
-	if (glContext == nullptr){
-		throw MLException("Fatal error: glContext not initialized");
-	}
 	MeshModel* mm = md.mm();
 
 	//RETRIEVE PARAMETERS
@@ -187,6 +188,14 @@ std::map<std::string, QVariant> SdfGpuPlugin::applyFilter(
 	//MESH CLEAN UP
 	setupMesh( md, mOnPrimitive );
 
+	//No OpenGL context available (e.g. headless machines): ray cast on the CPU
+	if (glContext == nullptr || !glContext->isValid())
+	{
+		log(GLLogStream::SYSTEM, "OpenGL context not available, computing on the CPU");
+		computeOnCPU(action, *mm, numViews, peel, cb);
+		return std::map<std::string, QVariant>();
+	}
+
 	//glContext->makeCurrent();
 	//GL INIT
 	if(!initGL(*mm))
@@ -262,6 +271,172 @@ std::map<std::string, QVariant> SdfGpuPlugin::applyFilter(
 	return std::map<std::string, QVariant>();
 }
 
+/*
+CPU counterpart of the depth peeling computation: for each direction d of the
+uniform sampling of the sphere and for each vertex (or face barycenter) P with
+normal N, a ray is cast against a BVH of the mesh.
+- SDF: if N*d >= minCos, the ray from P towards -d measures the thickness of
+  the mesh (i.e. the distance between the "front" and the "back" layers of
+  the GPU version); the result is the average thickness weighted by N*d.
+- Obscurance: if N*d > 0, an unoccluded ray along d contributes N*d, an
+  occluded one contributes (1-exp(-tau*dist))*N*d.
+- Depth complexity: a grid of DepthTextureSize x DepthTextureSize parallel
+  rays along -d is cast through the bounding box, counting all the hits.
+Rays are exact, so peelingIteration and peelingTolerance are not needed;
+the removeOutliers option (median filtering of the depth buffer) has no
+counterpart here.
+*/
+void SdfGpuPlugin::computeOnCPU(const QAction* action, MeshModel& mm, unsigned int numberOfRays, int peelingIteration, vcg::CallBackPos* cb)
+{
+	CMeshO& m = mm.cm;
+
+	std::vector<Point3m> dirs;
+	GenNormal<Scalarm>::Fibonacci(numberOfRays, dirs);
+	for (Point3m& d : dirs)
+		d.Normalize();
+	log(GLLogStream::SYSTEM, "Number of rays: %i ", dirs.size() );
+
+	meshlab::FaceBVH bvh(m);
+	const Scalarm bbDiag  = m.bbox.Diag();
+	const Scalarm eps     = bbDiag * 1e-4;
+	const Scalarm maxDist = std::numeric_limits<Scalarm>::max();
+
+	if (ID(action) == SDF_DEPTH_COMPLEXITY)
+	{
+		const int     res    = mPeelingTextureSize;
+		const Scalarm d      = bbDiag / 2.0;
+		const Point3m center = m.bbox.Center();
+		std::vector<int> depthDistrib(peelingIteration, 0);
+		for (size_t j = 0; j < dirs.size(); ++j)
+		{
+			const Point3m& dir = dirs[j];
+			Point3m u = (std::abs(dir.X()) > 0.9 ? Point3m(0, 1, 0) : Point3m(1, 0, 0)) ^ dir;
+			u.Normalize();
+			Point3m v = dir ^ u;
+			const Point3m eye = center + dir * (d + 0.1);
+
+			std::vector<int> rowLayers(res, 0);
+			#pragma omp parallel for schedule(dynamic, 4)
+			for (int y = 0; y < res; ++y)
+			{
+				for (int x = 0; x < res; ++x)
+				{
+					Point3m o = eye + u * (d * (2.0 * (x + 0.5) / res - 1.0)) + v * (d * (2.0 * (y + 0.5) / res - 1.0));
+					rowLayers[y] = std::max(rowLayers[y], (int) bvh.countHits(o, -dir, 0, maxDist));
+				}
+			}
+			int layers = rowLayers.empty() ? 0 : *std::max_element(rowLayers.begin(), rowLayers.end());
+			mDepthComplexity = std::max(mDepthComplexity, (unsigned int) layers);
+			if (layers < peelingIteration)
+				depthDistrib[layers]++;
+			if (cb)
+				cb(100*((float)j/(float)dirs.size()), "Tracing rays...");
+		}
+
+		log(GLLogStream::SYSTEM, "Mesh depth complexity %i\n", mDepthComplexity );
+		log(GLLogStream::SYSTEM, "Depth complexity             NumberOfViews\n" );
+		for (int j = 0; j < peelingIteration; j++)
+			log(GLLogStream::SYSTEM, "   %i                             %i\n", j, depthDistrib[j] );
+		mDepthComplexity = 0;
+		return;
+	}
+
+	const bool onVertices = (mOnPrimitive == ON_VERTICES);
+	const int  n          = onVertices ? m.vn : m.fn;
+	if (!onVertices)
+		tri::UpdateNormal<CMeshO>::PerFaceNormalized(m);
+
+	CMeshO::PerVertexAttributeHandle<Point3f> dirPerVertex;
+	CMeshO::PerFaceAttributeHandle<Point3f>   dirPerFace;
+	if (onVertices)
+		dirPerVertex = tri::Allocator<CMeshO>::GetPerVertexAttribute<Point3f>(m, std::string("maxQualityDir"));
+	else
+		dirPerFace = tri::Allocator<CMeshO>::GetPerFaceAttribute<Point3f>(m, std::string("maxQualityDir"));
+
+	const bool isSdf = (ID(action) == SDF_SDF);
+
+	//the parallel loop is split in blocks to report the progress from the main thread
+	const int blockSize = std::max(n / 100, 1024);
+	for (int begin = 0; begin < n; begin += blockSize)
+	{
+		const int end = std::min(begin + blockSize, n);
+		if (cb)
+			cb(100*((float)begin/(float)n), "Tracing rays...");
+
+		#pragma omp parallel for schedule(dynamic, 64)
+		for (int i = begin; i < end; ++i)
+		{
+			Point3m p, nrm;
+			if (onVertices)
+			{
+				p   = m.vert[i].cP();
+				nrm = m.vert[i].cN();
+			}
+			else
+			{
+				p   = Barycenter(m.face[i]);
+				nrm = m.face[i].cN();
+			}
+			nrm.Normalize();
+
+			Scalarm sum = 0, weightSum = 0;
+			Point3m dirSum(0, 0, 0);
+			for (const Point3m& d : dirs)
+			{
+				const Scalarm cosAngle = nrm.dot(d);
+				if (cosAngle <= 0)
+					continue;
+				meshlab::FaceBVH::RayHit hit;
+				Scalarm value = 0;
+				if (isSdf)
+				{
+					if (cosAngle < mMinCos || !bvh.closestHit(p, -d, eps, maxDist, hit))
+						continue;
+					if (mRemoveFalse && hit.normal.dot(nrm) > 0)
+						continue;
+					value = hit.t * cosAngle;
+					weightSum += cosAngle;
+				}
+				else
+				{
+					if (bvh.closestHit(p, d, eps, maxDist, hit))
+						value = std::max<Scalarm>(0, 1.0 - std::exp(-mTau * hit.t)) * cosAngle;
+					else
+						value = cosAngle;
+				}
+				sum    += value;
+				dirSum += d * value;
+			}
+
+			Scalarm q;
+			if (isSdf)
+				q = weightSum > 0 ? sum / weightSum : 0;
+			else
+				q = sum / dirs.size();
+			dirSum.Normalize();
+
+			if (onVertices)
+			{
+				m.vert[i].Q()   = q;
+				dirPerVertex[i] = Point3f::Construct(dirSum);
+			}
+			else
+			{
+				m.face[i].Q()   = q;
+				dirPerFace[i]   = Point3f::Construct(dirSum);
+			}
+		}
+	}
+
+	if (!isSdf)
+	{
+		if (onVertices)
+			tri::UpdateColor<CMeshO>::PerVertexQualityGray(m, 0.0f, 0.0f);
+		else
+			tri::UpdateColor<CMeshO>::PerFaceQualityGray(m);
+	}
+}
+
 bool SdfGpuPlugin::initGL(MeshModel& mm)
 {
 	const unsigned int numVertices = mm.cm.vn;
@@ -611,7 +786,8 @@ void SdfGpuPlugin::setupMesh(MeshDocument& md, ONPRIMITIVE onPrimitive )
 	else if(!vcg::tri::HasPerFaceAttribute(m,"maxQualityDir") && onPrimitive == ON_FACES)
 		mMaxQualityDirPerFace = vcg::tri::Allocator<CMeshO>::AddPerFaceAttribute<Point3f>(m,std::string("maxQualityDir"));
 
-	glContext->meshAttributesUpdated(mm->id(),true,MLRenderingData::RendAtts());
+	if (glContext != nullptr)
+		glContext->meshAttributesUpdated(mm->id(),true,MLRenderingData::RendAtts());
 
 }
 
@@ -57,6 +57,9 @@ class SdfGpuPlugin : public QObject, public FilterPlugin
 	//Mesh setup
 	void setupMesh(MeshDocument& md, ONPRIMITIVE onprim );
 	
+	//Sdf, obscurance or depth complexity computed by ray casting on the CPU, used when no OpenGL context is available
+	void computeOnCPU(const QAction* action, MeshModel& mm, unsigned int numberOfRays, int peelingIteration, vcg::CallBackPos* cb);
+	
 	//Init OpenGL context
 	bool initGL(MeshModel& mm);
 	
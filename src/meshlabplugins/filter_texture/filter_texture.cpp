@@ -33,6 +33,7 @@
 #include<wrap/io_trimesh/export_ply.h>
 #include <vcg/complex/algorithms/parametrization/voronoi_atlas.h>
 #include <common/utilities/load_save.h>
+#include <common/utilities/texture_raster.h>
 #include <QStandardPaths>
 
 using namespace vcg;
@@ -205,6 +206,25 @@ static QString extractFilenameTexture(const MeshModel* mm)
 	//fileName = fi.absolutePath() + "/" + fileName;
 	return fileName;
 }
+
+// Reverts to 255 the alpha of the texels written outside the border edges
+// (and, without the pull push filling, of the empty ones)
+static void revertBorderAlpha(QImage& img, bool pp)
+{
+	assert(img.format() == QImage::Format_ARGB32);
+	const int h = img.height();
+	const int w = img.width();
+	uchar*    bits = img.bits();
+	#pragma omp parallel for schedule(static)
+	for (int y = 0; y < h; ++y) {
+		QRgb* row = reinterpret_cast<QRgb*>(bits + size_t(y) * img.bytesPerLine());
+		for (int x = 0; x < w; ++x) {
+			QRgb px = row[x];
+			if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
+				row[x] = px | 0xff000000;
+		}
+	}
+}
 	
 // This function define the needed parameters for each filter. Return true if the filter has some parameters
 // it is called every time, so you can set the default value of parameters according to the mesh
@@ -766,8 +786,7 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 
 		// Rasterizing triangles
 		RasterSampler rs(trgImgs);
-		rs.InitCallback(cb, m.cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO,RasterSampler>::Texture(m.cm,rs,textW,textH,true);
+		meshlab::TextureRaster<CMeshO>::rasterize(m.cm, rs, textW, textH, true, cb, 0, 80);
 
 		// Undo topology changes
 		tri::UpdateTopology<CMeshO>::FaceFace(m.cm);
@@ -777,13 +796,7 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 		{
 			// Revert alpha values for border edge pixels to 255
 			cb(81, "Cleaning up texture ...");
-			for (int y = 0; y<textH; ++y)
-				for (int x = 0; x<textW; ++x)
-				{
-					QRgb px = trgImgs[texInd].pixel(x, y);
-					if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-						trgImgs[texInd].setPixel(x, y, px | 0xff000000);
-				}
+			revertBorderAlpha(trgImgs[texInd], pp);
 
 			// PullPush
 			if (pp)
@@ -835,7 +848,6 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 		}
 		
 		trgMesh->updateDataMask(MeshModel::MM_VERTCOLOR);
-		srcMesh->updateDataMask(MeshModel::MM_FACEMARK);
 		
 		// the meshes have to be transformed
 		// only if source different from target (if single mesh, it does not matter)
@@ -847,11 +859,9 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 				tri::UpdatePosition<CMeshO>::Matrix(trgMesh->cm, trgMesh->cm.Tr, true);
 		}
 		
-		tri::UpdateNormal<CMeshO>::PerFaceNormalized(srcMesh->cm);
 		// Colorizing vertices
 		VertexSampler vs(srcMesh->cm, srcImgs, upperbound);
-		vs.InitCallback(cb, trgMesh->cm.vn);
-		tri::SurfaceSampling<CMeshO,VertexSampler>::VertexUniform(trgMesh->cm,vs,trgMesh->cm.vn);
+		vs.AddAllVertices(trgMesh->cm);
 		
 		// the meshes have to return to their original position
 		// only if source different from target (if single mesh, it does not matter)
@@ -862,8 +872,6 @@ std::map<std::string, QVariant> FilterTexturePlugin::applyFilter(
 			if (trgMesh->cm.Tr != Matrix44m::Identity())
 				tri::UpdatePosition<CMeshO>::Matrix(trgMesh->cm, Inverse(trgMesh->cm.Tr), true);
 		}
-		
-		srcMesh->clearDataMask(MeshModel::MM_FACEMARK);
 	}
 		break;
 		
@@ -1019,19 +1027,15 @@ void FilterTexturePlugin::transferToTexture(
 	}
 
 	// Rasterizing faces
-	srcMesh->updateDataMask(MeshModel::MM_FACEMARK);
-	tri::UpdateNormal<CMeshO>::PerFaceNormalized(srcMesh->cm);
 	if (vertexSampling)
 	{
 		TransferColorSampler sampler(srcMesh->cm, trgImgs, upperbound, vertexMode); // color sampling
-		sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+		meshlab::TextureRaster<CMeshO>::rasterize(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 	}
 	else
 	{
 		TransferColorSampler sampler(srcMesh->cm, trgImgs, &srcImgs, upperbound); // texture sampling
-		sampler.InitCallback(cb, trgMesh->cm.fn, 0, 80);
-		tri::SurfaceSampling<CMeshO, TransferColorSampler>::Texture(trgMesh->cm, sampler, textW, textH, false);
+		meshlab::TextureRaster<CMeshO>::rasterize(trgMesh->cm, sampler, textW, textH, false, cb, 0, 80);
 	}
 
 	// the meshes have to return to their original position
@@ -1052,13 +1056,7 @@ void FilterTexturePlugin::transferToTexture(
 	{
 		// Revert alpha values for border edge pixels to 255
 		cb(81, "Cleaning up texture ...");
-		for (int y = 0; y<textH; ++y)
-			for (int x = 0; x<textW; ++x)
-			{
-				QRgb px = trgImgs[trgTexInd].pixel(x, y);
-				if (qAlpha(px) < 255 && (!pp || qAlpha(px) > 0))
-					trgImgs[trgTexInd].setPixel(x, y, px | 0xff000000);
-			}
+		revertBorderAlpha(trgImgs[trgTexInd], pp);
 
 		// PullPush
 		if (pp)
@@ -24,6 +24,11 @@
 #ifndef _PUSHPULL_H
 #define _PUSHPULL_H
 
+#include <cassert>
+#include <vector>
+
+#include <QImage>
+
 typedef unsigned char Byte;
 
 
@@ -49,100 +54,121 @@ namespace vcg
 
     }
 
+    // a level of the pull push pyramid, as raw ARGB32 pixels stored by rows
+    struct PullPushLevel
+    {
+        QRgb *bits;
+        int width, height;
+        int stride; // in pixels
+
+        QRgb *row(int y) const { return bits + size_t(y)*stride; }
+    };
+
     // Genera una mipmap pesata
-    void PullPushMip( QImage & p, QImage & mip, QRgb  bkcolor )
+    void PullPushMip( const PullPushLevel & p, const PullPushLevel & mip, QRgb  bkcolor )
     {
-        assert(p.width()/2==mip.width());
-        assert(p.height()/2==mip.height());
-        Byte w1,w2,w3,w4;
-        int x,y;
-        for(y=0;y<mip.height();++y)
-            for(x=0;x<mip.width();++x)
+        assert(p.width/2==mip.width);
+        assert(p.height/2==mip.height);
+        #pragma omp parallel for schedule(static)
+        for(int y=0;y<mip.height;++y)
+        {
+            const QRgb *p0 = p.row(y*2);
+            const QRgb *p1 = p.row(y*2+1);
+            QRgb *m = mip.row(y);
+            for(int x=0;x<mip.width;++x)
             {
-                if(p.pixel(x*2  ,y*2  )==bkcolor) w1=0; else w1=255;
-                if(p.pixel(x*2+1,y*2  )==bkcolor) w2=0; else w2=255;
-                if(p.pixel(x*2  ,y*2+1)==bkcolor) w3=0; else w3=255;
-                if(p.pixel(x*2+1,y*2+1)==bkcolor) w4=0; else w4=255;
-                if(w1+w2+w3+w4>0        )
-                    mip.setPixel(x, y, mean4Pixelw(
-                                                   p.pixel(x*2  ,y*2  ),w1,
-                                                   p.pixel(x*2+1,y*2  ),w2,
-                                                   p.pixel(x*2  ,y*2+1),w3,
-                                                   p.pixel(x*2+1,y*2+1),w4 ));
+                const QRgb c1=p0[x*2], c2=p0[x*2+1], c3=p1[x*2], c4=p1[x*2+1];
+                const Byte w1 = c1==bkcolor ? 0 : 255;
+                const Byte w2 = c2==bkcolor ? 0 : 255;
+                const Byte w3 = c3==bkcolor ? 0 : 255;
+                const Byte w4 = c4==bkcolor ? 0 : 255;
+                if(w1+w2+w3+w4>0)
+                    m[x] = mean4Pixelw(c1,w1,c2,w2,c3,w3,c4,w4);
             }
+        }
     }
 
     // interpola a partire da una mipmap
-    void PullPushFill( QImage & p, QImage & mip, QRgb  bkg )
+    void PullPushFill( const PullPushLevel & p, const PullPushLevel & mip, QRgb  bkg )
     {
-        assert(p.width()/2==mip.width());
-        assert(p.height()/2==mip.height());
-        //      byte w1,w2,w3,w4;
-        int x,y;
-        for(y=0;y<mip.height();++y)
-            for(x=0;x<mip.width();++x)
+        assert(p.width/2==mip.width);
+        assert(p.height/2==mip.height);
+        const int lastX = mip.width-1;
+        const int lastY = mip.height-1;
+        #pragma omp parallel for schedule(static)
+        for(int y=0;y<mip.height;++y)
+        {
+            QRgb *p0 = p.row(y*2);
+            QRgb *p1 = p.row(y*2+1);
+            const QRgb *m  = mip.row(y);
+            const QRgb *mu = y>0     ? mip.row(y-1) : 0; // row above
+            const QRgb *md = y<lastY ? mip.row(y+1) : 0; // row below
+            for(int x=0;x<mip.width;++x)
             {
-                if(p.pixel(x*2 ,y*2)==bkg)
-                    p.setPixel(x*2 ,y*2 ,mean4Pixelw( mip.pixel(x  ,y  ) ,  Byte(144),
-                                                     (x>0 ? mip.pixel(x-1,y  ) : bkg),  (x>0 ? Byte( 48) : 0),
-                                                     (y>0 ? mip.pixel(x  ,y-1) : bkg),  (y>0 ? Byte( 48) : 0),
-                                                     ((x>0 && y>0 )? mip.pixel(x-1,y-1) : bkg), ((x>0 && y>0 )? Byte( 16) : 0)));
-                if(p.pixel(x*2+1,y*2  )==bkg)
-                    p.setPixel(x*2+1,y*2  ,mean4Pixelw(mip.pixel(x  ,y  ) ,Byte(144),
-                                                       (x<mip.width()-1 ? mip.pixel(x+1,y) : bkg),  (x<mip.width()-1 ? Byte( 48) : 0),
-                                                       (y>0  ? mip.pixel(x  ,y-1) : bkg),  (y>0  ? Byte( 48) : 0),
-                                                       ((x<mip.width()-1 && y>0) ? mip.pixel(x+1,y-1) : bkg), ((x<mip.width()-1 && y>0) ? Byte( 16) : 0)));
-                if(p.pixel(x*2  ,y*2+1)==bkg)
-                    p.setPixel(x*2  ,y*2+1, mean4Pixelw( mip.pixel(x  ,y  ), Byte(144),
-                                                        (x>0 ? mip.pixel(x-1,y  ) : bkg),  (x>0 ? Byte( 48) : 0),
-                                                        (y<mip.height()-1  ? mip.pixel(x  ,y+1) : bkg),  (y<mip.height()-1  ? Byte( 48) : 0),
-                                                        ((x>0 && y<mip.height()-1) ? mip.pixel(x-1,y+1) : bkg), ((x>0 && y<mip.height()-1 )? Byte( 16) : 0)));
-                if(p.pixel(x*2+1,y*2+1)==bkg)
-                    p.setPixel(x*2+1,y*2+1, mean4Pixelw(mip.pixel(x  ,y  ), Byte(144),
-                                                        (x<mip.width()-1 ? mip.pixel(x+1,y  ) : bkg), (x<mip.width()-1 ? Byte( 48) : 0),
-                                                        (y<mip.height()-1  ? mip.pixel(x  ,y+1) : bkg), ( y<mip.height()-1  ? Byte( 48) : 0),
-                                                        ((x<mip.width()-1  && y<mip.height()-1) ? mip.pixel(x+1,y+1) : bkg), ((x<mip.width()-1  && y<mip.height()-1) ? Byte( 16) : 0)));
-
+                const bool l = x>0, r = x<lastX;
+                if(p0[x*2]==bkg)
+                    p0[x*2] = mean4Pixelw( m[x], Byte(144),
+                                           (l ? m[x-1] : bkg), (l ? Byte( 48) : 0),
+                                           (mu ? mu[x] : bkg), (mu ? Byte( 48) : 0),
+                                           ((l && mu) ? mu[x-1] : bkg), ((l && mu) ? Byte( 16) : 0));
+                if(p0[x*2+1]==bkg)
+                    p0[x*2+1] = mean4Pixelw( m[x], Byte(144),
+                                             (r ? m[x+1] : bkg), (r ? Byte( 48) : 0),
+                                             (mu ? mu[x] : bkg), (mu ? Byte( 48) : 0),
+                                             ((r && mu) ? mu[x+1] : bkg), ((r && mu) ? Byte( 16) : 0));
+                if(p1[x*2]==bkg)
+                    p1[x*2] = mean4Pixelw( m[x], Byte(144),
+                                           (l ? m[x-1] : bkg), (l ? Byte( 48) : 0),
+                                           (md ? md[x] : bkg), (md ? Byte( 48) : 0),
+                                           ((l && md) ? md[x-1] : bkg), ((l && md) ? Byte( 16) : 0));
+                if(p1[x*2+1]==bkg)
+                    p1[x*2+1] = mean4Pixelw( m[x], Byte(144),
+                                             (r ? m[x+1] : bkg), (r ? Byte( 48) : 0),
+                                             (md ? md[x] : bkg), (md ? Byte( 48) : 0),
+                                             ((r && md) ? md[x+1] : bkg), ((r && md) ? Byte( 16) : 0));
             }
+        }
     }
 
-
+    /* The pyramid works on raw pixels: the first level is the memory of the
+     * image itself (converted to ARGB32 if needed), the others are plain
+     * buffers. The rows of a level are processed in parallel. */
     void PullPush( QImage & p, QRgb  bkcolor )
     {
-        int i=0;
-        std::vector<QImage> mip(16);
-        int div=2;
-        int miplev=0;
+        const QImage::Format format = p.format();
+        if(format!=QImage::Format_ARGB32)
+            p = p.convertToFormat(QImage::Format_ARGB32);
+
+        PullPushLevel base;
+        base.bits = reinterpret_cast<QRgb *>(p.bits());
+        base.width = p.width();
+        base.height = p.height();
+        base.stride = p.bytesPerLine()/sizeof(QRgb);
+
+        std::vector<std::vector<QRgb> > buffers;
+        std::vector<PullPushLevel> mip;
 
         // pull phase create the mipmap
         while(1){
-            mip[miplev]= QImage(p.width()/div,p.height()/div,p.format());
-            mip[miplev].fill(bkcolor);
-            div*=2;
-            if(miplev>0) PullPushMip(mip[miplev-1],mip[miplev],bkcolor);
-            else PullPushMip(p,mip[miplev],bkcolor);
-            if(mip[miplev].width()<=4 || mip[miplev].height()<=4) break;
-            ++miplev;
-        }
-        miplev++;
-#ifdef _PUSHPULL_DEBUG
-        for(int k=0;k<miplev;k++)               {
-            char buf[100];sprintf(buf,"mip%02i.png",k);
-            mip[k].Save(buf);
+            const PullPushLevel &prev = mip.empty() ? base : mip.back();
+            PullPushLevel lev;
+            lev.width = prev.width/2;
+            lev.height = prev.height/2;
+            lev.stride = lev.width;
+            buffers.push_back(std::vector<QRgb>(size_t(lev.width)*lev.height, bkcolor));
+            lev.bits = buffers.back().data();
+            PullPushMip(prev,lev,bkcolor);
+            mip.push_back(lev);
+            if(lev.width<=4 || lev.height<=4) break;
         }
-#endif
         // push phase: refill
-        for(i=miplev-1;i>=0;--i){
+        for(int i=int(mip.size())-1;i>=0;--i){
             if(i>0) PullPushFill(mip[i-1],mip[i],bkcolor);
-            else PullPushFill(p,mip[i],bkcolor);
+            else PullPushFill(base,mip[i],bkcolor);
         }
 
-#ifdef _PUSHPULL_DEBUG
-        for(k=0;k<miplev;k++)           {
-            char buf[100];sprintf(buf,"mipfill%02i.png",k);
-            mip[k].Save(buf);
-        }
-#endif
+        if(format!=QImage::Format_ARGB32)
+            p = p.convertToFormat(format);
     }
 }       // End namespace
 #endif
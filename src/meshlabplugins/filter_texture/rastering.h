@@ -25,195 +25,212 @@
 #define _RASTERING_H
 
 #include <common/ml_document/mesh_model.h>
+#include <common/utilities/face_bvh.h>
 #include <vcg/complex/algorithms/point_sampling.h>
 #include <vcg/space/triangle2.h>
 
-class VertexSampler
+/* Direct access to the pixels of an image in Format_ARGB32, used by the
+ * samplers instead of QImage::pixel/setPixel, that are too slow for large
+ * textures and not safe to be called concurrently on the same image.
+ * A view built on a const image is read only. The image must outlive the
+ * view and must not be detached (copied and then modified) while the view
+ * is in use. */
+class TexelView
 {
-    typedef vcg::GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType > MetroMeshGrid;
-    typedef vcg::tri::FaceTmark<CMeshO> MarkerFace;
+    QRgb *bits;
+    int w, h;
+    int stride; // in pixels
 
-    std::vector <QImage> &srcImgs;
-    float dist_upper_bound;
+public:
+    TexelView() : bits(NULL), w(0), h(0), stride(0) {}
+
+    explicit TexelView(QImage &img) : w(img.width()), h(img.height()), stride(img.bytesPerLine()/sizeof(QRgb))
+    {
+        assert(img.format() == QImage::Format_ARGB32);
+        bits = reinterpret_cast<QRgb *>(img.bits());
+    }
+
+    explicit TexelView(const QImage &img) : w(img.width()), h(img.height()), stride(img.bytesPerLine()/sizeof(QRgb))
+    {
+        assert(img.format() == QImage::Format_ARGB32);
+        bits = const_cast<QRgb *>(reinterpret_cast<const QRgb *>(img.constBits()));
+    }
 
-    MetroMeshGrid unifGridFace;
-    MarkerFace markerFunctor;
-    vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
+    int width() const { return w; }
+    int height() const { return h; }
+
+    // image coords, y from the top
+    QRgb pixel(int x, int y) const { return bits[size_t(y)*stride + x]; }
+
+    // texel coords of the rasterization, y from the bottom; NULL outside the image
+    QRgb *texel(const vcg::Point2i &tp) const
+    {
+        if (tp.X() < 0 || tp.X() >= w || tp.Y() < 0 || tp.Y() >= h) return NULL;
+        return bits + size_t(h - 1 - tp.Y())*stride + tp.X();
+    }
+
+    // color at the texture coords of a point of a face, in repeat mode
+    QRgb texCoordPixel(const CMeshO::FaceType &f, const CMeshO::CoordType &interp) const
+    {
+        int x, y;
+        x = w * (interp[0]*f.cWT(0).U()+interp[1]*f.cWT(1).U()+interp[2]*f.cWT(2).U());
+        y = h * (1.0 - (interp[0]*f.cWT(0).V()+interp[1]*f.cWT(1).V()+interp[2]*f.cWT(2).V()));
+        x = (x%w + w)%w;
+        y = (y%h + h)%h;
+        return pixel(x, y);
+    }
+};
 
-    // Callback stuff
-    vcg::CallBackPos *cb;
-    int vertexNo, vertexCnt, start, offset;
+// source textures converted (if needed) to Format_ARGB32, with their views
+class SourceTextures
+{
+    std::vector<QImage> imgs;
+    std::vector<TexelView> views;
 
 public:
-	VertexSampler(CMeshO &_srcMesh, std::vector <QImage> &_srcImg, float upperBound) :
-	srcImgs(_srcImg), dist_upper_bound(upperBound)
+    SourceTextures() {}
+    SourceTextures(const std::vector<QImage> &_imgs)
     {
-        unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
+        imgs.reserve(_imgs.size());
+        for (size_t i = 0; i < _imgs.size(); ++i)
+            imgs.push_back(_imgs[i].format() == QImage::Format_ARGB32 ? _imgs[i] : _imgs[i].convertToFormat(QImage::Format_ARGB32));
+        for (size_t i = 0; i < imgs.size(); ++i)
+            views.push_back(TexelView(static_cast<const QImage &>(imgs[i])));
     }
 
-    void InitCallback(vcg::CallBackPos *_cb, int _vertexNo, int _start=0, int _offset=100)
+    size_t size() const { return views.size(); }
+    const TexelView &operator[](size_t i) const { return views[i]; }
+};
+
+/* Samplers for the tiled rasterization of meshlab::TextureRaster and for the
+ * parallel sampling of vertices: the closest point queries on the source
+ * mesh go through a FaceBVH (or a vertex grid, for point clouds) that can be
+ * queried concurrently, and the closest face of the last query is kept as
+ * a hint for the next one in the same tile or block of vertices. */
+
+class VertexSampler
+{
+    const CMeshO &srcMesh;
+    SourceTextures srcImgs;
+    float dist_upper_bound;
+    meshlab::FaceBVH bvh;
+
+public:
+    VertexSampler(CMeshO &_srcMesh, std::vector <QImage> &_srcImg, float upperBound) :
+    srcMesh(_srcMesh), srcImgs(_srcImg), dist_upper_bound(upperBound), bvh(_srcMesh)
     {
-        assert(_vertexNo > 0);
-        assert(_start>=0);
-        assert(_offset>=0 && _offset <= 100-_start);
-        cb = _cb;
-        vertexNo = _vertexNo;
-        vertexCnt = 0;
-        start = _start;
-        offset = _offset;
     }
 
-    void AddVert(CMeshO::VertexType &v)
+    void AddVert(CMeshO::VertexType &v, meshlab::FaceBVH::PointHit &hint)
     {
         // Get Closest point
-        CMeshO::CoordType closestPt;
-        CMeshO::ScalarType dist=dist_upper_bound;
-        CMeshO::FaceType *nearestF;
-        nearestF =  unifGridFace.GetClosest(PDistFunct, markerFunctor, v.cP(), dist_upper_bound, dist, closestPt);
-        if (dist == dist_upper_bound) return;
-
-        // Convert point to barycentric coords
-        CMeshO::CoordType interp;
-        bool ret = InterpolationParameters(*nearestF, nearestF->cN(), closestPt, interp);
-        assert(ret);
-        if (ret) {
-            interp[2]=1.0-interp[1]-interp[0];
-
-            int tIndex = nearestF->cWT(0).N();
-            if ((tIndex >= 0) && ((size_t)tIndex < srcImgs.size()))
-            {
-                int w = srcImgs[tIndex].width(), h = srcImgs[tIndex].height();
-                int x, y;
-                x = w * (interp[0] * nearestF->cWT(0).U() + interp[1] * nearestF->cWT(1).U() + interp[2] * nearestF->cWT(2).U());
-                y = h * (1.0 - (interp[0] * nearestF->cWT(0).V() + interp[1] * nearestF->cWT(1).V() + interp[2] * nearestF->cWT(2).V()));
-                // repeat mode
-                x = (x%w + w) % w;
-                y = (y%h + h) % h;
-                QRgb px = srcImgs[tIndex].pixel(x, y);
-                v.C() = CMeshO::VertexType::ColorType(qRed(px), qGreen(px), qBlue(px), 255);
-            }
-            else
-            {
-                v.C() = CMeshO::VertexType::ColorType(255, 255, 255, 255);
-            }
+        if (!bvh.closestPoint(v.cP(), dist_upper_bound, hint)) return;
+        const CMeshO::FaceType *nearestF = &srcMesh.face[hint.face];
+
+        // barycentric coords of the closest point
+        CMeshO::CoordType interp(1 - hint.u - hint.v, hint.u, hint.v);
+
+        int tIndex = nearestF->cWT(0).N();
+        if ((tIndex >= 0) && ((size_t)tIndex < srcImgs.size()))
+        {
+            QRgb px = srcImgs[tIndex].texCoordPixel(*nearestF, interp);
+            v.C() = CMeshO::VertexType::ColorType(qRed(px), qGreen(px), qBlue(px), 255);
+        }
+        else
+        {
+            v.C() = CMeshO::VertexType::ColorType(255, 255, 255, 255);
+        }
+    }
+
+    // samples all the non deleted vertices of m, in parallel
+    void AddAllVertices(CMeshO &m)
+    {
+        const int blockSize = 1024;
+        const int blockNum = int((m.vert.size() + blockSize - 1) / blockSize);
+        #pragma omp parallel for schedule(dynamic, 1)
+        for (int b = 0; b < blockNum; ++b)
+        {
+            meshlab::FaceBVH::PointHit hint;
+            const size_t end = std::min(m.vert.size(), size_t(b + 1) * blockSize);
+            for (size_t i = size_t(b) * blockSize; i < end; ++i)
+                if (!m.vert[i].IsD())
+                    AddVert(m.vert[i], hint);
         }
     }
 };
 
 class RasterSampler
 {
-    std::vector<QImage> &trgImgs;
-
-    // Callback stuff
-    vcg::CallBackPos *cb;
-    const CMeshO::FaceType *currFace;
-    int faceNo, faceCnt, start, offset;
+    std::vector<TexelView> trgImgs;
 
 public:
-	RasterSampler(std::vector<QImage> &_imgs) : trgImgs(_imgs) {}
+    struct Tile {};
 
-    void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
+    RasterSampler(std::vector<QImage> &_imgs)
     {
-        assert(_faceNo > 0);
-        assert(_start>=0);
-        assert(_offset>=0 && _offset <= 100-_start);
-        cb = _cb;
-        faceNo = _faceNo;
-        faceCnt = 0;
-        start = _start;
-        offset = _offset;
-        currFace = NULL;
+        for (size_t i = 0; i < _imgs.size(); ++i)
+            trgImgs.push_back(TexelView(_imgs[i]));
     }
 
+    void BeginTiles(int) {}
+    void EndTile(int, Tile &) {}
+
         // expects points outside face (affecting face color) with edge distance > 0
-    void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist= 0.0)
+    void AddTextureSample(Tile &, const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist= 0.0)
     {
+        QRgb *texel = trgImgs[f.cWT(0).N()].texel(tp);
+        if (texel == NULL) return;
+
         CMeshO::VertexType::ColorType c;
-        /*int alpha = 255;
-        if (fabs(p[0]+p[1]+p[2]-1)>=0.00001)
-            if (p[0] <.0) {alpha = 254+p[0]*128; bary[0] = 0.;} else
-                if (p[1] <.0) {alpha = 254+p[1]*128; bary[1] = 0.;} else
-                    if (p[2] <.0) {alpha = 254+p[2]*128; bary[2] = 0.;}*/
         int alpha = 255;
         if (edgeDist != 0.0)
             alpha=254-edgeDist*128;
 
-        if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
+        if (alpha == 255 || qAlpha(*texel) < alpha)
         {
             c.lerp(f.cV(0)->cC(), f.cV(1)->cC(), f.cV(2)->cC(), p);
-			trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
-        }
-        if (cb)
-        {
-            if (&f != currFace) {currFace = &f; ++faceCnt;}
-            cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+            *texel = qRgba(c[0], c[1], c[2], alpha);
         }
     }
 };
 
 class TransferColorSampler
 {
-    typedef vcg::GridStaticPtr<CMeshO::FaceType, CMeshO::ScalarType > MetroMeshGrid;
     typedef vcg::GridStaticPtr<CMeshO::VertexType, CMeshO::ScalarType > VertexMeshGrid;
 
-    std::vector <QImage> &trgImgs;
-    std::vector <QImage> *srcImgs;
+    std::vector <TexelView> trgImgs;
+    SourceTextures srcImgs;
     float dist_upper_bound;
     bool fromTexture;
-    MetroMeshGrid unifGridFace;
+    meshlab::FaceBVH bvh;
     VertexMeshGrid   unifGridVert;
     bool usePointCloudSampling;
 
-    // Callback stuff
-    vcg::CallBackPos *cb;
-    const CMeshO::FaceType *currFace;
     CMeshO *srcMesh;
-    int faceNo, faceCnt, start, offset;
     int vertexMode;
     float minQ,maxQ;
-    typedef vcg::tri::FaceTmark<CMeshO> MarkerFace;
-    MarkerFace markerFunctor;
 
-    /*QRgb GetBilinearPixelColor(float _u, float _v, int alpha)
+    void InitTargets(std::vector <QImage> &_trgImgs)
     {
-        int w = srcImg->width();
-        int h = srcImg->height();
-        QRgb p00, p01, p10, p11;
-        float u = _u * w -0.5;
-        float v = _v * h -0.5;
-        int x = floor(u);
-        int y = floor(v);
-        float u_ratio = u - x;
-        float v_ratio = v - y;
-        x = (x%w + w)%w;
-        y = (y%h + h)%h;
-        float u_opposite = 1 - u_ratio;
-        float v_opposite = 1 - v_ratio;
-
-        p00 = srcImg->pixel(x,y);
-        p01 = srcImg->pixel(x, (y+1)%h);
-        p10 = srcImg->pixel((x+1)%w, y);
-        p11 = srcImg->pixel((x+1)%w, (y+1)%h);
-        int r,g,b;
-        r = (qRed(p00)*u_opposite+qRed(p01)*u_ratio)*v_opposite +
-            (qRed(p01)*u_opposite+qRed(p11)*u_ratio)*v_ratio;
-        g = (qGreen(p00)*u_opposite+qGreen(p01)*u_ratio)*v_opposite +
-            (qGreen(p01)*u_opposite+qGreen(p11)*u_ratio)*v_ratio;
-        b = (qBlue(p00)*u_opposite+qBlue(p01)*u_ratio)*v_opposite +
-            (qBlue(p01)*u_opposite+qBlue(p11)*u_ratio)*v_ratio;
-        return qRgba(r,g,b, alpha);
-    }*/
+        for (size_t i = 0; i < _trgImgs.size(); ++i)
+            trgImgs.push_back(TexelView(_trgImgs[i]));
+    }
 
 public:
+    // the closest face of the last query, used as hint for the next one
+    struct Tile
+    {
+        meshlab::FaceBVH::PointHit hint;
+    };
+
     TransferColorSampler(CMeshO &_srcMesh, std::vector <QImage> &_trgImgs, float upperBound, int _vertexMode)
-    : trgImgs(_trgImgs), dist_upper_bound(upperBound)
+    : dist_upper_bound(upperBound)
     {
+        InitTargets(_trgImgs);
         srcMesh=&_srcMesh;
         usePointCloudSampling = _srcMesh.face.empty();
         if(usePointCloudSampling) unifGridVert.Set(_srcMesh.vert.begin(),_srcMesh.vert.end());
-                        else  unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
+                        else  bvh.build(_srcMesh);
         fromTexture = false;
         vertexMode=_vertexMode;
         if(vertexMode==2)
@@ -225,36 +242,24 @@ public:
     }
 
 	TransferColorSampler(CMeshO &_srcMesh, std::vector <QImage> &_trgImgs, std::vector <QImage> *_srcImgs, float upperBound)
-		: trgImgs(_trgImgs), srcImgs(_srcImgs), dist_upper_bound(upperBound)
+		: srcImgs(*_srcImgs), dist_upper_bound(upperBound)
     {
-        unifGridFace.Set(_srcMesh.face.begin(),_srcMesh.face.end());
-        markerFunctor.SetMesh(&_srcMesh);
+        InitTargets(_trgImgs);
+        srcMesh=&_srcMesh;
+        bvh.build(_srcMesh);
         fromTexture = true;
         usePointCloudSampling=false;
         vertexMode=-1;
     }
-    void InitCallback(vcg::CallBackPos *_cb, int _faceNo, int _start=0, int _offset=100)
-    {
-        assert(_faceNo > 0);
-        assert(_start>=0);
-        assert(_offset>=0 && _offset <= 100-_start);
-        cb = _cb;
-        faceNo = _faceNo;
-        faceCnt = 0;
-        start = _start;
-        offset = _offset;
-        currFace = NULL;
-    }
 
-    void AddTextureSample(const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
+    void BeginTiles(int) {}
+    void EndTile(int, Tile &) {}
+
+    void AddTextureSample(Tile &tile, const CMeshO::FaceType &f, const CMeshO::CoordType &p, const vcg::Point2i &tp, float edgeDist=0.0)
     {
-        // Calculate correct barycentric coords
-        /*CMeshO::CoordType bary = p;
-        int alpha = 255;
-        if (fabs(p[0]+p[1]+p[2]-1)>=0.00001)
-            if (p[0] <.0) {alpha = 254+p[0]*128; bary[0] = 0.;} else
-                if (p[1] <.0) {alpha = 254+p[1]*128; bary[1] = 0.;} else
-                    if (p[2] <.0) {alpha = 254+p[2]*128; bary[2] = 0.;}*/
+        QRgb *texel = trgImgs[f.cWT(0).N()].texel(tp);
+        if (texel == NULL) return;
+
         int rr=0,gg=0,bb=0;
         CMeshO::CoordType bary = p;
         int alpha = 255;
@@ -273,12 +278,12 @@ public:
 
         if(usePointCloudSampling)
         {
-            CMeshO::VertexType   *nearestV=0;
+            vcg::tri::EmptyTMark<CMeshO> markerFunctor;
+            vcg::vertex::PointDistanceFunctor<CMeshO::ScalarType> VDistFunct;
+            CMeshO::CoordType closestPt;
             CMeshO::ScalarType dist=dist_upper_bound;
-            nearestV =  vcg::tri::GetClosestVertex<CMeshO,VertexMeshGrid>(*srcMesh,unifGridVert,startPt,dist_upper_bound,dist); //(PDistFunct,markerFunctor,startPt,dist_upper_bound,dist,closestPt);
-            //if(cb) cb(sampleCnt++*100/sampleNum,"Resampling Vertex attributes");
-            //if(storeDistanceAsQualityFlag)  p.Q() = dist;
-            if(dist == dist_upper_bound) return ;
+            CMeshO::VertexType *nearestV =  unifGridVert.GetClosest(VDistFunct, markerFunctor, startPt, dist_upper_bound, dist, closestPt);
+            if(nearestV == NULL) return ;
 
             switch(vertexMode)
             {
@@ -300,57 +305,24 @@ public:
                     rr = gg = bb = q;
                 } break;
             }
-            int cx = tp.X();
-            int cy = trgImgs[f.cWT(0).N()].height() - 1 - tp.Y();
-            if (cx >= 0 && cx < trgImgs[f.cWT(0).N()].size().width()) {
-                if (cy >= 0 && cy < trgImgs[f.cWT(0).N()].size().height()){
-                    trgImgs[f.cWT(0).N()].setPixel(cx, cy, qRgba(rr, gg, bb, 255));
-                }
-            }
+            *texel = qRgba(rr, gg, bb, 255);
         }
         else // sampling from a mesh
         {
-            CMeshO::CoordType closestPt;
-            vcg::face::PointDistanceBaseFunctor<CMeshO::ScalarType> PDistFunct;
-            CMeshO::ScalarType dist=dist_upper_bound;
-            CMeshO::FaceType *nearestF;
-            nearestF =  unifGridFace.GetClosest(PDistFunct, markerFunctor, startPt, dist_upper_bound, dist, closestPt);
-            if (dist == dist_upper_bound) return;
-
-            // Convert point to barycentric coords
-            CMeshO::CoordType interp;
-            bool ret = vcg::InterpolationParameters(*nearestF, nearestF->N(), closestPt, interp);
-                        // if the point is outside the nearest face,
-            // then let's clamp it inside:
-                        if(!ret)
-                        {
-              assert(fabs((interp[0]+interp[1]+interp[2])-1.0f)<0.00001);
-              int nonZeroCnt=3;
-              if(interp[0]<0) {interp[0]=0; nonZeroCnt--;}
-              if(interp[1]<0) {interp[1]=0; nonZeroCnt--;}
-              if(interp[2]<0) {interp[2]=0; nonZeroCnt--;}
-              assert(nonZeroCnt>0);
-              float sum = interp[0]+interp[1]+interp[2];
-              if(interp[0]>0) interp[0]/=sum;
-              if(interp[1]>0) interp[1]/=sum;
-              if(interp[2]>0) interp[2]/=sum;
-
-              interp[2]=1.0-interp[1]-interp[0];
-            }
+            // texels already written with a higher alpha do not need the query
+            if (alpha != 255 && qAlpha(*texel) >= alpha) return;
+
+            meshlab::FaceBVH::PointHit &hit = tile.hint;
+            if (!bvh.closestPoint(startPt, dist_upper_bound, hit)) return;
+            const CMeshO::FaceType *nearestF = &srcMesh->face[hit.face];
+
+            // barycentric coords of the closest point, always inside the face
+            CMeshO::CoordType interp(1 - hit.u - hit.v, hit.u, hit.v);
 
-		if (alpha == 255 || qAlpha(trgImgs[f.cWT(0).N()].pixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y())) < alpha)
-        {
             if (fromTexture)
             {
-				int w = (*srcImgs)[nearestF->cWT(0).N()].width(), h = (*srcImgs)[nearestF->cWT(0).N()].height();
-                int x, y;
-                x = w * (interp[0]*nearestF->cWT(0).U()+interp[1]*nearestF->cWT(1).U()+interp[2]*nearestF->cWT(2).U());
-                y = h * (1.0 - (interp[0]*nearestF->cWT(0).V()+interp[1]*nearestF->cWT(1).V()+interp[2]*nearestF->cWT(2).V()));
-                // texture repeat mode
-                x = (x%w + w)%w;
-                y = (y%h + h)%h;
-				QRgb px = (*srcImgs)[nearestF->cWT(0).N()].pixel(x, y);
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(qRed(px), qGreen(px), qBlue(px), alpha));
+                QRgb px = srcImgs[nearestF->cWT(0).N()].texCoordPixel(*nearestF, interp);
+                *texel = qRgba(qRed(px), qGreen(px), qBlue(px), alpha);
             }
             else
             {
@@ -377,13 +349,7 @@ public:
                 } break;
                 default: assert(0);
                 }
-				trgImgs[f.cWT(0).N()].setPixel(tp.X(), trgImgs[f.cWT(0).N()].height() - 1 - tp.Y(), qRgba(c[0], c[1], c[2], alpha));
-            }
-        }
-            if (cb)
-            {
-                if (&f != currFace) {currFace = &f; ++faceCnt;}
-                cb(start + faceCnt*offset/faceNo, "Rasterizing faces ...");
+                *texel = qRgba(c[0], c[1], c[2], alpha);
             }
         }
     }
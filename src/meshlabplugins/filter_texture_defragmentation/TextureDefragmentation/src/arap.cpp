@@ -121,11 +121,15 @@ void ARAP::ComputeSystemMatrix(Mesh& m, const std::vector<Cot>& cotan, Eigen::Sp
     L.resize(m.VN(), m.VN());
     L.setZero();
     std::vector<Td> tri;
+    tri.reserve(9 * m.FN() + fixed_i.size());
+    std::vector<bool> isFixed(m.VN(), false);
+    for (auto vi : fixed_i)
+        isFixed[vi] = true;
     auto Idx = [&m](const Mesh::VertexPointer vp) { return (int) tri::Index(m, vp); };
     for (auto &f : m.face) {
         int fi = tri::Index(m, f);
         for (int i = 0; i < 3; ++i) {
-            if (std::find(fixed_i.begin(), fixed_i.end(), (int) tri::Index(m, f.V(i))) == fixed_i.end()) {
+            if (!isFixed[Idx(f.V(i))]) {
                 Mesh::VertexPointer vi = f.V0(i);
                 int j = (i+1)%3;
                 Mesh::VertexPointer vj = f.V1(i);
@@ -161,9 +165,10 @@ void ARAP::ComputeSystemMatrix(Mesh& m, const std::vector<Cot>& cotan, Eigen::Sp
 static std::vector<Eigen::Matrix2d> ComputeRotations(Mesh& m)
 {
     auto tsa = GetTargetShapeAttribute(m);
-    std::vector<Eigen::Matrix2d> rotations;
-    rotations.reserve(m.FN());
-    for (auto& f : m.face) {
+    std::vector<Eigen::Matrix2d> rotations(m.face.size());
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < (int) m.face.size(); ++i) {
+        auto& f = m.face[i];
         vcg::Point2d x10, x20;
         LocalIsometry(tsa[f].P[1] - tsa[f].P[0], tsa[f].P[2] - tsa[f].P[0], x10, x20);
         Eigen::Matrix2d Jf = ComputeTransformationMatrix(x10, x20, f.WT(1).P() - f.WT(0).P(), f.WT(2).P() - f.WT(0).P());
@@ -178,7 +183,7 @@ static std::vector<Eigen::Matrix2d> ComputeRotations(Mesh& m)
             R = U * V.transpose();
         }
 
-        rotations.push_back(R);
+        rotations[i] = R;
     }
 
     return rotations;
@@ -271,10 +276,14 @@ double ARAP::ComputeEnergyFromStoredWedgeTC(const std::vector<Mesh::FacePointer>
 
 double ARAP::ComputeEnergyFromStoredWedgeTC(Mesh& m, double *num, double *denom)
 {
-    double e = 0;
-    double total_area = 0;
+    // per-face terms are computed in parallel and summed serially, so that the
+    // result does not depend on the number of threads
     auto tsa = GetWedgeTexCoordStorageAttribute(m);
-    for (auto& f : m.face) {
+    std::vector<double> faceEnergy(m.face.size(), 0);
+    std::vector<double> faceArea(m.face.size(), 0);
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < (int) m.face.size(); ++i) {
+        auto& f = m.face[i];
         vcg::Point2d x10 = tsa[f].tc[1].P() - tsa[f].tc[0].P();
         vcg::Point2d x20 = tsa[f].tc[2].P() - tsa[f].tc[0].P();
         double area_f = std::abs(x10 ^ x20);
@@ -285,10 +294,16 @@ double ARAP::ComputeEnergyFromStoredWedgeTC(Mesh& m, double *num, double *denom)
             Eigen::JacobiSVD<Eigen::Matrix2d> svd;
             svd.compute(Jf, Eigen::ComputeFullU | Eigen::ComputeFullV);
             U = svd.matrixU(); V = svd.matrixV(); sigma = svd.singularValues();
-            total_area += area_f;
-            e += area_f * (std::pow(sigma[0] - 1.0, 2.0) + std::pow(sigma[1] - 1.0, 2.0));
+            faceArea[i] = area_f;
+            faceEnergy[i] = area_f * (std::pow(sigma[0] - 1.0, 2.0) + std::pow(sigma[1] - 1.0, 2.0));
         }
     }
+    double e = 0;
+    double total_area = 0;
+    for (std::size_t i = 0; i < faceEnergy.size(); ++i) {
+        total_area += faceArea[i];
+        e += faceEnergy[i];
+    }
     if (num)
         *num = e;
     if (denom)
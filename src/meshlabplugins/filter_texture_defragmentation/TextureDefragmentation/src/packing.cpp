@@ -40,12 +40,13 @@ int Pack(const std::vector<ChartHandle>& charts, TextureObjectHandle textureObje
 
     texszVec.clear();
 
-    std::vector<Outline2f> outlines;
+    std::vector<Outline2f> outlines(charts.size());
 
-    for (auto c : charts) {
+    // outlines are extracted in parallel, each chart only visits its own faces
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) charts.size(); ++i) {
         // Save the outline of the parameterization for this portion of the mesh
-        Outline2f outline = ExtractOutline2f(*c);
-        outlines.push_back(outline);
+        outlines[i] = ExtractOutline2f(*charts[i]);
     }
 
     int packingSize = 4096;
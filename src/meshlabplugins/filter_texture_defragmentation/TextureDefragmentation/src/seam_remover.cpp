@@ -57,7 +57,8 @@ struct Perf {
 };
 
 
-static void InsertNewClusterInQueue(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
+static void InsertNewClustersInQueue(const std::vector<ClusteredSeamHandle>& cshvec, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
+static void CommitClusterCost(ClusteredSeamHandle csh, CostInfo ci, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params);
 static CostInfo ComputeCost(ClusteredSeamHandle csh, GraphHandle graph, const AlgoParameters& params, double penalty);
 static inline double GetPenalty(ClusteredSeamHandle csh, AlgoStateHandle state);
 static inline bool Valid(const WeightedSeam& ws, ConstAlgoStateHandle state);
@@ -284,8 +285,8 @@ AlgoStateHandle InitializeState(GraphHandle graph, const AlgoParameters& algoPar
             nself++;
         else
             ndisconnecting++;
-        InsertNewClusterInQueue(csh, state, graph, algoParameters);
     }
+    InsertNewClustersInQueue(cshvec, state, graph, algoParameters);
     LOG_INFO << "Found " << ndisconnecting << " disconnecting seams";
     LOG_INFO << "Found " << nself << " non-disconnecting seams";
 
@@ -413,11 +414,44 @@ void Finalize(GraphHandle graph, int *vndup)
 
 // -- static functions ---------------------------------------------------------
 
-static void InsertNewClusterInQueue(ClusteredSeamHandle csh, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
+// Inserts a batch of clusters in the queue. The costs only read the charts and
+// the seams, so they are evaluated speculatively in parallel, and then committed
+// to the state serially in the order of cshvec: the result does not depend on the
+// number of threads. Seam reductions modify the clusters, and are performed by
+// the commit.
+static void InsertNewClustersInQueue(const std::vector<ClusteredSeamHandle>& cshvec, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
 {
-    ColorizeSeam(csh, vcg::Color4b::White);
+    const int n = (int) cshvec.size();
+
+    // the state is not thread safe, and charts compute their areas lazily: do
+    // the writes before the parallel evaluation
+    std::vector<double> penalty(n);
+    std::vector<ChartHandle> charts;
+    std::unordered_set<ChartHandle> visited;
+    for (int i = 0; i < n; ++i) {
+        penalty[i] = GetPenalty(cshvec[i], state);
+        ChartPair p = GetCharts(cshvec[i], graph);
+        for (ChartHandle c : {p.first, p.second})
+            if (c->dirty && visited.insert(c).second)
+                charts.push_back(c);
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) charts.size(); ++i)
+        charts[i]->UpdateCache();
 
-    CostInfo ci = ComputeCost(csh, graph, params, GetPenalty(csh, state));
+    std::vector<CostInfo> ci(n);
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < n; ++i)
+        ci[i] = ComputeCost(cshvec[i], graph, params, penalty[i]);
+
+    for (int i = 0; i < n; ++i)
+        CommitClusterCost(cshvec[i], ci[i], state, graph, params);
+}
+
+static void CommitClusterCost(ClusteredSeamHandle csh, CostInfo ci, AlgoStateHandle state, GraphHandle graph, const AlgoParameters& params)
+{
+    ColorizeSeam(csh, vcg::Color4b::White);
 
     if (params.reduce) {
         while (ci.mvalue == CostInfo::UNFEASIBLE_MATCHING) {
@@ -1384,6 +1418,7 @@ static void AcceptMove(const SeamData& sd, AlgoStateHandle state, GraphHandle gr
     EraseSeam(sd.csh, state, graph);
     state->penalty.erase(sd.csh);
 
+    std::vector<ClusteredSeamHandle> reinserted;
     for (auto csh : independentClusters) {
         auto it = state->status.find(csh);
         ensure(it != state->status.end());
@@ -1404,16 +1439,15 @@ static void AcceptMove(const SeamData& sd, AlgoStateHandle state, GraphHandle gr
         if (invalidate || (params.ignoreOnReject && mv == CostInfo::REJECTED))
             InvalidateCluster(csh, state, graph, clusterStatus, 1.0);
         else
-            InsertNewClusterInQueue(csh, state, graph, params);
+            reinserted.push_back(csh);
     }
+    InsertNewClustersInQueue(reinserted, state, graph, params);
 
     for (auto csh : sharedClusters)
         EraseSeam(csh, state, graph);
 
     std::vector<ClusteredSeamHandle> cshvec = ClusterSeamsByChartId(shared);
-    for (auto csh : cshvec) {
-        InsertNewClusterInQueue(csh, state, graph, params);
-    }
+    InsertNewClustersInQueue(cshvec, state, graph, params);
 
     if (params.visitComponents) {
         // if potential islands are allowed to ignore the boundary length limit,
@@ -1426,10 +1460,9 @@ static void AcceptMove(const SeamData& sd, AlgoStateHandle state, GraphHandle gr
                 if (state->mvalue[csh] == CostInfo::MatchingValue::UNFEASIBLE_BOUNDARY)
                     unfeasibleBoundaryAdj.insert(csh);
 
-        for (ClusteredSeamHandle csh : unfeasibleBoundaryAdj) {
+        for (ClusteredSeamHandle csh : unfeasibleBoundaryAdj)
             EraseSeam(csh, state, graph);
-            InsertNewClusterInQueue(csh, state, graph, params);
-        }
+        InsertNewClustersInQueue(std::vector<ClusteredSeamHandle>(unfeasibleBoundaryAdj.begin(), unfeasibleBoundaryAdj.end()), state, graph, params);
     }
 
     PERF_TIMER_ACCUMULATE(t_accept);
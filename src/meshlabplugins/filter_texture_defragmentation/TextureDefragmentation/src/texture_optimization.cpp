@@ -41,10 +41,17 @@ static void MirrorU(ChartHandle chart);
 
 void ReorientCharts(GraphHandle graph)
 {
-    for (auto entry : graph->charts) {
-        ChartHandle chart = entry.second;
-        if (chart->UVFlipped())
-            MirrorU(chart);
+    // charts do not share vertices (see DisconnectCharts()), so they can be
+    // mirrored in parallel
+    std::vector<ChartHandle> charts;
+    charts.reserve(graph->charts.size());
+    for (auto& entry : graph->charts)
+        charts.push_back(entry.second);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < (int) charts.size(); ++i) {
+        if (charts[i]->UVFlipped())
+            MirrorU(charts[i]);
     }
 }
 
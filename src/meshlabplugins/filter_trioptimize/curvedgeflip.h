@@ -69,11 +69,28 @@ protected:
     // adjacent to edge to be flipped
     ScalarType _cv0, _cv1, _cv2, _cv3;
 
+    // Vertex normals used to evaluate the curvature: the normals of (up to four)
+    // vertices are replaced by the given ones, the others are read from the mesh.
+    // This allows to evaluate a flip without modifying the mesh.
+    struct NormalOverride
+    {
+        VertexPointer v[4] = {NULL, NULL, NULL, NULL};
+        CoordType n[4];
+
+        CoordType operator()(VertexPointer vp) const
+        {
+            for (int k = 0; k < 4; ++k)
+                if (v[k] == vp)
+                    return n[k];
+            return vp->N();
+        }
+    };
 
     static CurvData FaceCurv(VertexPointer v0,
                           VertexPointer v1,
                           VertexPointer v2,
-                          CoordType fNormal)
+                          CoordType fNormal,
+                          const NormalOverride& normal = NormalOverride())
     {
         CurvData res;
 
@@ -98,8 +115,8 @@ protected:
 
         res.K += ang0;
 
-        ang1 = math::Abs(Angle(fNormal, v1->N()));
-        ang2 = math::Abs(Angle(fNormal, v2->N()));
+        ang1 = math::Abs(Angle(fNormal, normal(v1)));
+        ang2 = math::Abs(Angle(fNormal, normal(v2)));
         res.H += ( (math::Sqrt(s01) / 2.0) * ang1 +
                    (math::Sqrt(s02) / 2.0) * ang2 );
 
@@ -110,6 +127,11 @@ protected:
      * f1, f2 --> this faces are to be ignored
      * */
     static CurvData Curvature(VertexPointer v, FacePointer f1 = NULL, FacePointer f2 = NULL)
+    {
+        return Curvature(v, NormalOverride(), f1, f2);
+    }
+
+    static CurvData Curvature(VertexPointer v, const NormalOverride& normal, FacePointer f1 = NULL, FacePointer f2 = NULL)
     {
         CurvData curv;
         VFIteratorType vfi(v);
@@ -120,7 +142,8 @@ protected:
                 curv += FaceCurv(vfi.F()->V0(i),
                                  vfi.F()->V1(i),
                                  vfi.F()->V2(i),
-                                 vfi.F()->N());
+                                 vfi.F()->N(),
+                                 normal);
             }
             ++vfi;
         }
@@ -261,33 +284,22 @@ public:
         // save sum of curvatures of vertices
         float cbefore = v0->Q() + v1->Q() + v2->Q() + v3->Q();
 
-        // saving current vertex normals
-        CoordType nv0orig = v0->N();
-        CoordType nv1orig = v1->N();
-        CoordType nv2orig = v2->N();
-        CoordType nv3orig = v3->N();
-
         CurvData cd0, cd1, cd2, cd3;
         CoordType n1 = Normal(v0->P(), v3->P(), v2->P());
         CoordType n2 = Normal(v1->P(), v2->P(), v3->P());
 
-        // new vertex normal after the flip
-        // set this now to evaluate new curvatures
-        v0->N() = nv0orig - f1->N() - f2->N() + n1;
-        v1->N() = nv1orig - f1->N() - f2->N() + n2;
-        v2->N() = nv2orig - f1->N() + n1 + n2;
-        v3->N() = nv3orig - f2->N() + n1 + n2;
-
-        cd0 = FaceCurv(v0, v3, v2, n1) + Curvature(v0, f1, f2);
-        cd1 = FaceCurv(v1, v2, v3, n2) + Curvature(v1, f1, f2);
-        cd2 = FaceCurv(v2, v0, v3, n1) + FaceCurv(v2, v3, v1, n2) + Curvature(v2, f1, f2);
-        cd3 = FaceCurv(v3, v2, v0, n1) + FaceCurv(v3, v1, v2, n2) + Curvature(v3, f1, f2);
+        // new vertex normals after the flip, used to evaluate the new curvatures
+        // (the mesh is not modified, so flips can be evaluated concurrently)
+        NormalOverride normal;
+        normal.v[0] = v0; normal.n[0] = v0->N() - f1->N() - f2->N() + n1;
+        normal.v[1] = v1; normal.n[1] = v1->N() - f1->N() - f2->N() + n2;
+        normal.v[2] = v2; normal.n[2] = v2->N() - f1->N() + n1 + n2;
+        normal.v[3] = v3; normal.n[3] = v3->N() - f2->N() + n1 + n2;
 
-        // restore original pervertex normals after computation
-        v0->N() = nv0orig;
-        v1->N() = nv1orig;
-        v2->N() = nv2orig;
-        v3->N() = nv3orig;
+        cd0 = FaceCurv(v0, v3, v2, n1, normal) + Curvature(v0, normal, f1, f2);
+        cd1 = FaceCurv(v1, v2, v3, n2, normal) + Curvature(v1, normal, f1, f2);
+        cd2 = FaceCurv(v2, v0, v3, n1, normal) + FaceCurv(v2, v3, v1, n2, normal) + Curvature(v2, normal, f1, f2);
+        cd3 = FaceCurv(v3, v2, v0, n1, normal) + FaceCurv(v3, v1, v2, n2, normal) + Curvature(v3, normal, f1, f2);
 
         CURVEVAL curveval;
 
@@ -308,18 +320,26 @@ public:
     }
 
 
-  static void Init(TRIMESH_TYPE &m, HeapType &heap, BaseParameterClass *pp)
+  // computes the non normalized normals and the curvature of the vertices
+  // (in the vertex quality) needed by the flip priority
+  static void InitCurvature(TRIMESH_TYPE &m)
     {
-        CURVEVAL curveval;
-        heap.clear();
-
         // comuputing edge flip priority require non normalized vertex normals AND non normalized face normals.
             vcg::tri::UpdateNormal<TRIMESH_TYPE>::PerVertexPerFace(m);
 
-        VertexIterator vi;
-        for (vi = m.vert.begin(); vi != m.vert.end(); ++vi)
-            if (!(*vi).IsD() && (*vi).IsW())
-                (*vi).Q() = curveval(Curvature(&(*vi)));
+        #pragma omp parallel for schedule(static)
+        for (int i = 0; i < (int) m.vert.size(); ++i) {
+            VertexType& v = m.vert[i];
+            if (!v.IsD() && v.IsW())
+                v.Q() = CURVEVAL()(Curvature(&v));
+        }
+    }
+
+  static void Init(TRIMESH_TYPE &m, HeapType &heap, BaseParameterClass *pp)
+    {
+        heap.clear();
+
+        InitCurvature(m);
 
         FaceIterator fi;
         for (fi = m.face.begin(); fi != m.face.end(); ++fi)
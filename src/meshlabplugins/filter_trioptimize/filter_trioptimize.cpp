@@ -24,9 +24,11 @@
 #include <math.h>
 #include <stdlib.h>
 #include <time.h>
+#include <chrono>
 
 #include "filter_trioptimize.h"
 #include "curvedgeflip.h"
+#include "parallel_edge_flip.h"
 
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/smooth.h>
@@ -104,6 +106,30 @@ public:
 };
 
 
+// Performs the curvature edge flips in parallel rounds, and logs a report per round
+template <class FLIP_TYPE>
+static int parallelCurvatureFlip(
+		CMeshO& m,
+		vcg::BaseParameterClass* pp,
+		float limit,
+		vcg::CallBackPos* cb,
+		const MeshLabPluginLogger& logger)
+{
+	FLIP_TYPE::InitCurvature(m);
+	auto rounds = vcg::tri::ParallelEdgeFlip<CMeshO, FLIP_TYPE>::Do(m, pp, limit, 1000, cb);
+	int flips = 0;
+	for (int i = 0; i < (int) rounds.size(); ++i) {
+		const auto& r = rounds[i];
+		flips += r.performed;
+		logger.log(
+			"Round %d: %d edges evaluated, %d improving, %d flipped (curvature change %g) "
+			"in %.3f sec, %.0f edges/sec",
+			i + 1, r.candidates, r.improving, r.performed, r.gain, r.seconds,
+			r.seconds > 0 ? r.candidates / r.seconds : 0.0);
+	}
+	return flips;
+}
+
 // Constructor usually performs only two simple tasks of filling the two lists
 //  - typeList: with all the possible id of the filtering actions
 //  - actionList with the corresponding actions. If you want to add icons to
@@ -229,6 +255,10 @@ RichParameterList TriOptimizePlugin::initParameterList(const QAction *action, co
 					"3: Absolute curvature:<br>"
 					"     if(K >= 0) return 2 * H<br>"
 					"     else return 2 * sqrt(H ^ 2 - A * K)")));
+		parlst.addParam(RichBool("parallel", false, tr("Parallel flips"),
+				tr("Perform the flips in rounds of independent edges (with no vertex in the one-ring of each other), "
+				   "evaluated and flipped in parallel. Much faster on large meshes, the result is slightly "
+				   "different from the sequential optimization, that always performs the best flip first.")));
 		}
 
 		if (ID(action) == FP_PLANAR_EDGE_FLIP) {
@@ -323,19 +353,33 @@ std::map<std::string, QVariant> TriOptimizePlugin::applyFilter(
 
 		int metric = par.getEnum("curvtype");
 		pp.CoplanarAngleThresholdDeg = pthr;
-		switch (metric) {
-		case 0: optimiz.Init<MeanCEFlip>(); break;
-		case 1: optimiz.Init<NSMCEFlip>();  break;
-		case 2: optimiz.Init<AbsCEFlip>();  break;
+
+		if (par.getBool("parallel")) {
+			auto t0 = std::chrono::steady_clock::now();
+			int flips = 0;
+			switch (metric) {
+			case 0: flips = parallelCurvatureFlip<MeanCEFlip>(m.cm, &pp, limit, cb, *this); break;
+			case 1: flips = parallelCurvatureFlip<NSMCEFlip>(m.cm, &pp, limit, cb, *this);  break;
+			case 2: flips = parallelCurvatureFlip<AbsCEFlip>(m.cm, &pp, limit, cb, *this);  break;
+			}
+			log("%d curvature edge flips performed in %.2f sec.", flips,
+				std::chrono::duration<float>(std::chrono::steady_clock::now() - t0).count());
 		}
+		else {
+			switch (metric) {
+			case 0: optimiz.Init<MeanCEFlip>(); break;
+			case 1: optimiz.Init<NSMCEFlip>();  break;
+			case 2: optimiz.Init<AbsCEFlip>();  break;
+			}
 
-		// stop when flips become harmful
-		optimiz.SetTargetMetric(limit);
-		//optimiz.SetTargetOperations(10);
-		optimiz.DoOptimization();
-		optimiz.h.clear();
+			// stop when flips become harmful
+			optimiz.SetTargetMetric(limit);
+			//optimiz.SetTargetOperations(10);
+			optimiz.DoOptimization();
+			optimiz.h.clear();
 
-		log( "%d curvature edge flips performed in %.2f sec.",  optimiz.nPerformedOps, (clock() - start) / (float) CLOCKS_PER_SEC);
+			log( "%d curvature edge flips performed in %.2f sec.",  optimiz.nPerformedOps, (clock() - start) / (float) CLOCKS_PER_SEC);
+		}
 	}
 	else if (ID(filter) == FP_PLANAR_EDGE_FLIP) {
 		if ( tri::Clean<CMeshO>::CountNonManifoldEdgeFF(m.cm) >0) {
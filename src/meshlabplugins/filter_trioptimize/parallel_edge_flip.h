@@ -0,0 +1,213 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+#ifndef __PARALLELEDGEFLIP
+#define __PARALLELEDGEFLIP
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
+#include <vector>
+
+#include <vcg/complex/algorithms/local_optimization.h>
+
+namespace vcg
+{
+namespace tri
+{
+
+/*
+ * Parallel version of the LocalOptimization loop for the curvature edge flips
+ * (see CurvEdgeFlip), performed in rounds:
+ * - the priority of the candidate edges is evaluated in parallel. Only the
+ *   edges near the flips of the previous round are candidates, since the
+ *   priority of the other edges did not change;
+ * - an independent set of improving flips is chosen greedily, in priority
+ *   order: the vertices of the two faces of a chosen flip and their one-ring
+ *   are locked, and a flip is chosen only if none of its vertices is locked.
+ *   The priority of a flip only depends on the one-ring of its vertices, so
+ *   the chosen flips do not change the priority of each other;
+ * - the chosen flips are applied in parallel.
+ * The loop stops when a round does not find improving flips.
+ *
+ * Ties are broken by face and edge index, so the result does not depend on
+ * the number of threads. It can differ from the serial optimization, which
+ * performs the best flip at each step.
+ *
+ * The mesh must be compact, with FF and VF adjacency, and the vertex normals
+ * and curvatures must be initialized (see CurvEdgeFlip::InitCurvature).
+ */
+template <class TRIMESH_TYPE, class FLIP_TYPE>
+class ParallelEdgeFlip
+{
+public:
+    typedef typename TRIMESH_TYPE::FaceType FaceType;
+    typedef typename TRIMESH_TYPE::FacePointer FacePointer;
+    typedef typename TRIMESH_TYPE::VertexPointer VertexPointer;
+    typedef typename TRIMESH_TYPE::ScalarType ScalarType;
+    typedef vcg::face::Pos<FaceType> PosType;
+    typedef vcg::face::VFIterator<FaceType> VFIteratorType;
+
+    struct RoundInfo
+    {
+        int    candidates = 0; // edges whose priority was evaluated
+        int    improving  = 0; // candidates with priority below the target
+        int    performed  = 0; // flips applied in the round
+        double gain       = 0; // sum of the priorities of the applied flips
+        double seconds    = 0;
+    };
+
+    static std::vector<RoundInfo> Do(
+            TRIMESH_TYPE &m,
+            BaseParameterClass *pp,
+            ScalarType targetMetric,
+            int maxRounds,
+            CallBackPos *cb = NULL)
+    {
+        typedef std::chrono::steady_clock Clock;
+
+        const int fn = (int) m.face.size();
+        const int mark = tri::IMark(m);
+
+        // last round in which each vertex was locked: the edges with a vertex
+        // locked in the previous round are the candidates of the next one
+        std::vector<int> lockRound(m.vert.size(), -1);
+        std::vector<RoundInfo> rounds;
+
+        for (int round = 0; round < maxRounds; ++round) {
+            Clock::time_point start = Clock::now();
+            RoundInfo info;
+
+            // evaluate the candidate edges, each one from the face with the lower index
+            std::vector<Candidate> slots(3 * fn);
+            #pragma omp parallel for schedule(dynamic, 1024)
+            for (int fi = 0; fi < fn; ++fi) {
+                FaceType &f = m.face[fi];
+                for (int i = 0; i < 3; ++i) {
+                    Candidate &c = slots[3 * fi + i];
+                    c.face = fi;
+                    c.edge = i;
+                    c.priority = std::numeric_limits<ScalarType>::infinity();
+                    if (f.IsD() || f.FFp(i) == &f || tri::Index(m, f.FFp(i)) < (size_t) fi)
+                        continue;
+                    if (round > 0 && !Changed(m, f, i, lockRound, round - 1))
+                        continue;
+                    c.evaluated = true;
+                    FLIP_TYPE flip(PosType(&f, i), mark, pp);
+                    c.priority = flip.Priority();
+                }
+            }
+
+            std::vector<Candidate> improving;
+            for (const Candidate &c : slots) {
+                info.candidates += c.evaluated;
+                if (c.priority < targetMetric)
+                    improving.push_back(c);
+            }
+            info.improving = (int) improving.size();
+            std::sort(improving.begin(), improving.end());
+
+            // greedy independent set
+            std::vector<Candidate> chosen;
+            for (const Candidate &c : improving) {
+                VertexPointer v[4];
+                Vertices(m, c, v);
+                bool independent = true;
+                for (int k = 0; k < 4 && independent; ++k)
+                    independent = lockRound[tri::Index(m, v[k])] != round;
+                if (!independent)
+                    continue;
+                for (int k = 0; k < 4; ++k)
+                    LockOneRing(m, v[k], lockRound, round);
+                chosen.push_back(c);
+                info.gain += c.priority;
+            }
+
+            #pragma omp parallel for schedule(dynamic, 64)
+            for (int k = 0; k < (int) chosen.size(); ++k) {
+                FLIP_TYPE flip(PosType(&m.face[chosen[k].face], chosen[k].edge), mark, pp);
+                flip.Execute(m, pp);
+            }
+            info.performed = (int) chosen.size();
+            info.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+            rounds.push_back(info);
+
+            if (cb)
+                cb(std::min(99, round), "Flipping edges...");
+            if (chosen.empty())
+                break;
+        }
+        return rounds;
+    }
+
+private:
+    struct Candidate
+    {
+        ScalarType priority;
+        int face;
+        int edge;
+        bool evaluated = false;
+
+        bool operator<(const Candidate &o) const
+        {
+            if (priority != o.priority)
+                return priority < o.priority;
+            if (face != o.face)
+                return face < o.face;
+            return edge < o.edge;
+        }
+    };
+
+    // the vertices of the two faces adjacent to the edge
+    static void Vertices(TRIMESH_TYPE &m, const Candidate &c, VertexPointer v[4])
+    {
+        FaceType &f = m.face[c.face];
+        v[0] = f.V0(c.edge);
+        v[1] = f.V1(c.edge);
+        v[2] = f.V2(c.edge);
+        v[3] = f.FFp(c.edge)->V2(f.FFi(c.edge));
+    }
+
+    // true if a vertex of the faces adjacent to the edge was locked in the given round
+    static bool Changed(TRIMESH_TYPE &m, FaceType &f, int i, const std::vector<int> &lockRound, int round)
+    {
+        return lockRound[tri::Index(m, f.V0(i))] == round ||
+               lockRound[tri::Index(m, f.V1(i))] == round ||
+               lockRound[tri::Index(m, f.V2(i))] == round ||
+               lockRound[tri::Index(m, f.FFp(i)->V2(f.FFi(i)))] == round;
+    }
+
+    static void LockOneRing(TRIMESH_TYPE &m, VertexPointer v, std::vector<int> &lockRound, int round)
+    {
+        lockRound[tri::Index(m, v)] = round;
+        for (VFIteratorType vfi(v); !vfi.End(); ++vfi) {
+            lockRound[tri::Index(m, vfi.F()->V1(vfi.I()))] = round;
+            lockRound[tri::Index(m, vfi.F()->V2(vfi.I()))] = round;
+        }
+    }
+};
+
+} // namespace tri
+} // namespace vcg
+
+#endif // __PARALLELEDGEFLIP
@@ -22,9 +22,11 @@
  ****************************************************************************/
 #include "filter_unsharp.h"
 
+#include <common/utilities/eigen_mesh_conversions.h>
+#include <common/utilities/laplacian_cache.h>
+
 #include <vcg/complex/algorithms/clean.h>
 #include <vcg/complex/algorithms/crease_cut.h>
-#include <vcg/complex/algorithms/harmonic.h>
 #include <vcg/complex/algorithms/smooth.h>
 
 using namespace vcg;
@@ -1069,24 +1071,36 @@ std::map<std::string, QVariant> FilterUnsharp::applyFilter(
 			throw MLException("Error occurred for selected points.");
 		}
 
-		vcg::tri::Harmonic<CMeshO, FieldScalar>::ConstraintVec constraints;
-		constraints.push_back(vcg::tri::Harmonic<CMeshO, FieldScalar>::Constraint(
-			vp0, FieldScalar(par.getFloat("value1"))));
-		constraints.push_back(vcg::tri::Harmonic<CMeshO, FieldScalar>::Constraint(
-			vp1, FieldScalar(par.getFloat("value2"))));
+		// the two vertices are hard constraints of the cotangent Laplacian system: the
+		// factorization is cached, moving only the values does not factorize it again
+		Eigen::VectorXi fixed(2);
+		fixed << int(vcg::tri::Index(m, vp0)), int(vcg::tri::Index(m, vp1));
+		Eigen::MatrixXd fixedValues(2, 1);
+		fixedValues << par.getFloat("value1"), par.getFloat("value2");
+
+		meshlab::LaplacianCache::Timings timings;
+		Eigen::MatrixXd field = meshlab::LaplacianCache::instance().solve(
+			md.mm(),
+			meshlab::vertexMatrix(m).cast<double>(),
+			meshlab::faceMatrix(m),
+			"harmonic1",
+			[](const Eigen::SparseMatrix<double>& L) { return Eigen::SparseMatrix<double>(-L); },
+			fixed,
+			fixedValues,
+			timings);
+		log("Harmonic field: assembly %.3f s, factorization %.3f s%s, solve %.3f s",
+			timings.assembly,
+			timings.factorization,
+			timings.cachedFactorization ? " (cached)" : "",
+			timings.solve);
 
 		CMeshO::PerVertexAttributeHandle<FieldScalar> handle =
 			vcg::tri::Allocator<CMeshO>::GetPerVertexAttribute<FieldScalar>(m, "harmonic");
-
-		bool ok =
-			vcg::tri::Harmonic<CMeshO, FieldScalar>::ComputeScalarField(m, constraints, handle);
-
-		if (!ok) {
-			throw MLException("An error occurred.");
-		}
 		md.mm()->updateDataMask(MeshModel::MM_VERTQUALITY);
-		for (auto vi = m.vert.begin(); vi != m.vert.end(); ++vi)
-			vi->Q() = handle[vi];
+		for (int i = 0; i < m.vn; ++i) {
+			handle[i] = FieldScalar(field(i, 0));
+			m.vert[i].Q() = handle[i];
+		}
 
 		if (par.getBool("colorize")) {
 			md.mm()->updateDataMask(MeshModel::MM_VERTCOLOR);
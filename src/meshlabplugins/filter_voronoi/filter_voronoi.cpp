@@ -22,6 +22,7 @@
 ****************************************************************************/
 
 #include "filter_voronoi.h"
+#include "parallel_voronoi.h"
 
 #include<vcg/complex/algorithms/voronoi_processing.h>
 #include<vcg/complex/algorithms/update/curvature.h>
@@ -34,6 +35,21 @@
 using namespace vcg;
 using namespace vcg::tri;
 
+// one iteration of VoronoiProcessing::VoronoiRelaxing
+static void voronoiRelaxStep(
+		ParallelVoronoi& pv,
+		std::vector<CVertexO *>& seedVec,
+		const tri::VoronoiProcessingParameter& vpp,
+		unsigned int randomSeed,
+		int iter)
+{
+	pv.computeSources(seedVec);
+	if(vpp.deleteUnreachedRegionFlag)
+		pv.deleteUnreachedRegions();
+	pv.relax(seedVec, vpp.geodesicRelaxFlag);
+	pv.perturbSeeds(seedVec, vpp.seedPerturbationProbability, vpp.seedPerturbationAmount, randomSeed, iter);
+}
+
 FilterVoronoiPlugin::FilterVoronoiPlugin()
 { 
 	typeList = {
@@ -362,48 +378,58 @@ void FilterVoronoiPlugin::voronoiSampling(
 	fixedVec.resize(pointVec.size(),false);
 	QList<int> meshlist; meshlist << m.id();
 
+	ParallelVoronoi pv(m.cm);
+
 	// Uniform Euclidean Distance
 	if(distanceType==0)  {
 		EuclideanDistance<CMeshO> dd;
+		pv.setMetric(dd);
 		for(int i=0;i<iterNum;++i) {
 			cb(100*i/iterNum, "Relaxing...");
 			if(relaxType==2) {
 				tri::VoronoiProcessing<CMeshO, EuclideanDistance<CMeshO> >::RestrictedVoronoiRelaxing(m.cm, pointVec, fixedVec, 10,vpp);
 				tri::VoronoiProcessing<CMeshO>::SeedToVertexConversion(m.cm,pointVec,seedVec);
-				tri::VoronoiProcessing<CMeshO>::ComputePerVertexSources(m.cm,seedVec,dd);
 			}
 			else {
-				tri::VoronoiProcessing<CMeshO, EuclideanDistance<CMeshO> >::VoronoiRelaxing(m.cm, seedVec, 1,dd,vpp);
+				voronoiRelaxStep(pv, seedVec, vpp, randomSeed, i);
 			}
 			// md.updateRenderStateMeshes(meshlist,int(MeshModel::MM_VERTCOLOR));
 			//if (intteruptreq)
 			//	return true;
 		}
+		pv.computeSources(seedVec);
+		pv.colorize(colorStrategy);
 		om->updateDataMask(MeshModel::MM_FACEFACETOPO);
 		tri::VoronoiProcessing<CMeshO>::ConvertVoronoiDiagramToMesh(m.cm,om->cm,poly->cm,seedVec, vpp);
 	}
 
 	if(distanceType==1) {
 		IsotropicDistance<CMeshO> id(m.cm,radiusVariance);
+		pv.setMetric(id);
 		for(int i=0;i<iterNum;++i) {
 			cb(100*i/iterNum, "Relaxing...");
-			tri::VoronoiProcessing<CMeshO, IsotropicDistance<CMeshO> >::VoronoiRelaxing(m.cm, seedVec, 1,id,vpp);
+			voronoiRelaxStep(pv, seedVec, vpp, randomSeed, i);
 			//md.updateRenderStateMeshes(meshlist,int(MeshModel::MM_VERTCOLOR));
 			//if (intteruptreq)
 			//	return true;
 		}
+		pv.computeSources(seedVec);
+		pv.colorize(colorStrategy);
 		// tri::VoronoiProcessing<CMeshO>::ConvertVoronoiDiagramToMesh(m.cm,om->cm,poly->cm,seedVec, vpp);
 	}
 	if(distanceType==2) {
+		BasicCrossFunctor<CMeshO> bcf(m.cm);
+		AnisotropicDistance<CMeshO> ad(m.cm,bcf);
+		pv.setMetric(ad);
 		for(int i=0;i<iterNum;++i) {
 			cb(100*i/iterNum, "Relaxing...");
-			BasicCrossFunctor<CMeshO> bcf(m.cm);
-			AnisotropicDistance<CMeshO> ad(m.cm,bcf);
-			tri::VoronoiProcessing<CMeshO, AnisotropicDistance<CMeshO> >::VoronoiRelaxing(m.cm, seedVec, 1, ad, vpp);
+			voronoiRelaxStep(pv, seedVec, vpp, randomSeed, i);
 			//md.updateRenderStateMeshes(meshlist,int(MeshModel::MM_VERTCOLOR));
 			//if (intteruptreq)
 			//	return true;
 		}
+		pv.computeSources(seedVec);
+		pv.colorize(colorStrategy);
 		//tri::VoronoiProcessing<CMeshO, AnisotropicDistance<CMeshO> >::ConvertVoronoiDiagramToMesh(m.cm,om->cm,seedVec, ad, vpp);
 	}
 
@@ -442,7 +468,8 @@ void FilterVoronoiPlugin::volumeSampling(
 	cb(1, "Init");
 	vvs.Init(sampleSurfRadius);
 	cb(30, "Sampling Volume...");
-	vvs.BuildVolumeSampling(sampleVolNum,poissonRadius,0);
+	ParallelVoronoi::montecarloVolume(m->cm, sampleVolNum, 0, vvs.montecarloVolumeMesh);
+	vvs.BuildVolumeSampling(0,poissonRadius,0);
 	tri::Append<CMeshO,CMeshO>::MeshCopy(mcVm->cm,vvs.montecarloVolumeMesh);
 	tri::UpdateColor<CMeshO>::PerVertexQualityRamp(mcVm->cm);
 	//vvs.ThicknessEvaluator();
@@ -480,7 +507,8 @@ void FilterVoronoiPlugin::voronoiScaffolding(
 	vvs.Init(sampleSurfRadius);
 	cb(30, "Sampling Volume...");
 	CMeshO::ScalarType poissonVolumeRadius=0;
-	vvs.BuildVolumeSampling(sampleVolNum,poissonVolumeRadius,0);
+	ParallelVoronoi::montecarloVolume(m->cm, sampleVolNum, 0, vvs.montecarloVolumeMesh);
+	vvs.BuildVolumeSampling(0,poissonVolumeRadius,0);
 	log("Base Poisson volume sampling at a radius %f ",poissonVolumeRadius);
 
 	cb(40, "Relaxing Volume...");
@@ -0,0 +1,591 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#include "parallel_voronoi.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+
+#include <common/utilities/face_bvh.h>
+#include <vcg/complex/algorithms/geodesic.h>
+#include <vcg/complex/algorithms/update/bounding.h>
+#include <vcg/complex/algorithms/update/color.h>
+#include <vcg/complex/algorithms/update/topology.h>
+
+using namespace vcg;
+using meshlab::FaceBVH;
+
+namespace {
+
+const Scalarm INF = std::numeric_limits<Scalarm>::max();
+
+// frontier vertices whose neighbours are gathered by the same task
+const int GATHER_BLOCK = 1024;
+// vertex ranges of the counting sort of the regions; fixed, so the order of
+// the vertices of a region does not depend on the number of threads
+const int REGION_SORT_BLOCKS = 16;
+// candidate points of a block of the volume sampling
+const int VOLUME_BLOCK = 4096;
+
+// salts that separate the random streams used for different purposes
+enum StreamPurpose { PERTURB_STREAM = 1, VOLUME_STREAM = 2 };
+
+uint64_t hash(uint64_t seed, uint64_t i)
+{
+	// splitmix64 finalizer
+	uint64_t x = seed * 0x9E3779B97F4A7C15ull + i + 0x632BE59BD9B4E019ull;
+	x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ull;
+	x = (x ^ (x >> 27)) * 0x94D049BB133111EBull;
+	return x ^ (x >> 31);
+}
+
+// the random numbers of a block of work, fully specified so that they are the
+// same on every platform
+class Stream
+{
+public:
+	Stream(uint64_t key, uint64_t block) : gen(hash(key, block)) {}
+
+	Scalarm uniform() { return Scalarm((gen() >> 11) * (1.0 / 9007199254740992.0)); }
+
+	Point3m unitVector()
+	{
+		for (;;) {
+			const Scalarm x = 2 * uniform() - 1;
+			const Scalarm y = 2 * uniform() - 1;
+			const Scalarm z = 2 * uniform() - 1;
+			const Scalarm n = x * x + y * y + z * z;
+			if (n > Scalarm(1e-4) && n <= 1)
+				return Point3m(x, y, z) / std::sqrt(n);
+		}
+	}
+
+private:
+	std::mt19937_64 gen;
+};
+
+/*
+ * Distance of v from the source of the wavefront that reached a and b, with
+ * the triangle (a, b, v) unfolded on the plane: a in the origin, b on the x
+ * axis, v above it and the source below it. Negative when the segment from the
+ * source to v does not cross the edge ab (the edges give a better estimate).
+ */
+Scalarm unfold(Scalarm da, Scalarm db, Scalarm lab, Scalarm lav, Scalarm lbv)
+{
+	if (!(lab > 0))
+		return -1;
+	const Scalarm vx  = (lav * lav - lbv * lbv + lab * lab) / (2 * lab);
+	const Scalarm vy2 = lav * lav - vx * vx;
+	const Scalarm sx  = (da * da - db * db + lab * lab) / (2 * lab);
+	const Scalarm sy2 = da * da - sx * sx;
+	if (vy2 <= 0 || sy2 < 0)
+		return -1;
+	const Scalarm vy = std::sqrt(vy2);
+	const Scalarm sy = -std::sqrt(sy2);
+	const Scalarm x  = sx + (vx - sx) * (-sy) / (vy - sy);
+	if (x < 0 || x > lab)
+		return -1;
+	return std::sqrt((vx - sx) * (vx - sx) + (vy - sy) * (vy - sy));
+}
+
+} // namespace
+
+ParallelVoronoi::ParallelVoronoi(CMeshO& m) : mesh(m)
+{
+	buildAdjacency();
+
+	EuclideanDistance<CMeshO> dd;
+	setMetric(dd);
+}
+
+void ParallelVoronoi::buildAdjacency()
+{
+	const int vn = int(mesh.vert.size());
+	const int fn = int(mesh.face.size());
+	faceVert.assign(3 * size_t(fn), -1);
+	vertFaceBegin.assign(vn + 1, 0);
+	for (int i = 0; i < fn; ++i) {
+		const CFaceO& f = mesh.face[i];
+		if (f.IsD())
+			continue;
+		for (int k = 0; k < 3; ++k) {
+			faceVert[3 * i + k] = int(tri::Index(mesh, f.cV(k)));
+			++vertFaceBegin[faceVert[3 * i + k] + 1];
+		}
+	}
+	for (int i = 0; i < vn; ++i)
+		vertFaceBegin[i + 1] += vertFaceBegin[i];
+	vertFace.resize(vertFaceBegin[vn]);
+	std::vector<int> pos(vertFaceBegin.begin(), vertFaceBegin.end() - 1);
+	for (int i = 0; i < fn; ++i)
+		if (!mesh.face[i].IsD())
+			for (int k = 0; k < 3; ++k)
+				vertFace[pos[faceVert[3 * i + k]]++] = i;
+}
+
+void ParallelVoronoi::computeSources(const std::vector<CVertexO*>& seeds)
+{
+	std::vector<int> sources(seeds.size());
+	for (size_t i = 0; i < seeds.size(); ++i)
+		sources[i] = int(tri::Index(mesh, seeds[i]));
+	propagate(sources, nullptr, seedDist, seedIndex);
+
+	tri::Allocator<CMeshO>::DeletePerVertexAttribute(mesh, "sources");
+	CMeshO::PerVertexAttributeHandle<CVertexO*> vertexSources =
+		tri::Allocator<CMeshO>::AddPerVertexAttribute<CVertexO*>(mesh, "sources");
+	const int vn = int(mesh.vert.size());
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		CVertexO& v = mesh.vert[i];
+		if (v.IsD())
+			continue;
+		vertexSources[v] = seedIndex[i] >= 0 ? seeds[seedIndex[i]] : nullptr;
+		v.Q() = seedDist[i];
+	}
+	gatherRegions(int(seeds.size()));
+}
+
+int ParallelVoronoi::deleteUnreachedRegions()
+{
+	for (size_t i = 0; i < mesh.face.size(); ++i) {
+		CFaceO& f = mesh.face[i];
+		if (f.IsD())
+			continue;
+		for (int k = 0; k < 3; ++k)
+			if (seedIndex[faceVert[3 * i + k]] < 0) {
+				if (tri::HasVFAdjacency(mesh))
+					face::VFDetach(f);
+				tri::Allocator<CMeshO>::DeleteFace(mesh, f);
+				break;
+			}
+	}
+	int deleted = 0;
+	for (size_t i = 0; i < mesh.vert.size(); ++i)
+		if (!mesh.vert[i].IsD() && seedIndex[i] < 0) {
+			tri::Allocator<CMeshO>::DeleteVertex(mesh, mesh.vert[i]);
+			++deleted;
+		}
+
+	// as vcg::tri::VoronoiProcessing::DeleteUnreachedRegions; the indices are
+	// unchanged (the mesh is not compacted), so the metric is still valid
+	if (tri::HasFFAdjacency(mesh))
+		tri::UpdateTopology<CMeshO>::FaceFace(mesh);
+	if (tri::HasVFAdjacency(mesh))
+		tri::UpdateTopology<CMeshO>::VertexFace(mesh);
+	buildAdjacency();
+	return deleted;
+}
+
+int ParallelVoronoi::relax(std::vector<CVertexO*>& seeds, bool geodesicRelaxFlag)
+{
+	std::vector<Scalarm> border;
+	if (geodesicRelaxFlag)
+		border = borderDistance();
+
+	const int regionNum = int(seeds.size());
+	std::vector<CVertexO*> newSeeds(seeds);
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int r = 0; r < regionNum; ++r) {
+		const int begin = regionBegin[r];
+		const int end   = regionBegin[r + 1];
+		if (begin == end)
+			continue;
+		int best = -1;
+		// the vertex farthest from the border of the region...
+		if (geodesicRelaxFlag) {
+			for (int j = begin; j < end; ++j) {
+				const int v = regionVert[j];
+				if (border[v] < INF && (best == -1 || border[v] > border[best]))
+					best = v;
+			}
+		}
+		// ...or the one that minimizes the sum of the squared distances from
+		// the vertices of the region, i.e. the nearest to their barycenter
+		if (best == -1) {
+			Point3d bary(0, 0, 0);
+			for (int j = begin; j < end; ++j)
+				bary += Point3d::Construct(mesh.vert[regionVert[j]].cP());
+			bary /= double(end - begin);
+			double bestDist = std::numeric_limits<double>::max();
+			for (int j = begin; j < end; ++j) {
+				const double d = SquaredDistance(Point3d::Construct(mesh.vert[regionVert[j]].cP()), bary);
+				if (d < bestDist) {
+					bestDist = d;
+					best     = regionVert[j];
+				}
+			}
+		}
+		newSeeds[r] = &mesh.vert[best];
+	}
+
+	int moved = 0;
+	for (int r = 0; r < regionNum; ++r)
+		if (newSeeds[r] != seeds[r])
+			++moved;
+	seeds.swap(newSeeds);
+	return moved;
+}
+
+void ParallelVoronoi::perturbSeeds(
+	std::vector<CVertexO*>& seeds,
+	Scalarm                 probability,
+	Scalarm                 amount,
+	unsigned int            randomSeed,
+	int                     iteration)
+{
+	if (probability <= 0 || amount <= 0)
+		return;
+	const uint64_t key    = hash(hash(randomSeed, PERTURB_STREAM), uint64_t(iteration));
+	const Scalarm  radius = amount * mesh.bbox.Diag();
+	const int      regionNum = int(seeds.size());
+	#pragma omp parallel for schedule(dynamic, 64)
+	for (int r = 0; r < regionNum; ++r) {
+		Stream rng(key, uint64_t(r));
+		if (rng.uniform() >= probability || regionBegin[r] == regionBegin[r + 1])
+			continue;
+		const Point3m target = seeds[r]->cP() + rng.unitVector() * radius;
+		int best = -1;
+		Scalarm bestDist = INF;
+		for (int j = regionBegin[r]; j < regionBegin[r + 1]; ++j) {
+			const Scalarm d = SquaredDistance(mesh.vert[regionVert[j]].cP(), target);
+			if (d < bestDist) {
+				bestDist = d;
+				best     = regionVert[j];
+			}
+		}
+		seeds[r] = &mesh.vert[best];
+	}
+}
+
+void ParallelVoronoi::colorize(int colorStrategy)
+{
+	const int vn = int(mesh.vert.size());
+	if (colorStrategy == BORDER_DISTANCE) {
+		std::vector<Scalarm> border = borderDistance();
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < vn; ++i)
+			if (!mesh.vert[i].IsD())
+				mesh.vert[i].Q() = border[i] < INF ? border[i] : 0;
+	}
+	else if (colorStrategy == REGION_AREA) {
+		// a third of the area of each face goes to each of its vertices
+		std::vector<Scalarm> vertArea(vn, 0);
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < vn; ++i)
+			for (int j = vertFaceBegin[i]; j < vertFaceBegin[i + 1]; ++j)
+				if (!mesh.face[vertFace[j]].IsD())
+					vertArea[i] += DoubleArea(mesh.face[vertFace[j]]) / 6;
+		const int regionNum = int(regionBegin.size()) - 1;
+		std::vector<Scalarm> regionArea(regionNum, 0);
+		#pragma omp parallel for schedule(static)
+		for (int r = 0; r < regionNum; ++r)
+			for (int j = regionBegin[r]; j < regionBegin[r + 1]; ++j)
+				regionArea[r] += vertArea[regionVert[j]];
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < vn; ++i)
+			if (!mesh.vert[i].IsD() && seedIndex[i] >= 0)
+				mesh.vert[i].Q() = regionArea[seedIndex[i]];
+	}
+	if (colorStrategy != NONE)
+		tri::UpdateColor<CMeshO>::PerVertexQualityRamp(mesh);
+}
+
+void ParallelVoronoi::montecarloVolume(const CMeshO& m, int sampleNum, unsigned int randomSeed, CMeshO& out)
+{
+	out.Clear();
+	FaceBVH bvh(m);
+	if (sampleNum <= 0 || bvh.isEmpty())
+		return;
+	const Box3m    box     = bvh.boundingBox();
+	const Point3m  dim     = box.max - box.min;
+	const Scalarm  maxDist = box.Diag();
+	const uint64_t key     = hash(randomSeed, VOLUME_STREAM);
+
+	// the blocks are drawn in batches, sized on the fraction of the points
+	// found inside the mesh so far, until there are enough samples
+	std::vector<std::vector<std::pair<Point3m, Scalarm>>> blocks;
+	long long found = 0;
+	int blockNum = 0;
+	while (found < sampleNum) {
+		const double rate  = blockNum > 0 ? std::max(0.01, double(found) / (double(blockNum) * VOLUME_BLOCK)) : 0.5;
+		const double need  = double(sampleNum - found) / (rate * VOLUME_BLOCK);
+		const int    batch = int(std::min(1024.0, std::ceil(need)));
+		blocks.resize(blockNum + batch);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int b = blockNum; b < blockNum + batch; ++b) {
+			Stream rng(key, uint64_t(b));
+			FaceBVH::PointHit hit;
+			for (int i = 0; i < VOLUME_BLOCK; ++i) {
+				const Scalarm x = rng.uniform();
+				const Scalarm y = rng.uniform();
+				const Scalarm z = rng.uniform();
+				const Point3m p(box.min[0] + x * dim[0], box.min[1] + y * dim[1], box.min[2] + z * dim[2]);
+				if (!bvh.closestPoint(p, maxDist, hit))
+					continue;
+				// inside if behind the closest face, as the distance of
+				// vcg::tri::VoronoiVolumeSampling
+				const CFaceO& f = m.face[hit.face];
+				const Point3m n  = (f.cP(1) - f.cP(0)) ^ (f.cP(2) - f.cP(0));
+				if ((p - hit.point) * n < 0)
+					blocks[b].push_back(std::make_pair(p, hit.dist));
+			}
+		}
+		for (int b = blockNum; b < blockNum + batch; ++b)
+			found += blocks[b].size();
+		blockNum += batch;
+		// not a closed surface
+		if (found == 0 && blockNum >= 1024)
+			break;
+	}
+
+	const int n = int(std::min<long long>(found, sampleNum));
+	if (n == 0)
+		return;
+	CMeshO::VertexIterator vi = tri::Allocator<CMeshO>::AddVertices(out, n);
+	int k = 0;
+	for (int b = 0; b < blockNum && k < n; ++b)
+		for (size_t i = 0; i < blocks[b].size() && k < n; ++i, ++k, ++vi) {
+			vi->P() = blocks[b][i].first;
+			vi->Q() = blocks[b][i].second;
+		}
+	tri::UpdateBounding<CMeshO>::Box(out);
+}
+
+/*
+ * Multi source distance with a bucketed frontier. The sources start at
+ * distance zero; the vertices updated in a round whose distance is below the
+ * current limit form the frontier of the next round, the others wait for the
+ * limit to grow to their bucket. Within a round the neighbours of the frontier
+ * pull their distance from their own neighbours in parallel, then the improved
+ * ones are committed. If region is given, the distance only moves between
+ * vertices of the same region.
+ */
+void ParallelVoronoi::propagate(
+	const std::vector<int>& sources,
+	const std::vector<int>* region,
+	std::vector<Scalarm>&   dist,
+	std::vector<int>&       src) const
+{
+	const int vn = int(mesh.vert.size());
+	dist.assign(vn, INF);
+	src.assign(vn, -1);
+	std::vector<int> frontier, pending;
+	for (size_t i = 0; i < sources.size(); ++i) {
+		const int v = sources[i];
+		if (mesh.vert[v].IsD() || src[v] != -1)
+			continue;
+		dist[v] = 0;
+		src[v]  = int(i);
+		frontier.push_back(v);
+	}
+
+	std::vector<int>     stamp(vn, -1);
+	std::vector<int>     cand;
+	std::vector<Scalarm> candDist;
+	std::vector<int>     candSrc;
+	std::vector<char>    changed;
+	Scalarm limit = bucketWidth;
+	for (int round = 0;; ++round) {
+		if (frontier.empty()) {
+			Scalarm minDist = INF;
+			for (int v : pending)
+				minDist = std::min(minDist, dist[v]);
+			if (pending.empty())
+				break;
+			limit = (std::floor(minDist / bucketWidth) + 1) * bucketWidth;
+			std::vector<int> rest;
+			for (int v : pending)
+				(dist[v] < limit ? frontier : rest).push_back(v);
+			pending.swap(rest);
+		}
+
+		// the neighbours of the frontier, each one once
+		const int gatherNum = int((frontier.size() + GATHER_BLOCK - 1) / GATHER_BLOCK);
+		std::vector<std::vector<int>> gathered(gatherNum);
+		#pragma omp parallel for schedule(dynamic, 1)
+		for (int b = 0; b < gatherNum; ++b) {
+			const int end = std::min(int(frontier.size()), (b + 1) * GATHER_BLOCK);
+			for (int i = b * GATHER_BLOCK; i < end; ++i) {
+				const int u = frontier[i];
+				for (int j = vertFaceBegin[u]; j < vertFaceBegin[u + 1]; ++j) {
+					const int f = vertFace[j];
+					if (mesh.face[f].IsD())
+						continue;
+					for (int k = 0; k < 3; ++k) {
+						const int w = faceVert[3 * f + k];
+						if (w != u && (region == nullptr || (*region)[w] == (*region)[u]))
+							gathered[b].push_back(w);
+					}
+				}
+			}
+		}
+		cand.clear();
+		for (const std::vector<int>& g : gathered)
+			for (int w : g)
+				if (stamp[w] != round) {
+					stamp[w] = round;
+					cand.push_back(w);
+				}
+
+		const int cn = int(cand.size());
+		candDist.resize(cn);
+		candSrc.resize(cn);
+		changed.assign(cn, 0);
+		#pragma omp parallel for schedule(dynamic, 256)
+		for (int i = 0; i < cn; ++i)
+			pull(cand[i], region, dist, src, candDist[i], candSrc[i]);
+		#pragma omp parallel for schedule(static)
+		for (int i = 0; i < cn; ++i) {
+			const int w = cand[i];
+			// a relative tolerance, so that the rounding of the unfolding
+			// does not keep a vertex bouncing between two values
+			if (candDist[i] < dist[w] - dist[w] * Scalarm(1e-6)) {
+				dist[w]    = candDist[i];
+				src[w]     = candSrc[i];
+				changed[i] = 1;
+			}
+		}
+
+		frontier.clear();
+		for (int i = 0; i < cn; ++i)
+			if (changed[i])
+				(dist[cand[i]] < limit ? frontier : pending).push_back(cand[i]);
+	}
+}
+
+// the best distance that v gets from its neighbours
+void ParallelVoronoi::pull(
+	int                         v,
+	const std::vector<int>*     region,
+	const std::vector<Scalarm>& dist,
+	const std::vector<int>&     src,
+	Scalarm&                    bestDist,
+	int&                        bestSrc) const
+{
+	bestDist = INF;
+	bestSrc  = -1;
+	auto consider = [&](Scalarm d, int s) {
+		if (d < bestDist || (d == bestDist && s < bestSrc)) {
+			bestDist = d;
+			bestSrc  = s;
+		}
+	};
+	for (int j = vertFaceBegin[v]; j < vertFaceBegin[v + 1]; ++j) {
+		const int f = vertFace[j];
+		if (mesh.face[f].IsD())
+			continue;
+		int k = 0;
+		while (faceVert[3 * f + k] != v)
+			++k;
+		const int a = faceVert[3 * f + (k + 1) % 3];
+		const int b = faceVert[3 * f + (k + 2) % 3];
+		const Scalarm lav = edgeLength[3 * f + k];
+		const Scalarm lab = edgeLength[3 * f + (k + 1) % 3];
+		const Scalarm lbv = edgeLength[3 * f + (k + 2) % 3];
+		const bool reachedA = src[a] >= 0 && (region == nullptr || (*region)[a] == (*region)[v]);
+		const bool reachedB = src[b] >= 0 && (region == nullptr || (*region)[b] == (*region)[v]);
+		if (reachedA)
+			consider(dist[a] + lav, src[a]);
+		if (reachedB)
+			consider(dist[b] + lbv, src[b]);
+		if (reachedA && reachedB && src[a] == src[b]) {
+			const Scalarm d = unfold(dist[a], dist[b], lab, lav, lbv);
+			if (d >= 0)
+				consider(d, src[a]);
+		}
+	}
+}
+
+// the vertices of each region, sorted by index, with a parallel counting sort
+void ParallelVoronoi::gatherRegions(int regionNum)
+{
+	const int vn = int(mesh.vert.size());
+	std::vector<int> count(size_t(REGION_SORT_BLOCKS) * regionNum, 0);
+	#pragma omp parallel for schedule(static, 1)
+	for (int b = 0; b < REGION_SORT_BLOCKS; ++b) {
+		int* c = count.data() + size_t(b) * regionNum;
+		for (int i = int((long long) vn * b / REGION_SORT_BLOCKS); i < int((long long) vn * (b + 1) / REGION_SORT_BLOCKS); ++i)
+			if (!mesh.vert[i].IsD() && seedIndex[i] >= 0)
+				++c[seedIndex[i]];
+	}
+
+	regionBegin.assign(regionNum + 1, 0);
+	#pragma omp parallel for schedule(static)
+	for (int r = 0; r < regionNum; ++r)
+		for (int b = 0; b < REGION_SORT_BLOCKS; ++b)
+			regionBegin[r + 1] += count[size_t(b) * regionNum + r];
+	for (int r = 0; r < regionNum; ++r)
+		regionBegin[r + 1] += regionBegin[r];
+	// count becomes the position of the first vertex of each (block, region)
+	#pragma omp parallel for schedule(static)
+	for (int r = 0; r < regionNum; ++r) {
+		int pos = regionBegin[r];
+		for (int b = 0; b < REGION_SORT_BLOCKS; ++b) {
+			const int c = count[size_t(b) * regionNum + r];
+			count[size_t(b) * regionNum + r] = pos;
+			pos += c;
+		}
+	}
+
+	regionVert.resize(regionBegin[regionNum]);
+	#pragma omp parallel for schedule(static, 1)
+	for (int b = 0; b < REGION_SORT_BLOCKS; ++b) {
+		int* c = count.data() + size_t(b) * regionNum;
+		for (int i = int((long long) vn * b / REGION_SORT_BLOCKS); i < int((long long) vn * (b + 1) / REGION_SORT_BLOCKS); ++i)
+			if (!mesh.vert[i].IsD() && seedIndex[i] >= 0)
+				regionVert[c[seedIndex[i]]++] = i;
+	}
+}
+
+// distance of each vertex from the border of its region, inside the region
+std::vector<Scalarm> ParallelVoronoi::borderDistance() const
+{
+	const int vn = int(mesh.vert.size());
+	std::vector<char> onBorder(vn, 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < vn; ++i) {
+		if (mesh.vert[i].IsD() || seedIndex[i] < 0)
+			continue;
+		for (int j = vertFaceBegin[i]; j < vertFaceBegin[i + 1] && !onBorder[i]; ++j) {
+			const int f = vertFace[j];
+			if (mesh.face[f].IsD())
+				continue;
+			for (int k = 0; k < 3; ++k)
+				if (seedIndex[faceVert[3 * f + k]] != seedIndex[i])
+					onBorder[i] = 1;
+		}
+	}
+	std::vector<int> sources;
+	for (int i = 0; i < vn; ++i)
+		if (onBorder[i])
+			sources.push_back(i);
+
+	std::vector<Scalarm> dist;
+	std::vector<int> src;
+	propagate(sources, &seedIndex, dist, src);
+	return dist;
+}
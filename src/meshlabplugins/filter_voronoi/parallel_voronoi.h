@@ -0,0 +1,153 @@
+/****************************************************************************
+ * MeshLab                                                           o o     *
+ * A versatile mesh processing toolbox                             o     o   *
+ *                                                                _   O  _   *
+ * Copyright(C) 2005                                                \/)\/    *
+ * Visual Computing Lab                                            /\/|      *
+ * ISTI - Italian National Research Council                           |      *
+ *                                                                    \      *
+ * All rights reserved.                                                      *
+ *                                                                           *
+ * This program is free software; you can redistribute it and/or modify      *
+ * it under the terms of the GNU General Public License as published by      *
+ * the Free Software Foundation; either version 2 of the License, or         *
+ * (at your option) any later version.                                       *
+ *                                                                           *
+ * This program is distributed in the hope that it will be useful,           *
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of            *
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the             *
+ * GNU General Public License (http://www.gnu.org/licenses/gpl.txt)          *
+ * for more details.                                                         *
+ *                                                                           *
+ ****************************************************************************/
+
+
+#ifndef FILTER_VORONOI_PARALLEL_VORONOI_H
+#define FILTER_VORONOI_PARALLEL_VORONOI_H
+
+#include <vector>
+
+#include <common/ml_document/cmesh.h>
+
+/*
+Voronoi partitioning and Lloyd relaxation over the vertices of a mesh, as
+vcg::tri::VoronoiProcessing::VoronoiRelaxing, with every step parallel.
+
+The distance from the seeds is propagated as in vcg::tri::Geodesic (along the
+edges and unfolding the triangles whose two other vertices belong to the same
+region) but with a bucketed frontier: the vertices are settled by buckets of
+distance, and inside a bucket all the neighbours of the frontier are updated in
+parallel, each one from the current distance of its own neighbours. Since every
+round only reads the values of the previous one, the partition does not depend
+on the number of threads.
+
+The metric is given by the length of the edges of each face, computed once by
+setMetric with one of the distance functors of vcg::tri::Geodesic.
+
+The vertices of each region are gathered with a parallel counting sort, then the
+new seed of every region (the vertex nearest to its barycenter, or the one
+farthest from its border) is searched in parallel.
+*/
+class ParallelVoronoi
+{
+public:
+	// as the color strategies of vcg::tri::VoronoiProcessingParameter
+	enum ColorStrategy { NONE = 0, SEED_DISTANCE = 1, BORDER_DISTANCE = 2, REGION_AREA = 3 };
+
+	ParallelVoronoi(CMeshO& m);
+
+	template <class DistanceFunctor>
+	void setMetric(DistanceFunctor& df);
+
+	// assigns every vertex to its nearest seed: the distance is stored in the
+	// quality and the seed in the "sources" per vertex attribute, as
+	// vcg::tri::VoronoiProcessing::ComputePerVertexSources
+	void computeSources(const std::vector<CVertexO*>& seeds);
+
+	// deletes the vertices not reached by any seed, and their faces, and
+	// updates the topology of the mesh
+	int deleteUnreachedRegions();
+
+	// one Lloyd step on the partition of the last computeSources; returns
+	// the number of moved seeds
+	int relax(std::vector<CVertexO*>& seeds, bool geodesicRelaxFlag);
+
+	// moves each seed, with the given probability, to the vertex of its region
+	// nearest to a random point at distance amount*bbox diagonal from it
+	void perturbSeeds(
+		std::vector<CVertexO*>& seeds,
+		Scalarm                 probability,
+		Scalarm                 amount,
+		unsigned int            randomSeed,
+		int                     iteration);
+
+	void colorize(int colorStrategy);
+
+	// Montecarlo sampling of the volume enclosed by a mesh: sampleNum points
+	// inside it, with the distance from the surface as quality; the random
+	// numbers are drawn by blocks of points with independent streams, so the
+	// result depends only on randomSeed
+	static void montecarloVolume(const CMeshO& m, int sampleNum, unsigned int randomSeed, CMeshO& out);
+
+private:
+	void buildAdjacency();
+	void propagate(
+		const std::vector<int>& sources,
+		const std::vector<int>* region,
+		std::vector<Scalarm>&   dist,
+		std::vector<int>&       src) const;
+	void pull(
+		int                         v,
+		const std::vector<int>*     region,
+		const std::vector<Scalarm>& dist,
+		const std::vector<int>&     src,
+		Scalarm&                    bestDist,
+		int&                        bestSrc) const;
+	void gatherRegions(int regionNum);
+	std::vector<Scalarm> borderDistance() const;
+
+	CMeshO& mesh;
+
+	std::vector<int>     faceVert;      // 3 vertex indices per face
+	std::vector<int>     vertFaceBegin; // vertex -> incident faces
+	std::vector<int>     vertFace;
+	std::vector<Scalarm> edgeLength;    // edge (i, i+1) of each face
+	Scalarm              bucketWidth = 0;
+
+	// the last partition
+	std::vector<Scalarm> seedDist;
+	std::vector<int>     seedIndex;
+	std::vector<int>     regionBegin; // region -> its vertices
+	std::vector<int>     regionVert;
+};
+
+template <class DistanceFunctor>
+void ParallelVoronoi::setMetric(DistanceFunctor& df)
+{
+	const int fn = int(mesh.face.size());
+	edgeLength.assign(3 * size_t(fn), 0);
+	#pragma omp parallel for schedule(static)
+	for (int i = 0; i < fn; ++i) {
+		CFaceO& f = mesh.face[i];
+		if (f.IsD())
+			continue;
+		for (int k = 0; k < 3; ++k)
+			edgeLength[3 * i + k] = df(f.V(k), f.V((k + 1) % 3));
+	}
+
+	// a few edges per bucket: large enough to give each round a wide
+	// frontier, small enough to seldom update a vertex twice
+	double sum = 0;
+	long long cnt = 0;
+	for (int i = 0; i < fn; ++i)
+		if (!mesh.face[i].IsD())
+			for (int k = 0; k < 3; ++k) {
+				sum += edgeLength[3 * i + k];
+				++cnt;
+			}
+	bucketWidth = cnt > 0 ? Scalarm(4 * sum / cnt) : Scalarm(1);
+	if (!(bucketWidth > 0))
+		bucketWidth = 1;
+}
+
+#endif // FILTER_VORONOI_PARALLEL_VORONOI_H
@@ -688,6 +688,29 @@ void BaseMeshIOPlugin::exportMaskCapability(const QString &format, int &capabili
 
 }
 
+/*
+	PLY, STL and OFF importers/exporters work only on the given mesh and file
+	name, therefore different files can be loaded/saved concurrently.
+	OBJ is excluded since its importer keeps some global state.
+*/
+bool BaseMeshIOPlugin::isOpenReentrant(const QString& format) const
+{
+	return format.toUpper() == tr("PLY") || format.toUpper() == tr("STL") ||
+		   format.toUpper() == tr("OFF");
+}
+
+bool BaseMeshIOPlugin::isSaveReentrant(const QString& format) const
+{
+	return format.toUpper() == tr("PLY") || format.toUpper() == tr("STL") ||
+		   format.toUpper() == tr("OFF");
+}
+
+// images are loaded by QImage or by loadTga, that use only local data
+bool BaseMeshIOPlugin::isOpenImageReentrant(const QString&) const
+{
+	return true;
+}
+
 RichParameterList BaseMeshIOPlugin::initSaveParameter(const QString &format, const MeshModel &m) const
 {
 	RichParameterList par;
@@ -100,6 +100,10 @@ public:
 	RichParameterList initPreOpenParameter(const QString &formatName) const;
 	RichParameterList initSaveParameter(const QString &format, const MeshModel &/*m*/) const;
 
+	bool isOpenReentrant(const QString& format) const;
+	bool isSaveReentrant(const QString& format) const;
+	bool isOpenImageReentrant(const QString& format) const;
+
 private:
 	QImage loadTga(const char* filePath);
 };
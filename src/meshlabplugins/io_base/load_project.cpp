@@ -1,5 +1,7 @@
 #include "load_project.h"
 
+#include <iterator>
+
 #include <QDir>
 
 #include <wrap/io_trimesh/alnParser.h>
@@ -22,24 +24,29 @@ std::vector<MeshModel*> loadALN(
 		throw MLException("Unable to open ALN file");
 	}
 	QFileInfo fi(filename);
-	QString curr_path = QDir::currentPath();
-	QDir::setCurrent(fi.absolutePath());
-
-	for(const RangeMap& rm : rmv) {
-		QString relativeToProj = fi.absoluteDir().absolutePath() + "/" + rm.filename.c_str();
-		try {
-			std::list<MeshModel*> tmp =
-					meshlab::loadMeshWithStandardParameters(relativeToProj, md, cb);
-			md.mm()->cm.Tr.Import(rm.transformation);
-			meshList.insert(meshList.end(), tmp.begin(), tmp.end());
-		}
-		catch (const MLException& e){
-			for (const MeshModel* m : meshList)
-				md.delMesh(m->id());
-			throw e;
+	QStringList meshFiles;
+	for(const RangeMap& rm : rmv)
+		meshFiles.push_back(fi.absoluteDir().absolutePath() + "/" + rm.filename.c_str());
+
+	// all the range maps are loaded together, then the transformations are set
+	std::vector<QString> errors;
+	std::vector<std::list<MeshModel*>> loaded =
+			meshlab::loadMeshesWithStandardParameters(meshFiles, md, errors, cb);
+
+	QString errorString;
+	for (unsigned int i = 0; i < rmv.size(); ++i) {
+		for (MeshModel* m : loaded[i]) {
+			m->cm.Tr.Import(rmv[i].transformation);
+			meshList.push_back(m);
 		}
+		if (!errors[i].isEmpty())
+			errorString += errors[i] + "\n";
+	}
+	if (!errorString.isEmpty()) {
+		for (const MeshModel* m : meshList)
+			md.delMesh(m->id());
+		throw MLException(errorString);
 	}
-	QDir::setCurrent(curr_path);
 	return meshList;
 }
 
@@ -48,7 +55,7 @@ std::vector<MeshModel*> loadOUT(
 		const QString& imageListFile,
 		MeshDocument& md,
 		std::vector<std::string>& unloadedImgList,
-		vcg::CallBackPos*)
+		vcg::CallBackPos* cb)
 {
 	std::vector<MeshModel*> meshList;
 	unloadedImgList.clear();
@@ -77,16 +84,18 @@ std::vector<MeshModel*> loadOUT(
 	}
 
 
+	std::vector<QString> errors;
+	std::vector<QImage> images =
+			meshlab::loadImages(image_filenames_q.mid(0, int(shots.size())), errors, nullptr, cb);
+
 	for(size_t i=0 ; i<shots.size() ; i++)
 	{
 		md.addNewRaster();
 		const QString fullpath_image_filename = image_filenames_q[int(i)];
 
-		QImage img(":/img/dummy.png");
-		try {
-			img = meshlab::loadImage(fullpath_image_filename);
-		}
-		catch(const MLException& e){
+		QImage img = images[i];
+		if (!errors[i].isEmpty()){
+			img = QImage(":/img/dummy.png");
 			unloadedImgList.push_back(fullpath_image_filename.toStdString());
 		}
 
@@ -112,7 +121,7 @@ std::vector<MeshModel*> loadNVM(
 		const QString& filename,
 		MeshDocument& md,
 		std::vector<std::string>& unloadedImgList,
-		vcg::CallBackPos*)
+		vcg::CallBackPos* cb)
 {
 	std::vector<MeshModel*> meshList;
 	unloadedImgList.clear();
@@ -133,18 +142,20 @@ std::vector<MeshModel*> loadNVM(
 	for(size_t i  = 0; i < image_filenames.size(); ++i)
 		image_filenames_q.push_back(QString::fromStdString(image_filenames[int(i)]));
 
+	std::vector<QString> errors;
+	std::vector<QImage> images =
+			meshlab::loadImages(image_filenames_q.mid(0, int(shots.size())), errors, nullptr, cb);
+
 	for(size_t i=0 ; i<shots.size() ; i++){
 		md.addNewRaster();
 		const QString fullpath_image_filename = image_filenames_q[int(i)];
-		QImage img(":/img/dummy.png");
-		try {
-			img = meshlab::loadImage(fullpath_image_filename);
-		}
-		catch(const MLException& e){
+		QImage img = images[i];
+		if (!errors[i].isEmpty()){
+			img = QImage(":/img/dummy.png");
 			unloadedImgList.push_back(fullpath_image_filename.toStdString());
 		}
 
-		md.rm()->addPlane(new RasterPlane(fullpath_image_filename,RasterPlane::RGBA));
+		md.rm()->addPlane(new RasterPlane(img, fullpath_image_filename,RasterPlane::RGBA));
 		md.rm()->setLabel(image_filenames_q[int(i)].section('/',1,2));
 		md.rm()->shot = shots[int(i)];
 	}
@@ -160,7 +171,7 @@ std::vector<MeshModel*> loadMLP(
 		MeshDocument& md,
 		std::vector<MLRenderingData>& rendOpt,
 		std::vector<std::string>& unloadedImgList,
-		vcg::CallBackPos*)
+		vcg::CallBackPos* cb)
 {
 	std::vector<MeshModel*> meshList;
 	unloadedImgList.clear();
@@ -188,48 +199,72 @@ std::vector<MeshModel*> loadMLP(
 	//Devices
 	while (!node.isNull()) {
 		if (QString::compare(node.nodeName(), "MeshGroup") == 0) {
-			QDomNode mesh;
-			QString filen, label;
-			mesh = node.firstChild();
-			while (!mesh.isNull()) {
-				//return true;
-				filen = mesh.attributes().namedItem("filename").nodeValue();
-				label = mesh.attributes().namedItem("label").nodeValue();
-				bool visible = true;
-				if (mesh.attributes().contains("visible"))
-					visible = (mesh.attributes().namedItem("visible").nodeValue().toInt() == 1);
-				//MeshModel* mm = md.addNewMesh(filen, label);
-
-				//mm->visible = visible;
-
+			// all the files of the group are loaded together, then the
+			// properties of each layer are read
+			std::vector<QDomNode> meshNodes;
+			std::vector<int> idsInFile;
+			QStringList files;
+			for (QDomNode mesh = node.firstChild(); !mesh.isNull(); mesh = mesh.nextSibling()) {
 				int idInFile = -1;
 				if (mesh.attributes().contains("idInFile")){
 					idInFile = mesh.attributes().namedItem("idInFile").nodeValue().toInt();
 				}
-				if (idInFile <= 0){
-					//load the file just if it is the first layer contained
-					//in the file (or it is the only one)
-					try {
-						auto tmp = meshlab::loadMeshWithStandardParameters(filen, md);
-						for (auto m : tmp){
-							m->setVisible(visible);
-							m->setLabel(label);
-						}
-						meshList.insert(meshList.end(), tmp.begin(), tmp.end());
-					}
-					catch(const MLException& e) {
-						for (MeshModel* mm : meshList)
-							md.delMesh(mm->id());
-						throw MLException(filen + " mesh file not found.");
+				//load the file just if it is the first layer contained
+				//in the file (or it is the only one)
+				if (idInFile <= 0)
+					files.push_back(mesh.attributes().namedItem("filename").nodeValue());
+				meshNodes.push_back(mesh);
+				idsInFile.push_back(idInFile);
+			}
+
+			std::vector<QString> errors;
+			std::vector<std::list<MeshModel*>> loaded =
+					meshlab::loadMeshesWithStandardParameters(files, md, errors, cb);
+
+			QString errorString;
+			for (unsigned int i = 0; i < loaded.size(); ++i) {
+				meshList.insert(meshList.end(), loaded[i].begin(), loaded[i].end());
+				if (!errors[i].isEmpty())
+					errorString += files[i] + " mesh file not found.\n";
+			}
+			if (!errorString.isEmpty()) {
+				for (MeshModel* mm : meshList)
+					md.delMesh(mm->id());
+				QDir::setCurrent(tmpDir.absolutePath());
+				throw MLException(errorString);
+			}
+
+			int fileIndex = -1;
+			for (unsigned int k = 0; k < meshNodes.size(); ++k) {
+				const QDomNode& mesh = meshNodes[k];
+				QString label = mesh.attributes().namedItem("label").nodeValue();
+				bool visible = true;
+				if (mesh.attributes().contains("visible"))
+					visible = (mesh.attributes().namedItem("visible").nodeValue().toInt() == 1);
+
+				// the layer described by this node
+				MeshModel* mm = nullptr;
+				if (idsInFile[k] <= 0) {
+					++fileIndex;
+					for (MeshModel* m : loaded[fileIndex]){
+						m->setVisible(visible);
+						m->setLabel(label);
 					}
+					if (!loaded[fileIndex].empty())
+						mm = loaded[fileIndex].front();
+				}
+				else if (fileIndex >= 0 && (unsigned int) idsInFile[k] < loaded[fileIndex].size()) {
+					mm = *std::next(loaded[fileIndex].begin(), idsInFile[k]);
+					mm->setVisible(visible);
+					mm->setLabel(label);
 				}
 
 				QDomNode tr = mesh.firstChildElement("MLMatrix44");
 
-				if (!tr.isNull()) {
+				if (!tr.isNull() && mm != nullptr) {
 					if (tr.childNodes().size() == 1) {
 						if (!binary) {
-							Scalarm* v = md.mm()->cm.Tr.V();
+							Scalarm* v = mm->cm.Tr.V();
 							const QStringList rows = tr.firstChild().nodeValue().split("\n", Qt::SkipEmptyParts);
 							unsigned int i = 0;
 							for (const QString& row: rows) {
@@ -243,7 +278,7 @@ std::vector<MeshModel*> loadMLP(
 						else {
 							QString str = tr.firstChild().nodeValue();
 							QByteArray value = QByteArray::fromBase64(str.toLocal8Bit());
-							memcpy(md.mm()->cm.Tr.V(), value.data(), sizeof(Matrix44m::ScalarType) * 16);
+							memcpy(mm->cm.Tr.V(), value.data(), sizeof(Matrix44m::ScalarType) * 16);
 						}
 					}
 				}
@@ -282,13 +317,15 @@ std::vector<MeshModel*> loadMLP(
 					if (data.deserialize(value.toStdString()))
 						rendOpt.push_back(data);
 				}
-
-				mesh = mesh.nextSibling();
 			}
 		}
 		// READ IN POINT CORRESPONDECES INCOMPLETO!!
 		else if (QString::compare(node.nodeName(), "RasterGroup") == 0)
 		{
+			// all the planes of the group are loaded together, after
+			// creating the rasters
+			std::vector<RasterModel*> planeRasters;
+			QStringList planeFiles;
 			QDomNode raster;
 			raster = node.firstChild();
 			while (!raster.isNull())
@@ -305,19 +342,23 @@ std::vector<MeshModel*> loadMLP(
 				{
 					QString filen = el.attribute("fileName");
 					QFileInfo fi(filen);
-					QString nm = fi.absoluteFilePath();
-					QImage img(":/img/dummy.png");
-					try {
-						img = meshlab::loadImage(nm);
-					}
-					catch(const MLException& e){
-						unloadedImgList.push_back(nm.toStdString());
-					}
-					md.rm()->addPlane(new RasterPlane(img, nm, RasterPlane::RGBA));
-					el = node.nextSiblingElement("Plane");
+					planeRasters.push_back(md.rm());
+					planeFiles.push_back(fi.absoluteFilePath());
+					el = el.nextSiblingElement("Plane");
 				}
 				raster = raster.nextSibling();
 			}
+
+			std::vector<QString> errors;
+			std::vector<QImage> images = meshlab::loadImages(planeFiles, errors, nullptr, cb);
+			for (unsigned int i = 0; i < planeRasters.size(); ++i) {
+				QImage img = images[i];
+				if (!errors[i].isEmpty()){
+					img = QImage(":/img/dummy.png");
+					unloadedImgList.push_back(planeFiles[i].toStdString());
+				}
+				planeRasters[i]->addPlane(new RasterPlane(img, planeFiles[i], RasterPlane::RGBA));
+			}
 		}
 		node = node.nextSibling();
 	}